@@ -36,10 +36,25 @@ using namespace hal;
  * alignment depth.
  */
 
-/** Print the alignment depth wiggle for a subrange of a given sequence to
- * the output stream. */
-static void printSequence(ostream &outStream, const Sequence *sequence, const set<const Genome *> &targetSet, hal_size_t start,
-                          hal_size_t length, hal_size_t step, bool countDupes, bool noAncestors);
+/** A chunk of the positions of a sequence subrange to print, the first of
+ * which also prints the wiggle header for the subrange.  Chunks are printed
+ * in parallel. */
+struct DepthChunk {
+    const Sequence *_sequence;
+    hal_size_t _start;
+    hal_size_t _last;
+    hal_size_t _firstPosition;
+    hal_size_t _numPositions;
+    bool _header;
+};
+
+/** Split a subrange of a given sequence into chunks of positions to print */
+static void addSequenceChunks(vector<DepthChunk> &chunks, const Sequence *sequence, hal_size_t start, hal_size_t length,
+                              hal_size_t step);
+
+/** Print the alignment depth wiggle for a chunk of positions */
+static void printChunk(string &output, const DepthChunk &chunk, const set<const Genome *> &targetSet, hal_size_t step,
+                       bool countDupes, bool noAncestors);
 
 /** If given genome-relative coordinates, map them to a series of
  * sequence subranges */
@@ -49,6 +64,9 @@ static void printGenome(ostream &outStream, const Genome *genome, const Sequence
 
 static const hal_size_t StringBufferSize = 1024;
 
+/** Number of bases covered by a chunk of positions */
+static const hal_size_t ChunkBases = 100000;
+
 static void initParser(CLParser &optionsParser) {
     /** It is convenient to use the HAL command line parser for the command
      * line because it automatically adds some comman options.  Using the
@@ -210,10 +228,10 @@ int main(int argc, char **argv) {
 }
 
 /** Given a Sequence (chromosome) and a (sequence-relative) coordinate
- * range, print the alignmability wiggle with respect to the genomes
- * in the target set */
-void printSequence(ostream &outStream, const Sequence *sequence, const set<const Genome *> &targetSet, hal_size_t start,
-                   hal_size_t length, hal_size_t step, bool countDupes, bool noAncestors) {
+ * range, split the positions to print into chunks that can be printed
+ * independently */
+void addSequenceChunks(vector<DepthChunk> &chunks, const Sequence *sequence, hal_size_t start, hal_size_t length,
+                       hal_size_t step) {
     hal_size_t seqLen = sequence->getSequenceLength();
     if (seqLen == 0) {
         return;
@@ -230,9 +248,23 @@ void printSequence(ostream &outStream, const Sequence *sequence, const set<const
                             std::to_string(seqLen));
     }
 
-    const Genome *genome = sequence->getGenome();
-    string sequenceName = sequence->getName();
-    string genomeName = genome->getName();
+    /** With a step, positions run up to and including last (unless the
+     * range is a single base) */
+    hal_size_t numPositions = step == 1 || length == 1 ? length : length / step + 1;
+    hal_size_t chunkPositions = max(ChunkBases / step, hal_size_t(1));
+    for (const pair<hal_size_t, hal_size_t> &range : splitRange(0, numPositions, chunkPositions)) {
+        DepthChunk chunk = {sequence, start, last, range.first, range.second, range.first == 0};
+        chunks.push_back(chunk);
+    }
+}
+
+/** Given a chunk of positions in a sequence (chromosome) range, print the
+ * alignmability wiggle with respect to the genomes in the target set */
+void printChunk(string &output, const DepthChunk &chunk, const set<const Genome *> &targetSet, hal_size_t step,
+                bool countDupes, bool noAncestors) {
+    const Sequence *sequence = chunk._sequence;
+    hal_size_t start = chunk._start;
+    hal_size_t last = chunk._last;
 
     /** The ColumnIterator is fundamental structure used in this example to
      * traverse the alignment.  It essientially generates the multiple alignment
@@ -240,20 +272,46 @@ void printSequence(ostream &outStream, const Sequence *sequence, const set<const
      * sequence).  Since this is the sequence interface, the positions
      * are sequence relative.  Note that we must specify the last position
      * in advance when we get the iterator.  This will limit it following
-     * duplications out of the desired range while we are iterating. */
-    hal_size_t pos = start;
-    ColumnIteratorPtr colIt = sequence->getColumnIterator(&targetSet, 0, pos, last - 1, false, noAncestors);
-    // note wig coordinates are 1-based for some reason so we shift to right
-    outStream << "fixedStep chrom=" << sequenceName << " start=" << start + 1 << " step=" << step << "\n";
+     * duplications out of the desired range while we are iterating.
+     * Columns don't depend on the ones visited before them, so each chunk
+     * can start its own iterator. */
+    hal_size_t pos = start + chunk._firstPosition * step;
+    ColumnIteratorPtr colIt =
+        sequence->getColumnIterator(&targetSet, 0, step == 1 ? pos : start, last - 1, false, noAncestors);
+    if (chunk._header) {
+        // note wig coordinates are 1-based for some reason so we shift to right
+        output += "fixedStep chrom=" + sequence->getName() + " start=" + std::to_string(start + 1) +
+                  " step=" + std::to_string(step) + "\n";
+    }
 
     /** Since the column iterator stores coordinates in Genome coordinates
      * internally, we have to switch back to genome coordinates.  */
     // convert to genome coordinates
+    start += sequence->getStartPosition();
     pos += sequence->getStartPosition();
     last += sequence->getStartPosition();
     // keep track of unique genomes
     set<const Genome *> genomeSet;
-    while (pos <= last) {
+    for (hal_size_t k = 0; k < chunk._numPositions; ++k, pos += step) {
+        if (step == 1) {
+            if (k > 0) {
+                /** Move the iterator one position to the right */
+                colIt->toRight();
+
+                /** This is some tuning code that will probably be hidden from
+                 * the interface at some point.  It is a good idea to use for now
+                 * though */
+                // erase empty entries from the column.  helps when there are
+                // millions of sequences (ie from fastas with lots of scaffolds)
+                if (pos % 1000 == 0) {
+                    colIt->defragment();
+                }
+            }
+        } else if (pos != start) {
+            /** Reset the iterator to a non-contiguous position */
+            colIt->toSite(pos, last);
+        }
+
         genomeSet.clear();
         hal_size_t count = 0;
         /** ColumnIterator::ColumnMap maps a Sequence to a list of bases
@@ -277,33 +335,7 @@ void printSequence(ostream &outStream, const Sequence *sequence, const set<const
         // don't want to include reference base in output
         --count;
 
-        outStream << count << '\n';
-
-        /** lastColumn checks if we are at the last column (inclusive)
-         * in range.  So we need to check at end of iteration instead
-         * of beginning (which would be more convenient).  Need to
-         * merge global fix from other branch */
-        if (colIt->lastColumn() == true) {
-            break;
-        }
-
-        pos += step;
-        if (step == 1) {
-            /** Move the iterator one position to the right */
-            colIt->toRight();
-
-            /** This is some tuning code that will probably be hidden from
-             * the interface at some point.  It is a good idea to use for now
-             * though */
-            // erase empty entries from the column.  helps when there are
-            // millions of sequences (ie from fastas with lots of scaffolds)
-            if (pos % 1000 == 0) {
-                colIt->defragment();
-            }
-        } else {
-            /** Reset the iterator to a non-contiguous position */
-            colIt->toSite(pos, last);
-        }
+        output += std::to_string(count) + '\n';
     }
 }
 
@@ -317,8 +349,9 @@ void printSequence(ostream &outStream, const Sequence *sequence, const set<const
  * be 0 for ChrA and 500 for ChrB) */
 void printGenome(ostream &outStream, const Genome *genome, const Sequence *sequence, const set<const Genome *> &targetSet,
                  hal_size_t start, hal_size_t length, hal_size_t step, bool countDupes, bool noAncestors) {
+    vector<DepthChunk> chunks;
     if (sequence != NULL) {
-        printSequence(outStream, sequence, targetSet, start, length, step, countDupes, noAncestors);
+        addSequenceChunks(chunks, sequence, start, length, step);
     } else {
         if (start + length > genome->getSequenceLength()) {
             throw hal_exception("Specified range [" + std::to_string(start) + "," + std::to_string(length) + "] is" +
@@ -339,9 +372,18 @@ void printGenome(ostream &outStream, const Genome *genome, const Sequence *seque
                 hal_size_t readStart = seqStart >= start ? 0 : start - seqStart;
                 hal_size_t readLen = min(seqLen - readStart, length);
                 readLen = min(readLen, length - runningLength);
-                printSequence(outStream, sequence, targetSet, readStart, readLen, step, countDupes, noAncestors);
+                // the iterator's sequence is only valid until it moves on, so
+                // keep the genome's own
+                addSequenceChunks(chunks, genome->getSequence(sequence->getName()), readStart, readLen, step);
                 runningLength += readLen;
             }
         }
     }
+
+    /** Chunks are printed in parallel, and written out in order */
+    parallelOrderedOutput(
+        chunks.size(),
+        [&](size_t i, string &output) { printChunk(output, chunks[i], targetSet, step, countDupes, noAncestors); },
+        [&](const string &output) { outStream.write(output.data(), output.size()); },
+        getReadThreadPool(genome->getAlignment()));
 }
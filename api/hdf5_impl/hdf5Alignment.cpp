@@ -42,9 +42,19 @@ const hsize_t Hdf5Alignment::DefaultChunkSize = 1000;
 const hsize_t Hdf5Alignment::DefaultCompression = 2;
 const hsize_t Hdf5Alignment::DefaultCacheMDCElems = 113;
 const hsize_t Hdf5Alignment::DefaultCacheRDCElems = 599999;
-const hsize_t Hdf5Alignment::DefaultCacheRDCBytes = 15728640;
+const hsize_t Hdf5Alignment::DefaultCacheRDCBytes = 268435456;
 const double Hdf5Alignment::DefaultCacheW0 = 0.75;
 const bool Hdf5Alignment::DefaultInMemory = false;
+const hsize_t Hdf5Alignment::DefaultReadAheadBuffers = 4;
+const hsize_t Hdf5Alignment::DefaultChunkBytes = 65536;
+const hsize_t Hdf5Alignment::SequentialChunkScale = 4;
+const char *const Hdf5Alignment::SharedCacheDirEnvVar = "HAL_HDF5_SHARED_CACHE_DIR";
+
+/* shared chunk directory to use when not given one */
+static string getDefaultSharedCacheDir() {
+    const char *dirPath = getenv(Hdf5Alignment::SharedCacheDirEnvVar);
+    return (dirPath != NULL) ? dirPath : "";
+}
 
 /* check if first bit of file has HDF5 header */
 bool hal::Hdf5Alignment::isHdf5File(const std::string &initialBytes) {
@@ -67,13 +77,15 @@ Hdf5Alignment::Hdf5Alignment(const string &alignmentPath, unsigned mode, const H
                              const H5::FileAccPropList &fileAccessProps, const H5::DSetCreatPropList &datasetCreateProps,
                              bool inMemory)
     : _alignmentPath(alignmentPath), _mode(halDefaultAccessMode(mode)), _file(NULL), _flags(hdf5DefaultFlags(_mode)),
-      _inMemory(inMemory), _metaData(NULL), _tree(NULL), _dirty(false) {
+      _inMemory(inMemory), _printCacheStats(false), _readAheadBuffers(DefaultReadAheadBuffers), _chunkBytes(0),
+      _adoptChunking(true), _metaData(NULL), _tree(NULL), _dirty(false), _sharedCacheDir(getDefaultSharedCacheDir()) {
     _cprops.copy(fileCreateProps);
     _aprops.copy(fileAccessProps);
     _dcprops.copy(datasetCreateProps);
     if (_inMemory) {
         setInMemory();
     }
+    initChunkCache();
     if (_mode & CREATE_ACCESS) {
         create();
     } else {
@@ -83,16 +95,27 @@ Hdf5Alignment::Hdf5Alignment(const string &alignmentPath, unsigned mode, const H
 
 Hdf5Alignment::Hdf5Alignment(const std::string &alignmentPath, unsigned mode, const CLParser *parser)
     : _alignmentPath(alignmentPath), _mode(halDefaultAccessMode(mode)), _file(NULL), _flags(hdf5DefaultFlags(_mode)),
-      _inMemory(false), _metaData(NULL), _tree(NULL), _dirty(false) {
+      _inMemory(false), _printCacheStats(false), _readAheadBuffers(DefaultReadAheadBuffers), _chunkBytes(0),
+      _adoptChunking(true), _metaData(NULL), _tree(NULL), _dirty(false) {
     initializeFromOptions(parser);
     if (_inMemory) {
         setInMemory();
     }
+    initChunkCache();
     if (_mode & CREATE_ACCESS) {
         create();
     } else {
         open();
     }
+    // the tree is needed to check the genomes
+    string pinned = parser->getOption<string>("hdf5PinGenomes");
+    if (not pinned.empty()) {
+        pinGenomes(chopString(pinned, ","));
+    }
+    string pinnedSubtree = parser->getOption<string>("hdf5PinSubtree");
+    if (not pinnedSubtree.empty()) {
+        pinSubtree(pinnedSubtree);
+    }
 }
 
 Hdf5Alignment::~Hdf5Alignment() {
@@ -101,27 +124,59 @@ Hdf5Alignment::~Hdf5Alignment() {
 
 void Hdf5Alignment::defineOptions(CLParser *parser, unsigned mode) {
     if ((mode & CREATE_ACCESS) || (mode & WRITE_ACCESS)) {
-        parser->addOption("hdf5Chunk", "hdf5 chunk size", DefaultChunkSize);
+        parser->addOption("hdf5Chunk", "hdf5 chunk size in elements, used for every dataset instead of sizing "
+                                       "chunks per dataset with --hdf5ChunkBytes",
+                          DefaultChunkSize);
         parser->addOption("chunk", "obsolete name for --hdf5Chunk ", DefaultChunkSize);
 
+        parser->addOption("hdf5ChunkBytes", "target size in bytes of hdf5 chunks, from which the number of "
+                                            "elements per chunk is chosen for each dataset (defaults to the "
+                                            "setting recorded in the file when writing to an existing file)",
+                          DefaultChunkBytes);
+
         parser->addOption("hdf5Compression", "hdf5 compression factor [0:none - 9:max]", DefaultCompression);
         parser->addOption("deflate", "obsolete name for --hdf5Compression", DefaultCompression);
+
+        parser->addOption("hdf5Codec", "hdf5 compression codec [none, deflate, zstd, lz4].  zstd and lz4 shuffle "
+                                       "the bytes of segment arrays first, and need the HDF5 filter plugins (found "
+                                       "through HDF5_PLUGIN_PATH) to write and to read the file",
+                          Hdf5Codec::DefaultName);
     }
     parser->addOption("hdf5CacheMDC", "number of metadata slots in hdf5 cache", DefaultCacheMDCElems);
     parser->addOption("cacheMDC", "obsolete name for --hdf5CacheMDC ", DefaultCacheMDCElems);
 
-    parser->addOption("hdf5CacheRDC", "number of regular slots in hdf5 cache.  should be"
-                                      " a prime number ~= 10 * DefaultCacheRDCBytes / chunk",
+    parser->addOption("hdf5CacheRDC", "obsolete, the hdf5 chunk cache is replaced by the --hdf5CacheBytes cache",
                       DefaultCacheRDCElems);
     parser->addOption("cacheRDC", "obsolete name for --hdf5CacheRDC", Hdf5Alignment::DefaultCacheRDCElems);
 
-    parser->addOption("hdf5CacheBytes", "maximum size in bytes of regular hdf5 cache", DefaultCacheRDCBytes);
+    parser->addOption("hdf5CacheBytes", "maximum size in bytes of the cache of decompressed chunks, "
+                                        "shared by all genomes",
+                      DefaultCacheRDCBytes);
     parser->addOption("cacheBytes", "obsolete name for --hdf5CacheBytes", DefaultCacheRDCBytes);
 
-    parser->addOption("hdf5CacheW0", "w0 parameter for hdf5 cache", DefaultCacheW0);
+    parser->addOption("hdf5CacheW0", "obsolete, the hdf5 chunk cache is replaced by the --hdf5CacheBytes cache",
+                      DefaultCacheW0);
     parser->addOption("cacheW0", "obsolete name for --hdf5CacheW0", DefaultCacheW0);
 
+    parser->addOptionFlag("hdf5CacheStats", "print chunk cache statistics to stderr when closing the alignment", false);
+
+    parser->addOption("hdf5ReadAhead", "number of chunks to read ahead when reading an array sequentially, "
+                                       "decompressing them in parallel (when --numThreads is not 1)",
+                      DefaultReadAheadBuffers);
+
+    parser->addOption("hdf5SharedCacheDir", string("directory (for instance under /dev/shm) of decompressed chunks "
+                                                   "shared by the processes reading a file, so each chunk is only "
+                                                   "decompressed once (defaults to $") +
+                                                SharedCacheDirEnvVar + ")",
+                      getDefaultSharedCacheDir());
+
     parser->addOptionFlag("hdf5InMemory", "load all data in memory (and disable hdf5 cache)", DefaultInMemory);
+    parser->addOption("hdf5PinGenomes", "comma-separated genomes to load whole in memory when opened, and keep "
+                                        "loaded when closed, while the others are read through the cache",
+                      "");
+    parser->addOption("hdf5PinSubtree", "genome whose subtree (itself and all its descendants) is pinned in "
+                                        "memory as with --hdf5PinGenomes",
+                      "");
     parser->addOptionFlag("inMemory", "obsolete name for --hdf5InMemory", DefaultInMemory);
 }
 
@@ -135,11 +190,103 @@ void Hdf5Alignment::initializeFromOptions(const CLParser *parser) {
         // these are only available on create
         hsize_t chunk = parser->getOptionAlt<hsize_t>("hdf5Chunk", "chunk");
         _dcprops.setChunk(1, &chunk);
+        // an explicit chunk size is used for every dataset, otherwise
+        // chunks are sized per dataset
+        bool fixedChunk = parser->specifiedOption("hdf5Chunk") or parser->specifiedOption("chunk");
+        _chunkBytes = fixedChunk ? 0 : parser->getOption<hsize_t>("hdf5ChunkBytes");
+        _adoptChunking = not(fixedChunk or parser->specifiedOption("hdf5ChunkBytes"));
         _dcprops.setDeflate(parser->getOptionAlt<hsize_t>("hdf5Compression", "deflate"));
+        setCodec(
+            Hdf5Codec(parser->getOption<string>("hdf5Codec"), parser->getOptionAlt<hsize_t>("hdf5Compression", "deflate")));
     }
     _aprops.setCache(
         parser->getOptionAlt<hsize_t>("hdf5CacheMDC", "cacheMDC"), parser->getOptionAlt<hsize_t>("hdf5CacheRDC", "cacheRDC"),
         parser->getOptionAlt<hsize_t>("hdf5CacheBytes", "cacheBytes"), parser->getOptionAlt<double>("hdf5CacheW0", "cacheW0"));
+    _printCacheStats = parser->getFlag("hdf5CacheStats");
+    _readAheadBuffers = parser->getOption<hsize_t>("hdf5ReadAhead");
+    _sharedCacheDir = parser->getOption<string>("hdf5SharedCacheDir");
+    _ioStatsPath = parser->getOption<string>("ioStats");
+    checkIoStatsPath(_ioStatsPath);
+}
+
+void Hdf5Alignment::setCodec(const Hdf5Codec &codec) {
+    if (not codec.isAvailable()) {
+        throw hal_exception("hdf5 codec " + codec.getName() + " needs the HDF5 " + codec.getName() +
+                            " filter plugin, which was not found (check HDF5_PLUGIN_PATH)");
+    }
+    _codec = codec;
+}
+
+void Hdf5Alignment::setChunkBytes(hsize_t chunkBytes) {
+    _chunkBytes = chunkBytes;
+    if ((_file != NULL) and not isReadOnly()) {
+        writeChunking();
+    }
+}
+
+/* Arrays of sequences are read through in order when a genome's
+ * sequences are loaded, so they get bigger chunks.  Otherwise, the
+ * target trades compression (bigger chunks) against the data
+ * decompressed for a random access (smaller chunks), and gives small
+ * genomes a single chunk per array. */
+hsize_t Hdf5Alignment::getChunkSize(Hdf5Codec::DatasetType datasetType, hsize_t elementSize, hsize_t numElements) const {
+    if (_chunkBytes == 0) {
+        return 0;
+    }
+    hsize_t targetBytes = _chunkBytes;
+    if ((datasetType == Hdf5Codec::SequenceIndexDataset) or (datasetType == Hdf5Codec::SequenceNameDataset)) {
+        targetBytes *= SequentialChunkScale;
+    }
+    // chunks of one element are not supported
+    hsize_t chunkSize = max(targetBytes / max(elementSize, hsize_t(1)), hsize_t(2));
+    return min(chunkSize, max(numElements, hsize_t(2)));
+}
+
+/* adopt the chunk sizing recorded in the file, if any.  It is kept with
+ * the version rather than in a group of its own, since groups at the top
+ * of the file share their names with the genomes. */
+void Hdf5Alignment::readChunking() {
+    try {
+        HDF5DisableExceptionPrinting prDisable;
+        _file->openGroup(VersionGroupName);
+    } catch (Exception &e) {
+        return;
+    }
+    HDF5MetaData chunkingMeta(_file, VersionGroupName);
+    if (chunkingMeta.has("chunkBytes")) {
+        _chunkBytes = strtoull(chunkingMeta.get("chunkBytes").c_str(), NULL, 10);
+    }
+    if (chunkingMeta.has("chunkSize") and (_dcprops.getLayout() == H5D_CHUNKED)) {
+        hsize_t chunk = strtoull(chunkingMeta.get("chunkSize").c_str(), NULL, 10);
+        if (chunk > 0) {
+            _dcprops.setChunk(1, &chunk);
+        }
+    }
+}
+
+/* record the chunk sizing of new datasets.  The chunks actually used are
+ * in each dataset's properties, this is the setting that chose them. */
+void Hdf5Alignment::writeChunking() {
+    HDF5MetaData chunkingMeta(_file, VersionGroupName);
+    chunkingMeta.set("chunkBytes", std::to_string(_chunkBytes));
+    hsize_t chunk = 0;
+    if (_dcprops.getLayout() == H5D_CHUNKED) {
+        _dcprops.getChunk(1, &chunk);
+    }
+    chunkingMeta.set("chunkSize", std::to_string(chunk));
+}
+
+/* size our chunk cache from the hdf5 chunk cache size in the access
+ * properties, and turn the hdf5 chunk cache off.  It is per-dataset, so
+ * would use the whole size for every array read, and our arrays always
+ * read whole chunks, which hdf5 doesn't need to cache. */
+void Hdf5Alignment::initChunkCache() {
+    int mdc;
+    size_t rdc, rdcb;
+    double w0;
+    _aprops.getCache(mdc, rdc, rdcb, w0);
+    _chunkCache.setMaxBytes(rdcb);
+    _aprops.setCache(mdc, rdc, 0, w0);
 }
 
 /* set properties for in-memory access */
@@ -165,6 +312,7 @@ void Hdf5Alignment::create() {
     _tree = NULL;
     _dirty = true;
     writeVersion();
+    writeChunking();
 }
 
 void Hdf5Alignment::open() {
@@ -183,20 +331,65 @@ void Hdf5Alignment::open() {
         throw hal_exception("HAL API v" + HAL_VERSION + " incompatible with format v" + getVersion() + " HAL file.");
     }
     _metaData = new HDF5MetaData(_file, MetaGroupName);
+    // the file is only changed if chunk options were given
+    if (not isReadOnly()) {
+        if (_adoptChunking) {
+            readChunking();
+        } else {
+            writeChunking();
+        }
+    }
+    setSharedChunkDir(_sharedCacheDir);
     loadTree();
-    if (stTree_getNumNodes(_tree) > 199) {
-        // We disable the HDF5 chunk cache with large numbers of species
-        // (over 200 genomes, or 100 leaves with a binary tree), because
-        // every genome opened will cause several new chunk caches to be
-        // initialized. This causes massive memory usage (well over 17
-        // GB for just running halStats on a 250-genome alignment).
-        close();
-        delete _file;
-        _aprops.setCache(0, 0, 0, 0.);
-        _file = new H5File(_alignmentPath.c_str(), _flags, _cprops, _aprops);
-        delete _metaData;
-        _metaData = new HDF5MetaData(_file, MetaGroupName);
-        loadTree();
+}
+
+void Hdf5Alignment::getIoStats(IoStats &stats) const {
+    stats.merge(_closedIoStats);
+    for (map<string, Hdf5Genome *>::const_iterator mapIt = _openGenomes.begin(); mapIt != _openGenomes.end(); ++mapIt) {
+        mapIt->second->getIoStats(stats);
+    }
+    stats.addFile("cacheHits", _chunkCache.getNumHits());
+    stats.addFile("cacheMisses", _chunkCache.getNumMisses());
+    stats.addFile("cacheEvictions", _chunkCache.getNumEvictions());
+    stats.addFile("cachePeakBytes", _chunkCache.getPeakBytes());
+    stats.addFile("cacheMaxBytes", _chunkCache.getMaxBytes());
+    stats.addFile("chunksReadAhead", _chunkCache.getNumReadAhead());
+    stats.addFile("chunksReadAheadUsed", _chunkCache.getNumReadAheadUsed());
+    if (getSharedChunkDir() != NULL) {
+        stats.addFile("sharedChunksMapped", getSharedChunkDir()->getNumMapped());
+        stats.addFile("sharedChunkMisses", getSharedChunkDir()->getNumMisses());
+        stats.addFile("sharedChunksStored", getSharedChunkDir()->getNumStored());
+    }
+}
+
+void Hdf5Alignment::pinGenomes(const vector<string> &names) {
+    for (const string &name : names) {
+        if (_nodeMap.find(name) == _nodeMap.end()) {
+            throw hal_exception("can't pin genome " + name + ", which is not in the alignment");
+        }
+    }
+    _pinnedGenomes.insert(names.begin(), names.end());
+}
+
+void Hdf5Alignment::pinSubtree(const string &rootName) {
+    vector<string> names(1, rootName);
+    if (_nodeMap.find(rootName) != _nodeMap.end()) {
+        for (size_t i = 0; i < names.size(); i++) {
+            vector<string> childNames = getChildNames(names[i]);
+            names.insert(names.end(), childNames.begin(), childNames.end());
+        }
+    }
+    pinGenomes(names);
+}
+
+void Hdf5Alignment::setSharedChunkDir(const string &dirPath) {
+    if (not _openGenomes.empty()) {
+        throw hal_exception("the shared chunk directory can't be changed while genomes are open");
+    }
+    _sharedCacheDir = dirPath;
+    _sharedChunks.reset();
+    if (isReadOnly() and not dirPath.empty()) {
+        _sharedChunks.reset(new Hdf5SharedChunkDir(dirPath, _alignmentPath));
     }
 }
 
@@ -225,26 +418,45 @@ void Hdf5Alignment::close() {
             if (not isReadOnly()) {
                 genome->write();
             }
+            genome->getIoStats(_closedIoStats);
             delete genome;
         }
         _openGenomes.clear();
+        if (not _ioStatsPath.empty()) {
+            writeIoStatsOnClose(this, _alignmentPath, _ioStatsPath);
+        }
         if (not isReadOnly()) {
             _file->flush(H5F_SCOPE_LOCAL);
         }
         _file->close();
         delete _file;
         _file = NULL;
+        if (_printCacheStats) {
+            _chunkCache.printStats(cerr);
+            if (_sharedChunks != NULL) {
+                _sharedChunks->printStats(cerr);
+            }
+        }
     } else {
         assert(_tree == NULL);
         assert(_openGenomes.empty() == true);
     }
 }
 
+/* genome groups are at the top of the file, with the alignment's own
+ * groups, so can't have their names */
+void Hdf5Alignment::checkGenomeName(const string &name) {
+    if ((name == MetaGroupName) or (name == TreeGroupName) or (name == GenomesGroupName) or (name == VersionGroupName)) {
+        throw hal_exception("genome name " + name + " is reserved in HDF5 HAL files");
+    }
+}
+
 Genome *Hdf5Alignment::insertGenome(const string &name, const string &parentName, const string &childName,
                                     double upperBranchLength) {
     if (name.empty() == true || parentName.empty() || childName.empty()) {
         throw hal_exception("name can't be empty");
     }
+    checkGenomeName(name);
     map<string, stTree *>::iterator findIt = _nodeMap.find(name);
     if (findIt != _nodeMap.end()) {
         throw hal_exception("node " + name + " already exists");
@@ -268,7 +480,7 @@ Genome *Hdf5Alignment::insertGenome(const string &name, const string &parentName
     stTree_setParent(child, newNode);
     stTree_setBranchLength(child, lowerBranchLength);
 
-    Hdf5Genome *genome = new Hdf5Genome(name, this, _file, _dcprops, _inMemory);
+    Hdf5Genome *genome = new Hdf5Genome(name, this, _file, _dcprops, isPinned(name));
     _openGenomes.insert(pair<string, Hdf5Genome *>(name, genome));
     _dirty = true;
     return genome;
@@ -278,6 +490,7 @@ Genome *Hdf5Alignment::addLeafGenome(const string &name, const string &parentNam
     if (name.empty() == true || parentName.empty()) {
         throw hal_exception("name can't be empty");
     }
+    checkGenomeName(name);
     map<string, stTree *>::iterator findIt = _nodeMap.find(name);
     if (findIt != _nodeMap.end()) {
         throw hal_exception(string("node ") + name + " already exists");
@@ -293,7 +506,7 @@ Genome *Hdf5Alignment::addLeafGenome(const string &name, const string &parentNam
     stTree_setBranchLength(childNode, branchLength);
     _nodeMap.insert(pair<string, stTree *>(name, childNode));
 
-    Hdf5Genome *genome = new Hdf5Genome(name, this, _file, _dcprops, _inMemory);
+    Hdf5Genome *genome = new Hdf5Genome(name, this, _file, _dcprops, isPinned(name));
     _openGenomes.insert(pair<string, Hdf5Genome *>(name, genome));
     _dirty = true;
     return genome;
@@ -303,6 +516,7 @@ Genome *Hdf5Alignment::addRootGenome(const string &name, double branchLength) {
     if (name.empty() == true) {
         throw hal_exception("name can't be empty");
     }
+    checkGenomeName(name);
     map<string, stTree *>::iterator findIt = _nodeMap.find(name);
     if (findIt != _nodeMap.end()) {
         throw hal_exception(string("node ") + name + " already exists");
@@ -316,7 +530,7 @@ Genome *Hdf5Alignment::addRootGenome(const string &name, double branchLength) {
     _tree = node;
     _nodeMap.insert(pair<string, stTree *>(name, node));
 
-    Hdf5Genome *genome = new Hdf5Genome(name, this, _file, _dcprops, _inMemory);
+    Hdf5Genome *genome = new Hdf5Genome(name, this, _file, _dcprops, isPinned(name));
     _openGenomes.insert(pair<string, Hdf5Genome *>(name, genome));
     _dirty = true;
     return genome;
@@ -425,7 +639,7 @@ Genome *Hdf5Alignment::openGenome(const string &name) {
     }
     Hdf5Genome *genome = NULL;
     if (_nodeMap.find(name) != _nodeMap.end()) {
-        genome = new Hdf5Genome(name, this, _file, _dcprops, _inMemory);
+        genome = new Hdf5Genome(name, this, _file, _dcprops, isPinned(name));
         _openGenomes.insert(pair<string, Hdf5Genome *>(name, genome));
     }
     return genome;
@@ -438,7 +652,11 @@ void Hdf5Alignment::closeGenome(const Genome *genome) const {
         throw hal_exception("Attempt to close non-open genome.  "
                             "Should not even be possible");
     }
+    if (isReadOnly() and (_pinnedGenomes.find(name) != _pinnedGenomes.end())) {
+        return; // kept loaded until the alignment is closed
+    }
     mapIt->second->write();
+    mapIt->second->getIoStats(_closedIoStats);
     delete mapIt->second;
     _openGenomes.erase(mapIt);
 
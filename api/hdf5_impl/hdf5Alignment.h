@@ -10,10 +10,15 @@
 
 #include "halAlignmentInstance.h"
 #include "hdf5Alignment.h"
+#include "hdf5ChunkCache.h"
+#include "hdf5Codec.h"
 #include "hdf5Genome.h"
 #include "hdf5MetaData.h"
+#include "hdf5SharedChunkDir.h"
 #include <H5Cpp.h>
 #include <map>
+#include <memory>
+#include <set>
 
 typedef struct _stTree stTree;
 
@@ -83,6 +88,90 @@ namespace hal {
 
         void replaceNewickTree(const std::string &newNewickString);
 
+        /** Get the cache of decompressed chunks shared by all the genomes */
+        Hdf5ChunkCache *getChunkCache() const {
+            return &_chunkCache;
+        }
+
+        /** Get the number of chunks arrays read ahead when read
+         * sequentially.  Chunks are only read ahead from read-only
+         * alignments, as they are read from the file bypassing the
+         * buffers of arrays being modified. */
+        hsize_t getReadAheadBuffers() const {
+            return (_mode & (CREATE_ACCESS | WRITE_ACCESS)) ? 0 : _readAheadBuffers;
+        }
+
+        /** Get the codec new datasets are compressed with */
+        const Hdf5Codec &getCodec() const {
+            return _codec;
+        }
+
+        /** Set the codec new datasets are compressed with, for genomes
+         * created afterwards */
+        void setCodec(const Hdf5Codec &codec);
+
+        /** Get the target size in bytes of the chunks of new datasets,
+         * or 0 if they use the chunk size of the dataset creation
+         * properties */
+        hsize_t getChunkBytes() const {
+            return _chunkBytes;
+        }
+
+        /** Set the target size in bytes of the chunks of datasets
+         * created afterwards (0 for the chunk size of the dataset
+         * creation properties).  The setting is recorded in the file,
+         * and used by later writes that don't set it. */
+        void setChunkBytes(hsize_t chunkBytes);
+
+        /** Get the number of elements per chunk of a new dataset, or 0
+         * if chunks are not sized per dataset.  Chunks hold about
+         * getChunkBytes() bytes, more for the arrays read sequentially,
+         * and never more than the whole array.
+         * @param datasetType the kind of dataset
+         * @param elementSize size in bytes of an element
+         * @param numElements number of elements in the dataset */
+        hsize_t getChunkSize(Hdf5Codec::DatasetType datasetType, hsize_t elementSize, hsize_t numElements) const;
+
+        /** Get the directory of decompressed chunks shared with other
+         * processes reading the file, or NULL if none.  Only read-only
+         * alignments share chunks. */
+        Hdf5SharedChunkDir *getSharedChunkDir() const {
+            return (_mode & (CREATE_ACCESS | WRITE_ACCESS)) ? NULL : _sharedChunks.get();
+        }
+
+        /** Set the directory of decompressed chunks shared with other
+         * processes (empty for none), before any genome is opened */
+        void setSharedChunkDir(const std::string &dirPath);
+
+        /** Set the number of chunks arrays read ahead when read
+         * sequentially (0 for none), for genomes opened afterwards */
+        void setReadAheadBuffers(hsize_t readAheadBuffers) {
+            _readAheadBuffers = readAheadBuffers;
+        }
+
+        /** Pin genomes: their arrays are loaded whole and decompressed
+         * in memory when they are opened, rather than read through the
+         * chunk cache, and in a read-only alignment they stay loaded when
+         * closed, until the alignment is.  Genomes already open are not
+         * affected.
+         * @param names genomes to pin, which must be in the tree */
+        void pinGenomes(const std::vector<std::string> &names);
+
+        /** Pin a genome and all its descendants (see pinGenomes)
+         * @param rootName root of the subtree to pin */
+        void pinSubtree(const std::string &rootName);
+
+        /** Check if a genome is loaded in memory when opened, because
+         * it's pinned or the whole alignment is in memory */
+        bool isPinned(const std::string &name) const {
+            return _inMemory or (_pinnedGenomes.find(name) != _pinnedGenomes.end());
+        }
+
+        /** Add I/O statistics: the counters of each array of the genomes
+         * opened (see Hdf5ExternalArray::getIoStats()), and those of the
+         * chunk cache and shared chunk directory for the file */
+        void getIoStats(IoStats &stats) const;
+
       private:
         // FIXME: should these be private?
         void loadTree();
@@ -100,6 +189,9 @@ namespace hal {
         void create();
         void open();
         void setInMemory();
+        void initChunkCache();
+        void readChunking();
+        void writeChunking();
 
       public:
         static const hsize_t DefaultChunkSize;
@@ -109,11 +201,19 @@ namespace hal {
         static const hsize_t DefaultCacheRDCBytes;
         static const double DefaultCacheW0;
         static const bool DefaultInMemory;
+        static const hsize_t DefaultReadAheadBuffers;
+        static const hsize_t DefaultChunkBytes;
+        static const hsize_t SequentialChunkScale;
+        static const char *const SharedCacheDirEnvVar;
 
         static const H5std_string MetaGroupName;
         static const H5std_string TreeGroupName;
         static const H5std_string GenomesGroupName;
         static const H5std_string VersionGroupName;
+
+        /** Throw if a genome can't be given a name, because it is used by
+         * a group of the alignment */
+        static void checkGenomeName(const std::string &name);
         const std::string _alignmentPath;
 
       private:
@@ -122,6 +222,11 @@ namespace hal {
         H5::H5File *_file;
         int _flags;
         bool _inMemory;
+        bool _printCacheStats;
+        hsize_t _readAheadBuffers;
+        hsize_t _chunkBytes;
+        bool _adoptChunking;
+        Hdf5Codec _codec;
         H5::FileCreatPropList _cprops;
         H5::FileAccPropList _aprops;
         H5::DSetCreatPropList _dcprops;
@@ -130,6 +235,14 @@ namespace hal {
         mutable std::map<std::string, stTree *> _nodeMap;
         bool _dirty;
         mutable std::map<std::string, Hdf5Genome *> _openGenomes;
+        mutable Hdf5ChunkCache _chunkCache;
+        std::string _sharedCacheDir;
+        std::unique_ptr<Hdf5SharedChunkDir> _sharedChunks;
+        std::set<std::string> _pinnedGenomes;
+        /** Statistics of the genomes that have been closed */
+        mutable IoStats _closedIoStats;
+        /** File to write I/O statistics to when closing, if any */
+        std::string _ioStatsPath;
     };
 }
 #endif
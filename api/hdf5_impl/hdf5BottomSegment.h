@@ -17,6 +17,8 @@
 namespace hal {
 
     class Hdf5BottomSegment : public BottomSegment {
+        friend class Hdf5ToMMap;
+
       public:
         /** Constructor
         * @param genome Smart pointer to genome to which segment belongs
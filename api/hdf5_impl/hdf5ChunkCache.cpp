@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "hdf5ChunkCache.h"
+#include <algorithm>
+#include <iostream>
+
+using namespace hal;
+using namespace std;
+
+Hdf5ChunkCache::Hdf5ChunkCache(size_t maxBytes)
+    : _maxBytes(maxBytes), _numBytes(0), _peakBytes(0), _nextArrayId(0), _numHits(0), _numMisses(0), _numEvictions(0),
+      _numReadAhead(0), _numReadAheadUsed(0) {
+}
+
+void Hdf5ChunkCache::setMaxBytes(size_t maxBytes) {
+    lock_guard<mutex> guard(_lock);
+    _maxBytes = maxBytes;
+    evict(_maxBytes);
+}
+
+size_t Hdf5ChunkCache::getNumBytes() const {
+    lock_guard<mutex> guard(_lock);
+    return _numBytes;
+}
+
+size_t Hdf5ChunkCache::getPeakBytes() const {
+    lock_guard<mutex> guard(_lock);
+    return _peakBytes;
+}
+
+size_t Hdf5ChunkCache::registerArray() {
+    lock_guard<mutex> guard(_lock);
+    return _nextArrayId++;
+}
+
+void Hdf5ChunkCache::removeArray(size_t arrayId) {
+    lock_guard<mutex> guard(_lock);
+    map<Key, EntryList::iterator>::iterator indexIt = _index.lower_bound(Key(arrayId, 0));
+    while (indexIt != _index.end() and indexIt->first.first == arrayId) {
+        erase(indexIt++);
+    }
+}
+
+Hdf5ChunkCache::ChunkPtr Hdf5ChunkCache::find(size_t arrayId, hsize_t chunkIndex, MappedChunkPtr *mapped) {
+    lock_guard<mutex> guard(_lock);
+    if (mapped != NULL) {
+        mapped->reset();
+    }
+    map<Key, EntryList::iterator>::iterator indexIt = _index.find(Key(arrayId, chunkIndex));
+    if (indexIt == _index.end()) {
+        _numMisses++;
+        return ChunkPtr();
+    }
+    _numHits++;
+    // move to the front of the list
+    _entries.splice(_entries.begin(), _entries, indexIt->second);
+    if (mapped != NULL) {
+        *mapped = indexIt->second->_mapped;
+    }
+    return indexIt->second->_chunk;
+}
+
+void Hdf5ChunkCache::insert(size_t arrayId, hsize_t chunkIndex, const ChunkPtr &chunk) {
+    Entry entry = {Key(arrayId, chunkIndex), chunk, MappedChunkPtr(), chunk->size()};
+    insertEntry(entry);
+}
+
+void Hdf5ChunkCache::insertMapped(size_t arrayId, hsize_t chunkIndex, const MappedChunkPtr &mapped, size_t numBytes) {
+    Entry entry = {Key(arrayId, chunkIndex), ChunkPtr(), mapped, numBytes};
+    insertEntry(entry);
+}
+
+bool Hdf5ChunkCache::contains(size_t arrayId, hsize_t chunkIndex) const {
+    lock_guard<mutex> guard(_lock);
+    return _index.find(Key(arrayId, chunkIndex)) != _index.end();
+}
+
+void Hdf5ChunkCache::countReadAhead(size_t numRead, size_t numUsed) {
+    lock_guard<mutex> guard(_lock);
+    _numReadAhead += numRead;
+    _numReadAheadUsed += numUsed;
+}
+
+size_t Hdf5ChunkCache::getNumHits() const {
+    lock_guard<mutex> guard(_lock);
+    return _numHits;
+}
+
+size_t Hdf5ChunkCache::getNumMisses() const {
+    lock_guard<mutex> guard(_lock);
+    return _numMisses;
+}
+
+size_t Hdf5ChunkCache::getNumEvictions() const {
+    lock_guard<mutex> guard(_lock);
+    return _numEvictions;
+}
+
+size_t Hdf5ChunkCache::getNumReadAhead() const {
+    lock_guard<mutex> guard(_lock);
+    return _numReadAhead;
+}
+
+size_t Hdf5ChunkCache::getNumReadAheadUsed() const {
+    lock_guard<mutex> guard(_lock);
+    return _numReadAheadUsed;
+}
+
+void Hdf5ChunkCache::printStats(ostream &os) const {
+    lock_guard<mutex> guard(_lock);
+    os << "hdf5 chunk cache: " << _numHits << " hits, " << _numMisses << " misses, " << _numEvictions << " evictions, "
+       << _peakBytes << " peak bytes of " << _maxBytes << ", " << _numReadAhead << " chunks read ahead, "
+       << _numReadAheadUsed << " used" << endl;
+}
+
+/* add an entry, replacing any of the same chunk */
+void Hdf5ChunkCache::insertEntry(const Entry &entry) {
+    lock_guard<mutex> guard(_lock);
+    if (entry._numBytes > _maxBytes) {
+        return;
+    }
+    map<Key, EntryList::iterator>::iterator indexIt = _index.find(entry._key);
+    if (indexIt != _index.end()) {
+        erase(indexIt);
+    }
+    evict(_maxBytes - entry._numBytes);
+    _entries.push_front(entry);
+    _index[entry._key] = _entries.begin();
+    _numBytes += entry._numBytes;
+    _peakBytes = max(_peakBytes, _numBytes);
+}
+
+/* evict least recently used chunks until at most maxBytes are cached */
+void Hdf5ChunkCache::evict(size_t maxBytes) {
+    while (_numBytes > maxBytes) {
+        erase(_index.find(_entries.back()._key));
+        _numEvictions++;
+    }
+}
+
+void Hdf5ChunkCache::erase(map<Key, EntryList::iterator>::iterator indexIt) {
+    _numBytes -= indexIt->second->_numBytes;
+    _entries.erase(indexIt->second);
+    _index.erase(indexIt);
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HDF5CHUNKCACHE_H
+#define _HDF5CHUNKCACHE_H
+
+#include "halDefs.h"
+#include <H5Cpp.h>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace hal {
+
+    /**
+     * Least-recently-used cache of decompressed chunks, shared by all the
+     * Hdf5ExternalArrays of an alignment and limited to a total number of
+     * bytes.  This replaces the HDF5 chunk cache, which is per-dataset, so
+     * its memory use grew with the number of genomes opened.  Memory is
+     * only used for chunks that have actually been read.
+     *
+     * Each array registers for an id, and its chunks are cached under the
+     * id and the chunk's index in the array.  An array holds on to the
+     * chunk it is using, so chunks stay valid while in use even if the
+     * cache evicts them.
+     *
+     * A chunk can also be cached as a read-only image mapped from a file
+     * (see Hdf5SharedChunkDir), which counts towards the limit with its
+     * size like any other chunk, so the mappings of the chunks in use are
+     * kept rather than remade on every access.
+     */
+    class Hdf5ChunkCache {
+      public:
+        typedef std::shared_ptr<std::vector<char>> ChunkPtr;
+        typedef std::shared_ptr<const char> MappedChunkPtr;
+
+        /** Constructor
+         * @param maxBytes maximum number of bytes of chunks to keep (0
+         * disables caching) */
+        explicit Hdf5ChunkCache(size_t maxBytes = 0);
+
+        /** Set the maximum number of bytes of chunks to keep, evicting
+         * chunks if needed */
+        void setMaxBytes(size_t maxBytes);
+
+        /** Get the maximum number of bytes of chunks to keep */
+        size_t getMaxBytes() const {
+            return _maxBytes;
+        }
+
+        /** Get the number of bytes of chunks currently in the cache */
+        size_t getNumBytes() const;
+
+        /** Get the largest number of bytes of chunks that have been in the
+         * cache at once */
+        size_t getPeakBytes() const;
+
+        /** Get an id for a new array */
+        size_t registerArray();
+
+        /** Drop all the chunks of an array */
+        void removeArray(size_t arrayId);
+
+        /** Look up a chunk, counting a hit or miss
+         * @param arrayId id of the array
+         * @param chunkIndex index of the chunk in the array
+         * @param mapped set to the chunk if it is cached as a mapped
+         * image, and to NULL otherwise
+         * @return the chunk or NULL if not in the cache, or cached as a
+         * mapped image */
+        ChunkPtr find(size_t arrayId, hsize_t chunkIndex, MappedChunkPtr *mapped = NULL);
+
+        /** Add a chunk that has been read, evicting the least recently
+         * used chunks to stay within the limit.  Chunks larger than the
+         * limit are not cached.
+         * @param arrayId id of the array
+         * @param chunkIndex index of the chunk in the array
+         * @param chunk contents of the chunk */
+        void insert(size_t arrayId, hsize_t chunkIndex, const ChunkPtr &chunk);
+
+        /** Add a chunk mapped from a file, as insert()
+         * @param arrayId id of the array
+         * @param chunkIndex index of the chunk in the array
+         * @param mapped mapped contents of the chunk
+         * @param numBytes size of the chunk */
+        void insertMapped(size_t arrayId, hsize_t chunkIndex, const MappedChunkPtr &mapped, size_t numBytes);
+
+        /** Check if a chunk is in the cache, without counting a hit or
+         * miss or changing its position */
+        bool contains(size_t arrayId, hsize_t chunkIndex) const;
+
+        /** Count chunks that an array read ahead of being accessed, and
+         * read-ahead chunks that were then accessed */
+        void countReadAhead(size_t numRead, size_t numUsed);
+
+        /** Get the number of lookups that found their chunk */
+        size_t getNumHits() const;
+
+        /** Get the number of lookups that didn't find their chunk */
+        size_t getNumMisses() const;
+
+        /** Get the number of chunks evicted to stay within the limit */
+        size_t getNumEvictions() const;
+
+        /** Get the number of chunks read ahead of being accessed */
+        size_t getNumReadAhead() const;
+
+        /** Get the number of chunks read ahead that were accessed */
+        size_t getNumReadAheadUsed() const;
+
+        /** Print statistics to a stream */
+        void printStats(std::ostream &os) const;
+
+      private:
+        typedef std::pair<size_t, hsize_t> Key;
+        struct Entry {
+            Key _key;
+            ChunkPtr _chunk;
+            MappedChunkPtr _mapped;
+            size_t _numBytes;
+        };
+        typedef std::list<Entry> EntryList;
+
+        void insertEntry(const Entry &entry);
+        void evict(size_t maxBytes);
+        void erase(std::map<Key, EntryList::iterator>::iterator indexIt);
+
+        size_t _maxBytes;
+        size_t _numBytes;
+        size_t _peakBytes;
+        size_t _nextArrayId;
+        size_t _numHits;
+        size_t _numMisses;
+        size_t _numEvictions;
+        size_t _numReadAhead;
+        size_t _numReadAheadUsed;
+        /** Entries, most recently used first */
+        EntryList _entries;
+        std::map<Key, EntryList::iterator> _index;
+        mutable std::mutex _lock;
+
+        Hdf5ChunkCache(const Hdf5ChunkCache &);
+        Hdf5ChunkCache &operator=(const Hdf5ChunkCache &);
+    };
+}
+#endif
+// Local Variables:
+// mode: c++
+// End:
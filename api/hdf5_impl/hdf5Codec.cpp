@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "hdf5Codec.h"
+#include "halCommon.h"
+
+using namespace hal;
+using namespace std;
+using namespace H5;
+
+const string Hdf5Codec::DefaultName = "deflate";
+const H5Z_filter_t Hdf5Codec::ZstdFilterId = 32015;
+const H5Z_filter_t Hdf5Codec::Lz4FilterId = 32004;
+
+Hdf5Codec::Hdf5Codec(const string &name, unsigned level) : _name(name), _level(level) {
+    if ((_name != "none") and (_name != "deflate") and (_name != "zstd") and (_name != "lz4")) {
+        throw hal_exception("invalid hdf5 codec \"" + _name + "\", expected one of none, deflate, zstd or lz4");
+    }
+}
+
+bool Hdf5Codec::isAvailable() const {
+    if (_name == "zstd") {
+        return H5Zfilter_avail(ZstdFilterId) > 0;
+    } else if (_name == "lz4") {
+        return H5Zfilter_avail(Lz4FilterId) > 0;
+    } else {
+        return true;
+    }
+}
+
+/* DNA is packed in bytes and sequence names are strings, so shuffling
+ * bytes only helps the arrays of multi-byte integers.  The plugins are
+ * mandatory filters: writing fails rather than storing data
+ * uncompressed. */
+DSetCreatPropList Hdf5Codec::getDSetCreatPropList(const DSetCreatPropList &cparms, DatasetType datasetType) const {
+    DSetCreatPropList codecParms;
+    codecParms.copy(cparms);
+    if (_name == "deflate") {
+        return codecParms;
+    }
+    codecParms.removeFilter(H5Z_FILTER_ALL);
+    if (_name == "none") {
+        return codecParms;
+    }
+    if ((datasetType == SegmentDataset) or (datasetType == SequenceIndexDataset)) {
+        codecParms.setShuffle();
+    }
+    if (_name == "zstd") {
+        codecParms.setFilter(ZstdFilterId, H5Z_FLAG_MANDATORY, 1, &_level);
+    } else {
+        // lz4 has no level, its parameter is the block size (0 for the
+        // plugin's default)
+        unsigned blockSize = 0;
+        codecParms.setFilter(Lz4FilterId, H5Z_FLAG_MANDATORY, 1, &blockSize);
+    }
+    return codecParms;
+}
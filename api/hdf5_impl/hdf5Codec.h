@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HDF5CODEC_H
+#define _HDF5CODEC_H
+
+#include "halDefs.h"
+#include <H5Cpp.h>
+#include <string>
+
+namespace hal {
+
+    /**
+     * Compression codec for the datasets of new HDF5 alignments.  deflate
+     * (the default) is built into HDF5 and applies the dataset creation
+     * properties as given.  zstd and lz4 are HDF5 filter plugins, found
+     * through HDF5_PLUGIN_PATH, and apply the shuffle filter before
+     * compressing the arrays that it helps.  Files are read with whatever
+     * filters they were written with, so reading needs no option, only
+     * the plugin.
+     */
+    class Hdf5Codec {
+      public:
+        /** Kinds of dataset, which get their own filters */
+        enum DatasetType { DnaDataset, SegmentDataset, SequenceIndexDataset, SequenceNameDataset };
+
+        static const std::string DefaultName;
+        /** Filter ids registered with the HDF Group for the plugins */
+        static const H5Z_filter_t ZstdFilterId;
+        static const H5Z_filter_t Lz4FilterId;
+
+        /** Constructor
+         * @param name codec name: none, deflate, zstd or lz4
+         * @param level compression level, for deflate and zstd */
+        explicit Hdf5Codec(const std::string &name = DefaultName, unsigned level = 2);
+
+        /** Get the codec name */
+        const std::string &getName() const {
+            return _name;
+        }
+
+        /** Get the compression level */
+        unsigned getLevel() const {
+            return _level;
+        }
+
+        /** Check if files can be written with the codec, which needs the
+         * plugin for zstd and lz4 */
+        bool isAvailable() const;
+
+        /** Get the properties to create a type of dataset with.  The
+         * deflate codec uses the alignment's properties unchanged, the
+         * others replace their filters.
+         * @param cparms the alignment's dataset creation properties
+         * @param datasetType the kind of dataset */
+        H5::DSetCreatPropList getDSetCreatPropList(const H5::DSetCreatPropList &cparms, DatasetType datasetType) const;
+
+      private:
+        std::string _name;
+        unsigned _level;
+    };
+}
+
+#endif
+// Local Variables:
+// mode: c++
+// End:
@@ -10,9 +10,8 @@
 
 using namespace hal;
 
-HDF5DnaAccess::HDF5DnaAccess(Hdf5Genome *genome, Hdf5ExternalArray *dnaArray, hal_index_t index)
+HDF5DnaAccess::HDF5DnaAccess(Hdf5Genome *genome, Hdf5ExternalArray *dnaArray)
     : DnaAccess(0, 0, NULL), _dnaArray(dnaArray) {
-    fetch(index);
 }
 
 void HDF5DnaAccess::flush() {
@@ -13,17 +13,25 @@ namespace hal {
     class Hdf5ExternalArray;
 
     /**
-     * HDF5 implementation of DnaAccess.
+     * HDF5 implementation of DnaAccess.  Nothing is read until the first
+     * base is accessed.
      */
     class HDF5DnaAccess : public DnaAccess {
       public:
-        HDF5DnaAccess(Hdf5Genome *genome, Hdf5ExternalArray *dnaArray, hal_index_t index);
+        HDF5DnaAccess(Hdf5Genome *genome, Hdf5ExternalArray *dnaArray);
 
         virtual ~HDF5DnaAccess() {
         }
 
         void flush();
 
+        /* forget the buffer, so the next access fetches it again.  Used
+         * when something else has paged the array. */
+        void invalidate() {
+            _startIndex = _endIndex = 0;
+            _buffer = NULL;
+        }
+
       protected:
         virtual void fetch(hal_index_t index) const;
 
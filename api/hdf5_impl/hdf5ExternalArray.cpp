@@ -6,42 +6,308 @@
  */
 
 #include "hdf5ExternalArray.h"
+#include "halThreadPool.h"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
 #include <iostream>
+#include <mutex>
+#include <zlib.h>
 
 using namespace hal;
 using namespace H5;
 using namespace std;
 
+/* Work on the chunks of one buffer, done by whichever thread claims it
+ * first: a pool worker, or the array's thread when it needs the result
+ * before a worker has got to it.  HDF5 calls are only made by the array's
+ * thread, so tasks just encode or decode chunks in memory. */
+struct Hdf5ExternalArray::ChunkTask {
+    enum State { Queued, Running, Done };
+
+    ChunkTask() : _state(Queued) {
+    }
+    virtual ~ChunkTask() {
+    }
+
+    /** Queue the task on a pool */
+    static void submit(ThreadPool &pool, const shared_ptr<ChunkTask> &task) {
+        pool.submit([task]() {
+            if (task->claim()) {
+                task->runTask();
+            }
+        });
+    }
+
+    /** Run the task if no thread has claimed it yet, otherwise wait for
+     * it, and rethrow any exception it threw */
+    void finish() {
+        if (claim()) {
+            runTask();
+        } else {
+            unique_lock<mutex> guard(_lock);
+            _done.wait(guard, [this]() { return _state == Done; });
+        }
+        if (_exception) {
+            rethrow_exception(_exception);
+        }
+    }
+
+  protected:
+    virtual void run() = 0;
+
+  private:
+    bool claim() {
+        int expected = Queued;
+        return _state.compare_exchange_strong(expected, Running);
+    }
+    void runTask() {
+        try {
+            run();
+        } catch (...) {
+            _exception = current_exception();
+        }
+        lock_guard<mutex> guard(_lock);
+        _state = Done;
+        _done.notify_all();
+    }
+
+    atomic<int> _state;
+    exception_ptr _exception;
+    mutex _lock;
+    condition_variable _done;
+};
+
+/* A buffer being read ahead.  Its raw chunks are read from the file by the
+ * array's thread and decoded by the task. */
+struct Hdf5ExternalArray::ReadAhead : public ChunkTask {
+    struct RawChunk {
+        vector<char> _data;
+        uint32_t _filterMask;
+    };
+
+    ReadAhead(const shared_ptr<const FilterPipeline> &filters, size_t chunkBytes, size_t bufBytes)
+        : _filters(filters), _chunkBytes(chunkBytes), _bufBytes(bufBytes), _decodeSeconds(0) {
+    }
+
+    static void decodeChunk(const FilterPipeline &filters, uint32_t filterMask, vector<char> &data, size_t chunkBytes);
+
+    shared_ptr<const FilterPipeline> _filters;
+    /** Size of a decoded dataset chunk */
+    size_t _chunkBytes;
+    /** Size of the buffer, which may end partway through its last chunk */
+    size_t _bufBytes;
+    vector<RawChunk> _rawChunks;
+    Hdf5ChunkCache::ChunkPtr _buf;
+    /** Time taken to decode the chunks */
+    double _decodeSeconds;
+
+  protected:
+    void run();
+};
+
+/* A chunk waiting to be written.  The task encodes it, and the array's
+ * thread writes it to the file with a direct chunk write, in the order the
+ * chunks were queued. */
+struct Hdf5ExternalArray::ChunkWrite : public ChunkTask {
+    ChunkWrite(const shared_ptr<const FilterPipeline> &filters, hsize_t offset) : _filters(filters), _offset(offset) {
+    }
+
+    static void encodeChunk(const FilterPipeline &filters, vector<char> &data);
+
+    shared_ptr<const FilterPipeline> _filters;
+    /** Index of the chunk's first element in the array */
+    hsize_t _offset;
+    /** The chunk, padded to the full chunk size, then encoded */
+    vector<char> _data;
+
+  protected:
+    void run() {
+        encodeChunk(*_filters, _data);
+    }
+};
+
+/* undo HDF5's shuffle filter, which stores the first byte of every
+ * element, then the second, and so on.  Trailing bytes that don't make a
+ * whole element are left in place. */
+static void unshuffle(const vector<char> &data, size_t elementSize, vector<char> &decoded) {
+    decoded.resize(data.size());
+    size_t numElements = (elementSize > 1) ? data.size() / elementSize : 0;
+    for (size_t b = 0; b < elementSize and numElements > 0; b++) {
+        const char *src = data.data() + b * numElements;
+        for (size_t i = 0; i < numElements; i++) {
+            decoded[i * elementSize + b] = src[i];
+        }
+    }
+    memcpy(decoded.data() + numElements * elementSize, data.data() + numElements * elementSize,
+           data.size() - numElements * elementSize);
+}
+
+/* inflate a zlib stream, whose decoded size is only known for the last
+ * filter of the pipeline */
+static void inflateChunk(const vector<char> &data, size_t sizeHint, vector<char> &decoded) {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit(&stream) != Z_OK) {
+        throw hal_exception("error initializing zlib");
+    }
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+    stream.avail_in = data.size();
+    decoded.resize(max(sizeHint, data.size()));
+    int status = Z_OK;
+    while (status == Z_OK) {
+        if (stream.total_out == decoded.size()) {
+            decoded.resize(2 * decoded.size());
+        }
+        stream.next_out = reinterpret_cast<Bytef *>(decoded.data()) + stream.total_out;
+        stream.avail_out = decoded.size() - stream.total_out;
+        status = inflate(&stream, Z_NO_FLUSH);
+    }
+    decoded.resize(stream.total_out);
+    inflateEnd(&stream);
+    if (status != Z_STREAM_END) {
+        throw hal_exception("error inflating hdf5 chunk");
+    }
+}
+
+/* apply HDF5's shuffle filter, the inverse of unshuffle */
+static void shuffle(const vector<char> &data, size_t elementSize, vector<char> &encoded) {
+    encoded.resize(data.size());
+    size_t numElements = (elementSize > 1) ? data.size() / elementSize : 0;
+    for (size_t b = 0; b < elementSize and numElements > 0; b++) {
+        char *dest = encoded.data() + b * numElements;
+        for (size_t i = 0; i < numElements; i++) {
+            dest[i] = data[i * elementSize + b];
+        }
+    }
+    memcpy(encoded.data() + numElements * elementSize, data.data() + numElements * elementSize,
+           data.size() - numElements * elementSize);
+}
+
+/* deflate a chunk the same way as HDF5's deflate filter, which also calls
+ * compress2, so the chunks are the same as HDF5 would write */
+static void deflateChunk(const vector<char> &data, int level, vector<char> &encoded) {
+    uLongf encodedSize = compressBound(data.size());
+    encoded.resize(encodedSize);
+    if (compress2(reinterpret_cast<Bytef *>(encoded.data()), &encodedSize, reinterpret_cast<const Bytef *>(data.data()),
+                  data.size(), level) != Z_OK) {
+        throw hal_exception("error deflating hdf5 chunk");
+    }
+    encoded.resize(encodedSize);
+}
+
+/* apply the filter pipeline in reverse to a raw chunk, skipping the
+ * filters flagged in filterMask.  Like HDF5, we allow a chunk to decode to
+ * less than its full size, and zero the rest. */
+void Hdf5ExternalArray::ReadAhead::decodeChunk(const FilterPipeline &filters, uint32_t filterMask, vector<char> &data,
+                                               size_t chunkBytes) {
+    vector<char> decoded;
+    for (size_t f = filters.size(); f-- > 0;) {
+        if (filterMask & (1u << f)) {
+            continue;
+        }
+        if (filters[f]._id == H5Z_FILTER_DEFLATE) {
+            inflateChunk(data, chunkBytes, decoded);
+        } else {
+            assert(filters[f]._id == H5Z_FILTER_SHUFFLE);
+            unshuffle(data, filters[f]._params.empty() ? 1 : filters[f]._params[0], decoded);
+        }
+        data.swap(decoded);
+    }
+    if (data.size() > chunkBytes) {
+        throw hal_exception("hdf5 chunk is larger than expected after decoding");
+    }
+    data.resize(chunkBytes, 0);
+}
+
+/* apply the filter pipeline to a chunk */
+void Hdf5ExternalArray::ChunkWrite::encodeChunk(const FilterPipeline &filters, vector<char> &data) {
+    vector<char> encoded;
+    for (size_t f = 0; f < filters.size(); f++) {
+        if (filters[f]._id == H5Z_FILTER_DEFLATE) {
+            deflateChunk(data, filters[f]._params.empty() ? Z_DEFAULT_COMPRESSION : filters[f]._params[0], encoded);
+        } else {
+            assert(filters[f]._id == H5Z_FILTER_SHUFFLE);
+            shuffle(data, filters[f]._params.empty() ? 1 : filters[f]._params[0], encoded);
+        }
+        data.swap(encoded);
+    }
+}
+
+/* seconds elapsed since a time */
+static double secondsSince(const chrono::steady_clock::time_point &start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+void Hdf5ExternalArray::ReadAhead::run() {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    _buf.reset(new vector<char>(_bufBytes));
+    for (size_t j = 0; j < _rawChunks.size(); j++) {
+        decodeChunk(*_filters, _rawChunks[j]._filterMask, _rawChunks[j]._data, _chunkBytes);
+        size_t offset = j * _chunkBytes;
+        memcpy(_buf->data() + offset, _rawChunks[j]._data.data(), min(_chunkBytes, _bufBytes - offset));
+        vector<char>().swap(_rawChunks[j]._data);
+    }
+    _decodeSeconds = secondsSince(start);
+}
+
 /** Constructor */
 Hdf5ExternalArray::Hdf5ExternalArray()
-    : _file(NULL), _size(0), _chunkSize(0), _bufStart(0), _bufEnd(0), _bufSize(0), _buf(NULL), _dirty(false) {
+    : _file(NULL), _size(0), _chunkSize(0), _bufStart(0), _bufEnd(0), _bufSize(0), _buf(NULL), _ownBuf(NULL),
+      _cache(NULL), _cacheId(0), _sharedChunks(NULL), _readAheadBuffers(0), _datasetChunkSize(0), _lastBufIndex(0),
+      _parallelWrite(false), _dirty(false) {
 }
 
 /** Destructor */
 Hdf5ExternalArray::~Hdf5ExternalArray() {
-    delete[] _buf;
+    setCache(NULL);
+    delete[] _ownBuf;
 }
 
 /* initialize the internal data buffer */
 void Hdf5ExternalArray::initBuf() {
     _bufSize = _chunkSize > 1 ? _chunkSize : _size;
     _bufStart = 0;
-    _bufEnd = _bufSize - 1;
-    delete[] _buf;
-    _buf = new char[_bufSize * _dataSize];
+    _bufEnd = min(_bufSize, _size) - 1;
+    delete[] _ownBuf;
+    _ownBuf = NULL;
+    _cachedBuf.reset();
+    _mappedBuf.reset();
+    _readAheads.clear();
+    if (_cache == NULL) {
+        _ownBuf = new char[_bufSize * _dataSize]();
+    }
+    _buf = _ownBuf;
+}
+
+/* switch to a new cache (or none), dropping our buffers from the old one */
+void Hdf5ExternalArray::setCache(Hdf5ChunkCache *cache) {
+    if (_cache != NULL) {
+        _cache->removeArray(_cacheId);
+    }
+    _cache = cache;
+    if (_cache != NULL) {
+        _cacheId = _cache->registerArray();
+    }
 }
 
 // Create a new dataset in specifed location
 void Hdf5ExternalArray::create(PortableH5Location *file, const H5std_string &path, const DataType &dataType,
                                hsize_t numElements, const DSetCreatPropList *inCparms, hsize_t chunksInBuffer) {
     // copy in parameters
+    flushChunkWrites();
+    setCache(NULL);
+    _sharedChunks = NULL;
     _file = file;
     _path = path;
     _dataType = dataType;
     _size = numElements;
     _dataSize = _dataType.getSize();
     _dataSpace = DataSpace(1, &_size);
+    _readAheadBuffers = 0;
 
     DSetCreatPropList cparms;
     if (inCparms) {
@@ -61,6 +327,7 @@ void Hdf5ExternalArray::create(PortableH5Location *file, const H5std_string &pat
             _chunkSize = _size;
             cparms.setChunk(1, &_chunkSize);
         }
+        _datasetChunkSize = _chunkSize;
         _chunkSize *= chunksInBuffer;
     } else {
         _chunkSize = 0;
@@ -71,14 +338,17 @@ void Hdf5ExternalArray::create(PortableH5Location *file, const H5std_string &pat
 
     // create the hdf5 array
     _dataSet = _file->createDataSet(_path, _dataType, _dataSpace, cparms);
-    _chunkSpace = DataSpace(1, &_bufSize);
+    initParallelWrite();
     assert(getSize() == numElements);
     assert(_bufSize > 0 || _size == 0);
 }
 
 // Load an existing dataset into memory
-void Hdf5ExternalArray::load(PortableH5Location *file, const H5std_string &path, hsize_t chunksInBuffer) {
+void Hdf5ExternalArray::load(PortableH5Location *file, const H5std_string &path, hsize_t chunksInBuffer,
+                             Hdf5ChunkCache *cache, hsize_t readAheadBuffers, Hdf5SharedChunkDir *sharedChunks) {
     // load up the parameters
+    flushChunkWrites();
+    _parallelWrite = false;
     _file = file;
     _path = path;
     _dataSet = _file->openDataSet(_path);
@@ -92,8 +362,8 @@ void Hdf5ExternalArray::load(PortableH5Location *file, const H5std_string &path,
 
     // resolve chunking size (0 = do not chunk)
     if (cparms.getLayout() == H5D_CHUNKED) {
-        cparms.getChunk(1, &_chunkSize);
-        _chunkSize *= chunksInBuffer;
+        cparms.getChunk(1, &_datasetChunkSize);
+        _chunkSize = _datasetChunkSize * chunksInBuffer;
         if (_chunkSize == 1) {
             throw hal_exception("Hdf5ExternalArray::create: "
                                 "chunkSize of 1 not supported");
@@ -105,37 +375,369 @@ void Hdf5ExternalArray::load(PortableH5Location *file, const H5std_string &path,
     } else {
         _chunkSize = 0;
     }
+    // only paged arrays use the caches, others are read once
+    setCache(_chunkSize > 1 ? cache : NULL);
+    _sharedChunks = ((_chunkSize > 1) and (sharedChunks != NULL) and sharedChunks->isEnabled()) ? sharedChunks : NULL;
+    _datasetPath = (_sharedChunks != NULL) ? _dataSet.getObjName() : "";
     initBuf();
+    initReadAhead(cparms, readAheadBuffers);
     _bufStart = _bufEnd + 1; // set out of range to ensure page happens
-    _chunkSpace = DataSpace(1, &_bufSize);
     assert(_bufSize > 0 || _size == 0);
 }
 
 // Write the memory buffer back to the file
 void Hdf5ExternalArray::write() {
+    writeBuf();
+    flushChunkWrites();
+}
+
+/* write the buffer if it's dirty, or queue its chunks to be written when
+ * writing in parallel */
+void Hdf5ExternalArray::writeBuf() {
     if (_dirty) {
-        _dataSpace.selectHyperslab(H5S_SELECT_SET, &_bufSize, &_bufStart);
-        _dataSet.write(_buf, _dataType, _chunkSpace, _dataSpace);
+        hsize_t bufLen = _bufEnd - _bufStart + 1;
+        if (_parallelWrite) {
+            queueChunkWrites(bufLen);
+        } else {
+            _dataSpace.selectHyperslab(H5S_SELECT_SET, &bufLen, &_bufStart);
+            _dataSet.write(_buf, _dataType, DataSpace(1, &bufLen), _dataSpace);
+        }
         _dirty = false;
     }
 }
 
 // Page chunk containing index i into memory
 void Hdf5ExternalArray::page(hsize_t i) {
-    if (_dirty) {
-        write();
+    // any cached copy of the buffer is the buffer itself, so it's
+    // already up to date
+    writeBuf();
+    hsize_t bufIndex = i / _bufSize;
+    _bufStart = bufIndex * _bufSize;
+    _bufEnd = min(_bufStart + _bufSize, _size) - 1;
+    hsize_t bufLen = _bufEnd - _bufStart + 1;
+    // the file is out of date until chunks of the buffer queued for
+    // writing are written
+    for (const shared_ptr<ChunkWrite> &chunkWrite : _chunkWrites) {
+        if ((chunkWrite->_offset >= _bufStart) and (chunkWrite->_offset <= _bufEnd)) {
+            flushChunkWrites();
+            break;
+        }
     }
-    _bufStart = (i / _bufSize) * _bufSize; // todo: review
-    _bufEnd = _bufStart + _bufSize - 1;
 
-    if (_bufEnd >= _size) {
-        _bufEnd = _size - 1;
-        _bufSize = _bufEnd - _bufStart + 1;
-        _chunkSpace = DataSpace(1, &_bufSize);
+    _cachedBuf.reset();
+    _mappedBuf.reset();
+    _ioCounters._numPages++;
+    _ioCounters._pagedBytes += bufLen * _dataSize;
+    if (_cache != NULL) {
+        _cachedBuf = _cache->find(_cacheId, bufIndex, &_mappedBuf);
+        ((_cachedBuf != NULL or _mappedBuf != NULL) ? _ioCounters._numCacheHits : _ioCounters._numCacheMisses)++;
+    }
+    // a buffer decompressed by another process (or by us, then evicted)
+    // is mapped rather than decompressed again, its data left to the page
+    // cache and only its mapping kept in ours
+    if (_cachedBuf == NULL and _mappedBuf == NULL and _sharedChunks != NULL) {
+        _mappedBuf = _sharedChunks->map(_datasetPath, _bufStart * _dataSize, bufLen * _dataSize);
+        if (_mappedBuf != NULL) {
+            _ioCounters._numSharedChunkHits++;
+            if (_cache != NULL) {
+                _cache->insertMapped(_cacheId, bufIndex, _mappedBuf, bufLen * _dataSize);
+            }
+        }
+    }
+    bool decompressed = false;
+    if (_cachedBuf == NULL and _mappedBuf == NULL and not _readAheads.empty()) {
+        _cachedBuf = takeReadAhead(bufIndex);
+        if (_cachedBuf != NULL and _cache != NULL) {
+            _cache->insert(_cacheId, bufIndex, _cachedBuf);
+        }
+        decompressed = (_cachedBuf != NULL);
+    }
+    if (_cachedBuf == NULL and _mappedBuf == NULL and _cache != NULL) {
+        _cachedBuf.reset(new vector<char>(bufLen * _dataSize));
+        readBuf(_cachedBuf->data(), bufLen);
+        _cache->insert(_cacheId, bufIndex, _cachedBuf);
+        decompressed = true;
+    }
+    if (_mappedBuf != NULL) {
+        // only arrays that are not modified have shared buffers
+        _buf = const_cast<char *>(_mappedBuf.get());
+    } else if (_cachedBuf != NULL) {
+        _buf = _cachedBuf->data();
+    } else {
+        _buf = _ownBuf;
+        readBuf(_buf, bufLen);
+        decompressed = true;
+    }
+    if (decompressed and _sharedChunks != NULL) {
+        _sharedChunks->store(_datasetPath, _bufStart * _dataSize, _buf, bufLen * _dataSize);
     }
-
-    _dataSpace.selectHyperslab(H5S_SELECT_SET, &_bufSize, &_bufStart);
-    _dataSet.read(_buf, _dataType, _chunkSpace, _dataSpace);
     _dirty = false;
+    readAhead(bufIndex);
     assert(_bufSize > 0 || _size == 0);
 }
+
+/* read bufLen elements starting at _bufStart from the file */
+void Hdf5ExternalArray::readBuf(char *buf, hsize_t bufLen) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    _dataSpace.selectHyperslab(H5S_SELECT_SET, &bufLen, &_bufStart);
+    _dataSet.read(buf, _dataType, DataSpace(1, &bufLen), _dataSpace);
+    _ioCounters._numReads++;
+    _ioCounters._readBytes += bufLen * _dataSize;
+    _ioCounters._readSeconds += secondsSince(start);
+}
+
+void Hdf5ExternalArray::getIoStats(IoStats &stats, const string &genomeName, const string &arrayName) const {
+    stats.add(genomeName, arrayName, "pages", _ioCounters._numPages);
+    stats.add(genomeName, arrayName, "pagedBytes", _ioCounters._pagedBytes);
+    stats.add(genomeName, arrayName, "cacheHits", _ioCounters._numCacheHits);
+    stats.add(genomeName, arrayName, "cacheMisses", _ioCounters._numCacheMisses);
+    stats.add(genomeName, arrayName, "sharedChunkHits", _ioCounters._numSharedChunkHits);
+    stats.add(genomeName, arrayName, "readAheadHits", _ioCounters._numReadAheadHits);
+    stats.add(genomeName, arrayName, "reads", _ioCounters._numReads);
+    stats.add(genomeName, arrayName, "readBytes", _ioCounters._readBytes);
+    stats.add(genomeName, arrayName, "readSeconds", _ioCounters._readSeconds);
+    stats.add(genomeName, arrayName, "chunksReadAhead", _ioCounters._numChunksReadAhead);
+    stats.add(genomeName, arrayName, "readAheadBytes", _ioCounters._readAheadBytes);
+    stats.add(genomeName, arrayName, "decodeSeconds", _ioCounters._decodeSeconds);
+}
+
+/* get a dataset's filter pipeline, or NULL if it has filters that we
+ * can't encode and decode ourselves (only deflate and shuffle) */
+shared_ptr<const Hdf5ExternalArray::FilterPipeline> Hdf5ExternalArray::getFilters(const DSetCreatPropList &cparms) {
+    shared_ptr<FilterPipeline> filters(new FilterPipeline());
+    for (int f = 0; f < cparms.getNfilters(); f++) {
+        unsigned flags, config;
+        unsigned params[8];
+        size_t numParams = sizeof(params) / sizeof(params[0]);
+        char name[64];
+        Filter filter;
+        filter._id = cparms.getFilter(f, flags, numParams, params, sizeof(name), name, config);
+        if ((filter._id != H5Z_FILTER_DEFLATE) and (filter._id != H5Z_FILTER_SHUFFLE)) {
+            return shared_ptr<const FilterPipeline>();
+        }
+        filter._params.assign(params, params + min(numParams, sizeof(params) / sizeof(params[0])));
+        filters->push_back(filter);
+    }
+    return filters;
+}
+
+void Hdf5ExternalArray::readRange(hsize_t start, hsize_t count, char *dest, mutex &hdf5Lock) const {
+    assert(start + count <= _size);
+    if (count == 0) {
+        return;
+    }
+    hsize_t end = start + count;
+#if H5_VERSION_GE(1, 10, 3)
+    shared_ptr<const FilterPipeline> filters;
+    if (_datasetChunkSize > 1) {
+        lock_guard<mutex> guard(hdf5Lock);
+        filters = getFilters(_dataSet.getCreatePlist());
+    }
+    if (filters != NULL) {
+        size_t chunkBytes = _datasetChunkSize * _dataSize;
+        for (hsize_t offset = (start / _datasetChunkSize) * _datasetChunkSize; offset < end; offset += _datasetChunkSize) {
+            hsize_t first = max(offset, start);
+            hsize_t last = min(offset + _datasetChunkSize, end);
+            ReadAhead::RawChunk rawChunk;
+            {
+                lock_guard<mutex> guard(hdf5Lock);
+                hsize_t storageSize = 0;
+                if ((H5Dget_chunk_storage_size(_dataSet.getId(), &offset, &storageSize) < 0) or (storageSize == 0)) {
+                    // not written, let HDF5 fill it in
+                    hsize_t chunkCount = last - first;
+                    DataSpace memSpace(1, &chunkCount);
+                    DataSpace fileSpace(_dataSpace);
+                    fileSpace.selectHyperslab(H5S_SELECT_SET, &chunkCount, &first);
+                    _dataSet.read(dest + (first - start) * _dataSize, _dataType, memSpace, fileSpace);
+                    continue;
+                }
+                rawChunk._data.resize(storageSize);
+                if (H5Dread_chunk(_dataSet.getId(), H5P_DEFAULT, &offset, &rawChunk._filterMask, rawChunk._data.data()) < 0) {
+                    throw hal_exception("error reading chunk of hdf5 dataset " + _path);
+                }
+            }
+            ReadAhead::decodeChunk(*filters, rawChunk._filterMask, rawChunk._data, chunkBytes);
+            memcpy(dest + (first - start) * _dataSize, rawChunk._data.data() + (first - offset) * _dataSize,
+                   (last - first) * _dataSize);
+        }
+        return;
+    }
+#endif
+    lock_guard<mutex> guard(hdf5Lock);
+    DataSpace memSpace(1, &count);
+    DataSpace fileSpace(_dataSpace);
+    fileSpace.selectHyperslab(H5S_SELECT_SET, &count, &start);
+    _dataSet.read(dest, _dataType, memSpace, fileSpace);
+}
+
+/* set up reading ahead for a loaded array.  This needs HDF5's direct
+ * chunk reads.  The file and memory datatypes are the same, so decoded
+ * chunks need no conversion. */
+void Hdf5ExternalArray::initReadAhead(const DSetCreatPropList &cparms, hsize_t readAheadBuffers) {
+    _readAheadBuffers = 0;
+    _filters.reset();
+    _lastBufIndex = _size; // not followed by any buffer
+#if H5_VERSION_GE(1, 10, 3)
+    if ((readAheadBuffers == 0) or (_chunkSize <= 1)) {
+        return;
+    }
+    _filters = getFilters(cparms);
+    if (_filters != NULL) {
+        _readAheadBuffers = readAheadBuffers;
+    }
+#endif
+}
+
+/* after paging in a buffer, start reading the next buffers if the array is
+ * being read sequentially.  The raw chunks are read here, and decoded on
+ * the pool. */
+void Hdf5ExternalArray::readAhead(hsize_t bufIndex) {
+    bool sequential = (bufIndex == _lastBufIndex + 1);
+    _lastBufIndex = bufIndex;
+    if ((_readAheadBuffers == 0) or not sequential) {
+        return;
+    }
+    ThreadPool &pool = ThreadPool::getShared();
+    if (pool.getNumThreads() <= 1) {
+        return;
+    }
+#if H5_VERSION_GE(1, 10, 3)
+    // drop anything the scan has passed
+    _readAheads.erase(_readAheads.begin(), _readAheads.upper_bound(bufIndex));
+
+    hsize_t numBufs = (_size + _bufSize - 1) / _bufSize;
+    hsize_t lastAhead = min(bufIndex + _readAheadBuffers, numBufs - 1);
+    size_t chunkBytes = _datasetChunkSize * _dataSize;
+    size_t numRead = 0;
+    for (hsize_t ahead = bufIndex + 1; ahead <= lastAhead; ahead++) {
+        hsize_t bufStart = ahead * _bufSize;
+        hsize_t bufEnd = min(bufStart + _bufSize, _size);
+        if ((_readAheads.find(ahead) != _readAheads.end()) or ((_cache != NULL) and _cache->contains(_cacheId, ahead)) or
+            ((_sharedChunks != NULL) and
+             _sharedChunks->contains(_datasetPath, bufStart * _dataSize, (bufEnd - bufStart) * _dataSize))) {
+            continue;
+        }
+        // a buffer with a chunk that was never written is left to a normal
+        // read to fill in
+        vector<hsize_t> storageSizes;
+        for (hsize_t offset = bufStart; offset < bufEnd; offset += _datasetChunkSize) {
+            hsize_t storageSize = 0;
+            herr_t status;
+            // an unwritten chunk is an error, which is not worth printing
+            H5E_BEGIN_TRY {
+                status = H5Dget_chunk_storage_size(_dataSet.getId(), &offset, &storageSize);
+            }
+            H5E_END_TRY;
+            if ((status < 0) or (storageSize == 0)) {
+                storageSizes.clear();
+                break;
+            }
+            storageSizes.push_back(storageSize);
+        }
+        if (storageSizes.empty()) {
+            continue;
+        }
+        shared_ptr<ReadAhead> readAhead(new ReadAhead(_filters, chunkBytes, (bufEnd - bufStart) * _dataSize));
+        hsize_t offset = bufStart;
+        for (hsize_t storageSize : storageSizes) {
+            readAhead->_rawChunks.push_back(ReadAhead::RawChunk());
+            ReadAhead::RawChunk &rawChunk = readAhead->_rawChunks.back();
+            rawChunk._data.resize(storageSize);
+            if (H5Dread_chunk(_dataSet.getId(), H5P_DEFAULT, &offset, &rawChunk._filterMask, rawChunk._data.data()) < 0) {
+                throw hal_exception("error reading chunk of hdf5 dataset " + _path);
+            }
+            _ioCounters._numChunksReadAhead++;
+            _ioCounters._readAheadBytes += storageSize;
+            offset += _datasetChunkSize;
+        }
+        _readAheads[ahead] = readAhead;
+        ChunkTask::submit(pool, readAhead);
+        numRead++;
+    }
+    if ((_cache != NULL) and (numRead > 0)) {
+        _cache->countReadAhead(numRead, 0);
+    }
+#endif
+}
+
+/* get a buffer that has been read ahead, decoding it here if no worker has
+ * started on it yet, or NULL if it wasn't read ahead */
+Hdf5ChunkCache::ChunkPtr Hdf5ExternalArray::takeReadAhead(hsize_t bufIndex) {
+    map<hsize_t, shared_ptr<ReadAhead>>::iterator readAheadIt = _readAheads.find(bufIndex);
+    if (readAheadIt == _readAheads.end()) {
+        return Hdf5ChunkCache::ChunkPtr();
+    }
+    shared_ptr<ReadAhead> readAhead = readAheadIt->second;
+    _readAheads.erase(readAheadIt);
+    readAhead->finish();
+    _ioCounters._numReadAheadHits++;
+    _ioCounters._decodeSeconds += readAhead->_decodeSeconds;
+    if (_cache != NULL) {
+        _cache->countReadAhead(0, 1);
+    }
+    return readAhead->_buf;
+}
+
+/* set up writing in parallel for a created array.  Chunks are encoded on
+ * the pool and written with HDF5's direct chunk writes, so this is only
+ * done for arrays that are compressed with filters we can apply, and
+ * whose partial chunks are padded with zeros (the default fill value). */
+void Hdf5ExternalArray::initParallelWrite() {
+    _parallelWrite = false;
+    _filters.reset();
+#if H5_VERSION_GE(1, 10, 3)
+    if ((_chunkSize <= 1) or (ThreadPool::getShared().getNumThreads() <= 1)) {
+        return;
+    }
+    // the dataset's own properties have the filter parameters HDF5 fills
+    // in, like the element size for shuffle
+    DSetCreatPropList cparms = _dataSet.getCreatePlist();
+    H5D_fill_value_t fillValue;
+    if ((cparms.getNfilters() == 0) or (H5Pfill_value_defined(cparms.getId(), &fillValue) < 0) or
+        (fillValue == H5D_FILL_VALUE_USER_DEFINED)) {
+        return;
+    }
+    _filters = getFilters(cparms);
+    _parallelWrite = (_filters != NULL);
+#endif
+}
+
+/* queue the chunks of the buffer to be encoded on the pool, writing the
+ * oldest queued chunks to keep the queue short */
+void Hdf5ExternalArray::queueChunkWrites(hsize_t bufLen) {
+    ThreadPool &pool = ThreadPool::getShared();
+    size_t maxQueued = 4 * pool.getNumThreads();
+    size_t chunkBytes = _datasetChunkSize * _dataSize;
+    for (hsize_t offset = 0; offset < bufLen; offset += _datasetChunkSize) {
+        shared_ptr<ChunkWrite> chunkWrite(new ChunkWrite(_filters, _bufStart + offset));
+        size_t numBytes = min(_datasetChunkSize, bufLen - offset) * _dataSize;
+        chunkWrite->_data.resize(chunkBytes, 0);
+        memcpy(chunkWrite->_data.data(), _buf + offset * _dataSize, numBytes);
+        _chunkWrites.push_back(chunkWrite);
+        ChunkTask::submit(pool, chunkWrite);
+        while (_chunkWrites.size() > maxQueued) {
+            writeFirstChunk();
+        }
+    }
+}
+
+/* write the oldest queued chunk, encoding it here if no worker has started
+ * on it yet */
+void Hdf5ExternalArray::writeFirstChunk() {
+    shared_ptr<ChunkWrite> chunkWrite = _chunkWrites.front();
+    _chunkWrites.pop_front();
+    chunkWrite->finish();
+#if H5_VERSION_GE(1, 10, 3)
+    if (H5Dwrite_chunk(_dataSet.getId(), H5P_DEFAULT, 0, &chunkWrite->_offset, chunkWrite->_data.size(),
+                       chunkWrite->_data.data()) < 0) {
+        throw hal_exception("error writing chunk of hdf5 dataset " + _path);
+    }
+#endif
+}
+
+/* write all queued chunks */
+void Hdf5ExternalArray::flushChunkWrites() {
+    while (not _chunkWrites.empty()) {
+        writeFirstChunk();
+    }
+}
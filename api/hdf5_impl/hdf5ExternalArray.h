@@ -9,8 +9,16 @@
 #define _HDF5EXTERNALARRAY_H
 
 #include "halDefs.h"
+#include "halIoStats.h"
+#include "hdf5ChunkCache.h"
+#include "hdf5SharedChunkDir.h"
 #include <H5Cpp.h>
 #include <cassert>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 // Hack to compile with various versions of HDF5 that aren't themselves compatible
 namespace H5 {
@@ -30,7 +38,11 @@ namespace hal {
     /**
      * Wrapper for a 1-dimensional HDF5 array of fixed length.  Array objects
      * are defined (and typed) by the input datatype.  The array is paged into
-     * memory chunk-by-chunk as needed (using the HDF5 cache as a back-end).
+     * memory chunk-by-chunk as needed (using an Hdf5ChunkCache shared with
+     * the other arrays of the alignment, if given one, as a back-end).
+     * Arrays that are read sequentially can also read the following chunks
+     * ahead of time, decompressing them on the shared ThreadPool, and new
+     * arrays compress the chunks they write on the pool.
      * We can't use compiler tpying of the input objects (and instead just
      * expose the raw void* data) because the elements' sizes are not known
      * at compile time, and we don't want to move it around once its read.
@@ -64,10 +76,20 @@ namespace hal {
           * 0: load entire array into buffer
           * 1: use default chunking (from dataset)
           * N: buffersize will be N chunks.
+          * @param cache cache to share buffers in (NULL for none)
+          * @param readAheadBuffers number of buffers to read ahead when
+          * the array is accessed sequentially (0 for none).  These are
+          * decompressed on the shared ThreadPool, so nothing is read ahead
+          * unless it has more than one thread.
+          * @param sharedChunks directory of decompressed buffers shared
+          * with other processes (NULL for none), only for arrays that are
+          * not modified
           */
-        void load(H5::PortableH5Location *file, const H5std_string &path, hsize_t chunksInBuffer = 1);
+        void load(H5::PortableH5Location *file, const H5std_string &path, hsize_t chunksInBuffer = 1,
+                  Hdf5ChunkCache *cache = NULL, hsize_t readAheadBuffers = 0, Hdf5SharedChunkDir *sharedChunks = NULL);
 
-        /** Write the memory buffer back to the file */
+        /** Write the memory buffer back to the file, along with any chunks
+         * still queued to be written */
         void write();
 
         /** Access the raw data at given index
@@ -131,8 +153,76 @@ namespace hal {
         /** Read chunk from file */
         void page(hsize_t i);
 
+        /** Get the size of the dataset's chunks in elements (0 if it is
+         * not chunked) */
+        hsize_t getDatasetChunkSize() const {
+            return _datasetChunkSize;
+        }
+
+        /** Read elements straight from the file, bypassing the buffer and
+         * cache, so that threads can read different arrays of a file at
+         * once.  HDF5 calls are made holding hdf5Lock.  Chunks are read
+         * raw and decoded after releasing it when we can decode the
+         * dataset's filters, otherwise they are read with the lock held.
+         * @param start index of first element to read
+         * @param count number of elements to read
+         * @param dest where to put them
+         * @param hdf5Lock lock serializing calls to HDF5 */
+        void readRange(hsize_t start, hsize_t count, char *dest, std::mutex &hdf5Lock) const;
+
+        /** Add the array's I/O counters to statistics: buffers paged in
+         * (pages, pagedBytes), found in the chunk cache or not
+         * (cacheHits, cacheMisses), mapped from the shared chunk
+         * directory (sharedChunkHits) or taken from those read ahead
+         * (readAheadHits), buffers read and decompressed by HDF5
+         * (reads, readBytes, readSeconds), and chunks read ahead
+         * (chunksReadAhead, readAheadBytes before decompression, and
+         * decodeSeconds spent decompressing the ones used)
+         * @param stats statistics to add to
+         * @param genomeName genome the array belongs to
+         * @param arrayName name of the array in the statistics */
+        void getIoStats(IoStats &stats, const std::string &genomeName, const std::string &arrayName) const;
+
       private:
+        /** A filter of the dataset's filter pipeline */
+        struct Filter {
+            H5Z_filter_t _id;
+            std::vector<unsigned> _params;
+        };
+        typedef std::vector<Filter> FilterPipeline;
+        struct ChunkTask;
+        struct ReadAhead;
+        struct ChunkWrite;
+
+        /** I/O counters, see getIoStats() */
+        struct IoCounters {
+            size_t _numPages = 0;
+            size_t _pagedBytes = 0;
+            size_t _numCacheHits = 0;
+            size_t _numCacheMisses = 0;
+            size_t _numSharedChunkHits = 0;
+            size_t _numReadAheadHits = 0;
+            size_t _numReads = 0;
+            size_t _readBytes = 0;
+            double _readSeconds = 0;
+            size_t _numChunksReadAhead = 0;
+            size_t _readAheadBytes = 0;
+            double _decodeSeconds = 0;
+        };
+
+        static std::shared_ptr<const FilterPipeline> getFilters(const H5::DSetCreatPropList &cparms);
+
         void initBuf();
+        void setCache(Hdf5ChunkCache *cache);
+        void readBuf(char *buf, hsize_t bufLen);
+        void initReadAhead(const H5::DSetCreatPropList &cparms, hsize_t readAheadBuffers);
+        void readAhead(hsize_t bufIndex);
+        Hdf5ChunkCache::ChunkPtr takeReadAhead(hsize_t bufIndex);
+        void writeBuf();
+        void initParallelWrite();
+        void queueChunkWrites(hsize_t bufLen);
+        void writeFirstChunk();
+        void flushChunkWrites();
 
         /** Pointer to file that owns this dataset */
         H5::PortableH5Location *_file;
@@ -154,15 +244,48 @@ namespace hal {
         hsize_t _bufStart;
         /** Index of last element in memory buffer */
         hsize_t _bufEnd; // DANGER: close-ended
-        /** Number of elements in memory buffer */
+        /** Number of elements in a full memory buffer (the last buffer of
+         * the array may be shorter) */
         hsize_t _bufSize;
-        /** In-memory buffer */
+        /** In-memory buffer, either _ownBuf or the data of _cachedBuf or
+         * _mappedBuf */
         char *_buf;
-        /** Dimensional information for in-memory buffer */
-        H5::DataSpace _chunkSpace;
+        /** Buffer owned by the array when not using a cache */
+        char *_ownBuf;
+        /** Cache of buffers (NULL if not caching) */
+        Hdf5ChunkCache *_cache;
+        /** Id of the array in the cache */
+        size_t _cacheId;
+        /** Buffer shared with the cache */
+        Hdf5ChunkCache::ChunkPtr _cachedBuf;
+        /** Directory of buffers shared with other processes (NULL if
+         * none) */
+        Hdf5SharedChunkDir *_sharedChunks;
+        /** Path of the dataset in the file, naming its shared buffers */
+        std::string _datasetPath;
+        /** Buffer mapped from the shared directory */
+        Hdf5SharedChunkDir::MappedImage _mappedBuf;
+        /** Number of buffers to read ahead (0 if not reading ahead) */
+        hsize_t _readAheadBuffers;
+        /** Size of the dataset's chunks in elements (a buffer can hold
+         * several) */
+        hsize_t _datasetChunkSize;
+        /** Filters to decode chunks read ahead, or encode chunks written in
+         * parallel, with */
+        std::shared_ptr<const FilterPipeline> _filters;
+        /** Index of the last buffer paged in */
+        hsize_t _lastBufIndex;
+        /** Buffers being read ahead, by index */
+        std::map<hsize_t, std::shared_ptr<ReadAhead>> _readAheads;
+        /** Flag saying chunks are encoded on the pool when written */
+        bool _parallelWrite;
+        /** Chunks waiting to be written, in the order they were queued */
+        std::deque<std::shared_ptr<ChunkWrite>> _chunkWrites;
         /** Flag saying we should write to disk on write
          * or page-out calls (set by getUpdate()) */
         bool _dirty;
+        /** Counters of the I/O done since the array was constructed */
+        IoCounters _ioCounters;
 
       private:
         Hdf5ExternalArray(const Hdf5ExternalArray &);
@@ -179,7 +302,7 @@ namespace hal {
         if (i < _bufStart || i > _bufEnd) {
             page(i);
         }
-        assert((i - _bufStart) < _bufSize);
+        assert(i <= _bufEnd);
         return _buf + (i - _bufStart) * _dataSize;
     }
 
@@ -191,7 +314,7 @@ namespace hal {
             page(i);
         }
         _dirty = true;
-        assert((i - _bufStart) < _bufSize);
+        assert(i <= _bufEnd);
         return _buf + (i - _bufStart) * _dataSize;
     }
 
@@ -20,6 +20,7 @@
 #include "hdf5TopSegment.h"
 #include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <iostream>
 
 using namespace hal;
@@ -31,14 +32,39 @@ const string Hdf5Genome::topArrayName = "TOP_ARRAY";
 const string Hdf5Genome::bottomArrayName = "BOTTOM_ARRAY";
 const string Hdf5Genome::sequenceIdxArrayName = "SEQIDX_ARRAY";
 const string Hdf5Genome::sequenceNameArrayName = "SEQNAME_ARRAY";
+const string Hdf5Genome::sequenceNameIndexArrayName = "SEQNAMEIDX_ARRAY";
 const string Hdf5Genome::metaGroupName = "Meta";
 const string Hdf5Genome::rupGroupName = "Rup";
 const double Hdf5Genome::dnaChunkScale = 10.;
 
+/* check for a dataset by its link, which is much cheaper than opening it
+ * (and catching the exception when it's missing) */
+static bool hasDataSet(const Group &group, const string &name) {
+    return H5Lexists(group.getId(), name.c_str(), H5P_DEFAULT) > 0;
+}
+
+/* properties to create a dataset with the alignment's codec, and chunks
+ * sized for the dataset, or the alignment's chunk size scaled by
+ * fixedChunkScale if the alignment doesn't size chunks per dataset */
+DSetCreatPropList Hdf5Genome::getDSetCreatPropList(Hdf5Codec::DatasetType datasetType, const DataType &dataType,
+                                                   hsize_t numElements, double fixedChunkScale) const {
+    DSetCreatPropList dsetDC = _alignment->getCodec().getDSetCreatPropList(_dcprops, datasetType);
+    if (dsetDC.getLayout() != H5D_CHUNKED) {
+        return dsetDC;
+    }
+    hsize_t chunk = _alignment->getChunkSize(datasetType, dataType.getSize(), numElements);
+    if (chunk == 0) {
+        dsetDC.getChunk(1, &chunk);
+        chunk *= fixedChunkScale;
+    }
+    dsetDC.setChunk(1, &chunk);
+    return dsetDC;
+}
+
 Hdf5Genome::Hdf5Genome(const string &name, Hdf5Alignment *alignment, PortableH5Location *h5Parent,
                        const DSetCreatPropList &dcProps, bool inMemory)
-    : Genome(alignment, name), _alignment(alignment), _h5Parent(h5Parent), _name(name), _numChildrenInBottomArray(0),
-      _totalSequenceLength(0), _numChunksInArrayBuffer(inMemory ? 0 : 1) {
+    : Genome(alignment, name), _alignment(alignment), _h5Parent(h5Parent), _name(name), _metaData(NULL),
+      _numChildrenInBottomArray(0), _totalSequenceLength(0), _numChunksInArrayBuffer(inMemory ? 0 : 1) {
     _dcprops.copy(dcProps);
     assert(!name.empty());
     assert(alignment != NULL && h5Parent != NULL);
@@ -48,9 +74,11 @@ Hdf5Genome::Hdf5Genome(const string &name, Hdf5Alignment *alignment, PortableH5L
         _group = h5Parent->openGroup(name);
     } catch (Exception &e) {
         _group = h5Parent->createGroup(name);
+        // new genomes always get a metadata group, existing ones only
+        // read theirs when it's asked for
+        getMetaData();
     }
     read();
-    _metaData = new HDF5MetaData(&_group, metaGroupName);
     _rup = new HDF5MetaData(&_group, rupGroupName);
 
     _totalSequenceLength = _dnaArray.getSize() * 2;
@@ -111,6 +139,12 @@ void Hdf5Genome::setDimensions(const vector<Sequence::Info> &sequenceDimensions,
         _group.unlink(sequenceNameArrayName);
     } catch (H5::Exception &) {
     }
+    try {
+        HDF5DisableExceptionPrinting prDisable;
+        DataSet d = _group.openDataSet(sequenceNameIndexArrayName);
+        _group.unlink(sequenceNameIndexArrayName);
+    } catch (H5::Exception &) {
+    }
 
     if (_totalSequenceLength > 0 && storeDNAArrays) {
         hal_size_t arrayLength = _totalSequenceLength / 2;
@@ -120,26 +154,26 @@ void Hdf5Genome::setDimensions(const vector<Sequence::Info> &sequenceDimensions,
         } else {
             _rup->set(rupGroupName, "0");
         }
-        hsize_t chunk;
-        _dcprops.getChunk(1, &chunk);
-        // enalarge chunk size because dna bases are so much smaller
-        // than segments.  (about 30x). we default to 10x enlargement
-        // since the seem to compress about 3x worse.
-        chunk *= dnaChunkScale;
-        DSetCreatPropList dnaDC;
-        dnaDC.copy(_dcprops);
-        dnaDC.setChunk(1, &chunk);
+        // with a fixed chunk size, enalarge chunks because dna bases
+        // are so much smaller than segments.  (about 30x). we default
+        // to 10x enlargement since the seem to compress about 3x worse.
+        DSetCreatPropList dnaDC = getDSetCreatPropList(Hdf5Codec::DnaDataset, dnaDataType(), arrayLength, dnaChunkScale);
         _dnaArray.create(&_group, dnaArrayName, dnaDataType(), arrayLength, &dnaDC, _numChunksInArrayBuffer);
-        _dnaAccess = DnaAccessPtr(new HDF5DnaAccess(this, &_dnaArray, 0));
+        _dnaAccess = DnaAccessPtr(new HDF5DnaAccess(this, &_dnaArray));
     }
     if (totalSeq > 0) {
-        _sequenceIdxArray.create(&_group, sequenceIdxArrayName, Hdf5Sequence::idxDataType(), totalSeq + 1, &_dcprops,
+        DSetCreatPropList idxDC =
+            getDSetCreatPropList(Hdf5Codec::SequenceIndexDataset, Hdf5Sequence::idxDataType(), totalSeq + 1);
+        _sequenceIdxArray.create(&_group, sequenceIdxArrayName, Hdf5Sequence::idxDataType(), totalSeq + 1, &idxDC,
                                  _numChunksInArrayBuffer);
 
-        _sequenceNameArray.create(&_group, sequenceNameArrayName, Hdf5Sequence::nameDataType(maxName + 1), totalSeq, &_dcprops,
+        DSetCreatPropList nameDC =
+            getDSetCreatPropList(Hdf5Codec::SequenceNameDataset, Hdf5Sequence::nameDataType(maxName + 1), totalSeq);
+        _sequenceNameArray.create(&_group, sequenceNameArrayName, Hdf5Sequence::nameDataType(maxName + 1), totalSeq, &nameDC,
                                   _numChunksInArrayBuffer);
 
         writeSequences(sequenceDimensions);
+        writeSequenceNameIndex();
     }
 
     // Do the same as above for the segments.
@@ -288,7 +322,8 @@ void Hdf5Genome::setGenomeTopDimensions(const vector<Sequence::UpdateInfo> &topD
         _group.unlink(topArrayName);
     } catch (H5::Exception &) {
     }
-    _topArray.create(&_group, topArrayName, Hdf5TopSegment::dataType(), numTopSegments + 1, &_dcprops, _numChunksInArrayBuffer);
+    DSetCreatPropList topDC = getDSetCreatPropList(Hdf5Codec::SegmentDataset, Hdf5TopSegment::dataType(), numTopSegments + 1);
+    _topArray.create(&_group, topArrayName, Hdf5TopSegment::dataType(), numTopSegments + 1, &topDC, _numChunksInArrayBuffer);
     reload();
 }
 
@@ -305,15 +340,11 @@ void Hdf5Genome::setGenomeBottomDimensions(const vector<Sequence::UpdateInfo> &b
     }
     hal_size_t numChildren = _alignment->getChildNames(_name).size();
 
-    // scale down the chunk size in order to keep chunks proportional to
-    // the size of a bottom segment with two children.
-    hsize_t chunk;
-    _dcprops.getChunk(1, &chunk);
+    // with a fixed chunk size, scale it down in order to keep chunks
+    // proportional to the size of a bottom segment with two children.
     double scale = numChildren < 10 ? 1. : 10. / numChildren;
-    chunk *= scale;
-    DSetCreatPropList botDC;
-    botDC.copy(_dcprops);
-    botDC.setChunk(1, &chunk);
+    DSetCreatPropList botDC = getDSetCreatPropList(Hdf5Codec::SegmentDataset, Hdf5BottomSegment::dataType(numChildren),
+                                                   numBottomSegments + 1, scale);
 
     _bottomArray.create(&_group, bottomArrayName, Hdf5BottomSegment::dataType(numChildren), numBottomSegments + 1, &botDC,
                         _numChunksInArrayBuffer);
@@ -326,6 +357,9 @@ hal_size_t Hdf5Genome::getNumSequences() const {
 }
 
 Sequence *Hdf5Genome::getSequence(const string &name) {
+    if (_sequenceNameCache.empty() && hasSequenceNameIndex()) {
+        return findSequenceByName(name);
+    }
     loadSequenceNameCache();
     Sequence *sequence = NULL;
     map<string, Hdf5Sequence *>::iterator mapIt = _sequenceNameCache.find(name);
@@ -340,7 +374,9 @@ const Sequence *Hdf5Genome::getSequence(const string &name) const {
 }
 
 Sequence *Hdf5Genome::getSequenceBySite(hal_size_t position) {
-    loadSequencePosCache();
+    if (_sequencePosCache.empty()) {
+        return findSequenceBySite(position);
+    }
     map<hal_size_t, Hdf5Sequence *>::iterator i;
     i = _sequencePosCache.upper_bound(position);
     if (i != _sequencePosCache.end()) {
@@ -367,10 +403,13 @@ SequenceIteratorPtr Hdf5Genome::getSequenceIterator(hal_index_t position) const
 }
 
 MetaData *Hdf5Genome::getMetaData() {
-    return _metaData;
+    return const_cast<MetaData *>(static_cast<const Hdf5Genome *>(this)->getMetaData());
 }
 
 const MetaData *Hdf5Genome::getMetaData() const {
+    if (_metaData == NULL) {
+        _metaData = new HDF5MetaData(const_cast<H5::Group *>(&_group), metaGroupName);
+    }
     return _metaData;
 }
 
@@ -479,9 +518,9 @@ void Hdf5Genome::setString(const string &inString) {
 }
 
 void Hdf5Genome::getSubString(string &outString, hal_size_t start, hal_size_t length) const {
-    outString.resize(length);
-    DnaIteratorPtr dnaIt(getDnaIterator(start));
-    dnaIt->readString(outString, length);
+    PackedDnaSpan span;
+    getPackedDna(span, start, length);
+    span.unpack(outString);
 }
 
 void Hdf5Genome::setSubString(const string &inString, hal_size_t start, hal_size_t length) {
@@ -492,6 +531,33 @@ void Hdf5Genome::setSubString(const string &inString, hal_size_t start, hal_size
     dnaIt->writeString(inString, length);
 }
 
+void Hdf5Genome::getPackedDna(PackedDnaSpan &span, hal_size_t start, hal_size_t length) const {
+    if (start + length > getSequenceLength()) {
+        throw hal_exception("Hdf5Genome::getPackedDna: range (" + std::to_string(start) + ", " + std::to_string(length) +
+                            ") out of bounds for genome " + getName());
+    }
+    unsigned char *out = span.setCopy(length, start & 1);
+    if (length == 0) {
+        return;
+    }
+    // copy from the chunk buffers, which are shared with the DnaAccess, so
+    // make sure any pending writes are marked, and have it fetch its
+    // buffer again afterwards
+    Hdf5ExternalArray &dnaArray = const_cast<Hdf5ExternalArray &>(_dnaArray);
+    _dnaAccess->flush();
+    hsize_t first = start / 2;
+    hsize_t last = (start + length - 1) / 2; // close-ended
+    for (hsize_t i = first; i <= last;) {
+        if (i < dnaArray.getBufStart() || i > dnaArray.getBufEnd()) {
+            dnaArray.page(i);
+        }
+        hsize_t end = std::min(last, dnaArray.getBufEnd());
+        memcpy(out + (i - first), dnaArray.getBuf() + (i - dnaArray.getBufStart()), end - i + 1);
+        i = end + 1;
+    }
+    static_cast<HDF5DnaAccess *>(_dnaAccess.get())->invalidate();
+}
+
 RearrangementPtr Hdf5Genome::getRearrangement(hal_index_t position, hal_size_t gapLengthThreshold, double nThreshold,
                                               bool atomic) const {
     assert(position >= 0 && position < (hal_index_t)getNumTopSegments());
@@ -520,79 +586,86 @@ void Hdf5Genome::write() {
     _dnaArray.write();
     _topArray.write();
     _bottomArray.write();
-    _metaData->write();
+    if (_metaData != NULL) {
+        _metaData->write();
+    }
     _rup->write();
     _sequenceIdxArray.write();
     _sequenceNameArray.write();
+    _sequenceNameIndexArray.write();
 }
 
 void Hdf5Genome::read() {
     bool dnaLoaded = false;
-    try {
-        HDF5DisableExceptionPrinting prDisable;
-        _group.openDataSet(dnaArrayName);
-        _dnaArray.load(&_group, dnaArrayName, _numChunksInArrayBuffer);
+    if (hasDataSet(_group, dnaArrayName)) {
+        _dnaArray.load(&_group, dnaArrayName, _numChunksInArrayBuffer, _alignment->getChunkCache(),
+                       _alignment->getReadAheadBuffers(), _alignment->getSharedChunkDir());
         dnaLoaded = true;
-    } catch (H5::Exception &) {
     }
 
-    try {
-        HDF5DisableExceptionPrinting prDisable;
-        _group.openDataSet(topArrayName);
-        _topArray.load(&_group, topArrayName, _numChunksInArrayBuffer);
-    } catch (H5::Exception &) {
+    if (hasDataSet(_group, topArrayName)) {
+        _topArray.load(&_group, topArrayName, _numChunksInArrayBuffer, _alignment->getChunkCache(),
+                       _alignment->getReadAheadBuffers(), _alignment->getSharedChunkDir());
     }
-    try {
-        HDF5DisableExceptionPrinting prDisable;
-        _group.openDataSet(bottomArrayName);
-        _bottomArray.load(&_group, bottomArrayName, _numChunksInArrayBuffer);
+    if (hasDataSet(_group, bottomArrayName)) {
+        _bottomArray.load(&_group, bottomArrayName, _numChunksInArrayBuffer, _alignment->getChunkCache(),
+                          _alignment->getReadAheadBuffers(), _alignment->getSharedChunkDir());
         _numChildrenInBottomArray = Hdf5BottomSegment::numChildrenFromDataType(_bottomArray.getDataType());
-    } catch (H5::Exception &) {
     }
 
     deleteSequenceCache();
-    try {
-        HDF5DisableExceptionPrinting prDisable;
-        _group.openDataSet(sequenceIdxArrayName);
-        _sequenceIdxArray.load(&_group, sequenceIdxArrayName, _numChunksInArrayBuffer);
-    } catch (H5::Exception &) {
+    if (hasDataSet(_group, sequenceIdxArrayName)) {
+        _sequenceIdxArray.load(&_group, sequenceIdxArrayName, _numChunksInArrayBuffer, _alignment->getChunkCache(),
+                               _alignment->getReadAheadBuffers(), _alignment->getSharedChunkDir());
     }
-    try {
-        HDF5DisableExceptionPrinting prDisable;
-        _group.openDataSet(sequenceNameArrayName);
-        _sequenceNameArray.load(&_group, sequenceNameArrayName, _numChunksInArrayBuffer);
-    } catch (H5::Exception &) {
+    if (hasDataSet(_group, sequenceNameArrayName)) {
+        _sequenceNameArray.load(&_group, sequenceNameArrayName, _numChunksInArrayBuffer, _alignment->getChunkCache(),
+                                _alignment->getReadAheadBuffers(), _alignment->getSharedChunkDir());
+    }
+    if (hasDataSet(_group, sequenceNameIndexArrayName)) {
+        _sequenceNameIndexArray.load(&_group, sequenceNameIndexArrayName, _numChunksInArrayBuffer,
+                                     _alignment->getChunkCache(), _alignment->getReadAheadBuffers(),
+                                     _alignment->getSharedChunkDir());
     }
 
     readSequences();
     if (dnaLoaded) {
-        _dnaAccess = DnaAccessPtr(new HDF5DnaAccess(this, &_dnaArray, 0));
+        _dnaAccess = DnaAccessPtr(new HDF5DnaAccess(this, &_dnaArray));
     }
 }
 
+/* the arrays are named the same as those of the mmap format where they
+ * correspond */
+void Hdf5Genome::getIoStats(IoStats &stats) const {
+    _dnaArray.getIoStats(stats, _name, "dna");
+    _topArray.getIoStats(stats, _name, "topSegments");
+    _bottomArray.getIoStats(stats, _name, "bottomSegments");
+    _sequenceIdxArray.getIoStats(stats, _name, "sequences");
+    _sequenceNameArray.getIoStats(stats, _name, "sequenceNames");
+    _sequenceNameIndexArray.getIoStats(stats, _name, "sequenceNameIndex");
+}
+
 void Hdf5Genome::readSequences() {
     deleteSequenceCache();
 }
 
 void Hdf5Genome::deleteSequenceCache() {
-    if (_sequencePosCache.size() > 0 || _zeroLenPosCache.size() > 0) {
-        map<hal_size_t, Hdf5Sequence *>::iterator i;
-        for (i = _sequencePosCache.begin(); i != _sequencePosCache.end(); ++i) {
-            delete i->second;
-        }
-        vector<Hdf5Sequence *>::iterator z;
-        for (z = _zeroLenPosCache.begin(); z != _zeroLenPosCache.end(); ++z) {
-            delete *z;
-        }
-    } else if (_sequenceNameCache.size() > 0) {
-        map<string, Hdf5Sequence *>::iterator i;
-        for (i = _sequenceNameCache.begin(); i != _sequenceNameCache.end(); ++i) {
-            delete i->second;
-        }
+    for (map<hal_size_t, Hdf5Sequence *>::iterator i = _sequenceObjects.begin(); i != _sequenceObjects.end(); ++i) {
+        delete i->second;
     }
-    _sequencePosCache.clear();
+    _sequenceObjects.clear();
+    _sequencePosCache.clear(); // the caches share the pointers above
     _zeroLenPosCache.clear();
-    _sequenceNameCache.clear(); // I share my pointers with above.
+    _sequenceNameCache.clear();
+}
+
+Hdf5Sequence *Hdf5Genome::getSequenceObject(hal_size_t index) const {
+    Hdf5Sequence *&seq = _sequenceObjects[index];
+    if (seq == NULL) {
+        seq = new Hdf5Sequence(const_cast<Hdf5Genome *>(this), const_cast<Hdf5ExternalArray *>(&_sequenceIdxArray),
+                               const_cast<Hdf5ExternalArray *>(&_sequenceNameArray), index);
+    }
+    return seq;
 }
 
 void Hdf5Genome::loadSequencePosCache() const {
@@ -601,31 +674,13 @@ void Hdf5Genome::loadSequencePosCache() const {
     }
     hal_size_t totalReadLen = 0;
     hal_size_t numSequences = _sequenceNameArray.getSize();
-
-    if (_sequenceNameCache.size() > 0) {
-        assert(_sequenceNameCache.size() == numSequences);
-        map<std::string, Hdf5Sequence *>::const_iterator i;
-        for (i = _sequenceNameCache.begin(); i != _sequenceNameCache.end(); ++i) {
-            if (i->second->getSequenceLength() > 0) {
-                _sequencePosCache.insert(pair<hal_size_t, Hdf5Sequence *>(
-                    i->second->getStartPosition() + i->second->getSequenceLength(), i->second));
-                totalReadLen += i->second->getSequenceLength();
-            } else {
-                // FIXME: _zeroLenPosCache.push_back(i->second);
-            }
-        }
-    } else {
-        for (hal_size_t i = 0; i < numSequences; ++i) {
-            Hdf5Sequence *seq =
-                new Hdf5Sequence(const_cast<Hdf5Genome *>(this), const_cast<Hdf5ExternalArray *>(&_sequenceIdxArray),
-                                 const_cast<Hdf5ExternalArray *>(&_sequenceNameArray), i);
-            if (seq->getSequenceLength() > 0) {
-                _sequencePosCache.insert(
-                    pair<hal_size_t, Hdf5Sequence *>(seq->getStartPosition() + seq->getSequenceLength(), seq));
-                totalReadLen += seq->getSequenceLength();
-            } else {
-                // FIXME: _zeroLenPosCache.push_back(seq);
-            }
+    for (hal_size_t i = 0; i < numSequences; ++i) {
+        Hdf5Sequence *seq = getSequenceObject(i);
+        if (seq->getSequenceLength() > 0) {
+            _sequencePosCache.insert(pair<hal_size_t, Hdf5Sequence *>(seq->getStartPosition() + seq->getSequenceLength(), seq));
+            totalReadLen += seq->getSequenceLength();
+        } else {
+            // FIXME: _zeroLenPosCache.push_back(seq);
         }
     }
     if (_totalSequenceLength > 0 && totalReadLen != _totalSequenceLength) {
@@ -640,26 +695,89 @@ void Hdf5Genome::loadSequenceNameCache() const {
         return;
     }
     hal_size_t numSequences = _sequenceNameArray.getSize();
+    for (hal_size_t i = 0; i < numSequences; ++i) {
+        Hdf5Sequence *seq = getSequenceObject(i);
+        _sequenceNameCache.insert(pair<string, Hdf5Sequence *>(seq->getName(), seq));
+    }
+}
+
+/* the name index is missing in files written before it was added, and is
+ * ignored if it doesn't match the name array */
+bool Hdf5Genome::hasSequenceNameIndex() const {
+    return _sequenceNameIndexArray.getSize() > 0 && _sequenceNameIndexArray.getSize() == _sequenceNameArray.getSize();
+}
+
+/* write the indexes of the sequences sorted by name, so a sequence can be
+ * found by binary search instead of loading every name */
+void Hdf5Genome::writeSequenceNameIndex() {
+    hal_size_t numSequences = _sequenceNameArray.getSize();
+    vector<string> names;
+    names.reserve(numSequences);
+    for (hal_size_t i = 0; i < numSequences; ++i) {
+        names.push_back(_sequenceNameArray.get(i));
+    }
+    vector<hal_size_t> order(numSequences);
+    for (hal_size_t i = 0; i < numSequences; ++i) {
+        order[i] = i;
+    }
+    sort(order.begin(), order.end(), [&names](hal_size_t a, hal_size_t b) { return names[a] < names[b]; });
 
-    if (_sequencePosCache.size() > 0 || _zeroLenPosCache.size() > 0) {
-        assert(_sequencePosCache.size() + _zeroLenPosCache.size() == numSequences);
-        map<hal_size_t, Hdf5Sequence *>::iterator i;
-        for (i = _sequencePosCache.begin(); i != _sequencePosCache.end(); ++i) {
-            _sequenceNameCache.insert(pair<string, Hdf5Sequence *>(i->second->getName(), i->second));
-        }
-        vector<Hdf5Sequence *>::iterator z;
-        for (z = _zeroLenPosCache.begin(); z != _zeroLenPosCache.end(); ++z) {
-            _sequenceNameCache.insert(pair<string, Hdf5Sequence *>((*z)->getName(), (*z)));
+    try {
+        HDF5DisableExceptionPrinting prDisable;
+        DataSet d = _group.openDataSet(sequenceNameIndexArrayName);
+        _group.unlink(sequenceNameIndexArrayName);
+    } catch (H5::Exception &) {
+    }
+    DSetCreatPropList nameIdxDC = getDSetCreatPropList(Hdf5Codec::SequenceIndexDataset, PredType::NATIVE_HSIZE, numSequences);
+    _sequenceNameIndexArray.create(&_group, sequenceNameIndexArrayName, PredType::NATIVE_HSIZE, numSequences, &nameIdxDC,
+                                   _numChunksInArrayBuffer);
+    for (hal_size_t i = 0; i < numSequences; ++i) {
+        _sequenceNameIndexArray.setValue(i, 0, order[i]);
+    }
+    _sequenceNameIndexArray.write();
+}
+
+/* binary search of the name index */
+Hdf5Sequence *Hdf5Genome::findSequenceByName(const string &name) const {
+    Hdf5ExternalArray *nameArray = const_cast<Hdf5ExternalArray *>(&_sequenceNameArray);
+    hal_size_t lo = 0;
+    hal_size_t hi = _sequenceNameIndexArray.getSize();
+    while (lo < hi) {
+        hal_size_t mid = lo + (hi - lo) / 2;
+        hal_size_t index = _sequenceNameIndexArray.getValue<hal_size_t>(mid, 0);
+        int cmp = name.compare(nameArray->get(index));
+        if (cmp == 0) {
+            return getSequenceObject(index);
+        } else if (cmp < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
         }
-    } else {
-        for (hal_size_t i = 0; i < numSequences; ++i) {
-            Hdf5Sequence *seq =
-                new Hdf5Sequence(const_cast<Hdf5Genome *>(this), const_cast<Hdf5ExternalArray *>(&_sequenceIdxArray),
-                                 const_cast<Hdf5ExternalArray *>(&_sequenceNameArray), i);
+    }
+    return NULL;
+}
 
-            _sequenceNameCache.insert(pair<string, Hdf5Sequence *>(seq->getName(), seq));
+/* binary search of the start positions in the sequence index, whose last
+ * record holds the total length.  zero-length sequences are never
+ * returned, as with the position cache */
+Hdf5Sequence *Hdf5Genome::findSequenceBySite(hal_size_t position) const {
+    hal_size_t numSequences = _sequenceNameArray.getSize();
+    if (numSequences == 0 ||
+        position >= _sequenceIdxArray.getValue<hal_size_t>(numSequences, Hdf5Sequence::startOffset)) {
+        return NULL;
+    }
+    // find the last sequence starting at or before position
+    hal_size_t lo = 0;
+    hal_size_t hi = numSequences;
+    while (hi - lo > 1) {
+        hal_size_t mid = lo + (hi - lo) / 2;
+        if (_sequenceIdxArray.getValue<hal_size_t>(mid, Hdf5Sequence::startOffset) <= position) {
+            lo = mid;
+        } else {
+            hi = mid;
         }
     }
+    return getSequenceObject(lo);
 }
 
 void Hdf5Genome::writeSequences(const vector<Sequence::Info> &sequenceDimensions) {
@@ -670,7 +788,7 @@ void Hdf5Genome::writeSequences(const vector<Sequence::Info> &sequenceDimensions
     hal_size_t bottomArrayIndex = 0;
     for (i = sequenceDimensions.begin(); i != sequenceDimensions.end(); ++i) {
         // Copy segment into HDF5 array
-        Hdf5Sequence *seq = new Hdf5Sequence(this, &_sequenceIdxArray, &_sequenceNameArray, i - sequenceDimensions.begin());
+        Hdf5Sequence *seq = getSequenceObject(i - sequenceDimensions.begin());
         // write all the Sequence::Info into the hdf5 sequence record
         seq->set(startPosition, *i, topArrayIndex, bottomArrayIndex);
         // Keep the object pointer in our caches
@@ -692,6 +810,7 @@ void Hdf5Genome::resetBranchCaches() {
 }
 
 void Hdf5Genome::rename(const string &newName) {
+    Hdf5Alignment::checkGenomeName(newName);
     _group.move("/" + _name, "/" + newName);
     string newickStr = _alignment->getNewickTree();
     stTree *tree = stTree_parseNewickString(newickStr.c_str());
@@ -709,6 +828,7 @@ void Hdf5Genome::renameSequence(const string &oldName, size_t index, const strin
     strcpy(arrayBuffer, newName.c_str());
     _sequenceNameArray.write();
     readSequences();
+    writeSequenceNameIndex();
 }
 
 void Hdf5Genome::resizeNameArray(size_t newMaxSize) {
@@ -728,8 +848,10 @@ void Hdf5Genome::resizeNameArray(size_t newMaxSize) {
         } catch (H5::Exception &) {
         }
 
+        DSetCreatPropList nameDC =
+            getDSetCreatPropList(Hdf5Codec::SequenceNameDataset, Hdf5Sequence::nameDataType(newMaxSize + 1), numSequences);
         _sequenceNameArray.create(&_group, sequenceNameArrayName, Hdf5Sequence::nameDataType(newMaxSize + 1), numSequences,
-                                  &_dcprops, _numChunksInArrayBuffer);
+                                  &nameDC, _numChunksInArrayBuffer);
         for (size_t i = 0; i < numSequences; i++) {
             char *arrayBuffer = _sequenceNameArray.getUpdate(i);
             strcpy(arrayBuffer, names[i].c_str());
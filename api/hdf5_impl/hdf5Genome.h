@@ -12,6 +12,7 @@
 #include "halGenome.h"
 #include "halTopSegmentIterator.h"
 #include "hdf5Alignment.h"
+#include "hdf5Codec.h"
 #include "hdf5ExternalArray.h"
 #include "hdf5MetaData.h"
 #include <H5Cpp.h>
@@ -29,6 +30,7 @@ namespace hal {
         friend class Hdf5BottomSegment;
         friend class Hdf5SequenceIterator;
         friend class Hdf5Sequence;
+        friend class Hdf5ToMMap;
 
       public:
         Hdf5Genome(const std::string &name, Hdf5Alignment *alignment, H5::PortableH5Location *h5Parent,
@@ -107,6 +109,8 @@ namespace hal {
 
         void setSubString(const std::string &intString, hal_size_t start, hal_size_t length);
 
+        void getPackedDna(PackedDnaSpan &span, hal_size_t start, hal_size_t length) const;
+
         RearrangementPtr getRearrangement(hal_index_t position, hal_size_t gapLengthThreshold, double nThreshold,
                                           bool atomic = false) const;
 
@@ -122,6 +126,7 @@ namespace hal {
         void resetTreeCache();
         void resetBranchCaches();
         void renameSequence(const std::string &oldName, size_t index, const std::string &newName);
+        void getIoStats(IoStats &stats) const;
 
       private:
         void readSequences();
@@ -129,23 +134,31 @@ namespace hal {
         void deleteSequenceCache();
         void loadSequencePosCache() const;
         void loadSequenceNameCache() const;
+        Hdf5Sequence *getSequenceObject(hal_size_t index) const;
+        bool hasSequenceNameIndex() const;
+        void writeSequenceNameIndex();
+        Hdf5Sequence *findSequenceByName(const std::string &name) const;
+        Hdf5Sequence *findSequenceBySite(hal_size_t position) const;
         void setGenomeTopDimensions(const std::vector<hal::Sequence::UpdateInfo> &sequenceDimensions);
 
         void setGenomeBottomDimensions(const std::vector<hal::Sequence::UpdateInfo> &sequenceDimensions);
         void resizeNameArray(size_t newMaxSize);
+        H5::DSetCreatPropList getDSetCreatPropList(Hdf5Codec::DatasetType datasetType, const H5::DataType &dataType,
+                                                   hsize_t numElements, double fixedChunkScale = 1.) const;
 
       private:
         Hdf5Alignment *_alignment;
         H5::PortableH5Location *_h5Parent;
         AlignmentPtr _alignmentPtr;
         std::string _name;
-        HDF5MetaData *_metaData;
+        mutable HDF5MetaData *_metaData;
         HDF5MetaData *_rup;
         Hdf5ExternalArray _dnaArray;
         Hdf5ExternalArray _topArray;
         Hdf5ExternalArray _bottomArray;
         Hdf5ExternalArray _sequenceIdxArray;
         Hdf5ExternalArray _sequenceNameArray;
+        Hdf5ExternalArray _sequenceNameIndexArray;
 
         // FIXME: every DNAIteratorPtr uses the same DNAAccess. This causes
         // thrashing when multiple DNAIterators are used concurrently
@@ -157,6 +170,10 @@ namespace hal {
         hal_size_t _totalSequenceLength;
         hal_size_t _numChunksInArrayBuffer;
 
+        // sequences are instantiated on demand and owned by
+        // _sequenceObjects; the position and name caches are only loaded
+        // when the whole list is needed, or for files without a name index
+        mutable std::map<hal_size_t, Hdf5Sequence *> _sequenceObjects;
         mutable std::map<hal_size_t, Hdf5Sequence *> _sequencePosCache;
         mutable std::vector<Hdf5Sequence *> _zeroLenPosCache;
         mutable std::map<std::string, Hdf5Sequence *> _sequenceNameCache;
@@ -166,6 +183,7 @@ namespace hal {
         static const std::string bottomArrayName;
         static const std::string sequenceIdxArrayName;
         static const std::string sequenceNameArrayName;
+        static const std::string sequenceNameIndexArrayName;
         static const std::string metaGroupName;
         static const std::string rupGroupName;
 
@@ -170,9 +170,17 @@ void Hdf5Sequence::setString(const std::string &inString) {
 }
 
 void Hdf5Sequence::getSubString(std::string &outString, hal_size_t start, hal_size_t length) const {
-    outString.resize(length);
-    DnaIteratorPtr dnaIt(getDnaIterator(start));
-    dnaIt->readString(outString, length);
+    PackedDnaSpan span;
+    getPackedDna(span, start, length);
+    span.unpack(outString);
+}
+
+void Hdf5Sequence::getPackedDna(PackedDnaSpan &span, hal_size_t start, hal_size_t length) const {
+    if (start + length > getSequenceLength()) {
+        throw hal_exception("Hdf5Sequence::getPackedDna: range (" + std::to_string(start) + ", " + std::to_string(length) +
+                            ") out of bounds for sequence " + getFullName());
+    }
+    _genome->getPackedDna(span, getStartPosition() + start, length);
 }
 
 void Hdf5Sequence::setSubString(const std::string &inString, hal_size_t start, hal_size_t length) {
@@ -19,6 +19,7 @@ namespace hal {
 
     class Hdf5Sequence : public Sequence {
         friend class Hdf5SequenceIterator;
+        friend class Hdf5Genome;
 
       public:
         Hdf5Sequence(Hdf5Genome *genome, Hdf5ExternalArray *idxArray, Hdf5ExternalArray *nameArray, hal_index_t index);
@@ -77,6 +78,8 @@ namespace hal {
 
         void setSubString(const std::string &intString, hal_size_t start, hal_size_t length);
 
+        void getPackedDna(PackedDnaSpan &span, hal_size_t start, hal_size_t length) const;
+
         RearrangementPtr getRearrangement(hal_index_t position, hal_size_t gapLengthThreshold, double nThreshold,
                                           bool atomic = false) const;
 
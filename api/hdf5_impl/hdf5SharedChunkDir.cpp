@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "hdf5SharedChunkDir.h"
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <fcntl.h>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace hal;
+
+/* create a directory if it doesn't exist */
+static bool makeDir(const string &path) {
+    return (::mkdir(path.c_str(), 0700) == 0) or (errno == EEXIST);
+}
+
+/* check that a file was made by us and that no one else can have modified
+ * it, as we trust its contents */
+static bool isOwnFile(const struct stat &fileStat) {
+    return (fileStat.st_uid == ::geteuid()) and ((fileStat.st_mode & (S_IWGRP | S_IWOTH)) == 0);
+}
+
+/* escape a dataset path as a file name, keeping letters, digits, '_', '-'
+ * and '.' and writing other bytes (including '/') as %XX */
+static string escapeName(const string &name) {
+    static const char hexDigits[] = "0123456789ABCDEF";
+    string escaped;
+    for (unsigned char c : name) {
+        if (isalnum(c) or (c == '_') or (c == '-') or (c == '.')) {
+            escaped += c;
+        } else {
+            escaped += '%';
+            escaped += hexDigits[c >> 4];
+            escaped += hexDigits[c & 0xf];
+        }
+    }
+    return escaped;
+}
+
+Hdf5SharedChunkDir::Hdf5SharedChunkDir(const string &dirPath, const string &halPath)
+    : _numMapped(0), _numMisses(0), _numStored(0) {
+    struct stat halStat;
+    if (::stat(halPath.c_str(), &halStat) != 0) {
+        return; // not a local file, so it can't be identified
+    }
+    ostringstream imageDir;
+    imageDir << dirPath << "/" << hex << halStat.st_dev << "-" << halStat.st_ino << "-" << halStat.st_size << "-"
+             << halStat.st_mtim.tv_sec << "." << halStat.st_mtim.tv_nsec;
+    // the directory of our file's images may have been made by another
+    // process, so it must be ours and private to us
+    struct stat dirStat;
+    if (makeDir(dirPath) and makeDir(imageDir.str()) and (::lstat(imageDir.str().c_str(), &dirStat) == 0) and
+        S_ISDIR(dirStat.st_mode) and isOwnFile(dirStat) and ((dirStat.st_mode & (S_IRWXG | S_IRWXO)) == 0)) {
+        _imageDir = imageDir.str();
+    }
+}
+
+string Hdf5SharedChunkDir::getImagePath(const string &datasetPath, hsize_t start, size_t numBytes) const {
+    ostringstream path;
+    path << _imageDir << "/" << escapeName(datasetPath) << "@" << start << "+" << numBytes;
+    return path.str();
+}
+
+Hdf5SharedChunkDir::MappedImage Hdf5SharedChunkDir::map(const string &datasetPath, hsize_t start, size_t numBytes) {
+    if (not isEnabled()) {
+        return MappedImage();
+    }
+    int fd = ::open(getImagePath(datasetPath, start, numBytes).c_str(), O_RDONLY | O_NOFOLLOW);
+    if (fd < 0) {
+        _numMisses++;
+        return MappedImage();
+    }
+    struct stat imageStat;
+    void *data = MAP_FAILED;
+    if ((::fstat(fd, &imageStat) == 0) and S_ISREG(imageStat.st_mode) and isOwnFile(imageStat) and
+        (size_t(imageStat.st_size) == numBytes)) {
+        data = ::mmap(NULL, numBytes, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        _numMisses++;
+        return MappedImage();
+    }
+    _numMapped++;
+    return MappedImage(static_cast<const char *>(data),
+                       [numBytes](const char *data) { ::munmap(const_cast<char *>(data), numBytes); });
+}
+
+bool Hdf5SharedChunkDir::contains(const string &datasetPath, hsize_t start, size_t numBytes) const {
+    return isEnabled() and (::access(getImagePath(datasetPath, start, numBytes).c_str(), R_OK) == 0);
+}
+
+void Hdf5SharedChunkDir::store(const string &datasetPath, hsize_t start, const char *data, size_t numBytes) {
+    if (not isEnabled()) {
+        return;
+    }
+    string imagePath = getImagePath(datasetPath, start, numBytes);
+    // unique to the process, and to the thread through the address of data
+    ostringstream tmpPath;
+    tmpPath << imagePath << "." << ::getpid() << "." << hex << reinterpret_cast<uintptr_t>(data) << ".tmp";
+    int fd = ::open(tmpPath.str().c_str(), O_WRONLY | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        return;
+    }
+    size_t numWritten = 0;
+    while (numWritten < numBytes) {
+        ssize_t n = ::write(fd, data + numWritten, numBytes - numWritten);
+        if (n <= 0) {
+            break;
+        }
+        numWritten += n;
+    }
+    bool ok = (::close(fd) == 0) and (numWritten == numBytes);
+    if (ok and (::rename(tmpPath.str().c_str(), imagePath.c_str()) == 0)) {
+        _numStored++;
+    } else {
+        ::unlink(tmpPath.str().c_str());
+    }
+}
+
+void Hdf5SharedChunkDir::printStats(ostream &os) const {
+    os << "hdf5 shared chunk images: " << _numMapped << " mapped, " << _numMisses << " misses, " << _numStored << " stored"
+       << endl;
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HDF5SHAREDCHUNKDIR_H
+#define _HDF5SHAREDCHUNKDIR_H
+
+#include "halDefs.h"
+#include <H5Cpp.h>
+#include <atomic>
+#include <memory>
+#include <ostream>
+#include <string>
+
+namespace hal {
+
+    /**
+     * Directory of decompressed chunk images of a read-only HDF5 file,
+     * shared by all the processes reading the file.  The first process to
+     * page in a buffer of an array decompresses it as usual and stores the
+     * result as a file; later ones, and the same one after its own cache
+     * has evicted the buffer, map that file instead of decompressing it
+     * again, so the decompressed data lives once in the page cache.  Use a
+     * directory on tmpfs (/dev/shm) to keep the images in memory.
+     *
+     * Images are kept under a subdirectory named after the identity of
+     * the HAL file (device, inode, size and modification time), so a file
+     * that is rewritten gets fresh images, and are named after the path of
+     * the dataset in the file and the byte range of the buffer.  They are
+     * written to a temporary file then renamed, so a reader never sees a
+     * partial image.  Nothing is ever removed; stale subdirectories can be
+     * deleted at any time, as can the whole directory.
+     *
+     * The images are trusted as array data, so they are private to the
+     * user: the subdirectory of a file is created with mode 0700 and
+     * images with mode 0600, and a subdirectory or image that isn't owned
+     * by the user or that others can write to is ignored.  Processes of
+     * different users don't share images.
+     */
+    class Hdf5SharedChunkDir {
+      public:
+        /** Data of a mapped image, unmapped when the last copy is released */
+        typedef std::shared_ptr<const char> MappedImage;
+
+        /** Constructor
+         * @param dirPath directory to keep images in, created if needed
+         * @param halPath HAL file whose chunks are kept */
+        Hdf5SharedChunkDir(const std::string &dirPath, const std::string &halPath);
+
+        /** Check if images can be kept for the file, which must be a
+         * local file */
+        bool isEnabled() const {
+            return not _imageDir.empty();
+        }
+
+        /** Map the image of a buffer of a dataset
+         * @param datasetPath path of the dataset in the HDF5 file
+         * @param start offset in bytes of the buffer in the dataset
+         * @param numBytes size of the buffer in bytes
+         * @return the image, or NULL if it's not in the directory */
+        MappedImage map(const std::string &datasetPath, hsize_t start, size_t numBytes);
+
+        /** Check if the image of a buffer is in the directory, without
+         * counting a hit or miss */
+        bool contains(const std::string &datasetPath, hsize_t start, size_t numBytes) const;
+
+        /** Store the image of a buffer that has been decompressed, if
+         * the directory is writable (failures are ignored, as the
+         * buffer can always be decompressed again)
+         * @param datasetPath path of the dataset in the HDF5 file
+         * @param start offset in bytes of the buffer in the dataset
+         * @param data decompressed contents of the buffer
+         * @param numBytes size of the buffer in bytes */
+        void store(const std::string &datasetPath, hsize_t start, const char *data, size_t numBytes);
+
+        /** Get the number of buffers mapped rather than decompressed */
+        size_t getNumMapped() const {
+            return _numMapped;
+        }
+
+        /** Get the number of buffers that weren't in the directory */
+        size_t getNumMisses() const {
+            return _numMisses;
+        }
+
+        /** Get the number of images stored */
+        size_t getNumStored() const {
+            return _numStored;
+        }
+
+        /** Print statistics to a stream */
+        void printStats(std::ostream &os) const;
+
+      private:
+        std::string getImagePath(const std::string &datasetPath, hsize_t start, size_t numBytes) const;
+
+        /** Directory of the images of our HAL file (empty if disabled) */
+        std::string _imageDir;
+        std::atomic<size_t> _numMapped;
+        std::atomic<size_t> _numMisses;
+        std::atomic<size_t> _numStored;
+
+        Hdf5SharedChunkDir(const Hdf5SharedChunkDir &);
+        Hdf5SharedChunkDir &operator=(const Hdf5SharedChunkDir &);
+    };
+}
+#endif
+// Local Variables:
+// mode: c++
+// End:
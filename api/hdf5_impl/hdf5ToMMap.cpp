@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "hdf5ToMMap.h"
+#include "halSequence.h"
+#include "halSequenceIterator.h"
+#include "halThreadPool.h"
+#include "hdf5BottomSegment.h"
+#include "hdf5ExternalArray.h"
+#include "hdf5Genome.h"
+#include "hdf5TopSegment.h"
+#include "mmapGenome.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+using namespace H5;
+using namespace hal;
+
+/* number of bytes of segments read from the HDF5 file at once, rounded to
+ * whole chunks of the dataset */
+static const hsize_t segmentBatchBytes = 1 << 20;
+
+/* A genome being copied, with what the copying task needs to know about
+ * its neighbours so that it doesn't have to open them.  The genomes are
+ * only open (non-NULL) while something is being done with them. */
+struct Hdf5ToMMap::GenomeCopy {
+    string _name;
+    const Hdf5Genome *_inGenome;
+    MMapGenome *_outGenome;
+    /** Flag saying the genome is the root of the output alignment */
+    bool _isRoot;
+    /** Number of bottom segments of the parent (0 if none) */
+    hal_size_t _numParentSegments;
+    /** Number of top segments of each child of the output genome */
+    vector<hal_size_t> _numChildSegments;
+    /** Index of each child of the output genome among the children of the
+     * input genome */
+    vector<hal_size_t> _inChildIndex;
+    /** Sizes of the elements of the HDF5 segment arrays */
+    hsize_t _topElementSize;
+    hsize_t _bottomElementSize;
+};
+
+template <typename T> static T readField(const char *element, size_t offset) {
+    T value;
+    memcpy(&value, element + offset, sizeof(T));
+    return value;
+}
+
+/* check an index read from the HDF5 file refers to a segment of the genome
+ * it points into, so that setting it never has to widen an mmap column */
+static hal_index_t checkIndex(hal_index_t index, hal_size_t numSegments, const Genome *genome, const char *field,
+                              hsize_t segment) {
+    if ((index != NULL_INDEX) and ((index < 0) or (hal_size_t(index) >= numSegments))) {
+        throw hal_exception("invalid " + string(field) + " " + std::to_string(index) + " in segment " +
+                            std::to_string(segment) + " of genome " + genome->getName());
+    }
+    return index;
+}
+
+static hal_index_t checkPosition(hal_index_t position, hal_size_t length, const Genome *genome, hsize_t segment) {
+    if ((position < 0) or (hal_size_t(position) > length)) {
+        throw hal_exception("invalid start position " + std::to_string(position) + " in segment " +
+                            std::to_string(segment) + " of genome " + genome->getName());
+    }
+    return position;
+}
+
+Hdf5ToMMap::Hdf5ToMMap(const Hdf5Alignment *inAlignment, MMapAlignment *outAlignment)
+    : _inAlignment(inAlignment), _outAlignment(outAlignment) {
+}
+
+void Hdf5ToMMap::copyGenomes(const vector<string> &genomeNames, ostream *progress) {
+    // each genome is only open while it is being set up or copied, so a
+    // large subtree doesn't have all its HDF5 arrays loaded at once
+    vector<GenomeCopy> copies(genomeNames.size());
+    for (size_t i = 0; i < genomeNames.size(); i++) {
+        GenomeCopy &copy = copies[i];
+        copy._name = genomeNames[i];
+        openGenomes(copy);
+        if (progress != NULL) {
+            *progress << "Extracting " << genomeNames[i] << endl;
+        }
+        setDimensions(copy._inGenome, copy._outGenome);
+        const map<string, string> &meta = copy._inGenome->getMetaData()->getMap();
+        for (map<string, string>::const_iterator j = meta.begin(); j != meta.end(); ++j) {
+            copy._outGenome->getMetaData()->set(j->first, j->second);
+        }
+        initInputLayout(copy);
+        closeGenomes(copy);
+    }
+    for (GenomeCopy &copy : copies) {
+        openGenomes(copy);
+        copy._outGenome->fitSegmentColumns();
+        initGenomeCopy(copy);
+        closeGenomes(copy);
+    }
+
+    TaskGroup tasks;
+    for (GenomeCopy &copy : copies) {
+        tasks.run([this, &copy]() {
+            openGenomes(copy);
+            copyDna(copy);
+            copyTopSegments(copy);
+            copyBottomSegments(copy);
+            closeGenomes(copy);
+        });
+    }
+    tasks.wait();
+}
+
+/* open both genomes of a copy.  Opening and closing HDF5 genomes reads and
+ * updates the input alignment, so is serialized with the tasks' reads */
+void Hdf5ToMMap::openGenomes(GenomeCopy &copy) {
+    {
+        lock_guard<mutex> lock(_hdf5Lock);
+        copy._inGenome = dynamic_cast<const Hdf5Genome *>(_inAlignment->openGenome(copy._name));
+    }
+    copy._outGenome = dynamic_cast<MMapGenome *>(_outAlignment->openGenome(copy._name));
+    if ((copy._inGenome == NULL) or (copy._outGenome == NULL)) {
+        throw hal_exception("Genome not found: " + copy._name);
+    }
+}
+
+void Hdf5ToMMap::closeGenomes(GenomeCopy &copy) {
+    {
+        lock_guard<mutex> lock(_hdf5Lock);
+        _inAlignment->closeGenome(copy._inGenome);
+    }
+    _outAlignment->closeGenome(copy._outGenome);
+    copy._inGenome = NULL;
+    copy._outGenome = NULL;
+}
+
+void Hdf5ToMMap::setDimensions(const Genome *inGenome, MMapGenome *outGenome) {
+    bool root = _outAlignment->getParentName(inGenome->getName()).empty();
+    bool leaf = _outAlignment->getChildNames(inGenome->getName()).empty();
+    vector<Sequence::Info> dimensions;
+    for (SequenceIteratorPtr seqIt = inGenome->getSequenceIterator(); not seqIt->atEnd(); seqIt->toNext()) {
+        const Sequence *sequence = seqIt->getSequence();
+        dimensions.push_back(Sequence::Info(sequence->getName(), sequence->getSequenceLength(),
+                                            root ? 0 : sequence->getNumTopSegments(),
+                                            leaf ? 0 : sequence->getNumBottomSegments()));
+    }
+    outGenome->setDimensions(dimensions, true);
+}
+
+/* gather what the copying task needs to know about the input genome */
+void Hdf5ToMMap::initInputLayout(GenomeCopy &copy) {
+    const string &name = copy._name;
+    vector<string> inChildNames = _inAlignment->getChildNames(name);
+    for (const string &outChildName : _outAlignment->getChildNames(name)) {
+        vector<string>::const_iterator inChild = find(inChildNames.begin(), inChildNames.end(), outChildName);
+        if (inChild == inChildNames.end()) {
+            throw hal_exception("Genome " + outChildName + " is not a child of " + name + " in the input alignment");
+        }
+        if (hal_size_t(inChild - inChildNames.begin()) >= copy._inGenome->_numChildrenInBottomArray) {
+            throw hal_exception("bottom segment array of genome " + name + " has no entries for " + outChildName);
+        }
+        copy._inChildIndex.push_back(inChild - inChildNames.begin());
+    }
+    copy._topElementSize = copy._inGenome->_topArray.getSize() > 0 ? copy._inGenome->_topArray.getDataType().getSize() : 0;
+    copy._bottomElementSize =
+        copy._inGenome->_bottomArray.getSize() > 0 ? copy._inGenome->_bottomArray.getDataType().getSize() : 0;
+}
+
+/* gather what the copying task needs to know about the output genome's
+ * neighbours, once every genome has its dimensions */
+void Hdf5ToMMap::initGenomeCopy(GenomeCopy &copy) {
+    copy._isRoot = _outAlignment->getParentName(copy._name).empty();
+    const Genome *parent = copy._outGenome->getParent();
+    copy._numParentSegments = (parent != NULL) ? parent->getNumBottomSegments() : 0;
+    for (hal_size_t child = 0; child < copy._outGenome->getNumChildren(); child++) {
+        copy._numChildSegments.push_back(copy._outGenome->getChild(child)->getNumTopSegments());
+    }
+}
+
+void Hdf5ToMMap::copyDna(const GenomeCopy &copy) {
+    hal_size_t numBytes = (copy._outGenome->getSequenceLength() + 1) / 2;
+    if (numBytes == 0) {
+        return;
+    }
+    char *dna = copy._outGenome->getDNA(0, numBytes);
+    // both formats pack two bases per byte the same way
+    if (copy._inGenome->containsDNAArray()) {
+        if (copy._inGenome->_dnaArray.getSize() != numBytes) {
+            throw hal_exception("DNA array of genome " + copy._inGenome->getName() + " doesn't match its length");
+        }
+        copy._inGenome->_dnaArray.readRange(0, numBytes, dna, _hdf5Lock);
+    } else {
+        memset(dna, dnaPack('N', 1, dnaPack('N', 0, 0)), numBytes);
+    }
+}
+
+void Hdf5ToMMap::copyTopSegments(const GenomeCopy &copy) {
+    const Hdf5Genome *inGenome = copy._inGenome;
+    MMapGenome *outGenome = copy._outGenome;
+    hal_size_t numSegments = outGenome->getNumTopSegments();
+    if (numSegments == 0) {
+        return;
+    }
+    if (inGenome->_topArray.getSize() != numSegments + 1) {
+        throw hal_exception("top segment array of genome " + inGenome->getName() + " doesn't match its dimensions");
+    }
+    hal_size_t length = outGenome->getSequenceLength();
+    hal_size_t numBottomSegments = outGenome->getNumBottomSegments();
+    forEachBatch(inGenome->_topArray, copy._topElementSize, [&](hsize_t first, hsize_t count, const char *elements) {
+        for (hsize_t i = first; i < first + count; i++, elements += copy._topElementSize) {
+            outGenome->setTopStartPosition(
+                i, checkPosition(readField<hal_index_t>(elements, Hdf5TopSegment::genomeIndexOffset), length, inGenome, i));
+            if (i == numSegments) {
+                // the extra element only gives the end of the last segment
+                continue;
+            }
+            outGenome->setTopBottomParseIndex(i, checkIndex(readField<hal_index_t>(elements, Hdf5TopSegment::bottomIndexOffset),
+                                                            numBottomSegments, inGenome, "bottom parse index", i));
+            outGenome->setTopNextParalogyIndex(i, checkIndex(readField<hal_index_t>(elements, Hdf5TopSegment::parIndexOffset),
+                                                             numSegments, inGenome, "paralogy index", i));
+            outGenome->setTopParentIndex(i, checkIndex(readField<hal_index_t>(elements, Hdf5TopSegment::parentIndexOffset),
+                                                       copy._numParentSegments, inGenome, "parent index", i));
+            outGenome->setTopParentReversed(i, elements[Hdf5TopSegment::parentReversedOffset] != 0);
+        }
+    });
+}
+
+void Hdf5ToMMap::copyBottomSegments(const GenomeCopy &copy) {
+    const Hdf5Genome *inGenome = copy._inGenome;
+    MMapGenome *outGenome = copy._outGenome;
+    hal_size_t numSegments = outGenome->getNumBottomSegments();
+    if (numSegments == 0) {
+        return;
+    }
+    if (inGenome->_bottomArray.getSize() != numSegments + 1) {
+        throw hal_exception("bottom segment array of genome " + inGenome->getName() + " doesn't match its dimensions");
+    }
+    hal_size_t length = outGenome->getSequenceLength();
+    hal_size_t numTopSegments = outGenome->getNumTopSegments();
+    const size_t childSize = sizeof(hal_index_t) + sizeof(bool);
+    forEachBatch(inGenome->_bottomArray, copy._bottomElementSize, [&](hsize_t first, hsize_t count, const char *elements) {
+        for (hsize_t i = first; i < first + count; i++, elements += copy._bottomElementSize) {
+            outGenome->setBottomStartPosition(
+                i, checkPosition(readField<hal_index_t>(elements, Hdf5BottomSegment::genomeIndexOffset), length, inGenome, i));
+            if (i == numSegments) {
+                continue;
+            }
+            hal_index_t topParseIndex = NULL_INDEX;
+            if (not copy._isRoot) {
+                topParseIndex = checkIndex(readField<hal_index_t>(elements, Hdf5BottomSegment::topIndexOffset), numTopSegments,
+                                           inGenome, "top parse index", i);
+            }
+            outGenome->setBottomTopParseIndex(i, topParseIndex);
+            for (hal_size_t child = 0; child < copy._inChildIndex.size(); child++) {
+                size_t offset = Hdf5BottomSegment::firstChildOffset + copy._inChildIndex[child] * childSize;
+                outGenome->setBottomChildIndex(i, child, checkIndex(readField<hal_index_t>(elements, offset),
+                                                                    copy._numChildSegments[child], inGenome, "child index", i));
+                outGenome->setBottomChildReversed(i, child, elements[offset + sizeof(hal_index_t)] != 0);
+            }
+        }
+    });
+}
+
+/* read an HDF5 array in batches of whole chunks, calling func(first, count,
+ * elements) on each */
+template <typename Func> void Hdf5ToMMap::forEachBatch(const Hdf5ExternalArray &array, hsize_t elementSize, Func func) {
+    hsize_t batchSize = max(segmentBatchBytes / elementSize, hsize_t(1));
+    hsize_t chunkSize = array.getDatasetChunkSize();
+    if (chunkSize > 0) {
+        batchSize = max(batchSize / chunkSize, hsize_t(1)) * chunkSize;
+    }
+    vector<char> buffer(min(batchSize, array.getSize()) * elementSize);
+    for (hsize_t first = 0; first < array.getSize(); first += batchSize) {
+        hsize_t count = min(batchSize, array.getSize() - first);
+        array.readRange(first, count, buffer.data(), _hdf5Lock);
+        func(first, count, buffer.data());
+    }
+}
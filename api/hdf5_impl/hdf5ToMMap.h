@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HDF5TOMMAP_H
+#define _HDF5TOMMAP_H
+
+#include "hdf5Alignment.h"
+#include "mmapAlignment.h"
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace hal {
+    class Hdf5ExternalArray;
+    class MMapGenome;
+
+    /**
+     * Bulk copy of genomes from an HDF5 alignment to an mmap alignment.
+     * Rather than going through segment iterators one segment and one base
+     * at a time, whole chunks of the HDF5 arrays are read and their fields
+     * stored straight into the preallocated mmap arrays.
+     *
+     * Dimensions and metadata allocate space in the mmap file, so they are
+     * set for every genome first, in the calling thread.  The DNA and
+     * segments of each genome are then copied by a task on the shared
+     * ThreadPool.  HDF5 isn't thread-safe, so the tasks take turns reading
+     * raw chunks, and decode them in parallel.  Each task opens its genome
+     * and closes it when done, so only the genomes being copied are loaded.
+     */
+    class Hdf5ToMMap {
+      public:
+        /** Constructor
+         * @param inAlignment alignment to copy from
+         * @param outAlignment alignment to copy to, whose tree already has
+         * the genomes */
+        Hdf5ToMMap(const Hdf5Alignment *inAlignment, MMapAlignment *outAlignment);
+
+        /** Copy genomes, which must not have dimensions in the output
+         * alignment yet.  As with halExtract, the root of the output
+         * alignment gets no top segments and its leaves no bottom
+         * segments.
+         * @param genomeNames genomes to copy, parents before children
+         * @param progress stream to report each genome to, or NULL */
+        void copyGenomes(const std::vector<std::string> &genomeNames, std::ostream *progress);
+
+      private:
+        struct GenomeCopy;
+
+        void openGenomes(GenomeCopy &copy);
+        void closeGenomes(GenomeCopy &copy);
+        void setDimensions(const Genome *inGenome, MMapGenome *outGenome);
+        void initInputLayout(GenomeCopy &copy);
+        void initGenomeCopy(GenomeCopy &copy);
+        void copyDna(const GenomeCopy &copy);
+        void copyTopSegments(const GenomeCopy &copy);
+        void copyBottomSegments(const GenomeCopy &copy);
+        template <typename Func>
+        void forEachBatch(const Hdf5ExternalArray &array, hsize_t elementSize, Func func);
+
+        const Hdf5Alignment *_inAlignment;
+        MMapAlignment *_outAlignment;
+        /** Serializes HDF5 calls made by the copying tasks */
+        std::mutex _hdf5Lock;
+    };
+}
+
+#endif
+// Local Variables:
+// mode: c++
+// End:
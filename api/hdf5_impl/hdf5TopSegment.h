@@ -16,6 +16,8 @@
 namespace hal {
 
     class Hdf5TopSegment : public TopSegment {
+        friend class Hdf5ToMMap;
+
       public:
         /** Constructor
          * @param genome Smart pointer to genome to which segment belongs
@@ -9,6 +9,7 @@
 #include "halCLParser.h"
 #include "halCommon.h"
 #include "hdf5Alignment.h"
+#include "hdf5ToMMap.h"
 #include "mmapAlignment.h"
 #include <cassert>
 #include <cstdlib>
@@ -154,3 +155,13 @@ Alignment *hal::openHalAlignment(const std::string &path, const CLParser *option
                             STORAGE_FORMAT_MMAP);
     }
 }
+
+void hal::copyHdf5GenomesToMMap(const Alignment *inAlignment, Alignment *outAlignment, const vector<string> &genomeNames,
+                                ostream *progress) {
+    const Hdf5Alignment *hdf5Alignment = dynamic_cast<const Hdf5Alignment *>(inAlignment);
+    MMapAlignment *mmapAlignment = dynamic_cast<MMapAlignment *>(outAlignment);
+    if ((hdf5Alignment == NULL) or (mmapAlignment == NULL)) {
+        throw hal_exception("copying genomes in bulk needs an hdf5 input alignment and an mmap output alignment");
+    }
+    Hdf5ToMMap(hdf5Alignment, mmapAlignment).copyGenomes(genomeNames, progress);
+}
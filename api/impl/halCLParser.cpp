@@ -5,6 +5,7 @@
  * Released under the MIT license, see LICENSE.txt
  */
 #include "halCLParser.h"
+#include "halThreadPool.h"
 #include "hdf5Alignment.h"
 #include "mmapAlignment.h"
 #include <cassert>
@@ -27,6 +28,10 @@ CLParser::CLParser(unsigned mode) : _prefix("--"), _maxArgLen(0), _maxOptLen(0)
     Hdf5Alignment::defineOptions(this, mode);
     MMapAlignment::defineOptions(this, mode);
     addOption("format", "choose the back-end storage format.", STORAGE_FORMAT_HDF5);
+    addOption("numThreads", "number of threads to use (0 to use all cores)", 1);
+    addOption("ioStats", "file to write I/O statistics of each alignment to as a line of JSON when it is "
+                         "closed (- for stderr)",
+              "");
 #ifdef ENABLE_UDC
     // these can be used by multiple storage formats
     addOption("udcCacheDir", "udc cache path for *input* hal file(s).", "");
@@ -148,6 +153,7 @@ void CLParser::parseOptions(int argc, char **argv) {
     if (argNum != _args.size()) {
         throw hal_exception("Too few (required positional) arguments");
     }
+    ThreadPool::setSharedNumThreads(getOption<size_t>("numThreads"));
 #ifdef ENABLE_UDC
     const string &udcCacheDir = getOption<const string &>("udcCacheDir");
     if (not udcCacheDir.empty()) {
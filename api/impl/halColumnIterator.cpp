@@ -19,7 +19,7 @@ ColumnIterator::ColumnIterator(const Genome *reference, const set<const Genome *
                                hal_index_t lastColumnIndex, hal_size_t maxInsertLength, bool noDupes, bool noAncestors,
                                bool reverseStrand, bool unique, bool onlyOrthologs)
     : _maxInsertionLength(maxInsertLength), _noDupes(noDupes), _noAncestors(noAncestors),
-      _treeCache(NULL), _unique(unique), _onlyOrthologs(onlyOrthologs) {
+      _treeCache(NULL), _unique(unique), _onlyOrthologs(onlyOrthologs), _readerGenome(NULL), _readColumns(false) {
     assert(columnIndex >= 0 && lastColumnIndex >= columnIndex && lastColumnIndex < (hal_index_t)reference->getSequenceLength());
     // allocate temp iterators
     if (reference->getNumTopSegments() > 0) {
@@ -269,9 +269,7 @@ void ColumnIterator::recursiveUpdate(bool init) {
 
             // catch up to nextfreeindex
             linkTopIt->_it->slice(0, 0);
-            while (linkTopIt->_it->overlaps(_stack.top()->_index) == false) {
-                linkTopIt->_it->toRight();
-            }
+            toSegmentContaining(linkTopIt->_it.get(), _stack.top()->_index);
             bool rev = linkTopIt->_it->getReversed();
             if (rev == true) {
                 linkTopIt->_it->toReverseInPlace();
@@ -318,9 +316,7 @@ void ColumnIterator::recursiveUpdate(bool init) {
 
             // catch up to nextfreeindex
             linkBotIt->_it->slice(0, 0);
-            while (linkBotIt->_it->overlaps(_stack.top()->_index) == false) {
-                linkBotIt->_it->toRight();
-            }
+            toSegmentContaining(linkBotIt->_it.get(), _stack.top()->_index);
             bool rev = linkBotIt->_it->getReversed();
             if (rev == true) {
                 linkBotIt->_it->toReverseInPlace();
@@ -353,6 +349,42 @@ void ColumnIterator::recursiveUpdate(bool init) {
     }
 }
 
+/* the index of the segment containing a position, scanning from a
+ * segment in the direction of an iterator over its array */
+template <class Reader>
+static hal_index_t scanToSegment(const Reader &reader, bool top, hal_index_t index, bool reversed,
+                                 hal_index_t position) {
+    while (true) {
+        hal_index_t start = top ? reader.getTopStartPosition(index) : reader.getBottomStartPosition(index);
+        hal_index_t length = (hal_index_t)(top ? reader.getTopLength(index) : reader.getBottomLength(index));
+        if ((start <= position) && (position < start + length)) {
+            return index;
+        }
+        index += reversed ? -1 : 1;
+    }
+}
+
+/* Move an unsliced iterator right until its segment contains the position,
+ * as repeated toRight() calls would, reading the segments directly */
+void ColumnIterator::toSegmentContaining(SegmentIterator *segIt, hal_index_t position) {
+    assert(segIt->getStartOffset() == 0 && segIt->getEndOffset() == 0);
+    Genome *genome = segIt->getGenome();
+    if (genome != _readerGenome) {
+        _readerGenome = genome;
+        _readColumns = _columnReader.open(genome);
+        if (not _readColumns) {
+            _virtualReader.open(genome);
+        }
+    }
+    hal_index_t index =
+        _readColumns
+            ? scanToSegment(_columnReader, segIt->isTop(), segIt->getArrayIndex(), segIt->getReversed(), position)
+            : scanToSegment(_virtualReader, segIt->isTop(), segIt->getArrayIndex(), segIt->getReversed(), position);
+    if (index != segIt->getArrayIndex()) {
+        segIt->setArrayIndex(genome, index);
+    }
+}
+
 bool ColumnIterator::handleDeletion(const TopSegmentIteratorPtr &inputTopSegIt) {
     if (_maxInsertionLength > 0 && inputTopSegIt->tseg()->hasParent() == true) {
         _top->copy(inputTopSegIt);
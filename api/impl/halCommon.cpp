@@ -8,6 +8,7 @@
 #include "halAlignment.h"
 #include "halGenome.h"
 #include <cassert>
+#include <cstring>
 #include <map>
 #include <sstream>
 #include <sys/stat.h>
@@ -53,7 +54,10 @@ hal_index_t hal::strToInt(const string &str) {
 
 
 void hal::reverseComplement(std::string &s) {
-    if (!s.empty()) {
+    if (memchr(s.data(), '-', s.length()) == NULL) {
+        // no gaps to keep in place, so use the bulk kernel
+        dnaReverseComplement(&s[0], s.length());
+    } else {
         size_t j = s.length() - 1;
         size_t i = 0;
         char buf;
@@ -0,0 +1,304 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/* Bulk DNA decoding and reverse complement.  Each operation has a scalar
+ * implementation and, on x86, SSE4 and AVX2 implementations that are
+ * compiled with per-function target attributes and selected at run time
+ * based on the CPU, so the library itself is still built for the baseline
+ * instruction set. */
+
+#include "halCommon.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAL_DNA_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+using namespace hal;
+
+namespace {
+    /* Decoded pairs of bases for every packed byte, used to unpack two bases
+     * per table lookup.  The reverse complement table gives the complement
+     * of the low nibble followed by that of the high nibble. */
+    struct DnaTables {
+        char forward[256][2];
+        char reverseComplement[256][2];
+        char complement[256];
+        DnaTables() {
+            for (int b = 0; b < 256; ++b) {
+                forward[b][0] = dnaUnpackMap[b >> 4];
+                forward[b][1] = dnaUnpackMap[b & 0x0F];
+                reverseComplement[b][0] = hal::reverseComplement(forward[b][1]);
+                reverseComplement[b][1] = hal::reverseComplement(forward[b][0]);
+                complement[b] = hal::reverseComplement(char(b));
+            }
+        }
+    };
+
+    /* built on first use rather than by a static constructor, so the
+     * kernels work when called during the static initialization of other
+     * translation units */
+    const DnaTables &getDnaTables() {
+        static const DnaTables dnaTables;
+        return dnaTables;
+    }
+
+    /* Kernels work on whole packed bytes, so the callers deal with ranges
+     * that start or end in the middle of a byte. */
+    struct DnaKernels {
+        /* unpack the 2 * numBytes bases in packed */
+        void (*unpack)(const unsigned char *packed, size_t numBytes, char *out);
+        /* unpack the reverse complement of the 2 * numBytes bases in packed */
+        void (*unpackReverseComplement)(const unsigned char *packed, size_t numBytes, char *out);
+        /* reverse complement length characters in place */
+        void (*reverseComplement)(char *s, size_t length);
+    };
+
+    void unpackScalar(const unsigned char *packed, size_t numBytes, char *out) {
+        const DnaTables &dnaTables = getDnaTables();
+        for (size_t i = 0; i < numBytes; ++i, out += 2) {
+            memcpy(out, dnaTables.forward[packed[i]], 2);
+        }
+    }
+
+    void unpackReverseComplementScalar(const unsigned char *packed, size_t numBytes, char *out) {
+        const DnaTables &dnaTables = getDnaTables();
+        for (size_t i = numBytes; i > 0; --i, out += 2) {
+            memcpy(out, dnaTables.reverseComplement[packed[i - 1]], 2);
+        }
+    }
+
+    /* reverse complement the characters between two pointers, ending
+     * inclusive */
+    void reverseComplementBetween(char *first, char *last) {
+        const DnaTables &dnaTables = getDnaTables();
+        for (; first < last; ++first, --last) {
+            char c = dnaTables.complement[uint8_t(*first)];
+            *first = dnaTables.complement[uint8_t(*last)];
+            *last = c;
+        }
+        if (first == last) {
+            *first = dnaTables.complement[uint8_t(*first)];
+        }
+    }
+
+    void reverseComplementScalar(char *s, size_t length) {
+        if (length > 0) {
+            reverseComplementBetween(s, s + length - 1);
+        }
+    }
+
+    const DnaKernels scalarKernels = {unpackScalar, unpackReverseComplementScalar, reverseComplementScalar};
+
+#ifdef HAL_DNA_KERNELS_X86
+    /* complement characters: a<->t is xor 0x15 and c<->g is xor 0x04 in
+     * either case, everything else is unchanged */
+    __attribute__((target("sse4.1"))) inline __m128i complementSse4(__m128i v) {
+        __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        __m128i at = _mm_or_si128(_mm_cmpeq_epi8(lower, _mm_set1_epi8('a')), _mm_cmpeq_epi8(lower, _mm_set1_epi8('t')));
+        __m128i cg = _mm_or_si128(_mm_cmpeq_epi8(lower, _mm_set1_epi8('c')), _mm_cmpeq_epi8(lower, _mm_set1_epi8('g')));
+        __m128i flip = _mm_or_si128(_mm_and_si128(at, _mm_set1_epi8(0x15)), _mm_and_si128(cg, _mm_set1_epi8(0x04)));
+        return _mm_xor_si128(v, flip);
+    }
+
+    __attribute__((target("sse4.1"))) inline __m128i reverseBytesSse4(__m128i v) {
+        return _mm_shuffle_epi8(v, _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0));
+    }
+
+    /* decode 16 packed bytes with a 16 entry table, reversing the order of
+     * the nibbles if requested */
+    __attribute__((target("sse4.1"))) inline void decodeSse4(__m128i v, __m128i table, bool reverse, char *out) {
+        __m128i mask = _mm_set1_epi8(0x0F);
+        __m128i high = _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(v, 4), mask));
+        __m128i low = _mm_shuffle_epi8(table, _mm_and_si128(v, mask));
+        if (reverse) {
+            std::swap(high, low);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_unpacklo_epi8(high, low));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 16), _mm_unpackhi_epi8(high, low));
+    }
+
+    __attribute__((target("sse4.1"))) void unpackSse4(const unsigned char *packed, size_t numBytes, char *out) {
+        __m128i table = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dnaUnpackMap));
+        size_t i = 0;
+        for (; i + 16 <= numBytes; i += 16, out += 32) {
+            decodeSse4(_mm_loadu_si128(reinterpret_cast<const __m128i *>(packed + i)), table, false, out);
+        }
+        unpackScalar(packed + i, numBytes - i, out);
+    }
+
+    __attribute__((target("sse4.1"))) void unpackReverseComplementSse4(const unsigned char *packed, size_t numBytes,
+                                                                       char *out) {
+        __m128i table = complementSse4(_mm_loadu_si128(reinterpret_cast<const __m128i *>(dnaUnpackMap)));
+        size_t i = numBytes;
+        for (; i >= 16; i -= 16, out += 32) {
+            __m128i v = reverseBytesSse4(_mm_loadu_si128(reinterpret_cast<const __m128i *>(packed + i - 16)));
+            decodeSse4(v, table, true, out);
+        }
+        unpackReverseComplementScalar(packed, i, out);
+    }
+
+    __attribute__((target("sse4.1"))) void reverseComplementSse4(char *s, size_t length) {
+        char *first = s;
+        char *last = s + length; // exclusive
+        for (; last - first >= 32; first += 16, last -= 16) {
+            __m128i front = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first));
+            __m128i back = _mm_loadu_si128(reinterpret_cast<const __m128i *>(last - 16));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(first), complementSse4(reverseBytesSse4(back)));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(last - 16), complementSse4(reverseBytesSse4(front)));
+        }
+        reverseComplementScalar(first, last - first);
+    }
+
+    const DnaKernels sse4Kernels = {unpackSse4, unpackReverseComplementSse4, reverseComplementSse4};
+
+    __attribute__((target("avx2"))) inline __m256i complementAvx2(__m256i v) {
+        __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        __m256i at =
+            _mm256_or_si256(_mm256_cmpeq_epi8(lower, _mm256_set1_epi8('a')), _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('t')));
+        __m256i cg =
+            _mm256_or_si256(_mm256_cmpeq_epi8(lower, _mm256_set1_epi8('c')), _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('g')));
+        __m256i flip =
+            _mm256_or_si256(_mm256_and_si256(at, _mm256_set1_epi8(0x15)), _mm256_and_si256(cg, _mm256_set1_epi8(0x04)));
+        return _mm256_xor_si256(v, flip);
+    }
+
+    __attribute__((target("avx2"))) inline __m256i reverseBytesAvx2(__m256i v) {
+        __m256i reversedLanes = _mm256_shuffle_epi8(v, _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+                                                                        15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0));
+        return _mm256_permute4x64_epi64(reversedLanes, 0x4E);
+    }
+
+    /* decode 32 packed bytes; the interleave works within 128-bit lanes, so
+     * the halves are put back in order when storing */
+    __attribute__((target("avx2"))) inline void decodeAvx2(__m256i v, __m256i table, bool reverse, char *out) {
+        __m256i mask = _mm256_set1_epi8(0x0F);
+        __m256i high = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), mask));
+        __m256i low = _mm256_shuffle_epi8(table, _mm256_and_si256(v, mask));
+        if (reverse) {
+            std::swap(high, low);
+        }
+        __m256i first = _mm256_unpacklo_epi8(high, low);
+        __m256i second = _mm256_unpackhi_epi8(high, low);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 32), _mm256_permute2x128_si256(first, second, 0x31));
+    }
+
+    __attribute__((target("avx2"))) void unpackAvx2(const unsigned char *packed, size_t numBytes, char *out) {
+        __m256i table = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(dnaUnpackMap)));
+        size_t i = 0;
+        for (; i + 32 <= numBytes; i += 32, out += 64) {
+            decodeAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(packed + i)), table, false, out);
+        }
+        unpackScalar(packed + i, numBytes - i, out);
+    }
+
+    __attribute__((target("avx2"))) void unpackReverseComplementAvx2(const unsigned char *packed, size_t numBytes,
+                                                                     char *out) {
+        __m256i table =
+            complementAvx2(_mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(dnaUnpackMap))));
+        size_t i = numBytes;
+        for (; i >= 32; i -= 32, out += 64) {
+            __m256i v = reverseBytesAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(packed + i - 32)));
+            decodeAvx2(v, table, true, out);
+        }
+        unpackReverseComplementScalar(packed, i, out);
+    }
+
+    __attribute__((target("avx2"))) void reverseComplementAvx2(char *s, size_t length) {
+        char *first = s;
+        char *last = s + length; // exclusive
+        for (; last - first >= 64; first += 32, last -= 32) {
+            __m256i front = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first));
+            __m256i back = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(last - 32));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(first), complementAvx2(reverseBytesAvx2(back)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(last - 32), complementAvx2(reverseBytesAvx2(front)));
+        }
+        reverseComplementScalar(first, last - first);
+    }
+
+    const DnaKernels avx2Kernels = {unpackAvx2, unpackReverseComplementAvx2, reverseComplementAvx2};
+#endif
+
+    /* best level supported by this CPU */
+    DnaKernelLevel getMaxDnaKernelLevel() {
+#ifdef HAL_DNA_KERNELS_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return DNA_KERNEL_AVX2;
+        } else if (__builtin_cpu_supports("sse4.1")) {
+            return DNA_KERNEL_SSE4;
+        }
+#endif
+        return DNA_KERNEL_SCALAR;
+    }
+
+    const DnaKernels *getKernels(DnaKernelLevel level) {
+        switch (level) {
+#ifdef HAL_DNA_KERNELS_X86
+        case DNA_KERNEL_AVX2:
+            return &avx2Kernels;
+        case DNA_KERNEL_SSE4:
+            return &sse4Kernels;
+#endif
+        default:
+            return &scalarKernels;
+        }
+    }
+
+    /* constant-initialized to the scalar kernels, whose tables are built
+     * on first use, so usable before the CPU check */
+    DnaKernelLevel dnaKernelLevel = DNA_KERNEL_SCALAR;
+    const DnaKernels *dnaKernels = &scalarKernels;
+    const DnaKernelLevel initialDnaKernelLevel = hal::setDnaKernelLevel(getMaxDnaKernelLevel());
+}
+
+DnaKernelLevel hal::getDnaKernelLevel() {
+    return dnaKernelLevel;
+}
+
+DnaKernelLevel hal::setDnaKernelLevel(DnaKernelLevel level) {
+    dnaKernelLevel = std::min(level, getMaxDnaKernelLevel());
+    dnaKernels = getKernels(dnaKernelLevel);
+    return dnaKernelLevel;
+}
+
+void hal::dnaUnpackString(const unsigned char *packed, hal_size_t offset, hal_size_t length, char *out) {
+    const unsigned char *p = packed + offset / 2;
+    if ((offset & 1) && (length > 0)) {
+        *out++ = dnaUnpackMap[*p++ & 0x0F];
+        --length;
+    }
+    dnaKernels->unpack(p, length / 2, out);
+    if (length & 1) {
+        out[length - 1] = dnaUnpackMap[p[length / 2] >> 4];
+    }
+}
+
+void hal::dnaUnpackReverseComplement(const unsigned char *packed, hal_size_t offset, hal_size_t length, char *out) {
+    if (length == 0) {
+        return;
+    }
+    hal_size_t end = offset + length; // exclusive
+    if (end & 1) {
+        // last base is in a high nibble
+        *out++ = reverseComplement(dnaUnpackMap[packed[end / 2] >> 4]);
+        --length;
+        --end;
+    }
+    // whole bytes ending at end
+    hal_size_t numBytes = length / 2;
+    dnaKernels->unpackReverseComplement(packed + end / 2 - numBytes, numBytes, out);
+    if (length & 1) {
+        out[length - 1] = reverseComplement(dnaUnpackMap[packed[offset / 2] & 0x0F]);
+    }
+}
+
+void hal::dnaReverseComplement(char *s, hal_size_t length) {
+    dnaKernels->reverseComplement(s, length);
+}
@@ -260,6 +260,23 @@ void hal::Genome::copyMetadata(Genome *dest) const {
     }
 }
 
+void hal::Genome::getSequencesBySites(const vector<hal_size_t> &positions, vector<const Sequence *> &sequences) const {
+    sequences.resize(positions.size());
+    const Sequence *sequence = NULL;
+    hal_size_t seqStart = 0, seqEnd = 0;
+    for (size_t i = 0; i < positions.size(); i++) {
+        assert((i == 0) || (positions[i - 1] <= positions[i]));
+        if ((sequence == NULL) || (positions[i] < seqStart) || (positions[i] >= seqEnd)) {
+            sequence = getSequenceBySite(positions[i]);
+            if (sequence != NULL) {
+                seqStart = sequence->getStartPosition();
+                seqEnd = seqStart + sequence->getSequenceLength();
+            }
+        }
+        sequences[i] = sequence;
+    }
+}
+
 void hal::Genome::fixParseInfo() {
     if (getParent() == NULL || getNumChildren() == 0) {
         return;
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+#include "halIoStats.h"
+#include "halAlignment.h"
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <sstream>
+
+using namespace std;
+using namespace hal;
+
+void IoStats::merge(const IoStats &other) {
+    for (const auto &genome : other._genomes) {
+        for (const auto &array : genome.second) {
+            for (const auto &counter : array.second) {
+                add(genome.first, array.first, counter.first, counter.second);
+            }
+        }
+    }
+    for (const auto &counter : other._file) {
+        addFile(counter.first, counter.second);
+    }
+}
+
+double IoStats::get(const string &genomeName, const string &arrayName, const string &counterName) const {
+    map<string, ArrayCounters>::const_iterator genomeIt = _genomes.find(genomeName);
+    if (genomeIt == _genomes.end()) {
+        return 0;
+    }
+    ArrayCounters::const_iterator arrayIt = genomeIt->second.find(arrayName);
+    if (arrayIt == genomeIt->second.end()) {
+        return 0;
+    }
+    Counters::const_iterator counterIt = arrayIt->second.find(counterName);
+    return (counterIt == arrayIt->second.end()) ? 0 : counterIt->second;
+}
+
+double IoStats::getFile(const string &counterName) const {
+    Counters::const_iterator counterIt = _file.find(counterName);
+    return (counterIt == _file.end()) ? 0 : counterIt->second;
+}
+
+/* write a JSON string, escaping quotes, backslashes and control
+ * characters */
+static void writeJsonString(ostream &os, const string &str) {
+    os << '"';
+    for (unsigned char c : str) {
+        if ((c == '"') or (c == '\\')) {
+            os << '\\' << c;
+        } else if (c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            os << escaped;
+        } else {
+            os << c;
+        }
+    }
+    os << '"';
+}
+
+/* write counts as integers, and times with enough digits */
+static void writeJsonNumber(ostream &os, double value) {
+    char buf[32];
+    if ((value == floor(value)) and (fabs(value) < 9.0e15)) {
+        snprintf(buf, sizeof(buf), "%.0f", value);
+    } else {
+        snprintf(buf, sizeof(buf), "%.9g", value);
+    }
+    os << buf;
+}
+
+static void writeJsonCounters(ostream &os, const IoStats::Counters &counters) {
+    os << "{";
+    for (IoStats::Counters::const_iterator it = counters.begin(); it != counters.end(); ++it) {
+        os << ((it == counters.begin()) ? "" : ", ");
+        writeJsonString(os, it->first);
+        os << ": ";
+        writeJsonNumber(os, it->second);
+    }
+    os << "}";
+}
+
+void IoStats::writeJson(ostream &os, const string &path, const string &format) const {
+    os << "{\"path\": ";
+    writeJsonString(os, path);
+    os << ", \"format\": ";
+    writeJsonString(os, format);
+    os << ", \"file\": ";
+    writeJsonCounters(os, _file);
+    os << ", \"genomes\": {";
+    for (map<string, ArrayCounters>::const_iterator genomeIt = _genomes.begin(); genomeIt != _genomes.end(); ++genomeIt) {
+        os << ((genomeIt == _genomes.begin()) ? "" : ", ");
+        writeJsonString(os, genomeIt->first);
+        os << ": {";
+        for (ArrayCounters::const_iterator arrayIt = genomeIt->second.begin(); arrayIt != genomeIt->second.end();
+             ++arrayIt) {
+            os << ((arrayIt == genomeIt->second.begin()) ? "" : ", ");
+            writeJsonString(os, arrayIt->first);
+            os << ": ";
+            writeJsonCounters(os, arrayIt->second);
+        }
+        os << "}";
+    }
+    os << "}}" << endl;
+}
+
+void hal::writeIoStats(const Alignment *alignment, const string &alignmentPath, const string &path) {
+    IoStats stats;
+    alignment->getIoStats(stats);
+    ostringstream line;
+    stats.writeJson(line, alignmentPath, alignment->getStorageFormat());
+    if (path == "-") {
+        cerr << line.str();
+        return;
+    }
+    // files are truncated the first time the process writes to them
+    static mutex writtenLock;
+    static set<string> writtenPaths;
+    lock_guard<mutex> guard(writtenLock);
+    bool append = not writtenPaths.insert(path).second;
+    ofstream out(path.c_str(), append ? ios::app : ios::trunc);
+    out << line.str();
+    if (not out) {
+        throw hal_errno_exception(path, "writing I/O statistics failed", errno);
+    }
+}
+
+void hal::writeIoStatsOnClose(const Alignment *alignment, const string &alignmentPath, const string &path) {
+    // called from destructors, which mustn't throw
+    try {
+        writeIoStats(alignment, alignmentPath, path);
+    } catch (const exception &e) {
+        cerr << "warning: " << e.what() << endl;
+    }
+}
+
+void hal::checkIoStatsPath(const string &path) {
+    if (path.empty() or (path == "-")) {
+        return;
+    }
+    ofstream out(path.c_str(), ios::app);
+    if (not out) {
+        throw hal_errno_exception(path, "can't open --ioStats file", errno);
+    }
+}
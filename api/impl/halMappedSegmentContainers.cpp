@@ -0,0 +1,254 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+#include "halMappedSegmentContainers.h"
+#include "halMappedSegment.h"
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+using namespace std;
+using namespace hal;
+
+namespace {
+    /* a segment with its bounds, which are read once.  Ranks order
+     * segments that turn out equal: the one with the lowest rank is kept,
+     * so the segments of the set win over the ones added, and those added
+     * first over the later ones. */
+    struct Piece {
+        hal_index_t _targetMin;
+        hal_index_t _targetMax;
+        hal_index_t _sourceMin;
+        hal_index_t _sourceMax;
+        size_t _rank;
+        MappedSegmentPtr _segment;
+    };
+
+    hal_index_t getMinPosition(const SlicedSegment *segment) {
+        return min(segment->getStartPosition(), segment->getEndPosition());
+    }
+
+    hal_index_t getMaxPosition(const SlicedSegment *segment) {
+        return max(segment->getStartPosition(), segment->getEndPosition());
+    }
+
+    Piece makePiece(const MappedSegmentPtr &segment, size_t rank) {
+        Piece piece;
+        piece._targetMin = getMinPosition(segment->getTarget());
+        piece._targetMax = getMaxPosition(segment->getTarget());
+        piece._sourceMin = getMinPosition(segment->getSource());
+        piece._sourceMax = getMaxPosition(segment->getSource());
+        piece._rank = rank;
+        piece._segment = segment;
+        return piece;
+    }
+
+    /* the order of MappedSegmentLess, by target then source bounds,
+     * then by rank */
+    bool lessByBounds(const Piece &p1, const Piece &p2) {
+        if (p1._targetMin != p2._targetMin) {
+            return p1._targetMin < p2._targetMin;
+        } else if (p1._targetMax != p2._targetMax) {
+            return p1._targetMax < p2._targetMax;
+        } else if (p1._sourceMin != p2._sourceMin) {
+            return p1._sourceMin < p2._sourceMin;
+        } else if (p1._sourceMax != p2._sourceMax) {
+            return p1._sourceMax < p2._sourceMax;
+        }
+        return p1._rank < p2._rank;
+    }
+
+    bool equalBounds(const Piece &p1, const Piece &p2) {
+        return p1._targetMin == p2._targetMin && p1._targetMax == p2._targetMax && p1._sourceMin == p2._sourceMin &&
+               p1._sourceMax == p2._sourceMax;
+    }
+
+    /* cut a segment at every breakpoint strictly inside its target range:
+     * a breakpoint is the first position of a range, or the one after its
+     * last.  The segment itself becomes the leftmost piece. */
+    void cutAtBreakpoints(const Piece &piece, const vector<hal_index_t> &breakpoints, vector<Piece> &pieces) {
+        vector<hal_index_t>::const_iterator bp = upper_bound(breakpoints.begin(), breakpoints.end(), piece._targetMin);
+        if (bp == breakpoints.end() || *bp > piece._targetMax) {
+            pieces.push_back(piece);
+            return;
+        }
+        MappedSegmentPtr segment = piece._segment;
+        hal_offset_t startOffset = segment->getStartOffset();
+        hal_offset_t endOffset = segment->getEndOffset();
+        bool reversed = segment->getReversed();
+        hal_index_t leftmostEnd = *bp - 1;
+        for (hal_index_t start = *bp; start <= piece._targetMax; start = *bp) {
+            ++bp;
+            hal_index_t end = (bp == breakpoints.end() || *bp > piece._targetMax) ? piece._targetMax : *bp - 1;
+            hal_offset_t leftCut = start - piece._targetMin;
+            hal_offset_t rightCut = piece._targetMax - end;
+            if (reversed) {
+                swap(leftCut, rightCut);
+            }
+            MappedSegmentPtr right(segment->clone());
+            right->slice(startOffset + leftCut, endOffset + rightCut);
+            assert(getMinPosition(right->getTarget()) == start && getMaxPosition(right->getTarget()) == end);
+            pieces.push_back(makePiece(right, piece._rank));
+            if (end == piece._targetMax) {
+                break;
+            }
+        }
+        hal_offset_t rightCut = piece._targetMax - leftmostEnd;
+        if (reversed) {
+            segment->slice(startOffset + rightCut, endOffset);
+        } else {
+            segment->slice(startOffset, endOffset + rightCut);
+        }
+        pieces.push_back(makePiece(segment, piece._rank));
+    }
+}
+
+pair<MappedSegmentSet::iterator, bool> MappedSegmentSet::insert(const MappedSegmentPtr &segment) {
+    resolve();
+    MappedSegmentLess less;
+    // segments often come in order
+    if (_segments.empty() || less(_segments.back(), segment)) {
+        _segments.push_back(segment);
+        return make_pair(_segments.end() - 1, true);
+    }
+    iterator pos = std::lower_bound(_segments.begin(), _segments.end(), segment, less);
+    if (pos != _segments.end() && !less(segment, *pos)) {
+        return make_pair(pos, false);
+    }
+    return make_pair(_segments.insert(pos, segment), true);
+}
+
+MappedSegmentSet::iterator MappedSegmentSet::erase(const_iterator pos) {
+    resolve();
+    return _segments.erase(pos);
+}
+
+MappedSegmentSet::iterator MappedSegmentSet::erase(const_iterator first, const_iterator last) {
+    resolve();
+    return _segments.erase(first, last);
+}
+
+size_t MappedSegmentSet::erase(const MappedSegmentPtr &segment) {
+    iterator pos = find(segment);
+    if (pos == _segments.end()) {
+        return 0;
+    }
+    _segments.erase(pos);
+    return 1;
+}
+
+MappedSegmentSet::iterator MappedSegmentSet::find(const MappedSegmentPtr &segment) {
+    iterator pos = lower_bound(segment);
+    return (pos != _segments.end() && !MappedSegmentLess()(segment, *pos)) ? pos : _segments.end();
+}
+
+MappedSegmentSet::const_iterator MappedSegmentSet::find(const MappedSegmentPtr &segment) const {
+    const_iterator pos = lower_bound(segment);
+    return (pos != _segments.end() && !MappedSegmentLess()(segment, *pos)) ? pos : _segments.end();
+}
+
+MappedSegmentSet::iterator MappedSegmentSet::lower_bound(const MappedSegmentPtr &segment) {
+    resolve();
+    return std::lower_bound(_segments.begin(), _segments.end(), segment, MappedSegmentLess());
+}
+
+MappedSegmentSet::const_iterator MappedSegmentSet::lower_bound(const MappedSegmentPtr &segment) const {
+    assert(isResolved());
+    return std::lower_bound(_segments.begin(), _segments.end(), segment, MappedSegmentLess());
+}
+
+MappedSegmentSet::iterator MappedSegmentSet::upper_bound(const MappedSegmentPtr &segment) {
+    resolve();
+    return std::upper_bound(_segments.begin(), _segments.end(), segment, MappedSegmentLess());
+}
+
+MappedSegmentSet::const_iterator MappedSegmentSet::upper_bound(const MappedSegmentPtr &segment) const {
+    assert(isResolved());
+    return std::upper_bound(_segments.begin(), _segments.end(), segment, MappedSegmentLess());
+}
+
+void MappedSegmentSet::breakOverlaps() {
+    // the added segments, and the breakpoints of their target ranges
+    vector<Piece> added;
+    vector<hal_index_t> breakpoints;
+    added.reserve(_unresolved.size());
+    breakpoints.reserve(2 * _unresolved.size());
+    hal_index_t addedMin = numeric_limits<hal_index_t>::max();
+    hal_index_t addedMax = numeric_limits<hal_index_t>::min();
+    for (size_t i = 0; i < _unresolved.size(); ++i) {
+        assert(_unresolved[i]->getLength() == _unresolved[i]->getSource()->getLength());
+        added.push_back(makePiece(_unresolved[i], i + 1));
+        breakpoints.push_back(added.back()._targetMin);
+        breakpoints.push_back(added.back()._targetMax + 1);
+        addedMin = min(addedMin, added.back()._targetMin);
+        addedMax = max(addedMax, added.back()._targetMax);
+    }
+    _unresolved.clear();
+    sort(added.begin(), added.end(),
+         [](const Piece &p1, const Piece &p2) { return p1._targetMin < p2._targetMin; });
+
+    // The targets of the segments of the set are the same or disjoint, so
+    // sorted by their first position they are also sorted by their last.
+    // Sweep over those in the span of the added segments, keeping the
+    // furthest an added segment starting before each reaches, to pick
+    // the ones overlapping an added segment.
+    vector<Piece> pieces;
+    vector<size_t> overlapped;
+    vector<MappedSegmentPtr>::iterator first =
+        partition_point(_segments.begin(), _segments.end(), [addedMin](const MappedSegmentPtr &segment) {
+            return getMaxPosition(segment->getTarget()) < addedMin;
+        });
+    vector<Piece>::const_iterator addedIt = added.begin();
+    hal_index_t reach = numeric_limits<hal_index_t>::min();
+    for (vector<MappedSegmentPtr>::iterator i = first; i != _segments.end(); ++i) {
+        Piece piece = makePiece(*i, 0);
+        if (piece._targetMin > addedMax) {
+            break;
+        }
+        for (; addedIt != added.end() && addedIt->_targetMin <= piece._targetMax; ++addedIt) {
+            reach = max(reach, addedIt->_targetMax);
+        }
+        if (reach >= piece._targetMin) {
+            overlapped.push_back(i - _segments.begin());
+            breakpoints.push_back(piece._targetMin);
+            breakpoints.push_back(piece._targetMax + 1);
+            pieces.push_back(piece);
+        }
+    }
+    sort(breakpoints.begin(), breakpoints.end());
+    breakpoints.erase(unique(breakpoints.begin(), breakpoints.end()), breakpoints.end());
+
+    // cut everything involved, and keep the first of equal pieces
+    vector<Piece> cut;
+    for (const Piece &piece : pieces) {
+        cutAtBreakpoints(piece, breakpoints, cut);
+    }
+    for (const Piece &piece : added) {
+        cutAtBreakpoints(piece, breakpoints, cut);
+    }
+    sort(cut.begin(), cut.end(), lessByBounds);
+    cut.erase(unique(cut.begin(), cut.end(), equalBounds), cut.end());
+
+    // replace the overlapped segments with the pieces
+    if (!overlapped.empty()) {
+        vector<MappedSegmentPtr>::iterator out = _segments.begin() + overlapped.front();
+        size_t next = 0;
+        for (size_t i = overlapped.front(); i < _segments.size(); ++i) {
+            if (next < overlapped.size() && overlapped[next] == i) {
+                ++next;
+            } else {
+                *out++ = std::move(_segments[i]);
+            }
+        }
+        _segments.erase(out, _segments.end());
+    }
+    size_t middle = _segments.size();
+    for (Piece &piece : cut) {
+        _segments.push_back(std::move(piece._segment));
+    }
+    if (middle > 0 && middle < _segments.size() && MappedSegmentLess()(_segments[middle], _segments[middle - 1])) {
+        inplace_merge(_segments.begin(), _segments.begin() + middle, _segments.end(), MappedSegmentLess());
+    }
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+#include "halPairwiseBlockIterator.h"
+#include "halCommon.h"
+#include "halGenome.h"
+#include "halSequence.h"
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+using namespace hal;
+
+PairwiseBlockIterator::PairwiseBlockIterator(const Genome *srcGenome, const Genome *tgtGenome, bool doDupes,
+                                             const Genome *coalescenceLimit, hal_size_t segmentsPerRun)
+    : _srcGenome(srcGenome), _tgtGenome(tgtGenome), _doDupes(doDupes), _coalescenceLimit(coalescenceLimit),
+      _segmentsPerRun(segmentsPerRun), _nextIndex(0), _nextMapping(0), _srcPosition(0), _lastSrcSequence(NULL),
+      _lastTgtSequence(NULL), _atEnd(false) {
+    assert(srcGenome != NULL && tgtGenome != NULL && segmentsPerRun > 0);
+    // the top segments cover the genome unless it's the root
+    _top = srcGenome->getParent() != NULL;
+    _lastIndex = (hal_index_t)(_top ? srcGenome->getNumTopSegments() : srcGenome->getNumBottomSegments());
+
+    set<const Genome *> inputSet;
+    inputSet.insert(_srcGenome);
+    inputSet.insert(_tgtGenome);
+    _mrca = getLowestCommonAncestor(inputSet);
+    if (_coalescenceLimit == NULL) {
+        _coalescenceLimit = _mrca;
+    }
+    inputSet.clear();
+    inputSet.insert(_coalescenceLimit);
+    inputSet.insert(_tgtGenome);
+    getGenomesInSpanningTree(inputSet, _downwardPath);
+
+    toNext();
+}
+
+void PairwiseBlockIterator::toNext() {
+    while (not canOutput()) {
+        if (_nextMapping < _mapper.getMappings().size()) {
+            addMapping(_mapper.getMappings()[_nextMapping++]);
+        } else if (not mapNextRun()) {
+            _srcPosition = numeric_limits<hal_index_t>::max();
+            closeBlocksBefore(_srcPosition);
+            break;
+        }
+    }
+    if (_closedBlocks.empty()) {
+        _atEnd = true;
+    } else {
+        _block = _closedBlocks.top();
+        _closedBlocks.pop();
+    }
+}
+
+/* map the next run of source segments, returning false if there are none
+ * left */
+bool PairwiseBlockIterator::mapNextRun() {
+    if (_nextIndex >= _lastIndex) {
+        return false;
+    }
+    hal_size_t numSegments = min((hal_size_t)(_lastIndex - _nextIndex), _segmentsPerRun);
+    _mapper.mapSegments(_srcGenome, _top, _nextIndex, numSegments, _tgtGenome, &_downwardPath, _doDupes, 0,
+                        _coalescenceLimit, _mrca);
+    _nextIndex += (hal_index_t)numSegments;
+    _nextMapping = 0;
+    return true;
+}
+
+/* Add a mapping, which starts at or after the source positions of those
+ * added before it: extend the open block it continues, if any, or open a
+ * new one */
+void PairwiseBlockIterator::addMapping(const SegmentMapping &mapping) {
+    PairwiseBlock block;
+    block._srcStart = mapping._source.getMinPosition();
+    block._tgtStart = mapping._target.getMinPosition();
+    block._length = mapping._source.getLength();
+    block._reversed = mapping._source._reversed != mapping._target._reversed;
+    _lastSrcSequence = getSequence(_srcGenome, block._srcStart, _lastSrcSequence);
+    _lastTgtSequence = getSequence(_tgtGenome, block._tgtStart, _lastTgtSequence);
+    block._srcSequence = _lastSrcSequence;
+    block._tgtSequence = _lastTgtSequence;
+    assert(block._srcStart >= _srcPosition);
+    _srcPosition = block._srcStart;
+    closeBlocksBefore(block._srcStart);
+
+    // a reversed block continues one whose target starts where it ends
+    ExtensionKey key(block._srcStart, block._reversed,
+                     block._reversed ? block._tgtStart + (hal_index_t)block._length : block._tgtStart);
+    pair<OpenBlocks::iterator, OpenBlocks::iterator> range = _openBlocks.equal_range(key);
+    for (OpenBlocks::iterator i = range.first; i != range.second; ++i) {
+        if (i->second._srcSequence == block._srcSequence && i->second._tgtSequence == block._tgtSequence) {
+            PairwiseBlock extended = i->second;
+            extended._length += block._length;
+            if (block._reversed) {
+                extended._tgtStart = block._tgtStart;
+            }
+            _openBlocks.erase(i);
+            _openBlocks.insert(make_pair(getExtensionKey(extended), extended));
+            return;
+        }
+    }
+    _openBlocks.insert(make_pair(getExtensionKey(block), block));
+    _openStarts.insert(block._srcStart);
+}
+
+/* close the open blocks that no block starting at or after a source
+ * position can extend */
+void PairwiseBlockIterator::closeBlocksBefore(hal_index_t srcPosition) {
+    while (not _openBlocks.empty() && get<0>(_openBlocks.begin()->first) < srcPosition) {
+        const PairwiseBlock &block = _openBlocks.begin()->second;
+        _openStarts.erase(_openStarts.find(block._srcStart));
+        _closedBlocks.push(block);
+        _openBlocks.erase(_openBlocks.begin());
+    }
+}
+
+/* can the first closed block be output: do all open blocks, and those to
+ * come, start after it? */
+bool PairwiseBlockIterator::canOutput() const {
+    if (_closedBlocks.empty()) {
+        return false;
+    }
+    hal_index_t firstStart = _srcPosition;
+    if (not _openStarts.empty()) {
+        firstStart = min(firstStart, *_openStarts.begin());
+    }
+    return _closedBlocks.top()._srcStart < firstStart;
+}
+
+PairwiseBlockIterator::ExtensionKey PairwiseBlockIterator::getExtensionKey(const PairwiseBlock &block) {
+    return ExtensionKey(block._srcStart + (hal_index_t)block._length, block._reversed,
+                        block._reversed ? block._tgtStart : block._tgtStart + (hal_index_t)block._length);
+}
+
+/* the sequence of a genome position, checking the last one found first */
+const Sequence *PairwiseBlockIterator::getSequence(const Genome *genome, hal_index_t position, const Sequence *last) {
+    if (last != NULL && last->getGenome() == genome && position >= last->getStartPosition() &&
+        position < last->getStartPosition() + (hal_index_t)last->getSequenceLength()) {
+        return last;
+    }
+    return genome->getSequenceBySite(position);
+}
+
+/* order of output, reversed for the priority queue: by source, then target
+ * position */
+bool PairwiseBlockIterator::BlockGreater::operator()(const PairwiseBlock &b1, const PairwiseBlock &b2) const {
+    if (b1._srcStart != b2._srcStart) {
+        return b1._srcStart > b2._srcStart;
+    } else if (b1._tgtStart != b2._tgtStart) {
+        return b1._tgtStart > b2._tgtStart;
+    } else if (b1._length != b2._length) {
+        return b1._length > b2._length;
+    }
+    return b1._reversed > b2._reversed;
+}
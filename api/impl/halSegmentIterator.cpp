@@ -68,11 +68,14 @@ hal_size_t SegmentIterator::getLength() const {
 
 void SegmentIterator::getString(std::string &outString) const {
     assert(inRange());
-    getSegment()->getString(outString);
+    // decode only the sliced range, complementing as we go when reversed
+    PackedDnaSpan span;
+    getGenome()->getPackedDna(span, std::min(getStartPosition(), getEndPosition()), getLength());
     if (_reversed) {
-        reverseComplement(outString);
+        span.unpackReverseComplement(outString);
+    } else {
+        span.unpack(outString);
     }
-    outString = outString.substr(_startOffset, getLength());
 }
 
 void SegmentIterator::setCoordinates(hal_index_t startPos, hal_size_t length) {
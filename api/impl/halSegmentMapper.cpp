@@ -5,178 +5,253 @@
  * Released under the MIT license, see LICENSE.txt
  */
 #include "halSegmentMapper.h"
+#include "halBottomSegment.h"
 #include "halBottomSegmentIterator.h"
 #include "halCommon.h"
 #include "halMappedSegment.h"
 #include "halSegment.h"
 #include "halSegmentIterator.h"
+#include "halTopSegment.h"
 #include "halTopSegmentIterator.h"
+#include <algorithm>
 #include <cassert>
 #include <iostream>
+#include <limits>
 
 using namespace std;
 using namespace hal;
 
-enum OverlapCat { Same, Disjoint, AContainsB, BContainsA, AOverlapsLeftOfB, BOverlapsLeftOfA };
+SegmentMapper::SegmentMapper() : _lastReader(0), _numBuffersUsed(0) {
+}
 
-static hal_size_t mapSelf(MappedSegmentPtr mappedSeg, list<MappedSegmentPtr> &results, hal_size_t minLength);
+SegmentMapper::~SegmentMapper() {
+}
 
-// note: takes smart pointer as it maybe added to the results
-static hal_size_t mapUp(MappedSegmentPtr mappedSeg, list<MappedSegmentPtr> &results, bool doDupes, hal_size_t minLength) {
-    const Genome *parent = mappedSeg->getGenome()->getParent();
-    assert(parent != NULL);
-    hal_size_t added = 0;
-    if (mappedSeg->isTop() == true) {
-        BottomSegmentIteratorPtr botSegIt = parent->getBottomSegmentIterator();
-        TopSegmentIteratorPtr topSegIt = mappedSeg->targetAsTop();
-        if (topSegIt->tseg()->hasParent() == true && topSegIt->getLength() >= minLength &&
-            (doDupes == true || topSegIt->tseg()->isCanonicalParalog() == true)) {
-            botSegIt->toParent(topSegIt);
-            mappedSeg->setTarget(std::dynamic_pointer_cast<SegmentIterator>(botSegIt));
-            results.push_back(mappedSeg);
-            ++added;
+//////////////////////////////////////////////////////////////////////////////
+// SEGMENT ACCESS
+//////////////////////////////////////////////////////////////////////////////
+namespace hal {
+    template <> vector<VirtualSegmentReader> &SegmentMapper::getReaders<VirtualSegmentReader>() {
+        return _virtualReaders;
+    }
+
+    template <> vector<ColumnSegmentReader> &SegmentMapper::getReaders<ColumnSegmentReader>() {
+        return _columnReaders;
+    }
+}
+
+/* the reader of a genome, opened on first use.  The reference is only
+ * valid until the next call. */
+template <class Reader> const Reader &SegmentMapper::getReader(const Genome *genome) {
+    vector<Reader> &readers = getReaders<Reader>();
+    if ((_lastReader < readers.size()) && (readers[_lastReader].getGenome() == genome)) {
+        return readers[_lastReader];
+    }
+    for (_lastReader = 0; _lastReader < readers.size(); _lastReader++) {
+        if (readers[_lastReader].getGenome() == genome) {
+            return readers[_lastReader];
+        }
+    }
+    readers.push_back(Reader());
+    if (not readers.back().open(genome)) {
+        throw hal_exception("Segments of genome " + genome->getName() + " can't be read in place");
+    }
+    return readers.back();
+}
+
+/* move a slice to another segment of its genome and array, loading the
+ * segment coordinates if it is in range */
+template <class Reader> void SegmentMapper::toArrayIndex(SegmentSlice &slice, hal_index_t arrayIndex) {
+    slice._arrayIndex = arrayIndex;
+    const Reader &reader = getReader<Reader>(slice._genome);
+    if (slice._top) {
+        if ((arrayIndex >= 0) && ((hal_size_t)arrayIndex < reader.getNumTopSegments())) {
+            slice._segmentStart = reader.getTopStartPosition(arrayIndex);
+            slice._segmentLength = reader.getTopLength(arrayIndex);
         }
     } else {
-        hal_index_t rightCutoff = mappedSeg->getEndPosition();
-        BottomSegmentIteratorPtr botSegIt = mappedSeg->targetAsBottom();
-        hal_index_t startOffset = (hal_index_t)botSegIt->getStartOffset();
-        hal_index_t endOffset = (hal_index_t)botSegIt->getEndOffset();
-        TopSegmentIteratorPtr topSegIt = mappedSeg->getGenome()->getTopSegmentIterator();
-        topSegIt->toParseUp(botSegIt);
-        do {
-            TopSegmentIteratorPtr newTopSegIt = topSegIt->clone();
-
-            // we map the new target back to see how the offsets have
-            // changed.  these changes are then applied to the source segment
-            // as deltas
-            BottomSegmentIteratorPtr backBotSegIt = botSegIt->clone();
-            backBotSegIt->toParseDown(newTopSegIt);
-            hal_index_t startBack = (hal_index_t)backBotSegIt->getStartOffset();
-            hal_index_t endBack = (hal_index_t)backBotSegIt->getEndOffset();
-            assert(startBack >= startOffset);
-            assert(endBack >= endOffset);
-            SegmentIteratorPtr newSourceSegIt = mappedSeg->sourceClone();
-            hal_index_t startDelta = startBack - startOffset;
-            hal_index_t endDelta = endBack - endOffset;
-            assert((hal_index_t)newSourceSegIt->getLength() > startDelta + endDelta);
-            newSourceSegIt->slice(newSourceSegIt->getStartOffset() + startDelta, newSourceSegIt->getEndOffset() + endDelta);
-
-            MappedSegmentPtr newMappedSeg(new MappedSegment(newSourceSegIt, newTopSegIt));
-
-            assert(newMappedSeg->isTop() == true);
-            assert(newMappedSeg->getSource()->getGenome() == mappedSeg->getSource()->getGenome());
-
-            added += mapUp(newMappedSeg, results, doDupes, minLength);
-            // stupid that we have to make this check but odn't want to
-            // make fundamental api change now
-            if (topSegIt->getEndPosition() != rightCutoff) {
-                topSegIt->toRight(rightCutoff);
-            } else {
-                break;
-            }
-        } while (true);
+        if ((arrayIndex >= 0) && ((hal_size_t)arrayIndex < reader.getNumBottomSegments())) {
+            slice._segmentStart = reader.getBottomStartPosition(arrayIndex);
+            slice._segmentLength = reader.getBottomLength(arrayIndex);
+        }
     }
-    return added;
 }
 
-// Map the input segments up until reaching the target genome. If the
-// target genome is below the source genome, fail miserably.
-// Destructive to any data in the input or results list.
-static hal_size_t mapRecursiveUp(list<MappedSegmentPtr> &input, list<MappedSegmentPtr> &results, const Genome *tgtGenome,
-                                 hal_size_t minLength) {
-    list<MappedSegmentPtr> *inputPtr = &input;
-    list<MappedSegmentPtr> *outputPtr = &results;
+//////////////////////////////////////////////////////////////////////////////
+// SLICE MOVES, AS THOSE OF THE SEGMENT ITERATORS
+//////////////////////////////////////////////////////////////////////////////
+
+/* TopSegmentIterator::toParent() */
+template <class Reader> void SegmentMapper::toParent(const SegmentSlice &top, SegmentSlice &bottom) {
+    const Reader &reader = getReader<Reader>(top._genome);
+    hal_index_t parentIndex = reader.getTopParentIndex(top._arrayIndex);
+    bool parentReversed = reader.getTopParentReversed(top._arrayIndex);
+    bottom._genome = top._genome->getParent();
+    bottom._top = false;
+    bottom._startOffset = top._startOffset;
+    bottom._endOffset = top._endOffset;
+    bottom._reversed = top._reversed != parentReversed;
+    toArrayIndex<Reader>(bottom, parentIndex);
+}
+
+/* TopSegmentIterator::toChild() */
+template <class Reader>
+void SegmentMapper::toChild(const SegmentSlice &bottom, hal_size_t childIndex, SegmentSlice &top) {
+    const Reader &reader = getReader<Reader>(bottom._genome);
+    hal_index_t childSegIndex = reader.getBottomChildIndex(bottom._arrayIndex, childIndex);
+    bool childReversed = reader.getBottomChildReversed(bottom._arrayIndex, childIndex);
+    top._genome = bottom._genome->getChild(childIndex);
+    top._top = true;
+    top._startOffset = bottom._startOffset;
+    top._endOffset = bottom._endOffset;
+    top._reversed = bottom._reversed != childReversed;
+    toArrayIndex<Reader>(top, childSegIndex);
+}
 
-    if (inputPtr->empty() || (*inputPtr->begin())->getGenome() == tgtGenome) {
-        results = *inputPtr;
-        return 0;
+/* the offsets of a slice of one array of a genome over the segment of the
+ * other array that contains its start, as TopSegmentIterator::toParseUp()
+ * and BottomSegmentIterator::toParseDown() compute them */
+static void parseOffsets(const SegmentSlice &from, SegmentSlice &to) {
+    hal_index_t startPos = from.getStartPosition();
+    if (to._reversed == false) {
+        to._startOffset = startPos - to._segmentStart;
+        hal_index_t toEnd = to._segmentStart + (hal_index_t)to._segmentLength;
+        hal_index_t fromEnd = startPos + (hal_index_t)from.getLength();
+        to._endOffset = max((hal_index_t)0, toEnd - fromEnd);
+    } else {
+        to._startOffset = to._segmentStart + to._segmentLength - 1 - startPos;
+        hal_index_t toEnd = to._segmentStart;
+        hal_index_t fromEnd = startPos - (hal_index_t)from.getLength() + 1;
+        to._endOffset = max((hal_index_t)0, fromEnd - toEnd);
     }
+    assert(to._startOffset + to._endOffset <= to._segmentLength);
+}
 
-    const Genome *curGenome = (*inputPtr->begin())->getGenome();
-    assert(curGenome != NULL);
-    const Genome *nextGenome = curGenome->getParent();
+/* TopSegmentIterator::toParseUp() */
+template <class Reader> void SegmentMapper::toParseUp(const SegmentSlice &bottom, SegmentSlice &top) {
+    hal_index_t index = getReader<Reader>(bottom._genome).getBottomTopParseIndex(bottom._arrayIndex);
+    top._genome = bottom._genome;
+    top._top = true;
+    top._reversed = bottom._reversed;
+    toArrayIndex<Reader>(top, index);
+    hal_index_t startPos = bottom.getStartPosition();
+    while (startPos >= top._segmentStart + (hal_index_t)top._segmentLength) {
+        toArrayIndex<Reader>(top, ++index);
+    }
+    parseOffsets(bottom, top);
+}
 
-    if (nextGenome == NULL) {
-        throw hal_exception("Reached top of tree when attempting to recursively map up from " + curGenome->getName() + " to " +
-                            tgtGenome->getName());
-    }
+/* BottomSegmentIterator::toParseDown() */
+template <class Reader> void SegmentMapper::toParseDown(const SegmentSlice &top, SegmentSlice &bottom) {
+    hal_index_t index = getReader<Reader>(top._genome).getTopBottomParseIndex(top._arrayIndex);
+    bottom._genome = top._genome;
+    bottom._top = false;
+    bottom._reversed = top._reversed;
+    toArrayIndex<Reader>(bottom, index);
+    hal_index_t startPos = top.getStartPosition();
+    while (startPos >= bottom._segmentStart + (hal_index_t)bottom._segmentLength) {
+        toArrayIndex<Reader>(bottom, ++index);
+    }
+    parseOffsets(top, bottom);
+}
 
-    // Map all segments to the parent.
-    list<MappedSegmentPtr>::iterator i = inputPtr->begin();
-    for (; i != inputPtr->end(); ++i) {
-        assert((*i)->getGenome() == curGenome);
-        mapUp(*i, *outputPtr, true, minLength);
+/* SegmentIterator::overlaps() */
+bool SegmentMapper::overlaps(const SegmentSlice &slice, hal_index_t position) const {
+    hal_index_t start = slice.getStartPosition();
+    hal_index_t length = (hal_index_t)slice.getLength();
+    if (slice._reversed == false) {
+        return (start + length > position) && (start <= position);
+    } else {
+        return (start >= position) && (start - length < position);
     }
+}
 
-    if (nextGenome != tgtGenome) {
-        // Continue the recursion.
-        swap(inputPtr, outputPtr);
-        outputPtr->clear();
-        mapRecursiveUp(*inputPtr, *outputPtr, tgtGenome, minLength);
+/* SegmentIterator::toRight() */
+template <class Reader> void SegmentMapper::toRight(SegmentSlice &slice, hal_index_t rightCutoff) {
+    const Reader &reader = getReader<Reader>(slice._genome);
+    hal_size_t numSegments = slice._top ? reader.getNumTopSegments() : reader.getNumBottomSegments();
+    if (slice._reversed == false) {
+        if (slice._endOffset == 0) {
+            toArrayIndex<Reader>(slice, slice._arrayIndex + 1);
+            slice._startOffset = 0;
+        } else {
+            slice._startOffset = slice._segmentLength - slice._endOffset;
+            slice._endOffset = 0;
+        }
+        if (((hal_size_t)slice._arrayIndex < numSegments) && (rightCutoff != NULL_INDEX) && overlaps(slice, rightCutoff)) {
+            slice._endOffset = slice._segmentStart + slice._segmentLength - rightCutoff - 1;
+        }
+    } else {
+        if (slice._endOffset == 0) {
+            toArrayIndex<Reader>(slice, slice._arrayIndex - 1);
+            slice._startOffset = 0;
+        } else {
+            slice._startOffset = slice._segmentLength - slice._endOffset;
+            slice._endOffset = 0;
+        }
+        if ((slice._arrayIndex >= 0) && (rightCutoff != NULL_INDEX) && overlaps(slice, rightCutoff)) {
+            slice._endOffset = rightCutoff - slice._segmentStart;
+        }
     }
+}
 
-    if (outputPtr != &results) {
-        results = *outputPtr;
+/* TopSegmentIterator::toNextParalogy() */
+template <class Reader> void SegmentMapper::toNextParalogy(SegmentSlice &top) {
+    const Reader &reader = getReader<Reader>(top._genome);
+    hal_index_t paralogyIndex = reader.getTopNextParalogyIndex(top._arrayIndex);
+    assert(paralogyIndex != NULL_INDEX);
+    bool reversed = reader.getTopParentReversed(top._arrayIndex);
+    toArrayIndex<Reader>(top, paralogyIndex);
+    if (getReader<Reader>(top._genome).getTopParentReversed(top._arrayIndex) != reversed) {
+        top._reversed = !top._reversed;
     }
+}
 
-    results.sort(MappedSegment::LessSourcePtr());
-    results.unique(MappedSegment::EqualToPtr());
-    return results.size();
+//////////////////////////////////////////////////////////////////////////////
+// MAPPING
+//////////////////////////////////////////////////////////////////////////////
+
+/* Slice the source of a mapping as its target was sliced, going from
+ * oldTarget to newTarget (by the offsets of newTarget mapped back to the
+ * array of oldTarget) */
+static SegmentMapping sliceMapping(const SegmentMapping &mapping, const SegmentSlice &oldTarget,
+                                   const SegmentSlice &back, const SegmentSlice &newTarget) {
+    assert(back._startOffset >= oldTarget._startOffset);
+    assert(back._endOffset >= oldTarget._endOffset);
+    SegmentMapping newMapping;
+    newMapping._source = mapping._source;
+    newMapping._source._startOffset += back._startOffset - oldTarget._startOffset;
+    newMapping._source._endOffset += back._endOffset - oldTarget._endOffset;
+    newMapping._target = newTarget;
+    assert(newMapping._source.getLength() == newMapping._target.getLength());
+    return newMapping;
 }
 
-// note: takes smart pointer as it maybe added to the results
-static hal_size_t mapDown(MappedSegmentPtr mappedSeg, hal_size_t childIndex, list<MappedSegmentPtr> &results,
-                          hal_size_t minLength) {
-    const Genome *child = mappedSeg->getGenome()->getChild(childIndex);
-    assert(child != NULL);
+template <class Reader>
+hal_size_t SegmentMapper::mapUp(const SegmentMapping &mapping, Mappings &results, hal_size_t minLength) {
+    assert(mapping._target._genome->getParent() != NULL);
     hal_size_t added = 0;
-    if (mappedSeg->isTop() == false) {
-        TopSegmentIteratorPtr topSegIt = child->getTopSegmentIterator();
-        SegmentIteratorPtr targetSegIt = mappedSeg->getTargetIteratorPtr();
-        BottomSegmentIteratorPtr botSegIt = std::dynamic_pointer_cast<BottomSegmentIterator>(targetSegIt);
-
-        if (botSegIt->bseg()->hasChild(childIndex) == true && botSegIt->getLength() >= minLength) {
-            topSegIt->toChild(botSegIt, childIndex);
-            mappedSeg->setTarget(std::dynamic_pointer_cast<SegmentIterator>(topSegIt));
-            results.push_back(MappedSegmentPtr(mappedSeg));
+    if (mapping._target._top == true) {
+        if (getReader<Reader>(mapping._target._genome).getTopParentIndex(mapping._target._arrayIndex) != NULL_INDEX &&
+            mapping._target.getLength() >= minLength) {
+            SegmentMapping newMapping;
+            newMapping._source = mapping._source;
+            toParent<Reader>(mapping._target, newMapping._target);
+            results.push_back(newMapping);
             ++added;
         }
     } else {
-        hal_index_t rightCutoff = mappedSeg->getEndPosition();
-        TopSegmentIteratorPtr topSegIt = mappedSeg->targetAsTop();
-        hal_index_t startOffset = (hal_index_t)topSegIt->getStartOffset();
-        hal_index_t endOffset = (hal_index_t)topSegIt->getEndOffset();
-        BottomSegmentIteratorPtr botSegIt = mappedSeg->getGenome()->getBottomSegmentIterator();
-        botSegIt->toParseDown(topSegIt);
+        const SegmentSlice &bottom = mapping._target;
+        hal_index_t rightCutoff = bottom.getEndPosition();
+        SegmentSlice top, back;
+        toParseUp<Reader>(bottom, top);
         do {
-            BottomSegmentIteratorPtr newBotSegIt = botSegIt->clone();
-
-            // we map the new target back to see how the offsets have
-            // changed.  these changes are then applied to the source segment
-            // as deltas
-            TopSegmentIteratorPtr backTopSegIt = topSegIt->clone();
-            backTopSegIt->toParseUp(newBotSegIt);
-            hal_index_t startBack = (hal_index_t)backTopSegIt->getStartOffset();
-            hal_index_t endBack = (hal_index_t)backTopSegIt->getEndOffset();
-            assert(startBack >= startOffset);
-            assert(endBack >= endOffset);
-            SegmentIteratorPtr newSourceSegIt = mappedSeg->sourceClone();
-            hal_index_t startDelta = startBack - startOffset;
-            hal_index_t endDelta = endBack - endOffset;
-            assert((hal_index_t)newSourceSegIt->getLength() > startDelta + endDelta);
-            newSourceSegIt->slice(newSourceSegIt->getStartOffset() + startDelta, newSourceSegIt->getEndOffset() + endDelta);
-
-            MappedSegmentPtr newMappedSeg(new MappedSegment(newSourceSegIt, newBotSegIt));
-
-            assert(newMappedSeg->isTop() == false);
-            assert(newMappedSeg->getSource()->getGenome() == mappedSeg->getSource()->getGenome());
-
-            added += mapDown(newMappedSeg, childIndex, results, minLength);
-
-            // stupid that we have to make this check but odn't want to
-            // make fundamental api change now
-            if (botSegIt->getEndPosition() != rightCutoff) {
-                botSegIt->toRight(rightCutoff);
+            // map the new target back to see how the offsets have changed,
+            // and apply the changes to the source
+            toParseDown<Reader>(top, back);
+            added += mapUp<Reader>(sliceMapping(mapping, bottom, back, top), results, minLength);
+            if (top.getEndPosition() != rightCutoff) {
+                toRight<Reader>(top, rightCutoff);
             } else {
                 break;
             }
@@ -185,142 +260,62 @@ static hal_size_t mapDown(MappedSegmentPtr mappedSeg, hal_size_t childIndex, lis
     return added;
 }
 
-// Map the input segments down until reaching the target genome. If the
-// target genome is above the source genome, fail miserably.
-// Destructive to any data in the input or results list.
-static hal_size_t mapRecursiveDown(list<MappedSegmentPtr> &input, list<MappedSegmentPtr> &results, const Genome *tgtGenome,
-                                   const set<string> &namesOnPath, bool doDupes, hal_size_t minLength) {
-    list<MappedSegmentPtr> *inputPtr = &input;
-    list<MappedSegmentPtr> *outputPtr = &results;
-
-    if (inputPtr->empty()) {
-        results = *inputPtr;
-        return 0;
-    }
-
-    const Genome *curGenome = (*inputPtr->begin())->getGenome();
-    assert(curGenome != NULL);
-    if (curGenome == tgtGenome) {
-        results = *inputPtr;
-        return 0;
-    }
-
-    // Find the correct child to move down into.
-    const Genome *nextGenome = NULL;
-    hal_size_t nextChildIndex = numeric_limits<hal_size_t>::max();
-    const Alignment *alignment = curGenome->getAlignment();
-    vector<string> childNames = alignment->getChildNames(curGenome->getName());
-    for (hal_size_t child = 0; nextGenome == NULL && child < childNames.size(); ++child) {
-        if (childNames[child] == tgtGenome->getName() || namesOnPath.find(childNames[child]) != namesOnPath.end()) {
-            const Genome *childGenome = curGenome->getChild(child);
-            nextGenome = childGenome;
-            nextChildIndex = child;
-        }
-    }
-
-    if (nextGenome == NULL) {
-        throw hal_exception("Could not find correct child that leads from " + curGenome->getName() + " to " +
-                            tgtGenome->getName());
-    }
-
-    assert(nextGenome->getParent() == curGenome);
-
-    // Map the actual segments down.
-    list<MappedSegmentPtr>::iterator i = inputPtr->begin();
-    for (; i != inputPtr->end(); ++i) {
-        assert((*i)->getGenome() == curGenome);
-        mapDown(*i, nextChildIndex, *outputPtr, minLength);
-    }
-
-    // Find paralogs.
-    if (doDupes == true) {
-        swap(inputPtr, outputPtr);
-        outputPtr->clear();
-        list<MappedSegmentPtr>::iterator i = inputPtr->begin();
-        for (; i != inputPtr->end(); ++i) {
-            assert((*i)->getGenome() == nextGenome);
-            mapSelf(*i, *outputPtr, minLength);
+template <class Reader>
+hal_size_t SegmentMapper::mapDown(const SegmentMapping &mapping, hal_size_t childIndex, Mappings &results,
+                                  hal_size_t minLength) {
+    hal_size_t added = 0;
+    if (mapping._target._top == false) {
+        if (getReader<Reader>(mapping._target._genome).getBottomChildIndex(mapping._target._arrayIndex, childIndex) !=
+                NULL_INDEX &&
+            mapping._target.getLength() >= minLength) {
+            SegmentMapping newMapping;
+            newMapping._source = mapping._source;
+            toChild<Reader>(mapping._target, childIndex, newMapping._target);
+            results.push_back(newMapping);
+            ++added;
         }
+    } else {
+        const SegmentSlice &top = mapping._target;
+        hal_index_t rightCutoff = top.getEndPosition();
+        SegmentSlice bottom, back;
+        toParseDown<Reader>(top, bottom);
+        do {
+            toParseUp<Reader>(bottom, back);
+            added += mapDown<Reader>(sliceMapping(mapping, top, back, bottom), childIndex, results, minLength);
+            if (bottom.getEndPosition() != rightCutoff) {
+                toRight<Reader>(bottom, rightCutoff);
+            } else {
+                break;
+            }
+        } while (true);
     }
-
-    if (nextGenome != tgtGenome) {
-        // Continue the recursion.
-        swap(inputPtr, outputPtr);
-        outputPtr->clear();
-        mapRecursiveDown(*inputPtr, *outputPtr, tgtGenome, namesOnPath, doDupes, minLength);
-    }
-
-    if (outputPtr != &results) {
-        results = *outputPtr;
-    }
-
-    results.sort(MappedSegment::LessSourcePtr());
-    results.unique(MappedSegment::EqualToPtr());
-    return results.size();
+    return added;
 }
 
-// note: takes smart pointer as it maybe added to the results
-static hal_size_t mapSelf(MappedSegmentPtr mappedSeg, list<MappedSegmentPtr> &results, hal_size_t minLength) {
+template <class Reader>
+hal_size_t SegmentMapper::mapSelf(const SegmentMapping &mapping, Mappings &results, hal_size_t minLength) {
     hal_size_t added = 0;
-    if (mappedSeg->isTop() == true) {
-        SegmentIteratorPtr target = mappedSeg->getTargetIteratorPtr();
-        SegmentIteratorPtr source = mappedSeg->getSourceIteratorPtr();
-        TopSegmentIteratorPtr top = std::dynamic_pointer_cast<TopSegmentIterator>(target);
-        TopSegmentIteratorPtr topCopy = top->clone();
+    if (mapping._target._top == true) {
+        SegmentMapping newMapping = mapping;
+        SegmentSlice &paralog = newMapping._target;
         do {
-            // FIXME: why isn't clone() polymorphic?
-            SegmentIteratorPtr newSource;
-            if (source->isTop()) {
-                newSource = std::dynamic_pointer_cast<TopSegmentIterator>(source)->clone();
-            } else {
-                newSource = std::dynamic_pointer_cast<BottomSegmentIterator>(source)->clone();
-            }
-            TopSegmentIteratorPtr newTop = topCopy->clone();
-            MappedSegmentPtr newMappedSeg(new MappedSegment(newSource, newTop));
-            assert(newMappedSeg->getGenome() == mappedSeg->getGenome());
-            assert(newMappedSeg->getSource()->getGenome() == mappedSeg->getSource()->getGenome());
-            results.push_back(newMappedSeg);
+            results.push_back(newMapping);
             ++added;
-            if (topCopy->tseg()->hasNextParalogy()) {
-                topCopy->toNextParalogy();
+            if (getReader<Reader>(paralog._genome).getTopNextParalogyIndex(paralog._arrayIndex) != NULL_INDEX) {
+                toNextParalogy<Reader>(paralog);
             }
-        } while (topCopy->tseg()->hasNextParalogy() == true && topCopy->getLength() >= minLength &&
-                 topCopy->getArrayIndex() != top->getArrayIndex());
-    } else if (mappedSeg->getGenome()->getParent() != NULL) {
-        hal_index_t rightCutoff = mappedSeg->getEndPosition();
-        BottomSegmentIteratorPtr bottom = mappedSeg->targetAsBottom();
-        hal_index_t startOffset = (hal_index_t)bottom->getStartOffset();
-        hal_index_t endOffset = (hal_index_t)bottom->getEndOffset();
-        TopSegmentIteratorPtr top = mappedSeg->getGenome()->getTopSegmentIterator();
-        top->toParseUp(bottom);
+        } while (getReader<Reader>(paralog._genome).getTopNextParalogyIndex(paralog._arrayIndex) != NULL_INDEX &&
+                 paralog.getLength() >= minLength && paralog._arrayIndex != mapping._target._arrayIndex);
+    } else if (mapping._target._genome->getParent() != NULL) {
+        const SegmentSlice &bottom = mapping._target;
+        hal_index_t rightCutoff = bottom.getEndPosition();
+        SegmentSlice top, back;
+        toParseUp<Reader>(bottom, top);
         do {
-            TopSegmentIteratorPtr topNew = top->clone();
-
-            // we map the new target back to see how the offsets have
-            // changed.  these changes are then applied to the source segment
-            // as deltas
-            BottomSegmentIteratorPtr bottomBack = bottom->clone();
-            bottomBack->toParseDown(topNew);
-            hal_index_t startBack = (hal_index_t)bottomBack->getStartOffset();
-            hal_index_t endBack = (hal_index_t)bottomBack->getEndOffset();
-            assert(startBack >= startOffset);
-            assert(endBack >= endOffset);
-            SegmentIteratorPtr newSource = mappedSeg->sourceClone();
-            hal_index_t startDelta = startBack - startOffset;
-            hal_index_t endDelta = endBack - endOffset;
-            assert((hal_index_t)newSource->getLength() > startDelta + endDelta);
-            newSource->slice(newSource->getStartOffset() + startDelta, newSource->getEndOffset() + endDelta);
-
-            MappedSegmentPtr newMappedSeg(new MappedSegment(newSource, topNew));
-
-            assert(newMappedSeg->isTop() == true);
-            assert(newMappedSeg->getSource()->getGenome() == mappedSeg->getSource()->getGenome());
-
-            added += mapSelf(newMappedSeg, results, minLength);
-            // stupid that we have to make this check but odn't want to
-            // make fundamental api change now
-            if (top->getEndPosition() != rightCutoff) {
-                top->toRight(rightCutoff);
+            toParseDown<Reader>(top, back);
+            added += mapSelf<Reader>(sliceMapping(mapping, bottom, back, top), results, minLength);
+            if (top.getEndPosition() != rightCutoff) {
+                toRight<Reader>(top, rightCutoff);
             } else {
                 break;
             }
@@ -329,325 +324,257 @@ static hal_size_t mapSelf(MappedSegmentPtr mappedSeg, list<MappedSegmentPtr> &re
     return added;
 }
 
-static OverlapCat slowOverlap(const SlicedSegment *sA, const SlicedSegment *sB) {
-    hal_index_t startA = sA->getStartPosition();
-    hal_index_t endA = sA->getEndPosition();
-    hal_index_t startB = sB->getStartPosition();
-    hal_index_t endB = sB->getEndPosition();
-    if (startA > endA) {
-        swap(startA, endA);
+/* take a buffer from the pool; buffers taken by a function are given back
+ * by restoring _numBuffersUsed before it returns */
+SegmentMapper::Mappings &SegmentMapper::getBuffer() {
+    if (_numBuffersUsed == _buffers.size()) {
+        _buffers.push_back(Mappings());
     }
-    if (startB > endB) {
-        swap(startB, endB);
-    }
-
-    if (endA < startB || startA > endB) {
-        return Disjoint;
-    } else if (startA == startB && endA == endB) {
-        return Same;
-    } else if (startA >= startB && endA <= endB) {
-        return BContainsA;
-    } else if (startB >= startA && endB <= endA) {
-        return AContainsB;
-    } else if (startA <= startB && endA < endB) {
-        return AOverlapsLeftOfB;
-    }
-    assert(startB <= startA && endB < endA);
-    return BOverlapsLeftOfA;
+    Mappings &buffer = _buffers[_numBuffersUsed++];
+    buffer.clear();
+    return buffer;
 }
 
-static void getOverlapBounds(MappedSegmentPtr &seg, MappedSegmentSet &results, MappedSegmentSet::iterator &leftBound,
-                             MappedSegmentSet::iterator &rightBound) {
-    if (results.size() <= 2) {
-        leftBound = results.begin();
-        rightBound = results.end();
-    } else {
-        MappedSegmentSet::iterator i = results.lower_bound(seg);
-        leftBound = i;
-        if (leftBound != results.begin()) {
-            --leftBound;
-        }
-        MappedSegmentSet::iterator iprev;
-        MappedSegmentSet::key_compare resLess = results.key_comp();
-        while (leftBound != results.begin()) {
-            iprev = leftBound;
-            --iprev;
-            if (leftBound == results.end() || !resLess(*iprev, *leftBound)) {
-                leftBound = iprev;
-            } else {
-                break;
-            }
-        }
-        for (; leftBound != results.begin(); --leftBound) {
-            if (leftBound != results.end() && slowOverlap(seg.get()->getTarget(), leftBound->get()->getTarget()) == Disjoint) {
-                break;
-            }
-        }
-        rightBound = i;
-        if (rightBound != results.end()) {
-            for (++rightBound; rightBound != results.end(); ++rightBound) {
-                if (slowOverlap(seg.get()->getTarget(), rightBound->get()->getTarget()) == Disjoint) {
-                    break;
-                }
-            }
-        }
-    }
+/* the order of MappedSegment::LessSourcePtr, keeping the first of equal
+ * mappings like std::list::sort() and unique() */
+static bool lessBySource(const SegmentMapping &m1, const SegmentMapping &m2) {
+    hal_index_t k1[4] = {m1._source.getMinPosition(), m1._source.getMaxPosition(), m1._target.getMinPosition(),
+                         m1._target.getMaxPosition()};
+    hal_index_t k2[4] = {m2._source.getMinPosition(), m2._source.getMaxPosition(), m2._target.getMinPosition(),
+                         m2._target.getMaxPosition()};
+    return lexicographical_compare(k1, k1 + 4, k2, k2 + 4);
 }
 
-static void clipAagainstB(MappedSegmentPtr segA, MappedSegmentPtr segB, OverlapCat overlapCat,
-                          vector<MappedSegmentPtr> &clippedSegs) {
-    assert(overlapCat != Same && overlapCat != Disjoint && overlapCat != BContainsA);
-
-    hal_index_t startA = segA->getStartPosition();
-    hal_index_t endA = segA->getEndPosition();
-    hal_index_t startB = segB->getStartPosition();
-    hal_index_t endB = segB->getEndPosition();
-    if (startA > endA) {
-        swap(startA, endA);
-    }
-    if (startB > endB) {
-        swap(startB, endB);
-    }
-    MappedSegmentPtr left = segA;
-    MappedSegmentPtr middle = MappedSegmentPtr(segA->clone());
-    MappedSegmentPtr right;
-
-    hal_index_t startO = segA->getStartOffset();
-    hal_index_t endO = segA->getEndOffset();
-    hal_index_t length = segA->getLength();
-    hal_index_t leftSize = std::max((hal_index_t)0, startB - startA);
-    hal_index_t rightSize = std::max((hal_index_t)0, endA - endB);
-    hal_index_t middleSize = length - leftSize - rightSize;
-    if (rightSize > 0) {
-        right = MappedSegmentPtr(segA->clone());
-    }
+static bool equalBySource(const SegmentMapping &m1, const SegmentMapping &m2) {
+    return not lessBySource(m1, m2) and not lessBySource(m2, m1);
+}
 
-    assert(overlapCat == AOverlapsLeftOfB || overlapCat == BOverlapsLeftOfA || overlapCat == AContainsB);
+void SegmentMapper::sortUnique(Mappings &mappings) {
+    stable_sort(mappings.begin(), mappings.end(), lessBySource);
+    mappings.erase(unique(mappings.begin(), mappings.end(), equalBySource), mappings.end());
+}
 
-    assert(leftSize >= 0 && rightSize >= 0 && middleSize >= 0);
-    hal_index_t leftSlice = 0;
-    hal_index_t rightSlice = 0;
-    if (leftSize > 0) {
-        leftSlice = 0;
-        rightSlice = (length - leftSize);
-        if (left->getReversed()) {
-            swap(leftSlice, rightSlice);
+// Map the input segments up until reaching the target genome. If the
+// target genome is below the source genome, fail miserably.
+// Destructive to any data in the input or results list.
+template <class Reader>
+void SegmentMapper::mapRecursiveUp(Mappings &input, Mappings &results, const Genome *tgtGenome, hal_size_t minLength) {
+    if (input.empty() || input.front()._target._genome == tgtGenome) {
+        results.swap(input);
+        return;
+    }
+    Mappings *inputPtr = &input;
+    Mappings *outputPtr = &results;
+    while (true) {
+        const Genome *curGenome = inputPtr->front()._target._genome;
+        const Genome *nextGenome = curGenome->getParent();
+        if (nextGenome == NULL) {
+            throw hal_exception("Reached top of tree when attempting to recursively map up from " + curGenome->getName() +
+                                " to " + tgtGenome->getName());
         }
-        left->slice(startO + leftSlice, endO + rightSlice);
-        assert(left->getLength() == (hal_size_t)leftSize);
-        assert(min(left->getStartPosition(), left->getEndPosition()) == startA);
-        assert(max(left->getStartPosition(), left->getEndPosition()) == startB - 1);
-    } else {
-        middle = segA;
-    }
-
-    leftSlice = leftSize;
-    rightSlice = rightSize;
-    if (middle->getReversed()) {
-        swap(leftSlice, rightSlice);
+        outputPtr->clear();
+        for (const SegmentMapping &mapping : *inputPtr) {
+            assert(mapping._target._genome == curGenome);
+            mapUp<Reader>(mapping, *outputPtr, minLength);
+        }
+        if ((nextGenome == tgtGenome) || outputPtr->empty()) {
+            break;
+        }
+        swap(inputPtr, outputPtr);
     }
-    middle->slice(startO + leftSlice, endO + rightSlice);
-    assert(middle->getLength() == (hal_size_t)middleSize);
-    assert(min(middle->getStartPosition(), middle->getEndPosition()) == max(startB, startA));
-    assert(max(middle->getStartPosition(), middle->getEndPosition()) == min(endB, endA));
-    if (middle.get() != segA.get()) {
-        assert(leftSize > 0);
-        assert(middle->getLength() == middle->getSource()->getLength());
-        clippedSegs.push_back(middle);
+    if (outputPtr != &results) {
+        results.swap(*outputPtr);
     }
+    sortUnique(results);
+}
 
-    if (rightSize > 0) {
-        leftSlice = leftSize + middleSize;
-        rightSlice = 0;
-        if (right->getReversed()) {
-            swap(leftSlice, rightSlice);
-        }
-        right->slice(startO + leftSlice, endO + rightSlice);
-        assert(right->getLength() == (hal_size_t)rightSize);
-        assert(min(right->getStartPosition(), right->getEndPosition()) == endB + 1);
-        assert(max(right->getStartPosition(), right->getEndPosition()) == endA);
-        assert(right->getLength() == right->getSource()->getLength());
-        clippedSegs.push_back(right);
-    }
-    assert(segA->getLength() == segA->getSource()->getLength());
-}
-
-static void insertAndBreakOverlaps(MappedSegmentPtr seg, MappedSegmentSet &results) {
-    assert(seg->getLength() == seg->getSource()->getLength());
-    list<MappedSegmentPtr> inputSegs;
-    vector<MappedSegmentPtr> clippedSegs;
-
-    // 1) compute invariant range in set of candidate overalaps
-    MappedSegmentSet::iterator leftBound;
-    MappedSegmentSet::iterator rightBound;
-    getOverlapBounds(seg, results, leftBound, rightBound);
-    bool leftBegin = leftBound == results.begin();
-
-    // 2) cut seg by each segment in range
-    list<MappedSegmentPtr>::iterator inputIt;
-    OverlapCat oc;
-    inputSegs.push_back(seg);
-    MappedSegmentSet::iterator resIt;
-    for (resIt = leftBound; resIt != rightBound; ++resIt) {
-        for (inputIt = inputSegs.begin(); inputIt != inputSegs.end(); ++inputIt) {
-            oc = slowOverlap(inputIt->get()->getTarget(), resIt->get()->getTarget());
-            if (oc == AContainsB || oc == AOverlapsLeftOfB || oc == BOverlapsLeftOfA) {
-                clippedSegs.clear();
-                clipAagainstB(*inputIt, *resIt, oc, clippedSegs);
-                inputSegs.insert(inputSegs.end(), clippedSegs.begin(), clippedSegs.end());
+// Map the input segments down until reaching the target genome. If the
+// target genome is above the source genome, fail miserably.
+// Destructive to any data in the input or results list.
+template <class Reader>
+void SegmentMapper::mapRecursiveDown(Mappings &input, Mappings &results, const Genome *tgtGenome,
+                                     const set<const Genome *> &genomesOnPath, bool doDupes, hal_size_t minLength) {
+    if (input.empty() || input.front()._target._genome == tgtGenome) {
+        results.swap(input);
+        return;
+    }
+    Mappings *inputPtr = &input;
+    Mappings *outputPtr = &results;
+    while (true) {
+        const Genome *curGenome = inputPtr->front()._target._genome;
+
+        // Find the correct child to move down into.
+        const Genome *nextGenome = NULL;
+        hal_size_t nextChildIndex = numeric_limits<hal_size_t>::max();
+        const Alignment *alignment = curGenome->getAlignment();
+        vector<string> childNames = alignment->getChildNames(curGenome->getName());
+        for (hal_size_t child = 0; nextGenome == NULL && child < childNames.size(); ++child) {
+            bool onPath = childNames[child] == tgtGenome->getName();
+            for (set<const Genome *>::const_iterator i = genomesOnPath.begin(); not onPath && i != genomesOnPath.end(); ++i) {
+                onPath = (*i)->getName() == childNames[child];
+            }
+            if (onPath) {
+                nextGenome = curGenome->getChild(child);
+                nextChildIndex = child;
             }
         }
-    }
+        if (nextGenome == NULL) {
+            throw hal_exception("Could not find correct child that leads from " + curGenome->getName() + " to " +
+                                tgtGenome->getName());
+        }
+        assert(nextGenome->getParent() == curGenome);
+
+        // Map the actual segments down.
+        outputPtr->clear();
+        for (const SegmentMapping &mapping : *inputPtr) {
+            assert(mapping._target._genome == curGenome);
+            mapDown<Reader>(mapping, nextChildIndex, *outputPtr, minLength);
+        }
 
-    // 3) cut results by input list
-    for (inputIt = inputSegs.begin(); inputIt != inputSegs.end(); ++inputIt) {
-        assert((*inputIt)->getLength() == (*inputIt)->getSource()->getLength());
-        resIt = leftBegin ? results.begin() : leftBound;
-        for (; resIt != rightBound; ++resIt) {
-            assert((*resIt)->getLength() == (*resIt)->getSource()->getLength());
-            oc = slowOverlap(resIt->get()->getTarget(), inputIt->get()->getTarget());
-            // assert(oc == Same || oc == Disjoint || oc == AContainsB);
-            if (oc == AContainsB) {
-                clippedSegs.clear();
-                clipAagainstB(*resIt, *inputIt, oc, clippedSegs);
-                results.insert(clippedSegs.begin(), clippedSegs.end());
+        // Find paralogs.
+        if (doDupes == true) {
+            swap(inputPtr, outputPtr);
+            outputPtr->clear();
+            for (const SegmentMapping &mapping : *inputPtr) {
+                assert(mapping._target._genome == nextGenome);
+                mapSelf<Reader>(mapping, *outputPtr, minLength);
             }
         }
+        if ((nextGenome == tgtGenome) || outputPtr->empty()) {
+            break;
+        }
+        swap(inputPtr, outputPtr);
     }
-
-    // 4) insert the input list
-    results.insert(inputSegs.begin(), inputSegs.end());
+    if (outputPtr != &results) {
+        results.swap(*outputPtr);
+    }
+    sortUnique(results);
 }
 
 // Map all segments from the input to any segments in the same genome
 // that coalesce in or before the given "coalescence limit" genome.
 // Destructive to any data in the input list.
-static hal_size_t mapRecursiveParalogies(const Genome *srcGenome, list<MappedSegmentPtr> &input,
-                                         list<MappedSegmentPtr> &results, const set<string> &namesOnPath,
-                                         const Genome *coalescenceLimit, hal_size_t minLength) {
-    if (input.empty()) {
-        results = input;
-        return 0;
-    }
-
-    const Genome *curGenome = (*input.begin())->getGenome();
-    assert(curGenome != NULL);
-    if (curGenome == coalescenceLimit) {
-        results = input;
-        return 0;
-    }
-
+template <class Reader>
+void SegmentMapper::mapRecursiveParalogies(const Genome *srcGenome, Mappings &input, Mappings &results,
+                                           const set<const Genome *> &genomesOnPath, const Genome *coalescenceLimit,
+                                           hal_size_t minLength) {
+    if (input.empty() || input.front()._target._genome == coalescenceLimit) {
+        results.swap(input);
+        return;
+    }
+    const Genome *curGenome = input.front()._target._genome;
     const Genome *nextGenome = curGenome->getParent();
-
     if (nextGenome == NULL) {
         throw hal_exception("Hit root genome when attempting to map paralogies");
     }
-    list<MappedSegmentPtr> paralogs;
+    size_t numBuffersUsed = _numBuffersUsed;
+
     // Map to any paralogs in the current genome.
     // FIXME: I think the original segments are included in this, which is a waste.
-    list<MappedSegmentPtr>::iterator i = input.begin();
-    for (; i != input.end(); ++i) {
-        assert((*i)->getGenome() == curGenome);
-        mapSelf(*i, paralogs, minLength);
+    Mappings &paralogs = getBuffer();
+    for (const SegmentMapping &mapping : input) {
+        assert(mapping._target._genome == curGenome);
+        mapSelf<Reader>(mapping, paralogs, minLength);
     }
 
+    results.clear();
     if (nextGenome != coalescenceLimit) {
-        list<MappedSegmentPtr> nextSegments;
         // Map all of the original segments (not the paralogs, which is a
-        // waste) up to the next genome.
-        i = input.begin();
-        for (; i != input.end(); ++i) {
-            assert((*i)->getGenome() == curGenome);
-            mapUp(*i, nextSegments, true, minLength);
+        // waste) up to the next genome, and recurse on them.
+        Mappings &nextSegments = getBuffer();
+        for (const SegmentMapping &mapping : input) {
+            mapUp<Reader>(mapping, nextSegments, minLength);
         }
-
-        // Recurse on the mapped segments.
-        mapRecursiveParalogies(srcGenome, nextSegments, results, namesOnPath, coalescenceLimit, minLength);
+        mapRecursiveParalogies<Reader>(srcGenome, nextSegments, results, genomesOnPath, coalescenceLimit, minLength);
     }
 
-    // Map all the paralogs we found in this genome back to the source.
-    list<MappedSegmentPtr> paralogsMappedToSrc;
-    mapRecursiveDown(paralogs, paralogsMappedToSrc, srcGenome, namesOnPath, false, minLength);
-
-    results.splice(results.begin(), paralogsMappedToSrc);
-    results.sort(MappedSegment::LessSourcePtr());
-    results.unique(MappedSegment::EqualToPtr());
-    return results.size();
+    // Map all the paralogs we found in this genome back to the source,
+    // ahead of those of the genomes above.
+    Mappings &paralogsMappedToSrc = getBuffer();
+    mapRecursiveDown<Reader>(paralogs, paralogsMappedToSrc, srcGenome, genomesOnPath, false, minLength);
+    results.insert(results.begin(), paralogsMappedToSrc.begin(), paralogsMappedToSrc.end());
+    sortUnique(results);
+    _numBuffersUsed = numBuffersUsed;
 }
 
-static hal_size_t mapSource(const SegmentIterator *source, MappedSegmentSet &results, const Genome *tgtGenome,
-                            const set<const Genome *> *genomesOnPath, bool doDupes, hal_size_t minLength,
-                            const Genome *coalescenceLimit, const Genome *mrca) {
-    assert(source != NULL);
-
-    // FIXME: why does target start out as source??  This is all a bit clunky
-    SegmentIteratorPtr startSourceSegIt;
-    SegmentIteratorPtr startTargetSegIt;
-    if (source->isTop()) {
-        startSourceSegIt = dynamic_cast<const TopSegmentIterator *>(source)->clone();
-        startTargetSegIt = dynamic_cast<const TopSegmentIterator *>(source)->clone();
-    } else {
-        startSourceSegIt = dynamic_cast<const BottomSegmentIterator *>(source)->clone();
-        startTargetSegIt = dynamic_cast<const BottomSegmentIterator *>(source)->clone();
-    }
-
-    MappedSegmentPtr newMappedSeg(new MappedSegment(startSourceSegIt, startTargetSegIt));
-
-    list<MappedSegmentPtr> input;
-    input.push_back(newMappedSeg);
-    list<MappedSegmentPtr> output;
-
-    set<string> namesOnPath;
-    assert(genomesOnPath != NULL);
-    for (set<const Genome *>::const_iterator i = genomesOnPath->begin(); i != genomesOnPath->end(); ++i) {
-        namesOnPath.insert((*i)->getName());
+template <class Reader>
+void SegmentMapper::mapThroughTree(const SourceSegments &source, const Genome *tgtGenome,
+                                   const set<const Genome *> &genomesOnPath, bool doDupes, hal_size_t minLength,
+                                   const Genome *coalescenceLimit, const Genome *mrca) {
+    // the targets start out as the sources
+    Mappings &input = getBuffer();
+    SegmentMapping start;
+    start._source._genome = source._genome;
+    start._source._top = source._top;
+    start._source._startOffset = source._startOffset;
+    start._source._endOffset = source._endOffset;
+    start._source._reversed = source._reversed;
+    for (hal_size_t i = 0; i < source._numSegments; ++i) {
+        toArrayIndex<Reader>(start._source, source._firstIndex + (hal_index_t)i);
+        start._target = start._source;
+        input.push_back(start);
     }
 
-    // FIXME: using multiple lists is probably much slower than just
-    // reusing the results list over and over.
-    list<MappedSegmentPtr> upResults;
     // Map all segments up to the MRCA of src and tgt.
-    if (source->getGenome() != mrca) {
-        mapRecursiveUp(input, upResults, mrca, minLength);
-    } else {
-        upResults = input;
-    }
+    Mappings &upResults = getBuffer();
+    mapRecursiveUp<Reader>(input, upResults, mrca, minLength);
 
-    list<MappedSegmentPtr> paralogResults;
     // Map to all paralogs that coalesce in or below the coalescenceLimit.
+    Mappings &paralogResults = getBuffer();
     if (mrca != coalescenceLimit && doDupes) {
-        mapRecursiveParalogies(mrca, upResults, paralogResults, namesOnPath, coalescenceLimit, minLength);
+        mapRecursiveParalogies<Reader>(mrca, upResults, paralogResults, genomesOnPath, coalescenceLimit, minLength);
     } else {
-        paralogResults = upResults;
+        paralogResults.swap(upResults);
     }
 
     // Finally, map back down to the target genome.
-    if (tgtGenome != mrca) {
-        mapRecursiveDown(paralogResults, output, tgtGenome, namesOnPath, doDupes, minLength);
-    } else {
-        output = paralogResults;
-    }
+    mapRecursiveDown<Reader>(paralogResults, _mappings, tgtGenome, genomesOnPath, doDupes, minLength);
+}
 
-    list<MappedSegmentPtr>::iterator outIt = output.begin();
-    for (; outIt != output.end(); ++outIt) {
-        insertAndBreakOverlaps(*outIt, results);
-    }
+hal_size_t SegmentMapper::map(const SegmentIterator *source, const Genome *tgtGenome, const set<const Genome *> *genomesOnPath,
+                              bool doDupes, hal_size_t minLength, const Genome *coalescenceLimit, const Genome *mrca) {
+    assert(source != NULL);
+    SourceSegments segments;
+    segments._genome = source->getGenome();
+    segments._top = source->isTop();
+    segments._firstIndex = source->getArrayIndex();
+    segments._numSegments = 1;
+    segments._startOffset = source->getStartOffset();
+    segments._endOffset = source->getEndOffset();
+    segments._reversed = source->getReversed();
+    return mapSource(segments, tgtGenome, genomesOnPath, doDupes, minLength, coalescenceLimit, mrca);
+}
 
-    return output.size();
+hal_size_t SegmentMapper::mapSegments(const Genome *srcGenome, bool top, hal_index_t firstIndex, hal_size_t numSegments,
+                                      const Genome *tgtGenome, const set<const Genome *> *genomesOnPath, bool doDupes,
+                                      hal_size_t minLength, const Genome *coalescenceLimit, const Genome *mrca) {
+    assert(srcGenome != NULL);
+    assert(firstIndex >= 0 &&
+           firstIndex + numSegments <= (top ? srcGenome->getNumTopSegments() : srcGenome->getNumBottomSegments()));
+    SourceSegments segments;
+    segments._genome = srcGenome;
+    segments._top = top;
+    segments._firstIndex = firstIndex;
+    segments._numSegments = numSegments;
+    segments._startOffset = 0;
+    segments._endOffset = 0;
+    segments._reversed = false;
+    return mapSource(segments, tgtGenome, genomesOnPath, doDupes, minLength, coalescenceLimit, mrca);
 }
 
-hal_size_t hal::halMapSegment(const SegmentIterator *source, MappedSegmentSet &outSegments, const Genome *tgtGenome,
-                              const set<const Genome *> *genomesOnPath, bool doDupes, hal_size_t minLength,
-                              const Genome *coalescenceLimit, const Genome *mrca) {
+hal_size_t SegmentMapper::mapSource(const SourceSegments &source, const Genome *tgtGenome,
+                                    const set<const Genome *> *genomesOnPath, bool doDupes, hal_size_t minLength,
+                                    const Genome *coalescenceLimit, const Genome *mrca) {
     assert(tgtGenome != NULL);
+    _numBuffersUsed = 0;
+    _mappings.clear();
 
     if (mrca == NULL) {
         set<const Genome *> inputSet;
-        inputSet.insert(source->getGenome());
+        inputSet.insert(source._genome);
         inputSet.insert(tgtGenome);
         mrca = getLowestCommonAncestor(inputSet);
     }
-
     if (coalescenceLimit == NULL) {
         coalescenceLimit = mrca;
     }
@@ -664,8 +591,62 @@ hal_size_t hal::halMapSegment(const SegmentIterator *source, MappedSegmentSet &o
         genomesOnPath = &pathSet;
     }
 
-    hal_size_t numResults =
-        mapSource(source, outSegments, tgtGenome, genomesOnPath, doDupes, minLength, coalescenceLimit, mrca);
+    try {
+        // all genomes of an alignment are stored alike, so the reader is
+        // chosen by the source genome
+        _columnReaders.push_back(ColumnSegmentReader());
+        if (_columnReaders.back().open(source._genome)) {
+            mapThroughTree<ColumnSegmentReader>(source, tgtGenome, *genomesOnPath, doDupes, minLength,
+                                                coalescenceLimit, mrca);
+        } else {
+            _columnReaders.clear();
+            mapThroughTree<VirtualSegmentReader>(source, tgtGenome, *genomesOnPath, doDupes, minLength,
+                                                 coalescenceLimit, mrca);
+        }
+    } catch (...) {
+        _virtualReaders.clear();
+        _columnReaders.clear();
+        throw;
+    }
+    // release the segment readers, the genomes may be closed
+    _virtualReaders.clear();
+    _columnReaders.clear();
+    return _mappings.size();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// MAPPED SEGMENT SETS
+//////////////////////////////////////////////////////////////////////////////
+/* a segment iterator at a slice */
+static SegmentIteratorPtr getSegmentIterator(const SegmentSlice &slice) {
+    SegmentIteratorPtr segIt;
+    if (slice._top) {
+        segIt = slice._genome->getTopSegmentIterator(slice._arrayIndex);
+    } else {
+        segIt = slice._genome->getBottomSegmentIterator(slice._arrayIndex);
+    }
+    if (slice._reversed) {
+        segIt->toReverse();
+    }
+    segIt->slice(slice._startOffset, slice._endOffset);
+    return segIt;
+}
+
+void SegmentMapper::addToSet(MappedSegmentSet &outSegments) const {
+    for (const SegmentMapping &mapping : _mappings) {
+        MappedSegmentPtr mappedSeg(
+            new MappedSegment(getSegmentIterator(mapping._source), getSegmentIterator(mapping._target)));
+        outSegments.insertAndBreakOverlaps(mappedSeg);
+    }
+    outSegments.resolve();
+}
+
+hal_size_t hal::halMapSegment(const SegmentIterator *source, MappedSegmentSet &outSegments, const Genome *tgtGenome,
+                              const set<const Genome *> *genomesOnPath, bool doDupes, hal_size_t minLength,
+                              const Genome *coalescenceLimit, const Genome *mrca) {
+    static thread_local SegmentMapper mapper;
+    hal_size_t numResults = mapper.map(source, tgtGenome, genomesOnPath, doDupes, minLength, coalescenceLimit, mrca);
+    mapper.addToSet(outSegments);
     return numResults;
 }
 
@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+#include "halThreadPool.h"
+#include "halAlignment.h"
+#include <algorithm>
+#include <chrono>
+
+using namespace std;
+using namespace hal;
+
+// queue of the worker running in this thread, so that tasks submitted from
+// a task go on the same queue
+static thread_local ThreadPool *currentPool = NULL;
+static thread_local size_t currentQueue = 0;
+
+// how long waiting threads sleep before checking for tasks to help with
+static const chrono::milliseconds helpInterval(1);
+
+ThreadPool::ThreadPool(size_t numThreads)
+    : _numThreads(numThreads), _numQueued(0), _nextQueue(0), _stopping(false) {
+    if (_numThreads == 0) {
+        _numThreads = std::max(thread::hardware_concurrency(), 1u);
+    }
+    if (_numThreads > 1) {
+        for (size_t i = 0; i < _numThreads; i++) {
+            _queues.push_back(unique_ptr<WorkQueue>(new WorkQueue()));
+        }
+        for (size_t i = 0; i < _numThreads; i++) {
+            _workers.push_back(thread(&ThreadPool::workerLoop, this, i));
+        }
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> lock(_sleepLock);
+        _stopping = true;
+    }
+    _wakeUp.notify_all();
+    for (thread &worker : _workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(Task task) {
+    if (_workers.empty()) {
+        task();
+        return;
+    }
+    size_t queueIndex = (currentPool == this) ? currentQueue : _nextQueue++ % _queues.size();
+    {
+        lock_guard<mutex> lock(_queues[queueIndex]->_lock);
+        _queues[queueIndex]->_tasks.push_back(std::move(task));
+    }
+    {
+        // count under the sleep lock, so a worker can't miss the wake up
+        lock_guard<mutex> lock(_sleepLock);
+        ++_numQueued;
+    }
+    _wakeUp.notify_one();
+}
+
+bool ThreadPool::runPendingTask() {
+    Task task;
+    if (_workers.empty() or not popTask((currentPool == this) ? currentQueue : _nextQueue++ % _queues.size(), task)) {
+        return false;
+    }
+    task();
+    return true;
+}
+
+/* take the newest task from our own queue, otherwise steal the oldest
+ * task from another */
+bool ThreadPool::popTask(size_t queueIndex, Task &task) {
+    if (_numQueued == 0) {
+        return false;
+    }
+    {
+        WorkQueue &queue = *_queues[queueIndex];
+        lock_guard<mutex> lock(queue._lock);
+        if (not queue._tasks.empty()) {
+            task = std::move(queue._tasks.back());
+            queue._tasks.pop_back();
+            --_numQueued;
+            return true;
+        }
+    }
+    for (size_t i = 1; i < _queues.size(); i++) {
+        WorkQueue &queue = *_queues[(queueIndex + i) % _queues.size()];
+        lock_guard<mutex> lock(queue._lock);
+        if (not queue._tasks.empty()) {
+            task = std::move(queue._tasks.front());
+            queue._tasks.pop_front();
+            --_numQueued;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(size_t queueIndex) {
+    currentPool = this;
+    currentQueue = queueIndex;
+    while (true) {
+        Task task;
+        if (popTask(queueIndex, task)) {
+            task();
+            continue;
+        }
+        unique_lock<mutex> lock(_sleepLock);
+        _wakeUp.wait(lock, [this]() { return _stopping or _numQueued > 0; });
+        if (_stopping and _numQueued == 0) {
+            return;
+        }
+    }
+}
+
+static unique_ptr<ThreadPool> sharedPool;
+static mutex sharedPoolLock;
+
+ThreadPool &ThreadPool::getShared() {
+    lock_guard<mutex> lock(sharedPoolLock);
+    if (sharedPool == NULL) {
+        sharedPool.reset(new ThreadPool(1));
+    }
+    return *sharedPool;
+}
+
+void ThreadPool::setSharedNumThreads(size_t numThreads) {
+    lock_guard<mutex> lock(sharedPoolLock);
+    if ((sharedPool == NULL) or (sharedPool->getNumThreads() != numThreads)) {
+        sharedPool.reset(new ThreadPool(numThreads));
+    }
+}
+
+TaskGroup::TaskGroup(ThreadPool &pool) : _pool(pool), _numPending(0) {
+}
+
+TaskGroup::~TaskGroup() {
+    waitAll();
+}
+
+void TaskGroup::run(ThreadPool::Task task) {
+    {
+        lock_guard<mutex> lock(_lock);
+        _numPending++;
+    }
+    _pool.submit([this, task]() {
+        exception_ptr exception;
+        try {
+            task();
+        } catch (...) {
+            exception = current_exception();
+        }
+        // everything is done under the lock, as the group may be destroyed
+        // as soon as the waiting thread sees the count reach zero
+        lock_guard<mutex> lock(_lock);
+        if (exception and not _exception) {
+            _exception = exception;
+        }
+        if (--_numPending == 0) {
+            _done.notify_all();
+        }
+    });
+}
+
+void TaskGroup::wait() {
+    waitAll();
+    exception_ptr exception;
+    {
+        lock_guard<mutex> lock(_lock);
+        std::swap(exception, _exception);
+    }
+    if (exception) {
+        rethrow_exception(exception);
+    }
+}
+
+void TaskGroup::waitAll() {
+    while (true) {
+        {
+            lock_guard<mutex> lock(_lock);
+            if (_numPending == 0) {
+                return;
+            }
+        }
+        if (not _pool.runPendingTask()) {
+            unique_lock<mutex> lock(_lock);
+            _done.wait_for(lock, helpInterval, [this]() { return _numPending == 0; });
+        }
+    }
+}
+
+ThreadPool &hal::getReadThreadPool(const Alignment *alignment) {
+    static ThreadPool serialPool(1);
+    return alignment->supportsConcurrentReads() ? ThreadPool::getShared() : serialPool;
+}
+
+vector<pair<hal_size_t, hal_size_t>> hal::splitRange(hal_size_t start, hal_size_t length, hal_size_t chunkSize,
+                                                     hal_size_t alignment) {
+    chunkSize = std::max((chunkSize / alignment) * alignment, alignment);
+    vector<pair<hal_size_t, hal_size_t>> chunks;
+    for (hal_size_t i = 0; i < length; i += chunkSize) {
+        chunks.push_back(make_pair(start + i, std::min(chunkSize, length - i)));
+    }
+    return chunks;
+}
+
+void hal::parallelOrderedOutput(size_t numChunks, const function<void(size_t, string &)> &produce,
+                                const function<void(const string &)> &consume, ThreadPool &pool) {
+    // the outputs of a window of chunks, as a ring buffer
+    struct Chunk {
+        string _output;
+        exception_ptr _exception;
+        bool _ready = false;
+    };
+    size_t window = 2 * pool.getNumThreads();
+    vector<Chunk> chunks(window);
+    mutex lock;
+    condition_variable readyCond;
+    TaskGroup group(pool); // destroyed (waiting for its tasks) before the chunks
+    size_t numSubmitted = 0;
+
+    for (size_t next = 0; next < numChunks; next++) {
+        for (; numSubmitted < std::min(next + window, numChunks); numSubmitted++) {
+            size_t i = numSubmitted;
+            group.run([&, i]() {
+                string output;
+                exception_ptr exception;
+                try {
+                    produce(i, output);
+                } catch (...) {
+                    exception = current_exception();
+                }
+                lock_guard<mutex> guard(lock);
+                Chunk &chunk = chunks[i % window];
+                chunk._output.swap(output);
+                chunk._exception = exception;
+                chunk._ready = true;
+                readyCond.notify_all();
+            });
+        }
+        Chunk &chunk = chunks[next % window];
+        while (true) {
+            {
+                lock_guard<mutex> guard(lock);
+                if (chunk._ready) {
+                    break;
+                }
+            }
+            if (not pool.runPendingTask()) {
+                unique_lock<mutex> guard(lock);
+                readyCond.wait_for(guard, helpInterval, [&chunk]() { return chunk._ready; });
+            }
+        }
+        // nothing else touches the chunk until it is resubmitted below
+        if (chunk._exception) {
+            rethrow_exception(chunk._exception);
+        }
+        consume(chunk._output);
+        chunk._output.clear();
+        chunk._ready = false;
+    }
+    group.wait();
+}
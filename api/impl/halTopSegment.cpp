@@ -1,9 +1,8 @@
 #include "halTopSegment.h"
-#include "halDnaIterator.h"
+#include "halGenome.h"
 
 using namespace hal;
 
 void TopSegment::getString(std::string &outString) const {
-    DnaIteratorPtr dnaIt(getGenome()->getDnaIterator(getStartPosition()));
-    dnaIt->readString(outString, getLength());
+    getGenome()->getSubString(outString, getStartPosition(), getLength());
 }
@@ -71,17 +71,23 @@
 #include "halGappedBottomSegmentIterator.h"
 #include "halGappedTopSegmentIterator.h"
 #include "halGenome.h"
+#include "halIoStats.h"
 #include "halMappedSegment.h"
 #include "halMetaData.h"
+#include "halPairwiseBlockIterator.h"
+#include "halPackedDnaSpan.h"
 #include "halPositionCache.h"
 #include "halRearrangement.h"
 #include "halSegment.h"
 #include "halSegmentIterator.h"
+#include "halSegmentColumns.h"
 #include "halSegmentMapper.h"
+#include "halSegmentReader.h"
 #include "halSegmentedSequence.h"
 #include "halSequence.h"
 #include "halSequenceIterator.h"
 #include "halSlicedSegment.h"
+#include "halThreadPool.h"
 #include "halTopSegment.h"
 #include "halTopSegmentIterator.h"
 #include "halValidate.h"
@@ -13,6 +13,7 @@
 #include <vector>
 
 namespace hal {
+    class IoStats;
 
     /**
      * Interface for a hierarhcical alignment.  Responsible for creating
@@ -117,8 +118,39 @@ namespace hal {
         /** Is this file open for read-only? */
         virtual bool isReadOnly() const = 0;
 
+        /** Can several threads read from this alignment at once?  If so,
+         * openGenome(), tree queries, genome and sequence lookups, segment,
+         * sequence and DNA iterators, getString() and segment mapping may all
+         * be used concurrently, provided that each iterator is only used by
+         * one thread at a time and that nothing modifies the alignment in the
+         * meantime.  Otherwise, all access must be serialized by the caller.
+         * The mmap format supports concurrent reads, HDF5 does not (its
+         * arrays are paged through buffers shared by all readers). */
+        virtual bool supportsConcurrentReads() const {
+            return false;
+        }
+
         /** Replace the newick tree with a new string */
         virtual void replaceNewickTree(const std::string &newick) = 0;
+
+        /** Hint that the alignment will be read mostly sequentially,
+         * allowing the storage layer to read ahead aggressively.
+         * No-op for storage formats that don't support access hints. */
+        virtual void adviseSequential() const {
+        }
+
+        /** Hint that the alignment will be read in small random pieces, so
+         * reading ahead is wasted effort.  No-op for storage formats that don't
+         * support access hints. */
+        virtual void adviseRandom() const {
+        }
+
+        /** Add the I/O statistics of the alignment so far, for the
+         * genomes that have been opened, to stats.  No-op for storage
+         * formats that don't gather statistics.  The --ioStats option of
+         * CLParser writes them when the alignment is closed. */
+        virtual void getIoStats(IoStats &stats) const {
+        }
     };
 }
 #endif
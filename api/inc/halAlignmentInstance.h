@@ -55,10 +55,11 @@ namespace hal {
     }
 
     /*
-     * MMap file default size when opening file for write access.
+     * MMap file default initial size when opening file for write access.
+     * The file grows as needed, so this is only a starting point.
      */
-    static const size_t MMAP_DEFAULT_FILE_SIZE_GB = 64;
-    static const size_t MMAP_DEFAULT_FILE_SIZE = 64 * GIGABYTE;
+    static const size_t MMAP_DEFAULT_FILE_SIZE_GB = 1;
+    static const size_t MMAP_DEFAULT_FILE_SIZE = 1 * GIGABYTE;
 
     /* get default FileCreatPropList with HAL default properties set */
     const H5::FileCreatPropList &hdf5DefaultFileCreatPropList();
@@ -91,7 +92,8 @@ namespace hal {
     /** Get an instance of an mmap-implemented Alignment.
      * @param alignmentPath Path to file or URL for UDC access.
      * @param mode Access mode bit map
-     * @param fileSize Size to allocate when creating new file (CREATE_ACCESS)
+     * @param fileSize Initial size to allocate when creating new file (CREATE_ACCESS),
+     * the file will grow as needed.
      */
     Alignment *mmapAlignmentInstance(const std::string &alignmentPath, unsigned mode = hal::READ_ACCESS,
                                      size_t fileSize = hal::MMAP_DEFAULT_FILE_SIZE);
@@ -110,6 +112,20 @@ namespace hal {
      */
     Alignment *openHalAlignment(const std::string &path, const CLParser *options = NULL, unsigned mode = hal::READ_ACCESS,
                                 const std::string &overrideFormat = "");
+
+    /** Copy genomes from an HDF5 alignment into an mmap alignment in bulk,
+     * reading whole chunks of the HDF5 arrays and copying different
+     * genomes on the threads of the shared ThreadPool.  The genomes must
+     * already be in the tree of the output alignment, without dimensions.
+     * Like halExtract, the root of the output alignment gets no top
+     * segments and its leaves no bottom segments.
+     * @param inAlignment HDF5 alignment to copy from
+     * @param outAlignment mmap alignment to copy to
+     * @param genomeNames genomes to copy, parents before children
+     * @param progress stream to report each genome to, or NULL
+     */
+    void copyHdf5GenomesToMMap(const Alignment *inAlignment, Alignment *outAlignment,
+                               const std::vector<std::string> &genomeNames, std::ostream *progress = NULL);
 }
 
 #endif
@@ -12,6 +12,7 @@
 #include "halDefs.h"
 #include "halDnaIterator.h"
 #include "halPositionCache.h"
+#include "halSegmentReader.h"
 #include "halSequence.h"
 #include "sonLib.h"
 #include <list>
@@ -138,6 +139,7 @@ namespace hal {
         void updateNextTopDup(LinkedTopIterator *linkTopIt);
         void updateParseUp(LinkedBottomIterator *linkBotIt);
         void updateParseDown(LinkedTopIterator *linkTopIt);
+        void toSegmentContaining(SegmentIterator *segIt, hal_index_t position);
 
         bool parentInScope(const Genome *) const;
         bool childInScope(const Genome *, hal_size_t child) const;
@@ -173,6 +175,12 @@ namespace hal {
         mutable stTree *_treeCache;
         bool _unique;
         bool _onlyOrthologs;
+
+        // segments of the reference genome, read in place when possible
+        const Genome *_readerGenome;
+        bool _readColumns;
+        ColumnSegmentReader _columnReader;
+        VirtualSegmentReader _virtualReader;
     };
 
     inline std::ostream &operator<<(std::ostream &os, const ColumnIterator &cit) {
@@ -194,6 +194,33 @@ namespace hal {
         uint8_t code = dnaPackMap[uint8_t(unpackedChar)];
         return (index & 1) ? ((packedChar & 0xF0) | code) : ((packedChar & 0x0F) | (code << 4));
     }
+
+    /** Instruction set used by the bulk DNA functions below.  The best one
+     * supported by the CPU is selected when the library is loaded. */
+    enum DnaKernelLevel { DNA_KERNEL_SCALAR = 0, DNA_KERNEL_SSE4 = 1, DNA_KERNEL_AVX2 = 2 };
+
+    /** Get the instruction set used by the bulk DNA functions */
+    DnaKernelLevel getDnaKernelLevel();
+
+    /** Set the instruction set used by the bulk DNA functions, limited to
+     * what the CPU supports (mainly for testing).  Returns the level used. */
+    DnaKernelLevel setDnaKernelLevel(DnaKernelLevel level);
+
+    /** Unpack a range of nibble-packed DNA into a character buffer.
+     * @param packed packed bytes, base 0 is the high nibble of packed[0]
+     * @param offset index of first base to unpack
+     * @param length number of bases to unpack
+     * @param out buffer of at least length characters (not terminated) */
+    void dnaUnpackString(const unsigned char *packed, hal_size_t offset, hal_size_t length, char *out);
+
+    /** Unpack the reverse complement of a range of nibble-packed DNA,
+     * so out[0] is the complement of base offset + length - 1.
+     * Arguments as for dnaUnpackString(). */
+    void dnaUnpackReverseComplement(const unsigned char *packed, hal_size_t offset, hal_size_t length, char *out);
+
+    /** Reverse complement a buffer of DNA characters in place.  Unlike
+     * reverseComplement(std::string&), gaps are not treated specially. */
+    void dnaReverseComplement(char *s, hal_size_t length);
 }
 
 #endif
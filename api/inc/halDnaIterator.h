@@ -164,11 +164,15 @@ namespace hal {
 
     inline void DnaIterator::readString(std::string &outString, hal_size_t length) {
         assert(length == 0 || inRange() == true);
-        outString.resize(length);
-
-        for (hal_size_t i = 0; i < length; ++i) {
-            outString[i] = getBase();
-            toRight();
+        PackedDnaSpan span;
+        if (not _reversed) {
+            _genome->getPackedDna(span, _index, length);
+            span.unpack(outString);
+            _index += length;
+        } else {
+            _genome->getPackedDna(span, _index + 1 - length, length);
+            span.unpackReverseComplement(outString);
+            _index -= length;
         }
     }
 
@@ -10,8 +10,10 @@
 
 #include "halAlignment.h"
 #include "halDefs.h"
+#include "halSegmentColumns.h"
 #include "halSegmentedSequence.h"
 #include "halSequence.h"
+#include <atomic>
 #include <string>
 #include <vector>
 
@@ -27,7 +29,8 @@ namespace hal {
       public:
         /* Constructor */
         Genome(Alignment *alignment, const std::string &name)
-            : _alignment(alignment), _name(name), _numChildren(alignment->getChildNames(name).size()), _parentCache(NULL){};
+            : _alignment(alignment), _name(name), _numChildren(alignment->getChildNames(name).size()), _parentCache(NULL),
+              _childCache(_numChildren){};
 
         /** Destructor */
         virtual ~Genome() {
@@ -78,6 +81,16 @@ namespace hal {
         /** Get a sequence by base's position (in genome coordinates) */
         virtual const Sequence *getSequenceBySite(hal_size_t position) const = 0;
 
+        /** Get the sequences containing each of a list of positions (in
+         * genome coordinates).  This is faster than calling
+         * getSequenceBySite() for each position, as consecutive positions in
+         * the same sequence don't need to be looked up.
+         * @param positions positions, sorted in increasing order
+         * @param sequences set to the sequence for each position, or NULL
+         * if the position is past the end of the genome */
+        virtual void getSequencesBySites(const std::vector<hal_size_t> &positions,
+                                         std::vector<const Sequence *> &sequences) const;
+
         /** Get a sequence iterator
          * @param position Number of the sequence to start iterator at */
         virtual SequenceIteratorPtr getSequenceIterator(hal_index_t position = 0) = 0;
@@ -175,10 +188,28 @@ namespace hal {
         /** Rename this genome. */
         virtual void rename(const std::string &name) = 0;
 
+        /** Hint that a range of the genome is about to be accessed.  Storage
+         * formats that support it start loading the segments and DNA
+         * covering the range in bulk, rather than a page at a time.  This is
+         * a no-op by default.
+         * @param start first position of range (in genome coordinates)
+         * @param length length of the range */
+        virtual void prefetchRange(hal_index_t start, hal_size_t length) const {
+        }
+
+        /** Get the segment arrays as columns in memory, to be read in place
+         * (see ColumnSegmentReader).  Storage formats that can't give them
+         * (HDF5, and mmap files that are not local or predate columns)
+         * return false, which is the default.
+         * @param columns Set to the columns of the genome */
+        virtual bool getSegmentColumns(SegmentColumns &columns) const {
+            return false;
+        }
+
         /** Reload the genome after some aspect has changed, clearing any caches. */
         void reload() {
             _numChildren = _alignment->getChildNames(_name).size();
-            _childCache.empty();
+            std::vector<std::atomic<Genome *>>(_numChildren).swap(_childCache);
             _parentCache = NULL;
         };
 
@@ -186,33 +217,32 @@ namespace hal {
         Alignment *_alignment;
         std::string _name;
         hal_index_t _numChildren;
-        mutable Genome *_parentCache;
-        mutable std::vector<Genome *> _childCache;
+        // Caches are atomic so that readers in several threads can fill them
+        // (see Alignment::supportsConcurrentReads()).  Racing threads store
+        // the same pointer, since openGenome() returns the one open genome.
+        mutable std::atomic<Genome *> _parentCache;
+        mutable std::vector<std::atomic<Genome *>> _childCache;
     };
 
     inline Genome *Genome::getChild(hal_size_t childIdx) {
-        if (_childCache.size() <= childIdx) {
-            _childCache.assign(_numChildren, NULL);
-        }
-        if (_childCache[childIdx] == NULL) {
-            std::vector<std::string> childNames = _alignment->getChildNames(_name);
-            _childCache[childIdx] = _alignment->openGenome(childNames.at(childIdx));
-        }
-        return _childCache[childIdx];
+        return const_cast<Genome *>(static_cast<const Genome *>(this)->getChild(childIdx));
     }
 
     inline const Genome *Genome::getChild(hal_size_t childIdx) const {
         if (childIdx >= _numChildren) {
             throw hal_exception("Genome::getChild() - child out of range");
         }
-        if (_childCache.size() < _numChildren) {
-            _childCache.assign(_numChildren, NULL);
+        if (_childCache.size() != _numChildren) {
+            // only after the tree was modified
+            std::vector<std::atomic<Genome *>>(_numChildren).swap(_childCache);
         }
-        if (_childCache[childIdx] == NULL) {
+        Genome *child = _childCache[childIdx].load(std::memory_order_acquire);
+        if (child == NULL) {
             std::vector<std::string> childNames = _alignment->getChildNames(_name);
-            _childCache[childIdx] = _alignment->openGenome(childNames.at(childIdx));
+            child = const_cast<Genome *>(_alignment->openGenome(childNames.at(childIdx)));
+            _childCache[childIdx].store(child, std::memory_order_release);
         }
-        return _childCache[childIdx];
+        return child;
     }
 
     inline hal_size_t Genome::getNumChildren() const {
@@ -231,23 +261,19 @@ namespace hal {
     }
 
     inline Genome *Genome::getParent() {
-        if (_parentCache == NULL) {
-            std::string parName = _alignment->getParentName(_name);
-            if (parName.empty() == false) {
-                _parentCache = _alignment->openGenome(parName);
-            }
-        }
-        return _parentCache;
+        return const_cast<Genome *>(static_cast<const Genome *>(this)->getParent());
     }
 
     inline const Genome *Genome::getParent() const {
-        if (_parentCache == NULL) {
+        Genome *parent = _parentCache.load(std::memory_order_acquire);
+        if (parent == NULL) {
             std::string parName = _alignment->getParentName(_name);
             if (parName.empty() == false) {
-                _parentCache = _alignment->openGenome(parName);
+                parent = const_cast<Genome *>(_alignment->openGenome(parName));
+                _parentCache.store(parent, std::memory_order_release);
             }
         }
-        return _parentCache;
+        return parent;
     }
 }
 #endif
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HALIOSTATS_H
+#define _HALIOSTATS_H
+#include "halDefs.h"
+#include <map>
+#include <ostream>
+#include <string>
+
+namespace hal {
+    /**
+     * I/O statistics of an alignment, as gathered by its storage layer:
+     * counters for each array of each genome, and counters for the file as
+     * a whole.  The arrays and counters depend on the storage format (see
+     * Alignment::getIoStats()).  Counters are added to rather than set, so
+     * the statistics of several arrays, genomes or alignments can be
+     * summed.
+     */
+    class IoStats {
+      public:
+        typedef std::map<std::string, double> Counters;
+        typedef std::map<std::string, Counters> ArrayCounters;
+
+        /** Add to a counter of an array of a genome */
+        void add(const std::string &genomeName, const std::string &arrayName, const std::string &counterName,
+                 double value) {
+            _genomes[genomeName][arrayName][counterName] += value;
+        }
+
+        /** Add to a counter of the whole file */
+        void addFile(const std::string &counterName, double value) {
+            _file[counterName] += value;
+        }
+
+        /** Add all the counters of other statistics */
+        void merge(const IoStats &other);
+
+        /** Get a counter of an array of a genome, 0 if it was never added
+         * to */
+        double get(const std::string &genomeName, const std::string &arrayName, const std::string &counterName) const;
+
+        /** Get a counter of the whole file, 0 if it was never added to */
+        double getFile(const std::string &counterName) const;
+
+        /** Get the counters of each array of each genome */
+        const std::map<std::string, ArrayCounters> &getGenomes() const {
+            return _genomes;
+        }
+
+        /** Write the statistics as a JSON object on one line:
+         * {"path": ..., "format": ..., "file": {counter: value, ...},
+         *  "genomes": {genome: {array: {counter: value, ...}, ...}, ...}}
+         * @param os stream to write to
+         * @param path path of the alignment
+         * @param format storage format of the alignment */
+        void writeJson(std::ostream &os, const std::string &path, const std::string &format) const;
+
+      private:
+        std::map<std::string, ArrayCounters> _genomes;
+        Counters _file;
+    };
+
+    /** Write the I/O statistics of an alignment as a line of JSON (see
+     * IoStats::writeJson()), to stderr if path is "-", otherwise to a
+     * file.  The file is truncated by the first alignment of the process
+     * that writes to it, and appended to by the others, so a tool with
+     * several alignments writes one line for each.
+     * @param alignment alignment to get the statistics of
+     * @param alignmentPath path of the alignment
+     * @param path file to write to */
+    void writeIoStats(const Alignment *alignment, const std::string &alignmentPath, const std::string &path);
+
+    /** As writeIoStats(), for an alignment being closed: a failure is
+     * reported on stderr rather than thrown. */
+    void writeIoStatsOnClose(const Alignment *alignment, const std::string &alignmentPath, const std::string &path);
+
+    /** Throw an exception if an --ioStats path can't be opened for
+     * writing, so a bad path is reported when the alignment is opened
+     * rather than when it is closed. */
+    void checkIoStatsPath(const std::string &path);
+}
+#endif
+// Local Variables:
+// mode: c++
+// End:
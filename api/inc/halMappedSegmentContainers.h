@@ -7,7 +7,10 @@
 #ifndef _HALMAPPEDSEGMENTCONTAINERS_H
 #define _HALMAPPEDSEGMENTCONTAINERS_H
 #include "halDefs.h"
+#include <cassert>
 #include <set>
+#include <utility>
+#include <vector>
 
 namespace hal {
     /* Functor for set compare; implemented in halMappedSegment.cpp This needs
@@ -20,8 +23,113 @@ namespace hal {
         bool operator()(const hal::MappedSegmentPtr &m1, const hal::MappedSegmentPtr &m2) const;
     };
 
-    /* set of MappedSegments objects */
-    class MappedSegmentSet : public std::set<MappedSegmentPtr, MappedSegmentLess> {};
+    /**
+     * Set of MappedSegments objects, ordered by MappedSegmentLess and kept
+     * in a sorted vector, with the operations of a std::set.  Iterators
+     * are those of the vector: inserting or erasing invalidates the ones
+     * at or after the position changed.
+     *
+     * Segments added with insertAndBreakOverlaps() are only gathered
+     * until resolve() is called, or the set is next looked at through a
+     * non-const method.  They are then cut, along with the segments
+     * already in the set, wherever their target ranges partially
+     * overlap, in one sweep over the breakpoints of the segments
+     * involved.  Afterwards the targets of any two segments are either
+     * the same or disjoint, and segments equal to one already in the set
+     * (or to one added before them) are dropped.  Resolving rewrites the
+     * vector, so invalidates all iterators.  The const methods never
+     * resolve, so are safe to call from several threads at once, and
+     * must only be used on a resolved set; halMapSegment() resolves the
+     * sets it adds to.  Implemented in halMappedSegmentContainers.cpp.
+     */
+    class MappedSegmentSet {
+      public:
+        typedef MappedSegmentPtr key_type;
+        typedef MappedSegmentPtr value_type;
+        typedef MappedSegmentLess key_compare;
+        typedef std::vector<MappedSegmentPtr>::iterator iterator;
+        typedef std::vector<MappedSegmentPtr>::const_iterator const_iterator;
+        typedef size_t size_type;
+
+        iterator begin() {
+            resolve();
+            return _segments.begin();
+        }
+        const_iterator begin() const {
+            assert(isResolved());
+            return _segments.begin();
+        }
+        iterator end() {
+            resolve();
+            return _segments.end();
+        }
+        const_iterator end() const {
+            assert(isResolved());
+            return _segments.end();
+        }
+        size_t size() const {
+            assert(isResolved());
+            return _segments.size();
+        }
+        bool empty() const {
+            return _segments.empty() && _unresolved.empty();
+        }
+        void clear() {
+            _segments.clear();
+            _unresolved.clear();
+        }
+        void swap(MappedSegmentSet &other) {
+            _segments.swap(other._segments);
+            _unresolved.swap(other._unresolved);
+        }
+        key_compare key_comp() const {
+            return key_compare();
+        }
+
+        /** Insert a segment unless an equal one is in the set, without
+         * looking at overlaps */
+        std::pair<iterator, bool> insert(const MappedSegmentPtr &segment);
+        template <class InputIt> void insert(InputIt first, InputIt last) {
+            for (; first != last; ++first) {
+                insert(*first);
+            }
+        }
+
+        iterator erase(const_iterator pos);
+        iterator erase(const_iterator first, const_iterator last);
+        /** Erase the segment equal to the one given, returning the number
+         * erased */
+        size_t erase(const MappedSegmentPtr &segment);
+
+        iterator find(const MappedSegmentPtr &segment);
+        const_iterator find(const MappedSegmentPtr &segment) const;
+        iterator lower_bound(const MappedSegmentPtr &segment);
+        const_iterator lower_bound(const MappedSegmentPtr &segment) const;
+        iterator upper_bound(const MappedSegmentPtr &segment);
+        const_iterator upper_bound(const MappedSegmentPtr &segment) const;
+
+        /** Add a segment, to be cut against the other segments of the set
+         * where their targets overlap (see above) */
+        void insertAndBreakOverlaps(const MappedSegmentPtr &segment) {
+            _unresolved.push_back(segment);
+        }
+
+        /** Cut the segments added by insertAndBreakOverlaps() (see above) */
+        void resolve() {
+            if (not _unresolved.empty()) {
+                breakOverlaps();
+            }
+        }
+        bool isResolved() const {
+            return _unresolved.empty();
+        }
+
+      private:
+        void breakOverlaps();
+
+        std::vector<MappedSegmentPtr> _segments;
+        std::vector<MappedSegmentPtr> _unresolved;
+    };
 }
 
 #endif
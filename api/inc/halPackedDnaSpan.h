@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HALPACKEDDNASPAN_H
+#define _HALPACKEDDNASPAN_H
+#include "halCommon.h"
+#include <algorithm>
+#include <cassert>
+#include <string>
+#include <vector>
+
+namespace hal {
+    /**
+     * Read-only view of a range of nibble-packed DNA, as returned by
+     * SegmentedSequence::getPackedDna().  The first base of the range is in
+     * the high nibble of the first byte, unless the span is odd, in which
+     * case it is in the low nibble.  Storage that can't be referenced
+     * directly (e.g. HDF5) is copied into a buffer owned by the span.
+     * A span that references storage is valid until the alignment is
+     * closed or the DNA is modified.
+     */
+    class PackedDnaSpan {
+      public:
+        /** Constructor, creates an empty span */
+        PackedDnaSpan() : _data(NULL), _length(0), _odd(false) {
+        }
+
+        /** Get the first byte containing the range */
+        const unsigned char *getData() const {
+            return _data;
+        }
+
+        /** Get the number of bases in the range */
+        hal_size_t getLength() const {
+            return _length;
+        }
+
+        /** Is the first base in the low nibble of the first byte? */
+        bool isOdd() const {
+            return _odd;
+        }
+
+        /** Get the number of bytes spanned by the range */
+        hal_size_t getNumBytes() const {
+            return (_odd + _length + 1) / 2;
+        }
+
+        /** Does the span reference the underlying storage without a copy? */
+        bool isZeroCopy() const {
+            return _copy.empty();
+        }
+
+        /** Get a base relative to the start of the range */
+        char getBase(hal_size_t i) const {
+            assert(i < _length);
+            return dnaUnpack(_odd + i, _data[(_odd + i) / 2]);
+        }
+
+        /** Unpack the range into a buffer of at least getLength() characters */
+        void unpack(char *out) const {
+            dnaUnpackString(_data, _odd, _length, out);
+        }
+
+        /** Unpack the range into a string */
+        void unpack(std::string &outString) const {
+            outString.resize(_length);
+            unpack(&outString[0]);
+        }
+
+        /** Unpack the reverse complement of the range into a buffer of at
+         * least getLength() characters */
+        void unpackReverseComplement(char *out) const {
+            dnaUnpackReverseComplement(_data, _odd, _length, out);
+        }
+
+        /** Unpack the reverse complement of the range into a string */
+        void unpackReverseComplement(std::string &outString) const {
+            outString.resize(_length);
+            unpackReverseComplement(&outString[0]);
+        }
+
+        /** Point the span at packed storage (used by implementations) */
+        void set(const unsigned char *data, hal_size_t length, bool odd) {
+            _copy.clear();
+            _data = data;
+            _length = length;
+            _odd = odd;
+        }
+
+        /** Size the span's own buffer for a copy of the range and return
+         * it to be filled with getNumBytes() bytes (used by implementations) */
+        unsigned char *setCopy(hal_size_t length, bool odd) {
+            _length = length;
+            _odd = odd;
+            _copy.resize(std::max(getNumBytes(), hal_size_t(1)));
+            _data = _copy.data();
+            return _copy.data();
+        }
+
+      private:
+        const unsigned char *_data;
+        hal_size_t _length;
+        bool _odd;
+        std::vector<unsigned char> _copy;
+    };
+}
+#endif
+// Local Variables:
+// mode: c++
+// End:
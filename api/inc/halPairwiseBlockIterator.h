@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HALPAIRWISEBLOCKITERATOR_H
+#define _HALPAIRWISEBLOCKITERATOR_H
+#include "halDefs.h"
+#include "halSegmentMapper.h"
+#include <cassert>
+#include <map>
+#include <queue>
+#include <set>
+#include <tuple>
+#include <vector>
+
+namespace hal {
+    class Genome;
+    class Sequence;
+
+    /**
+     * An ungapped block of homology between a source and a target genome:
+     * the source bases from _srcStart, and the target bases from
+     * _tgtStart, both in genome coordinates on the forward strand.  If
+     * _reversed is true, the source aligns to the reverse complement of
+     * the target, so the first source base aligns to the last target
+     * base.  A block lies within one sequence of each genome.
+     */
+    struct PairwiseBlock {
+        const Sequence *_srcSequence;
+        hal_index_t _srcStart;
+        const Sequence *_tgtSequence;
+        hal_index_t _tgtStart;
+        hal_size_t _length;
+        bool _reversed;
+    };
+
+    /**
+     * Stream the homology blocks between two genomes: every base of the
+     * source genome appears in a block for each target base that
+     * halMapSegment() maps it to.  Blocks are collinear runs merged as
+     * far as they go, and come sorted by source, then target position.
+     *
+     * The source segments are mapped in runs with
+     * SegmentMapper::mapSegments(), so the tree is walked once per run
+     * rather than once per segment, and only blocks that can still be
+     * extended are held in memory, along with those waiting for them to
+     * be output in order.
+     *
+     * Usage:
+     *   for (PairwiseBlockIterator blockIt(src, tgt); not blockIt.atEnd(); blockIt.toNext()) {
+     *       const PairwiseBlock &block = blockIt.getBlock();
+     *   }
+     */
+    class PairwiseBlockIterator {
+      public:
+        /** Iterate over the blocks between two genomes, which may be the
+         * same one
+         * @param doDupes follow paralogy edges, as for halMapSegment()
+         * @param coalescenceLimit as for halMapSegment(); the MRCA by
+         * default
+         * @param segmentsPerRun number of source segments mapped together,
+         * which bounds the mappings held at once */
+        PairwiseBlockIterator(const Genome *srcGenome, const Genome *tgtGenome, bool doDupes = true,
+                              const Genome *coalescenceLimit = NULL, hal_size_t segmentsPerRun = 4096);
+
+        /** Has the iterator gone past the last block? */
+        bool atEnd() const {
+            return _atEnd;
+        }
+
+        /** Move to the next block */
+        void toNext();
+
+        /** The current block */
+        const PairwiseBlock &getBlock() const {
+            assert(not _atEnd);
+            return _block;
+        }
+
+      private:
+        /* blocks that may still be extended, by the source position,
+         * orientation and target position the next block would continue
+         * them at */
+        typedef std::tuple<hal_index_t, bool, hal_index_t> ExtensionKey;
+        typedef std::multimap<ExtensionKey, PairwiseBlock> OpenBlocks;
+
+        struct BlockGreater {
+            bool operator()(const PairwiseBlock &b1, const PairwiseBlock &b2) const;
+        };
+
+        bool mapNextRun();
+        void addMapping(const SegmentMapping &mapping);
+        void closeBlocksBefore(hal_index_t srcPosition);
+        bool canOutput() const;
+        static ExtensionKey getExtensionKey(const PairwiseBlock &block);
+        static const Sequence *getSequence(const Genome *genome, hal_index_t position, const Sequence *last);
+
+        const Genome *_srcGenome;
+        const Genome *_tgtGenome;
+        bool _doDupes;
+        const Genome *_coalescenceLimit;
+        const Genome *_mrca;
+        std::set<const Genome *> _downwardPath;
+        hal_size_t _segmentsPerRun;
+        bool _top;
+        hal_index_t _nextIndex;
+        hal_index_t _lastIndex;
+        SegmentMapper _mapper;
+        size_t _nextMapping;
+        hal_index_t _srcPosition;
+        const Sequence *_lastSrcSequence;
+        const Sequence *_lastTgtSequence;
+        OpenBlocks _openBlocks;
+        std::multiset<hal_index_t> _openStarts;
+        std::priority_queue<PairwiseBlock, std::vector<PairwiseBlock>, BlockGreater> _closedBlocks;
+        PairwiseBlock _block;
+        bool _atEnd;
+    };
+}
+#endif
+// Local Variables:
+// mode: c++
+// End:
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HALSEGMENTCOLUMNS_H
+#define _HALSEGMENTCOLUMNS_H
+#include "halDefs.h"
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace hal {
+    /**
+     * Read-only view of a column of unsigned integers bit-packed at a
+     * fixed width in memory, as mmap files store segments.  The words are
+     * followed by an extra one, so two can always be read.
+     */
+    class PackedColumnView {
+      public:
+        PackedColumnView() : _words(NULL), _length(0), _width(0), _mask(0) {
+        }
+        PackedColumnView(const uint64_t *words, size_t length, unsigned width)
+            : _words(words), _length(length), _width(width),
+              _mask((width == 64) ? ~uint64_t(0) : ((uint64_t(1) << width) - 1)) {
+        }
+
+        uint64_t get(size_t index) const {
+            assert(index < _length);
+            size_t bit = index * _width;
+            unsigned shift = bit % 64;
+            const uint64_t *words = _words + bit / 64;
+            uint64_t value = words[0] >> shift;
+            if (shift + _width > 64) {
+                value |= words[1] << (64 - shift);
+            }
+            return value & _mask;
+        }
+
+        size_t getLength() const {
+            return _length;
+        }
+
+      private:
+        const uint64_t *_words;
+        size_t _length;
+        unsigned _width;
+        uint64_t _mask;
+    };
+
+    /**
+     * The segment arrays of a genome as columns in memory, as returned by
+     * Genome::getSegmentColumns().  Each column has one more element than
+     * the number of segments; the start position of the extra one gives
+     * the length of the last segment.  Indices are stored plus one, so
+     * NULL_INDEX is zero.  Valid until the alignment is closed or the
+     * genome is modified.
+     */
+    struct SegmentColumns {
+        hal_size_t _numTopSegments;
+        hal_size_t _numBottomSegments;
+        PackedColumnView _topStartPosition;
+        PackedColumnView _topBottomParseIndex;
+        PackedColumnView _topParalogyIndex;
+        PackedColumnView _topParentIndex;
+        PackedColumnView _topReversed;
+        PackedColumnView _bottomStartPosition;
+        PackedColumnView _bottomTopParseIndex;
+        std::vector<PackedColumnView> _bottomChildIndex;
+        std::vector<PackedColumnView> _bottomChildReversed;
+    };
+}
+#endif
+// Local Variables:
+// mode: c++
+// End:
@@ -9,13 +9,171 @@
 #define _HALSEGMENTMAPPER_H
 #include "halDefs.h"
 #include "halSegmentIterator.h"
+#include "halSegmentReader.h"
+#include <deque>
 #include <set>
+#include <vector>
 
 namespace hal {
     class Segment;
     class MappedSegmentSet;
     class Genome;
 
+    /**
+     * A sliced segment as plain values: the genome, array and index of
+     * the segment, its coordinates, and the slice and orientation within
+     * it, with the same meaning as in SegmentIterator.  Copying one costs
+     * nothing and touches no storage.
+     */
+    struct SegmentSlice {
+        const Genome *_genome;
+        hal_index_t _arrayIndex;
+        hal_index_t _segmentStart;
+        hal_size_t _segmentLength;
+        hal_offset_t _startOffset;
+        hal_offset_t _endOffset;
+        bool _top;
+        bool _reversed;
+
+        hal_size_t getLength() const {
+            return _segmentLength - _startOffset - _endOffset;
+        }
+        hal_index_t getStartPosition() const {
+            return _reversed ? _segmentStart + (hal_index_t)(_segmentLength - _startOffset) - 1
+                             : _segmentStart + (hal_index_t)_startOffset;
+        }
+        hal_index_t getEndPosition() const {
+            return _reversed ? getStartPosition() - (hal_index_t)(getLength() - 1)
+                             : getStartPosition() + (hal_index_t)(getLength() - 1);
+        }
+        /* leftmost and rightmost positions, whatever the orientation */
+        hal_index_t getMinPosition() const {
+            return _reversed ? getEndPosition() : getStartPosition();
+        }
+        hal_index_t getMaxPosition() const {
+            return _reversed ? getStartPosition() : getEndPosition();
+        }
+    };
+
+    /** A slice of a source genome and the homologous slice of a target
+     * genome, of the same length */
+    struct SegmentMapping {
+        SegmentSlice _source;
+        SegmentSlice _target;
+    };
+
+    /**
+     * The engine behind halMapSegment().  Segments are SegmentSlice values
+     * rather than cloned iterators: their data is read through a segment
+     * reader per genome, which reads the columns of mmap files in place
+     * and goes through segment objects otherwise.  Mappings
+     * are gathered in vectors that are kept from call to call, and are
+     * sorted and made unique once per traversal rather than held in
+     * lists of shared pointers.  Reusing a SegmentMapper for many
+     * segments therefore allocates nothing while mapping, and only the
+     * results converted with addToSet() become MappedSegments.
+     *
+     * Segment readers are released at the end of each map() call, so
+     * genomes may be closed between calls.  Not thread-safe: use one
+     * SegmentMapper per thread.
+     */
+    class SegmentMapper {
+      public:
+        SegmentMapper();
+        ~SegmentMapper();
+
+        /** Map a segment to a target genome, with the arguments and
+         * semantics of halMapSegment().  Returns the number of mappings,
+         * which getMappings() gives sorted by source then target
+         * coordinates. */
+        hal_size_t map(const SegmentIterator *source, const Genome *tgtGenome,
+                       const std::set<const Genome *> *genomesOnPath = NULL, bool doDupes = true,
+                       hal_size_t minLength = 0, const Genome *coalescenceLimit = NULL, const Genome *mrca = NULL);
+
+        /** Map a run of whole segments of a source genome to a target
+         * genome: the numSegments segments from firstIndex of its top
+         * segment array, or of its bottom segment array if top is false.
+         * The mappings are those map() finds for each of the segments, but
+         * the tree is walked once for all of them, a genome at a time.
+         * Other arguments as for map(). */
+        hal_size_t mapSegments(const Genome *srcGenome, bool top, hal_index_t firstIndex, hal_size_t numSegments,
+                               const Genome *tgtGenome, const std::set<const Genome *> *genomesOnPath = NULL,
+                               bool doDupes = true, hal_size_t minLength = 0, const Genome *coalescenceLimit = NULL,
+                               const Genome *mrca = NULL);
+
+        /** The mappings found by the last map() call */
+        const std::vector<SegmentMapping> &getMappings() const {
+            return _mappings;
+        }
+
+        /** Add the mappings found by the last map() call to a set,
+         * splitting them where their target ranges overlap mappings
+         * already in it, as halMapSegment() does.  The set is left
+         * resolved. */
+        void addToSet(MappedSegmentSet &outSegments) const;
+
+      private:
+        typedef std::vector<SegmentMapping> Mappings;
+
+        /* the segments to map: a run of segments of an array, sliced
+         * and oriented alike */
+        struct SourceSegments {
+            const Genome *_genome;
+            bool _top;
+            hal_index_t _firstIndex;
+            hal_size_t _numSegments;
+            hal_offset_t _startOffset;
+            hal_offset_t _endOffset;
+            bool _reversed;
+        };
+        hal_size_t mapSource(const SourceSegments &source, const Genome *tgtGenome,
+                             const std::set<const Genome *> *genomesOnPath, bool doDupes, hal_size_t minLength,
+                             const Genome *coalescenceLimit, const Genome *mrca);
+
+        /* The traversal is written over a segment reader (see
+         * halSegmentReader.h) and instantiated for both: the column reader
+         * is used when the source genome's storage can be read in place,
+         * the virtual reader otherwise. */
+        template <class Reader> std::vector<Reader> &getReaders();
+        template <class Reader> const Reader &getReader(const Genome *genome);
+        template <class Reader> void toArrayIndex(SegmentSlice &slice, hal_index_t arrayIndex);
+
+        template <class Reader> void toParent(const SegmentSlice &top, SegmentSlice &bottom);
+        template <class Reader> void toChild(const SegmentSlice &bottom, hal_size_t childIndex, SegmentSlice &top);
+        template <class Reader> void toParseUp(const SegmentSlice &bottom, SegmentSlice &top);
+        template <class Reader> void toParseDown(const SegmentSlice &top, SegmentSlice &bottom);
+        template <class Reader> void toRight(SegmentSlice &slice, hal_index_t rightCutoff);
+        template <class Reader> void toNextParalogy(SegmentSlice &top);
+        bool overlaps(const SegmentSlice &slice, hal_index_t position) const;
+
+        template <class Reader> hal_size_t mapUp(const SegmentMapping &mapping, Mappings &results, hal_size_t minLength);
+        template <class Reader>
+        hal_size_t mapDown(const SegmentMapping &mapping, hal_size_t childIndex, Mappings &results, hal_size_t minLength);
+        template <class Reader> hal_size_t mapSelf(const SegmentMapping &mapping, Mappings &results, hal_size_t minLength);
+        template <class Reader>
+        void mapRecursiveUp(Mappings &input, Mappings &results, const Genome *tgtGenome, hal_size_t minLength);
+        template <class Reader>
+        void mapRecursiveDown(Mappings &input, Mappings &results, const Genome *tgtGenome,
+                              const std::set<const Genome *> &genomesOnPath, bool doDupes, hal_size_t minLength);
+        template <class Reader>
+        void mapRecursiveParalogies(const Genome *srcGenome, Mappings &input, Mappings &results,
+                                    const std::set<const Genome *> &genomesOnPath, const Genome *coalescenceLimit,
+                                    hal_size_t minLength);
+        template <class Reader>
+        void mapThroughTree(const SourceSegments &source, const Genome *tgtGenome,
+                            const std::set<const Genome *> &genomesOnPath, bool doDupes, hal_size_t minLength,
+                            const Genome *coalescenceLimit, const Genome *mrca);
+        Mappings &getBuffer();
+        static void sortUnique(Mappings &mappings);
+
+        std::vector<VirtualSegmentReader> _virtualReaders;
+        std::vector<ColumnSegmentReader> _columnReaders;
+        size_t _lastReader;
+        std::deque<Mappings> _buffers; // reused, taken and given back in stack order
+        size_t _numBuffersUsed;
+        Mappings _mappings;
+    };
+
     /** Get homologous segments in target genome.  Returns the number
       * of mapped segments found.
       * @param source Input.
@@ -38,7 +196,9 @@ namespace hal {
       * this genome will be mapped to the target as well. Must be the
       * MRCA or higher. By default, the coalescenceLimit is the MRCA.
       * @param mrca The MRCA of the source and target genomes. By
-      * default, it is computed automatically. */
+      * default, it is computed automatically.
+      * The mapping is done by a SegmentMapper kept for each thread, so
+      * repeated calls reuse its buffers. */
     hal_size_t halMapSegment(const SegmentIterator *source, MappedSegmentSet &outSegments, const Genome *tgtGenome,
                              const std::set<const Genome *> *genomesOnPath = NULL, bool doDupes = true,
                              hal_size_t minLength = 0, const Genome *coalescenceLimit = NULL, const Genome *mrca = NULL);
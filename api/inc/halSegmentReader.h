@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HALSEGMENTREADER_H
+#define _HALSEGMENTREADER_H
+#include "halBottomSegment.h"
+#include "halBottomSegmentIterator.h"
+#include "halGenome.h"
+#include "halSegmentColumns.h"
+#include "halTopSegment.h"
+#include "halTopSegmentIterator.h"
+#include <cassert>
+
+namespace hal {
+    /**
+     * Reads the segments of a genome by array index, through the
+     * TopSegment and BottomSegment interfaces of any storage format.
+     * Traversals that only need segment fields, rather than iterators,
+     * are written as templates over a reader, and instantiated both with
+     * this one and with ColumnSegmentReader, which has the same interface
+     * but reads the columns of the storage directly.  The segment objects
+     * are created on first use.
+     */
+    class VirtualSegmentReader {
+      public:
+        VirtualSegmentReader() : _genome(NULL) {
+        }
+
+        /** Read the segments of a genome; always possible */
+        bool open(const Genome *genome) {
+            _genome = genome;
+            _topIt.reset();
+            _bottomIt.reset();
+            return true;
+        }
+        const Genome *getGenome() const {
+            return _genome;
+        }
+
+        hal_size_t getNumTopSegments() const {
+            return _genome->getNumTopSegments();
+        }
+        hal_index_t getTopStartPosition(hal_index_t index) const {
+            return getTop(index)->getStartPosition();
+        }
+        hal_size_t getTopLength(hal_index_t index) const {
+            return getTop(index)->getLength();
+        }
+        hal_index_t getTopParentIndex(hal_index_t index) const {
+            return getTop(index)->getParentIndex();
+        }
+        bool getTopParentReversed(hal_index_t index) const {
+            return getTop(index)->getParentReversed();
+        }
+        hal_index_t getTopBottomParseIndex(hal_index_t index) const {
+            return getTop(index)->getBottomParseIndex();
+        }
+        hal_index_t getTopNextParalogyIndex(hal_index_t index) const {
+            return getTop(index)->getNextParalogyIndex();
+        }
+
+        hal_size_t getNumBottomSegments() const {
+            return _genome->getNumBottomSegments();
+        }
+        hal_index_t getBottomStartPosition(hal_index_t index) const {
+            return getBottom(index)->getStartPosition();
+        }
+        hal_size_t getBottomLength(hal_index_t index) const {
+            return getBottom(index)->getLength();
+        }
+        hal_index_t getBottomChildIndex(hal_index_t index, hal_size_t child) const {
+            return getBottom(index)->getChildIndex(child);
+        }
+        bool getBottomChildReversed(hal_index_t index, hal_size_t child) const {
+            return getBottom(index)->getChildReversed(child);
+        }
+        hal_index_t getBottomTopParseIndex(hal_index_t index) const {
+            return getBottom(index)->getTopParseIndex();
+        }
+
+      private:
+        /* the segment object, moved to the index */
+        const TopSegment *getTop(hal_index_t index) const {
+            if (_topIt == NULL) {
+                _topIt = _genome->getTopSegmentIterator(index);
+            }
+            TopSegment *segment = _topIt->tseg();
+            if (segment->getArrayIndex() != index) {
+                segment->setArrayIndex(segment->getGenome(), index);
+            }
+            return segment;
+        }
+        const BottomSegment *getBottom(hal_index_t index) const {
+            if (_bottomIt == NULL) {
+                _bottomIt = _genome->getBottomSegmentIterator(index);
+            }
+            BottomSegment *segment = _bottomIt->bseg();
+            if (segment->getArrayIndex() != index) {
+                segment->setArrayIndex(segment->getGenome(), index);
+            }
+            return segment;
+        }
+
+        const Genome *_genome;
+        mutable TopSegmentIteratorPtr _topIt;
+        mutable BottomSegmentIteratorPtr _bottomIt;
+    };
+
+    /**
+     * Reads the segments of a genome by array index straight from the
+     * columns given by Genome::getSegmentColumns(), so every access
+     * inlines to a few shifts on memory: no virtual calls, segment objects
+     * or per-access file lookups.  Same interface as VirtualSegmentReader.
+     */
+    class ColumnSegmentReader {
+      public:
+        ColumnSegmentReader() : _genome(NULL) {
+        }
+
+        /** Read the segments of a genome, returning false if its storage
+         * can't be read in place (see Genome::getSegmentColumns()) */
+        bool open(const Genome *genome) {
+            _genome = genome;
+            return genome->getSegmentColumns(_columns);
+        }
+        const Genome *getGenome() const {
+            return _genome;
+        }
+
+        hal_size_t getNumTopSegments() const {
+            return _columns._numTopSegments;
+        }
+        hal_index_t getTopStartPosition(hal_index_t index) const {
+            return (hal_index_t)_columns._topStartPosition.get(index);
+        }
+        hal_size_t getTopLength(hal_index_t index) const {
+            return getTopStartPosition(index + 1) - getTopStartPosition(index);
+        }
+        hal_index_t getTopParentIndex(hal_index_t index) const {
+            return decodeIndex(_columns._topParentIndex.get(index));
+        }
+        bool getTopParentReversed(hal_index_t index) const {
+            return _columns._topReversed.get(index) != 0;
+        }
+        hal_index_t getTopBottomParseIndex(hal_index_t index) const {
+            return decodeIndex(_columns._topBottomParseIndex.get(index));
+        }
+        hal_index_t getTopNextParalogyIndex(hal_index_t index) const {
+            return decodeIndex(_columns._topParalogyIndex.get(index));
+        }
+
+        hal_size_t getNumBottomSegments() const {
+            return _columns._numBottomSegments;
+        }
+        hal_index_t getBottomStartPosition(hal_index_t index) const {
+            return (hal_index_t)_columns._bottomStartPosition.get(index);
+        }
+        hal_size_t getBottomLength(hal_index_t index) const {
+            return getBottomStartPosition(index + 1) - getBottomStartPosition(index);
+        }
+        hal_index_t getBottomChildIndex(hal_index_t index, hal_size_t child) const {
+            assert(child < _columns._bottomChildIndex.size());
+            return decodeIndex(_columns._bottomChildIndex[child].get(index));
+        }
+        bool getBottomChildReversed(hal_index_t index, hal_size_t child) const {
+            assert(child < _columns._bottomChildReversed.size());
+            return _columns._bottomChildReversed[child].get(index) != 0;
+        }
+        hal_index_t getBottomTopParseIndex(hal_index_t index) const {
+            return decodeIndex(_columns._bottomTopParseIndex.get(index));
+        }
+
+      private:
+        static hal_index_t decodeIndex(uint64_t value) {
+            return (hal_index_t)value - 1;
+        }
+
+        const Genome *_genome;
+        SegmentColumns _columns;
+    };
+}
+#endif
+// Local Variables:
+// mode: c++
+// End:
@@ -9,6 +9,7 @@
 #define _HALSEGMENTEDSEQUENCE_H
 
 #include "halDefs.h"
+#include "halPackedDnaSpan.h"
 #include <set>
 
 namespace hal {
@@ -107,6 +108,14 @@ namespace hal {
           * @param length Length of substring */
         virtual void setSubString(const std::string &inString, hal_size_t start, hal_size_t length) = 0;
 
+        /** Get a read-only view of a range of the nibble-packed DNA
+         * underlying the segmented sequence, without copying when the
+         * storage allows it.  Use the span to bulk decode the range.
+         * @param span Span set to the range
+         * @param start First position of range
+         * @param length Length of range */
+        virtual void getPackedDna(PackedDnaSpan &span, hal_size_t start, hal_size_t length) const = 0;
+
         /** Get a rearrangement object
          * @param position Position of topsegment defining first breakpoint of
          * rearrangement
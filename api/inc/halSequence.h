@@ -9,6 +9,7 @@
 #define _HALSEQUENCE_H
 
 #include "halDefs.h"
+#include "halPackedDnaSpan.h"
 #include <set>
 #include <string>
 
@@ -164,6 +165,14 @@ namespace hal {
           * @param start First position of substring
           * @param length Length of substring */
         virtual void setSubString(const std::string &inString, hal_size_t start, hal_size_t length) = 0;
+
+        /** Get a read-only view of a range of the nibble-packed DNA
+         * underlying the sequence, without copying when the storage
+         * allows it.  Use the span to bulk decode the range.
+         * @param span Span set to the range
+         * @param start First position of range, relative to the sequence
+         * @param length Length of range */
+        virtual void getPackedDna(PackedDnaSpan &span, hal_size_t start, hal_size_t length) const = 0;
     };
 }
 #endif
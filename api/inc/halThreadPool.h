@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HALTHREADPOOL_H
+#define _HALTHREADPOOL_H
+#include "halDefs.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace hal {
+    /**
+     * Work-stealing pool of threads.  Each worker has its own queue of
+     * tasks; tasks submitted from a worker go on its queue, and idle workers
+     * steal from the others.  A pool of one thread has no workers and runs
+     * every task immediately in the submitting thread, so tools behave as
+     * they did before threading unless more threads are requested.
+     *
+     * Tasks are normally run through a TaskGroup, which waits for them and
+     * passes on their exceptions.  All tools share one pool, sized by the
+     * --numThreads option of CLParser.
+     */
+    class ThreadPool {
+      public:
+        typedef std::function<void()> Task;
+
+        /** Constructor
+         * @param numThreads number of threads to run tasks in (0 to use
+         * all cores) */
+        explicit ThreadPool(size_t numThreads);
+
+        /** Destructor, runs any remaining tasks and stops the workers */
+        ~ThreadPool();
+
+        /** Get the number of threads tasks are run in */
+        size_t getNumThreads() const {
+            return _numThreads;
+        }
+
+        /** Queue a task to be run.  Exceptions must not escape the task
+         * (use TaskGroup to pass them on) */
+        void submit(Task task);
+
+        /** Run one queued task in the calling thread, returning false if
+         * there were none.  Threads waiting on tasks use this to help. */
+        bool runPendingTask();
+
+        /** Get the pool shared by everything in the process */
+        static ThreadPool &getShared();
+
+        /** Resize the shared pool.  Must not be called while the shared
+         * pool is in use.
+         * @param numThreads number of threads (0 to use all cores) */
+        static void setSharedNumThreads(size_t numThreads);
+
+      private:
+        struct WorkQueue {
+            std::mutex _lock;
+            std::deque<Task> _tasks;
+        };
+
+        bool popTask(size_t queueIndex, Task &task);
+        void workerLoop(size_t queueIndex);
+
+        size_t _numThreads;
+        std::vector<std::unique_ptr<WorkQueue>> _queues;
+        std::vector<std::thread> _workers;
+        std::atomic<size_t> _numQueued;
+        std::atomic<size_t> _nextQueue;
+        std::mutex _sleepLock;
+        std::condition_variable _wakeUp;
+        bool _stopping;
+    };
+
+    /**
+     * A set of tasks run in a ThreadPool that can be waited on together.
+     * The first exception thrown by a task is rethrown by wait().
+     */
+    class TaskGroup {
+      public:
+        /** Constructor
+         * @param pool pool to run the tasks in */
+        explicit TaskGroup(ThreadPool &pool = ThreadPool::getShared());
+
+        /** Destructor, waits for any remaining tasks (ignoring their
+         * exceptions) */
+        ~TaskGroup();
+
+        /** Run a task in the pool
+         * @param task task to run */
+        void run(ThreadPool::Task task);
+
+        /** Wait for all tasks to finish, running queued tasks in the calling
+         * thread meanwhile.  Rethrows the first exception thrown by a task. */
+        void wait();
+
+      private:
+        void waitAll();
+
+        ThreadPool &_pool;
+        size_t _numPending;
+        std::exception_ptr _exception;
+        std::mutex _lock;
+        std::condition_variable _done;
+    };
+
+    /** Get the pool to use for reading an alignment: the shared pool if
+     * the alignment supports concurrent reads, otherwise a single-threaded
+     * pool that runs tasks in the calling thread.
+     * @param alignment alignment that tasks will read */
+    ThreadPool &getReadThreadPool(const Alignment *alignment);
+
+    /** Split a range into consecutive chunks, returned as (start, length)
+     * pairs.  An empty range gives no chunks.
+     * @param start start of the range
+     * @param length length of the range
+     * @param chunkSize maximum length of a chunk
+     * @param alignment chunk starts (after the first) are multiples of this
+     * from the start of the range */
+    std::vector<std::pair<hal_size_t, hal_size_t>> splitRange(hal_size_t start, hal_size_t length, hal_size_t chunkSize,
+                                                              hal_size_t alignment = 1);
+
+    /** Produce output for a series of chunks in parallel, and consume it in
+     * order as soon as each chunk is ready, so that tools can write their
+     * output in the same order as a serial loop.  Only a small window of
+     * chunks is held in memory at once.  Exceptions from produce or consume
+     * are rethrown, after which no more chunks are consumed.
+     * @param numChunks number of chunks
+     * @param produce fills in the output of a chunk, given its index (called
+     * in any thread)
+     * @param consume uses the output of a chunk (called in the calling
+     * thread, in chunk order)
+     * @param pool pool to produce the chunks in */
+    void parallelOrderedOutput(size_t numChunks, const std::function<void(size_t, std::string &)> &produce,
+                               const std::function<void(const std::string &)> &consume,
+                               ThreadPool &pool = ThreadPool::getShared());
+}
+#endif
+// Local Variables:
+// mode: c++
+// End:
@@ -31,6 +31,7 @@ MMapAlignment::MMapAlignment(const std::string &alignmentPath, unsigned mode, co
 }
 
 void MMapAlignment::close() {
+    writeIoStatsOnce();
     // Free the memory used by all open genomes.
     for (auto kv : _openGenomes) {
         delete kv.second;
@@ -41,11 +42,31 @@ void MMapAlignment::close() {
     _file->close();
 }
 
+/* write the --ioStats line, if requested and not already written by
+ * close() */
+void MMapAlignment::writeIoStatsOnce() {
+    if (not _ioStatsPath.empty()) {
+        string path = _ioStatsPath;
+        _ioStatsPath.clear();
+        writeIoStatsOnClose(this, _alignmentPath, path);
+    }
+}
+
+void MMapAlignment::getIoStats(IoStats &stats) const {
+    _file->getIoStats(stats);
+    std::lock_guard<std::mutex> lock(_openGenomesLock);
+    for (const auto &name_genome : _openGenomes) {
+        name_genome.second->getIoStats(stats);
+    }
+}
+
 void MMapAlignment::defineOptions(CLParser *parser, unsigned mode) {
     if (mode & CREATE_ACCESS) {
-        parser->addOption("mmapFileSize", "mmap HAL file initial size (in gigabytes)", MMAP_DEFAULT_FILE_SIZE_GB);
+        parser->addOption("mmapFileSize", "mmap HAL file initial size (in gigabytes), file grows as needed",
+                          MMAP_DEFAULT_FILE_SIZE_GB);
     } else if (mode & WRITE_ACCESS) {
-        parser->addOption("mmapSizeIncrease", "additional space to reserve at end of file (in gigabytes)", 1);
+        parser->addOption("mmapSizeIncrease",
+                          "initial additional space to reserve at end of file (in gigabytes), file grows as needed", 1);
     }
 }
 
@@ -62,6 +83,8 @@ void MMapAlignment::initializeFromOptions(const CLParser *parser) {
         // 3 separate factory functions.
         _fileSize = GIGABYTE * parser->get<size_t>("mmapSizeIncrease");
     }
+    _ioStatsPath = parser->getOption<string>("ioStats");
+    checkIoStatsPath(_ioStatsPath);
 }
 
 void MMapAlignment::create() {
@@ -129,7 +152,6 @@ void MMapAlignment::addGenomeToNameHash(const MMapGenome *genome, vector<string>
 }
 
 Genome *MMapAlignment::addLeafGenome(const string &name, const string &parentName, double branchLength) {
-    _childNames.clear();
     stTree *parentNode = getGenomeNode(parentName);
     stTree *childNode = stTree_construct();
     stTree_setLabel(childNode, name.c_str());
@@ -144,7 +166,6 @@ Genome *MMapAlignment::addLeafGenome(const string &name, const string &parentNam
 }
 
 Genome *MMapAlignment::addRootGenome(const string &name, double branchLength) {
-    _childNames.clear();
     stTree *newRoot = stTree_construct();
     stTree_setLabel(newRoot, name.c_str());
     if (_tree != NULL) {
@@ -161,9 +182,11 @@ Genome *MMapAlignment::addRootGenome(const string &name, double branchLength) {
 }
 
 Genome *MMapAlignment::_openGenome(const string &name) const {
-    if (_openGenomes.find(name) != _openGenomes.end()) {
+    std::lock_guard<std::mutex> lock(_openGenomesLock);
+    map<string, MMapGenome *>::const_iterator i = _openGenomes.find(name);
+    if (i != _openGenomes.end()) {
         // Already loaded.
-        return _openGenomes[name];
+        return i->second;
     }
     if (_genomeNameHash == NULL) {
         return NULL;
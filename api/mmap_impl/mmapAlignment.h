@@ -6,6 +6,7 @@
 #include "sonLib.h"
 #include <deque>
 #include <map>
+#include <mutex>
 
 namespace hal {
     class CLParser;
@@ -40,6 +41,8 @@ namespace hal {
         /* constructor from command line options */
         MMapAlignment(const std::string &alignmentPath, unsigned mode, const CLParser *parser);
         ~MMapAlignment() {
+            // read-only alignments are usually deleted without being closed
+            writeIoStatsOnce();
             if (_tree != NULL) {
                 stTree_destruct(_tree);
             }
@@ -125,33 +128,17 @@ namespace hal {
         };
 
         std::vector<std::string> getChildNames(const std::string &name) const {
-            if (_childNames.find(name) != _childNames.end()) {
-                return _childNames[name];
-            } else {
-                _fillChildNames(name);
-                return _childNames[name];
-            }
+            return getChildNamesRef(name);
         }
 
-        std::vector<std::string> &getChildNamesRef(const std::string &name) const {
-            if (_childNames.find(name) != _childNames.end()) {
-                return _childNames[name];
-            } else {
-                _fillChildNames(name);
-                return _childNames[name];
+        const std::vector<std::string> &getChildNamesRef(const std::string &name) const {
+            std::map<std::string, std::vector<std::string>>::const_iterator i = _childNames.find(name);
+            if (i == _childNames.end()) {
+                throw hal_exception("genome " + name + " not found in alignment.");
             }
+            return i->second;
         }
 
-        void _fillChildNames(const std::string &name) const {
-            stTree *node = getGenomeNode(name);
-            std::vector<std::string> childNames;
-            for (int64_t i = 0; i < stTree_getChildNumber(node); i++) {
-                const char *name = stTree_getLabel(stTree_getChild(node, i));
-                childNames.push_back(std::string(name));
-            }
-            _childNames[name] = childNames;
-        };
-
         std::vector<std::string> getLeafNamesBelow(const std::string &name) const {
             std::vector<std::string> leaves;
             std::vector<std::string> children;
@@ -195,11 +182,27 @@ namespace hal {
             return _file->isReadOnly();
         };
 
+        bool supportsConcurrentReads() const {
+            return true;
+        }
+
         void replaceNewickTree(const std::string &newNewickString) {
             _data->setNewickString(this, newNewickString.c_str());
             loadTree();
         };
 
+        void adviseSequential() const {
+            _file->adviseSequential();
+        }
+
+        void adviseRandom() const {
+            _file->adviseRandom();
+        }
+
+        /* Add I/O statistics: the size and resident bytes of each array of
+         * the genomes opened, and of the whole file */
+        void getIoStats(IoStats &stats) const;
+
       private:
         void initializeFromOptions(const CLParser *parser);
         void create();
@@ -207,11 +210,29 @@ namespace hal {
         void addGenomeToNameHash(const MMapGenome *genome, vector<string> &existingNames);
         Genome *_openGenome(const std::string &name) const;
         stTree *getGenomeNode(const std::string &name) const {
-            stTree *node = stTree_findChild(_tree, name.c_str());
-            if (node == NULL) {
+            std::map<std::string, stTree *>::const_iterator i = _nodeMap.find(name);
+            if (i == _nodeMap.end()) {
                 throw hal_exception("genome " + name + " not found in alignment.");
             }
-            return node;
+            return i->second;
+        };
+        /* index the tree nodes and their children by name, so tree
+         * queries don't search the tree each time, and never modify
+         * anything when reading */
+        void indexTree() {
+            _nodeMap.clear();
+            _childNames.clear();
+            std::deque<stTree *> bfQueue(1, _tree);
+            while (!bfQueue.empty()) {
+                stTree *node = bfQueue.front();
+                bfQueue.pop_front();
+                _nodeMap[stTree_getLabel(node)] = node;
+                std::vector<std::string> &childNames = _childNames[stTree_getLabel(node)];
+                for (int64_t i = 0; i < stTree_getChildNumber(node); i++) {
+                    bfQueue.push_back(stTree_getChild(node, i));
+                    childNames.push_back(stTree_getLabel(stTree_getChild(node, i)));
+                }
+            }
         };
         void loadTree() {
             if (_tree != NULL) {
@@ -221,14 +242,17 @@ namespace hal {
                 throw hal_exception("hal alignment has no tree");
             }
             _tree = stTree_parseNewickString(_data->getNewickString(this));
+            indexTree();
         };
+        void writeIoStatsOnce();
         void writeTree() {
-            _childNames.clear();
+            indexTree();
             char *newickString = stTree_getNewickTreeString(_tree);
             _data->setNewickString(this, newickString);
             free(newickString);
         };
         mutable std::map<std::string, MMapGenome *> _openGenomes;
+        mutable std::mutex _openGenomesLock;
         std::string _alignmentPath;
         unsigned _mode;
         size_t _fileSize;
@@ -236,7 +260,9 @@ namespace hal {
         MMapAlignmentData *_data;
         MMapPerfectHashTable *_genomeNameHash;
         stTree *_tree;
-        mutable std::map<std::string, std::vector<std::string>> _childNames;
+        std::map<std::string, stTree *> _nodeMap;
+        std::map<std::string, std::vector<std::string>> _childNames;
+        std::string _ioStatsPath; // --ioStats file, written on close
     };
 
     inline const char *MMapAlignmentData::getNewickString(const MMapAlignment *alignment) {
@@ -10,8 +10,8 @@ void MMapBottomSegment::setCoordinates(hal_index_t startPos, hal_size_t length)
         throw hal_exception("Trying to set top segment coordinate out of range");
     }
 
-    _data->setStartPosition(startPos);
-    getNextData()->setStartPosition(startPos + length);
+    getMMapGenome()->setBottomStartPosition(_index, startPos);
+    getMMapGenome()->setBottomStartPosition(_index + 1, startPos + length);
 }
 
 hal_offset_t MMapBottomSegment::getTopParseOffset() const {
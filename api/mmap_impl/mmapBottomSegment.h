@@ -2,26 +2,23 @@
 #define _MMAPBOTTOMSEGMENT_H
 #include "halBottomSegment.h"
 #include "halGenome.h"
-#include "mmapBottomSegmentData.h"
 #include "mmapGenome.h"
 #include <cassert>
 
 namespace hal {
     class MMapBottomSegment : public BottomSegment {
       public:
-        MMapBottomSegment(MMapGenome *genome, hal_index_t arrayIndex)
-            : BottomSegment(genome, arrayIndex), _data(genome->getBottomSegmentPointer(arrayIndex)) {
+        MMapBottomSegment(MMapGenome *genome, hal_index_t arrayIndex) : BottomSegment(genome, arrayIndex) {
         }
 
         // SEGMENT INTERFACE
         void setArrayIndex(Genome *genome, hal_index_t arrayIndex) {
             _genome = genome;
-            _data = getMMapGenome()->getBottomSegmentPointer(arrayIndex);
             _index = arrayIndex;
         };
         const Sequence *getSequence() const;
         hal_index_t getStartPosition() const {
-            return _data->getStartPosition();
+            return getMMapGenome()->getBottomStartPosition(_index);
         };
         hal_index_t getEndPosition() const;
         hal_size_t getLength() const;
@@ -34,25 +31,25 @@ namespace hal {
         // BOTTOM SEGMENT INTERFACE
         hal_size_t getNumChildren() const;
         hal_index_t getChildIndex(hal_size_t i) const {
-            return _data->getChildIndex(i);
+            return getMMapGenome()->getBottomChildIndex(_index, i);
         };
         hal_index_t getChildIndexG(const Genome *childGenome) const;
         bool hasChild(hal_size_t child) const;
         bool hasChildG(const Genome *childGenome) const;
         void setChildIndex(hal_size_t i, hal_index_t childIndex) {
-            _data->setChildIndex(i, childIndex);
+            getMMapGenome()->setBottomChildIndex(_index, i, childIndex);
         };
         bool getChildReversed(hal_size_t i) const {
-            return _data->getChildReversed(_genome->getNumChildren(), i);
+            return getMMapGenome()->getBottomChildReversed(_index, i);
         };
         void setChildReversed(hal_size_t child, bool isReversed) {
-            _data->setChildReversed(_genome->getNumChildren(), child, isReversed);
+            getMMapGenome()->setBottomChildReversed(_index, child, isReversed);
         };
         hal_index_t getTopParseIndex() const {
-            return _data->getTopParseIndex();
+            return getMMapGenome()->getBottomTopParseIndex(_index);
         };
         void setTopParseIndex(hal_index_t parseIndex) {
-            _data->setTopParseIndex(parseIndex);
+            getMMapGenome()->setBottomTopParseIndex(_index, parseIndex);
         };
         hal_offset_t getTopParseOffset() const;
         bool hasParseUp() const;
@@ -63,12 +60,6 @@ namespace hal {
         MMapGenome *getMMapGenome() const {
             return static_cast<MMapGenome *>(_genome);
         }
-
-        // Return a pointer to the data for the segment *after* this one in the array.
-        MMapBottomSegmentData *getNextData() const {
-            return (MMapBottomSegmentData *)(((char *)_data) + MMapBottomSegmentData::getSize(_genome));
-        };
-        MMapBottomSegmentData *_data;
     };
 
     inline hal_index_t MMapBottomSegment::getEndPosition() const {
@@ -76,7 +67,7 @@ namespace hal {
     }
 
     inline hal_size_t MMapBottomSegment::getLength() const {
-        return getNextData()->getStartPosition() - _data->getStartPosition();
+        return getMMapGenome()->getBottomStartPosition(_index + 1) - getStartPosition();
     }
 
     inline const Sequence *MMapBottomSegment::getSequence() const {
@@ -1,7 +1,9 @@
 #ifndef _MMAPBOTTOMSEGMENTDATA_H
 #define _MMAPBOTTOMSEGMENTDATA_H
+#include "mmapPackedArray.h"
 
 namespace hal {
+    /* Bottom segment record, mmap API 1.x files store an array of these. */
     class MMapBottomSegmentData {
       public:
         void setStartPosition(hal_index_t startPosition) {
@@ -50,6 +52,31 @@ namespace hal {
         hal_index_t _startPosition;
         hal_index_t _topParseIndex;
     };
+
+    /* Bottom segments stored as columns in mmap API 2.x files, see
+     * MMapTopSegmentColumns.  The fixed columns are followed by a child
+     * index column for each child and then a reversed column for each
+     * child. */
+    class MMapBottomSegmentColumns {
+      public:
+        MMapPackedArrayData *getChildIndexColumn(hal_size_t child) {
+            assert(child < _numChildren);
+            return &_topParseIndex + 1 + child;
+        }
+        MMapPackedArrayData *getChildReversedColumn(hal_size_t child) {
+            assert(child < _numChildren);
+            return &_topParseIndex + 1 + _numChildren + child;
+        }
+
+        // Get on-disk size of the columns descriptor
+        static size_t getSize(hal_size_t numChildren) {
+            return sizeof(MMapBottomSegmentColumns) + 2 * numChildren * sizeof(MMapPackedArrayData);
+        };
+
+        hal_size_t _numChildren;
+        MMapPackedArrayData _startPosition;
+        MMapPackedArrayData _topParseIndex;
+    };
 }
 #endif
 // Local Variables:
@@ -32,7 +32,7 @@ void MMapDnaAccess::flush() {
 void MMapDnaAccess::fetch(hal_index_t index) const {
     if (_isUdcProtocol) {
         _startIndex = 2 * (index / 2); // even boundary
-        _endIndex = std::max(hal_size_t(_startIndex + UDC_FETCH_SIZE), _genome->getSequenceLength());
+        _endIndex = std::min(hal_size_t(_startIndex + UDC_FETCH_SIZE), _genome->getSequenceLength());
         _buffer = _genome->getDNA(_startIndex / 2, (((_endIndex - _startIndex) + 1) / 2));
     } else {
         assert(false); // this should never be called for local
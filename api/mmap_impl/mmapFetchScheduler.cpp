@@ -0,0 +1,92 @@
+#include "mmapFetchScheduler.h"
+#include <algorithm>
+
+/* constructor */
+hal::MMapFetchScheduler::MMapFetchScheduler(size_t blockSize, size_t maxReadAhead)
+    : _blockSize(blockSize), _maxReadAheadBlocks(std::max(maxReadAhead / blockSize, size_t(1))), _fileSize(0),
+      _lastFirstBlock(0), _lastLastBlock(0), _haveLast(false), _readAheadBlocks(0), _numFetches(0), _fetchBytes(0) {
+}
+
+/* set the size of the file, clearing all resident information. */
+void hal::MMapFetchScheduler::setFileSize(size_t fileSize) {
+    _fileSize = fileSize;
+    _resident.assign((fileSize + _blockSize - 1) / _blockSize, false);
+    _haveLast = false;
+    _readAheadBlocks = 0;
+}
+
+/* is the range resident? */
+bool hal::MMapFetchScheduler::isResident(size_t offset, size_t size) const {
+    if ((size == 0) || (offset >= _fileSize)) {
+        return true;
+    }
+    size_t last = (std::min(offset + size, _fileSize) - 1) / _blockSize;
+    for (size_t block = offset / _blockSize; block <= last; block++) {
+        if (not _resident[block]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* mark a range of blocks as resident */
+void hal::MMapFetchScheduler::markResident(size_t firstBlock, size_t lastBlock) {
+    for (size_t block = firstBlock; block <= lastBlock; block++) {
+        _resident[block] = true;
+    }
+}
+
+/* Determine the range that should be fetched so that the range is
+ * resident. */
+bool hal::MMapFetchScheduler::schedule(size_t offset, size_t size, size_t &fetchOffset, size_t &fetchSize) {
+    if ((size == 0) || (offset >= _fileSize)) {
+        return false;
+    }
+    // trim resident blocks off of the request, there is at least one
+    // missing block left if it's not entirely resident.
+    size_t first = offset / _blockSize;
+    size_t last = (std::min(offset + size, _fileSize) - 1) / _blockSize;
+    while ((first <= last) && _resident[first]) {
+        first++;
+    }
+    if (first > last) {
+        return false;
+    }
+    while (_resident[last]) {
+        last--;
+    }
+
+    // Compare with the last fetch to decide on direction.  If the request
+    // is just after or before it, fill in any gap and read ahead, growing
+    // the read-ahead window.  Otherwise this is a random access.
+    size_t nearby = _readAheadBlocks + 1;
+    if (_haveLast && (first > _lastLastBlock) && ((first - _lastLastBlock) <= nearby)) {
+        _readAheadBlocks = std::min(std::max(2 * _readAheadBlocks, size_t(1)), _maxReadAheadBlocks);
+        first = _lastLastBlock + 1;
+        last = std::min(last + _readAheadBlocks, getNumBlocks() - 1);
+    } else if (_haveLast && (last < _lastFirstBlock) && ((_lastFirstBlock - last) <= nearby)) {
+        _readAheadBlocks = std::min(std::max(2 * _readAheadBlocks, size_t(1)), _maxReadAheadBlocks);
+        last = _lastFirstBlock - 1;
+        first = (first > _readAheadBlocks) ? first - _readAheadBlocks : 0;
+    } else {
+        _readAheadBlocks = 0;
+    }
+
+    // don't fetch resident blocks on the ends of the extended range
+    while (_resident[first]) {
+        first++;
+    }
+    while (_resident[last]) {
+        last--;
+    }
+    markResident(first, last);
+    _lastFirstBlock = first;
+    _lastLastBlock = last;
+    _haveLast = true;
+
+    fetchOffset = blockStart(first);
+    fetchSize = std::min(blockStart(last + 1), _fileSize) - fetchOffset;
+    _numFetches++;
+    _fetchBytes += fetchSize;
+    return true;
+}
@@ -0,0 +1,70 @@
+#ifndef _MMAPFETCHSCHEDULER_H
+#define _MMAPFETCHSCHEDULER_H
+#include <cstddef>
+#include <vector>
+
+namespace hal {
+    /**
+     * Schedules fetching of ranges of a mmapped file that is accessed
+     * remotely (UDC).  Without this, every element access results in a
+     * request, often for only a few dozen bytes.  The scheduler tracks which
+     * blocks are already resident, so accesses to them don't make a request
+     * at all.  Requests for missing data are expanded to block boundaries,
+     * merged with nearby previous requests and extended to read ahead in
+     * the direction of iteration.  The read-ahead window grows geometrically
+     * while access stays sequential and is reset on random access.
+     */
+    class MMapFetchScheduler {
+      public:
+        static const size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+        static const size_t DEFAULT_MAX_READ_AHEAD = 4 * 1024 * 1024;
+
+        MMapFetchScheduler(size_t blockSize = DEFAULT_BLOCK_SIZE, size_t maxReadAhead = DEFAULT_MAX_READ_AHEAD);
+
+        /* set the size of the file, clearing all resident information. */
+        void setFileSize(size_t fileSize);
+
+        /* Determine the range that should be fetched so that the range
+         * [offset, offset+size) is resident.  Returns false if the range is
+         * already resident and nothing need be fetched.  The returned range is
+         * marked as resident. */
+        bool schedule(size_t offset, size_t size, size_t &fetchOffset, size_t &fetchSize);
+
+        /* is the range resident? */
+        bool isResident(size_t offset, size_t size) const;
+
+        /* number of fetches that have been scheduled */
+        size_t getNumFetches() const {
+            return _numFetches;
+        }
+
+        /* number of bytes that have been scheduled to fetch */
+        size_t getFetchBytes() const {
+            return _fetchBytes;
+        }
+
+      private:
+        size_t blockStart(size_t block) const {
+            return block * _blockSize;
+        }
+        size_t getNumBlocks() const {
+            return _resident.size();
+        }
+        void markResident(size_t firstBlock, size_t lastBlock);
+
+        size_t _blockSize;
+        size_t _maxReadAheadBlocks;
+        size_t _fileSize;
+        std::vector<bool> _resident; // per block
+        size_t _lastFirstBlock;      // block range of last fetch
+        size_t _lastLastBlock;
+        bool _haveLast;
+        size_t _readAheadBlocks; // current read-ahead window
+        size_t _numFetches;
+        size_t _fetchBytes;
+    };
+}
+#endif
+// Local Variables:
+// mode: c++
+// End:
@@ -1,12 +1,16 @@
 #include "mmapFile.h"
 #include "halCommon.h"
+#include <algorithm>
 #include <errno.h>
 #include <fcntl.h>
 #include <string.h>
 #include <sys/mman.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <vector>
 #ifdef ENABLE_UDC
+#include "mmapFetchScheduler.h"
+#include <mutex>
 extern "C" {
 #include "common.h"
 #include "udc2.h"
@@ -16,6 +20,15 @@ extern "C" {
 /* constants for header */
 static const std::string FORMAT_NAME = "HAL-MMAP";
 
+/* Virtual address space reserved when a file is opened for write access.
+ * The file is grown within this range, so the base address never changes.
+ * This only consumes address space, not memory or disk. */
+static const size_t MMAP_WRITE_RESERVE_SIZE = 16384 * GIGABYTE;
+
+/* Minimum amount to grow a file by when it fills up.  Growth is otherwise
+ * geometric, doubling the file size. */
+static const size_t MMAP_MIN_GROWTH_SIZE = GIGABYTE;
+
 /* get current version as a string */
 static const std::string& getMmapApiVersion() {
     static std::string version;
@@ -66,7 +79,7 @@ void hal::MMapFile::parseCheckVersion() {
                             + fileVersion.substr(0, 20));
     }
     
-    if (_majorVersion != MMAP_API_MAJOR_VERSION) {
+    if ((_majorVersion < MMAP_API_MIN_MAJOR_VERSION) || (_majorVersion > MMAP_API_MAJOR_VERSION)) {
         throw hal_exception(_alignmentPath + ": incompatible mmap major versions: " + "file version " + _version +
                             ", mmap API version " + getMmapApiVersion());
     }
@@ -109,6 +122,9 @@ void hal::MMapFile::createHeader() {
     strncpy(_header->format, FORMAT_NAME.c_str(), sizeof(_header->format) - 1);
     assert(getMmapApiVersion().size() < sizeof(_header->mmapVersion));
     strncpy(_header->mmapVersion, getMmapApiVersion().c_str(), sizeof(_header->mmapVersion) - 1);
+    _majorVersion = MMAP_API_MAJOR_VERSION;
+    _minorVersion = MMAP_API_MINOR_VERSION;
+    _version = getMmapApiVersion();
     assert(HAL_VERSION.size() < sizeof(_header->halVersion));
     strncpy(_header->halVersion, HAL_VERSION.c_str(), sizeof(_header->halVersion) - 1);
     _header->nextOffset = alignRound(sizeof(MMapHeader));
@@ -116,6 +132,34 @@ void hal::MMapFile::createHeader() {
     _header->nextOffset = _header->nextOffset;
 }
 
+/* count the bytes of a range that are in resident pages, asking the
+ * kernel a window of pages at a time */
+size_t hal::MMapFile::getResidentBytes(size_t offset, size_t length) const {
+    static const size_t windowPages = 65536;
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t end = std::min(offset + length, _fileSize);
+    size_t residentBytes = 0;
+    std::vector<unsigned char> residency(windowPages);
+    for (size_t start = (offset / pageSize) * pageSize; start < end; start += windowPages * pageSize) {
+        size_t windowEnd = std::min(start + windowPages * pageSize, end);
+        if (mincore(static_cast<char *>(_basePtr) + start, windowEnd - start, residency.data()) < 0) {
+            throw hal_errno_exception(_alignmentPath, "getting page residency failed", errno);
+        }
+        for (size_t page = start; page < windowEnd; page += pageSize) {
+            if (residency[(page - start) / pageSize] & 1) {
+                residentBytes += std::min(page + pageSize, end) - std::max(page, offset);
+            }
+        }
+    }
+    return residentBytes;
+}
+
+/* size of the file and how much of it is resident */
+void hal::MMapFile::getIoStats(IoStats &stats) const {
+    stats.addFile("bytes", _fileSize);
+    stats.addFile("residentBytes", getResidentBytes(0, _fileSize));
+}
+
 namespace hal {
     /* Class that implements local file version of MMapFile */
     class MMapFileLocal : public MMapFile {
@@ -126,23 +170,38 @@ namespace hal {
         virtual bool isUdcProtocol() const {
             return false;
         }
+        virtual void prefetch(size_t offset, size_t length) const {
+            adviseRange(offset, length, MADV_WILLNEED);
+        }
+        virtual void adviseSequential() const {
+            adviseRange(0, _fileSize, MADV_SEQUENTIAL);
+        }
+        virtual void adviseRandom() const {
+            adviseRange(0, _fileSize, MADV_RANDOM);
+        }
+
+      protected:
+        virtual void grow(size_t requiredSize);
 
       private:
         int openFile();
         void closeFile();
         void adjustFileSize(size_t size);
+        void *reserveAddressSpace(size_t size);
+        void adviseRange(size_t offset, size_t length, int advice) const;
         void *mapFile(void *requiredAddr = NULL);
         void unmapFile();
         void openRead();
         void openWrite(size_t fileSize);
 
-        int _fd; // open file descriptor
+        int _fd;             // open file descriptor
+        size_t _reserveSize; // size of reserved address range for writing, or zero
     };
 }
 
 /* Constructor. Open or create the specified file. */
 hal::MMapFileLocal::MMapFileLocal(const std::string &alignmentPath, unsigned mode, size_t fileSize)
-    : MMapFile(alignmentPath, mode, false), _fd(-1) {
+    : MMapFile(alignmentPath, mode, false), _fd(-1), _reserveSize(0) {
     if (_mode & WRITE_ACCESS) {
         openWrite(fileSize);
     } else {
@@ -186,7 +245,8 @@ int hal::MMapFileLocal::openFile() {
     return fd;
 }
 
-/* change size size of the file, possibly deleting data. */
+/* change size size of the file, possibly deleting data.  Growing with
+ * ftruncate() leaves the file sparse, so unused space doesn't consume disk. */
 void hal::MMapFileLocal::adjustFileSize(size_t size) {
     if (ftruncate(_fd, size) < 0) {
         throw hal_errno_exception(_alignmentPath, "set size failed", errno);
@@ -194,6 +254,18 @@ void hal::MMapFileLocal::adjustFileSize(size_t size) {
     _fileSize = size;
 }
 
+/* Reserve a range of address space with no access, into which the file is
+ * mapped with MAP_FIXED.  */
+void *hal::MMapFileLocal::reserveAddressSpace(size_t size) {
+    void *ptr = mmap(NULL, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (ptr == MAP_FAILED) {
+        throw hal_errno_exception(_alignmentPath, "reserving " + std::to_string(size) + " bytes of address space failed",
+                                  errno);
+    }
+    _reserveSize = size;
+    return ptr;
+}
+
 /* map file into memory */
 void *hal::MMapFileLocal::mapFile(void *requiredAddr) {
     assert(_basePtr == NULL);
@@ -216,16 +288,48 @@ void *hal::MMapFileLocal::mapFile(void *requiredAddr) {
     return ptr;
 }
 
-/* unmap file, if mapped */
+/* unmap file, if mapped, along with any reserved address space */
 void hal::MMapFileLocal::unmapFile() {
     if (_basePtr != NULL) {
-        if (::munmap(const_cast<void *>(_basePtr), _fileSize) < 0) {
+        size_t mapSize = (_reserveSize > 0) ? _reserveSize : _fileSize;
+        if (::munmap(const_cast<void *>(_basePtr), mapSize) < 0) {
             throw hal_errno_exception(_alignmentPath, "munmap failed", errno);
         }
         _basePtr = NULL;
+        _reserveSize = 0;
+    }
+}
+
+/* madvise() a range of the file, expanding it to page boundaries and
+ * clipping it to the end of the file. */
+void hal::MMapFileLocal::adviseRange(size_t offset, size_t length, int advice) const {
+    if (offset >= _fileSize) {
+        return;
+    }
+    size_t end = std::min(offset + length, _fileSize);
+    static const size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t pageStart = (offset / pageSize) * pageSize;
+    if (::madvise(static_cast<char *>(_basePtr) + pageStart, end - pageStart, advice) < 0) {
+        throw hal_errno_exception(_alignmentPath, "madvise failed", errno);
     }
 }
 
+/* Grow the file geometrically so that it is at least requiredSize, remapping
+ * it in place inside of the reserved address range. */
+void hal::MMapFileLocal::grow(size_t requiredSize) {
+    validateWriteAccess();
+    if (requiredSize > _reserveSize) {
+        throw hal_exception(_alignmentPath + ": mmap file can't grow to " + std::to_string(requiredSize) +
+                            " bytes, exceeds reserved address space of " + std::to_string(_reserveSize) + " bytes");
+    }
+    size_t newSize = std::max(requiredSize, _fileSize + std::max(_fileSize, MMAP_MIN_GROWTH_SIZE));
+    newSize = std::min(newSize, _reserveSize);
+    adjustFileSize(newSize);
+    void *basePtr = _basePtr;
+    _basePtr = NULL; // mapFile() requires an unmapped file
+    _basePtr = mapFile(basePtr);
+}
+
 /* open the file for read access */
 void hal::MMapFileLocal::openRead() {
     _fd = openFile();
@@ -234,7 +338,8 @@ void hal::MMapFileLocal::openRead() {
     loadHeader(false);
 }
 
-/* open the file for write access */
+/* open the file for write access.  fileSize is the initial size (or
+ * additional space for existing files), the file grows as needed. */
 void hal::MMapFileLocal::openWrite(size_t fileSize) {
     _fd = openFile();
     if (_mode & CREATE_ACCESS) {
@@ -243,7 +348,7 @@ void hal::MMapFileLocal::openWrite(size_t fileSize) {
     } else if (_mode & WRITE_ACCESS) {
         adjustFileSize(getFileStatSize(_fd) + fileSize);
     }
-    _basePtr = mapFile();
+    _basePtr = mapFile(reserveAddressSpace(std::max(MMAP_WRITE_RESERVE_SIZE, _fileSize)));
     if (_mode & CREATE_ACCESS) {
         createHeader();
     } else {
@@ -272,18 +377,25 @@ namespace hal {
         virtual bool isUdcProtocol() const {
             return true;
         }
+        virtual void prefetch(size_t offset, size_t length) const {
+            fetch(offset, length);
+        }
+        virtual void getIoStats(IoStats &stats) const;
 
       protected:
         virtual void fetch(size_t offset, size_t accessSize) const;
 
       private:
         struct udc2File *_udcFile;
+        mutable MMapFetchScheduler _fetchScheduler; // avoids a UDC request on each access
+        mutable std::mutex _fetchLock;              // fetches come from all reading threads
+        mutable size_t _numFetchRequests;           // accesses checked by the scheduler
     };
 }
 
 /* Constructor. Open or create the specified file. */
 hal::MMapFileUdc::MMapFileUdc(const std::string &alignmentPath, unsigned mode, size_t fileSize)
-    : MMapFile(alignmentPath, mode, true), _udcFile(NULL) {
+    : MMapFile(alignmentPath, mode, true), _udcFile(NULL), _numFetchRequests(0) {
     if (_mode & WRITE_ACCESS) {
         throw hal_exception("write access not supported for UDC:" + alignmentPath);
     }
@@ -296,6 +408,7 @@ hal::MMapFileUdc::MMapFileUdc(const std::string &alignmentPath, unsigned mode, s
     // get base point and fetch header
     _basePtr = udc2MMapFetch(_udcFile, 0, sizeof(MMapHeader));
     _fileSize = udc2SizeFromCache(const_cast<char *>(_alignmentPath.c_str()), NULL);
+    _fetchScheduler.setFileSize(_fileSize);
     loadHeader(false);
 }
 
@@ -315,14 +428,28 @@ hal::MMapFileUdc::~MMapFileUdc() {
     }
 }
 
-/* fetch into UDC cache */
+/* fetch into UDC cache, if not already fetched.  The scheduler
+ * turns this into larger, block-aligned requests with read-ahead. */
 void hal::MMapFileUdc::fetch(size_t offset, size_t accessSize) const {
     if ((offset < _fileSize) and (offset + accessSize) > _fileSize) {
         // FIXME  - length off end, iterator does this
         accessSize = _fileSize - offset;
     }
+    size_t fetchOffset, fetchSize;
+    std::lock_guard<std::mutex> lock(_fetchLock);
+    _numFetchRequests++;
+    if (_fetchScheduler.schedule(offset, accessSize, fetchOffset, fetchSize)) {
+        udc2MMapFetch(_udcFile, fetchOffset, fetchSize);
+    }
+}
 
-    udc2MMapFetch(_udcFile, offset, accessSize);
+/* add the UDC requests made to the file statistics */
+void hal::MMapFileUdc::getIoStats(IoStats &stats) const {
+    MMapFile::getIoStats(stats);
+    std::lock_guard<std::mutex> lock(_fetchLock);
+    stats.addFile("fetchRequests", _numFetchRequests);
+    stats.addFile("udcFetches", _fetchScheduler.getNumFetches());
+    stats.addFile("udcFetchBytes", _fetchScheduler.getFetchBytes());
 }
 
 #endif
@@ -2,16 +2,22 @@
 #define _MMAPFILE_H
 #include "halAlignmentInstance.h"
 #include "halDefs.h"
+#include "halIoStats.h"
 #include <cassert>
 #include <cstddef>
 #include <iostream>
 #include <string>
 
 namespace hal {
-    /* Current API major and minor versions */
-    static const unsigned MMAP_API_MAJOR_VERSION = 1;
+    /* Current API major and minor versions.  Version 2.0 stores segments
+     * as bit-packed columns rather than arrays of records; 2.1 replaces the
+     * genome site map tree with an Eytzinger ordered site index. */
+    static const unsigned MMAP_API_MAJOR_VERSION = 2;
     static const unsigned MMAP_API_MINOR_VERSION = 1;
 
+    /* Oldest major version that can still be read and updated */
+    static const unsigned MMAP_API_MIN_MAJOR_VERSION = 1;
+
     /* get current mmap version as a string */
     const std::string& getMmapCurentVersion();
     
@@ -64,6 +70,24 @@ namespace hal {
 
         virtual bool isUdcProtocol() const = 0;
 
+        /* Hint that a range of the file will be accessed soon, and start
+         * loading it. */
+        virtual void prefetch(size_t offset, size_t length) const {
+        }
+        /* Hint that the file will be access sequentially or randomly. */
+        virtual void adviseSequential() const {
+        }
+        virtual void adviseRandom() const {
+        }
+
+        /* count the bytes of a range of the file that are resident in
+         * memory, rather than needing to be read from disk */
+        size_t getResidentBytes(size_t offset, size_t length) const;
+
+        /* add the file counters to I/O statistics: its size, the bytes of
+         * it that are resident, and for UDC, the fetches made */
+        virtual void getIoStats(IoStats &stats) const;
+
         inline size_t getRootOffset() const;
         inline void *toPtr(size_t offset, size_t accessSize);
         inline const void *toPtr(size_t offset, size_t accessSize) const;
@@ -88,6 +112,11 @@ namespace hal {
         virtual void fetch(size_t offset, size_t accessSize) const {
             // no-op by default
         }
+        /* grow the file to at least requiredSize without moving _basePtr;
+         * default is not growable */
+        virtual void grow(size_t requiredSize) {
+            throw hal_exception("mmap file is full, specify file size larger than " + std::to_string(_fileSize));
+        }
 
         void setHeaderPtr();
         void createHeader();
@@ -145,12 +174,13 @@ const void *hal::MMapFile::toPtr(size_t offset, size_t accessSize) const {
     return static_cast<const char *>(_basePtr) + offset;
 }
 
-/** Allocate new memory, resize file if necessary. If isRoot is specified, it
- * is stored as the root used to find all object.  */
+/** Allocate new memory, growing file if necessary. If isRoot is specified, it
+ * is stored as the root used to find all object.  Growing never moves the
+ * mapping, so pointers obtained with toPtr() remain valid. */
 size_t hal::MMapFile::allocMem(size_t size, bool isRoot) {
     validateWriteAccess();
     if (_header->nextOffset + size > _fileSize) {
-        throw hal_exception("mmap file is full, specify file size larger than " + std::to_string(_fileSize));
+        grow(_header->nextOffset + size);
     }
     size_t offset = _header->nextOffset;
     _header->nextOffset += alignRound(size);
@@ -11,6 +11,7 @@
 #include "mmapSequence.h"
 #include "mmapSequenceIterator.h"
 #include "mmapTopSegment.h"
+#include <algorithm>
 using namespace hal;
 using namespace std;
 
@@ -19,7 +20,7 @@ MMapGenome::~MMapGenome() {
 }
 
 void MMapGenome::setDimensions(const vector<Sequence::Info> &sequenceDimensions, bool storeDNAArrays) {
-    _sequenceObjCache.resize(sequenceDimensions.size());
+    resizeSequenceCache(sequenceDimensions.size());
 
     // FIXME: should we check storeDNAArrays??
     hal_size_t totalSequenceLength = 0;
@@ -81,7 +82,8 @@ void MMapGenome::createSequenceNameHash(size_t numSequences) {
 /* must be called after sequences are created */
 void MMapGenome::createGenomeSiteMap(size_t numSequences) {
     assert(_sequenceObjCache.size() == numSequences);
-    _data->_genomeSiteMapOffset = _genomeSiteMap.build(_sequenceObjCache);
+    vector<MMapSequence *> sequences(_sequenceObjCache.begin(), _sequenceObjCache.end());
+    _data->_genomeSiteMapOffset = _genomeSiteMap.build(sequences);
 }
 
 void MMapGenome::setSequenceData(size_t i, hal_index_t startPos, hal_index_t topSegmentStartIndex,
@@ -90,7 +92,7 @@ void MMapGenome::setSequenceData(size_t i, hal_index_t startPos, hal_index_t top
     MMapSequence *seq =
         new MMapSequence(this, data, i, startPos, sequenceInfo._length, topSegmentStartIndex, bottomSegmentStartIndex,
                          sequenceInfo._numTopSegments, sequenceInfo._numBottomSegments, sequenceInfo._name);
-    _sequenceObjCache[i] = seq;
+    _sequenceObjCache[i].store(seq);
 }
 
 MMapSequenceData *MMapGenome::getSequenceData(size_t i) const {
@@ -138,7 +140,11 @@ void MMapGenome::updateTopDimensions(const vector<Sequence::UpdateInfo> &updated
     }
     _data->_numTopSegments = numTopSegments;
 
-    _data->_topSegmentsOffset = _alignment->allocateNewArray((_data->_numTopSegments + 1) * sizeof(MMapTopSegmentData));
+    if (_segmentColumns) {
+        allocateTopSegmentColumns();
+    } else {
+        _data->_topSegmentsOffset = _alignment->allocateNewArray((_data->_numTopSegments + 1) * sizeof(MMapTopSegmentData));
+    }
     hal_index_t topSegmentStartIndex = 0;
     for (size_t i = 0; i < topDimensions.size(); i++) {
         MMapSequence seq(this, getSequenceData(i));
@@ -156,8 +162,12 @@ void MMapGenome::updateBottomDimensions(const vector<Sequence::UpdateInfo> &upda
         numBottomSegments += i._numSegments;
     }
     _data->_numBottomSegments = numBottomSegments;
-    _data->_bottomSegmentsOffset =
-        _alignment->allocateNewArray((_data->_numBottomSegments + 1) * MMapBottomSegmentData::getSize(this));
+    if (_segmentColumns) {
+        allocateBottomSegmentColumns();
+    } else {
+        _data->_bottomSegmentsOffset =
+            _alignment->allocateNewArray((_data->_numBottomSegments + 1) * MMapBottomSegmentData::getSize(this));
+    }
     hal_index_t bottomSegmentStartIndex = 0;
     for (size_t i = 0; i < bottomDimensions.size(); i++) {
         MMapSequence seq(this, getSequenceData(i));
@@ -168,15 +178,88 @@ void MMapGenome::updateBottomDimensions(const vector<Sequence::UpdateInfo> &upda
     reload();
 }
 
+/* Number of bits for an index column referencing numSegments segments.
+ * Indices are stored plus one, so they range up to numSegments.  If the
+ * referenced genome doesn't have its dimensions yet, numSegments is an
+ * estimate and the column is widened if needed. */
+static unsigned getIndexWidth(hal_size_t numSegments) {
+    return MMapPackedArrayData::getBitWidth(numSegments);
+}
+
+/* Allocate top segment columns, with an extra element to give the length of
+ * the last segment. The parent is typically dimensioned first, otherwise
+ * assume a similar number of segments. */
+void MMapGenome::allocateTopSegmentColumns() {
+    hal_size_t numSegments = _data->_numTopSegments + 1;
+    const Genome *parent = getParent();
+    hal_size_t numParentSegments = (parent != NULL) ? parent->getNumBottomSegments() : 0;
+    if (numParentSegments == 0) {
+        numParentSegments = _data->_numTopSegments;
+    }
+    _data->_topSegmentsOffset = _alignment->allocateNewArray(sizeof(MMapTopSegmentColumns));
+    MMapTopSegmentColumns *columns = getTopColumns();
+    columns->_startPosition.allocate(_alignment, numSegments, MMapPackedArrayData::getBitWidth(_data->_totalSequenceLength));
+    columns->_bottomParseIndex.allocate(_alignment, numSegments, getIndexWidth(_data->_numBottomSegments));
+    columns->_paralogyIndex.allocate(_alignment, numSegments, getIndexWidth(_data->_numTopSegments));
+    columns->_parentIndex.allocate(_alignment, numSegments, getIndexWidth(numParentSegments));
+    columns->_reversed.allocate(_alignment, numSegments, 1);
+}
+
+/* Allocate bottom segment columns, see allocateTopSegmentColumns() */
+void MMapGenome::allocateBottomSegmentColumns() {
+    hal_size_t numSegments = _data->_numBottomSegments + 1;
+    hal_size_t numChildren = getNumChildren();
+    _data->_bottomSegmentsOffset = _alignment->allocateNewArray(MMapBottomSegmentColumns::getSize(numChildren));
+    MMapBottomSegmentColumns *columns = getBottomColumns();
+    columns->_numChildren = numChildren;
+    columns->_startPosition.allocate(_alignment, numSegments, MMapPackedArrayData::getBitWidth(_data->_totalSequenceLength));
+    columns->_topParseIndex.allocate(_alignment, numSegments, getIndexWidth(_data->_numTopSegments));
+    for (hal_size_t child = 0; child < numChildren; child++) {
+        hal_size_t numChildSegments = getChild(child)->getNumTopSegments();
+        if (numChildSegments == 0) {
+            numChildSegments = _data->_numBottomSegments;
+        }
+        columns->getChildIndexColumn(child)->allocate(_alignment, numSegments, getIndexWidth(numChildSegments));
+        columns->getChildReversedColumn(child)->allocate(_alignment, numSegments, 1);
+    }
+}
+
+void MMapGenome::fitSegmentColumns() {
+    if (not _segmentColumns) {
+        return;
+    }
+    // the top columns are allocated before the genome has bottom segments
+    const Genome *parent = getParent();
+    if (_data->_numTopSegments > 0) {
+        getTopColumns()->_bottomParseIndex.reserveWidth(_alignment, getIndexWidth(_data->_numBottomSegments));
+        if (parent != NULL) {
+            getTopColumns()->_parentIndex.reserveWidth(_alignment, getIndexWidth(parent->getNumBottomSegments()));
+        }
+    }
+    if (_data->_numBottomSegments > 0) {
+        for (hal_size_t child = 0; child < getNumChildren(); child++) {
+            getBottomColumns()->getChildIndexColumn(child)->reserveWidth(_alignment,
+                                                                         getIndexWidth(getChild(child)->getNumTopSegments()));
+        }
+    }
+}
+
 hal_size_t MMapGenome::getNumSequences() const {
     return _data->_numSequences;
 }
 
 Sequence *MMapGenome::getSequenceByIndex(hal_index_t index) {
-    if (_sequenceObjCache[index] == NULL) {
-        _sequenceObjCache[index] = new MMapSequence(this, getSequenceData(index));
+    MMapSequence *sequence = _sequenceObjCache[index].load(std::memory_order_acquire);
+    if (sequence == NULL) {
+        // threads may race to create the object; only the first is kept
+        MMapSequence *newSequence = new MMapSequence(this, getSequenceData(index));
+        if (_sequenceObjCache[index].compare_exchange_strong(sequence, newSequence, std::memory_order_acq_rel)) {
+            sequence = newSequence;
+        } else {
+            delete newSequence;
+        }
     }
-    return _sequenceObjCache[index];
+    return sequence;
 }
 
 const Sequence *MMapGenome::getSequenceByIndex(hal_index_t index) const {
@@ -200,7 +283,11 @@ const Sequence *MMapGenome::getSequence(const string &name) const {
 }
 
 Sequence *MMapGenome::getSequenceBySite(hal_size_t position) {
-    return getSequenceByIndex(_genomeSiteMap.getSequenceIndexBySite(position));
+    hal_index_t index = _genomeSiteMap.getSequenceIndexBySite(position);
+    if (index == NULL_INDEX) {
+        return NULL; // past end of genome
+    }
+    return getSequenceByIndex(index);
 }
 
 const Sequence *MMapGenome::getSequenceBySite(hal_size_t position) const {
@@ -326,9 +413,9 @@ void MMapGenome::setString(const string &inString) {
 }
 
 void MMapGenome::getSubString(string &outString, hal_size_t start, hal_size_t length) const {
-    outString.resize(length);
-    DnaIteratorPtr dnaIt(getDnaIterator(start));
-    dnaIt->readString(outString, length);
+    PackedDnaSpan span;
+    getPackedDna(span, start, length);
+    span.unpack(outString);
 }
 
 void MMapGenome::setSubString(const string &inString, hal_size_t start, hal_size_t length) {
@@ -339,6 +426,17 @@ void MMapGenome::setSubString(const string &inString, hal_size_t start, hal_size
     dnaIt->writeString(inString, length);
 }
 
+void MMapGenome::getPackedDna(PackedDnaSpan &span, hal_size_t start, hal_size_t length) const {
+    if (start + length > getSequenceLength()) {
+        throw hal_exception("MMapGenome::getPackedDna: range (" + std::to_string(start) + ", " + std::to_string(length) +
+                            ") out of bounds for genome " + getName());
+    }
+    // the file is never remapped, so the span can point straight into it
+    bool odd = start & 1;
+    size_t numBytes = (odd + length + 1) / 2;
+    span.set(reinterpret_cast<const unsigned char *>(_data->getDNA(_alignment, start / 2, numBytes)), length, odd);
+}
+
 RearrangementPtr MMapGenome::getRearrangement(hal_index_t position, hal_size_t gapLengthThreshold, double nThreshold,
                                               bool atomic) const {
     assert(position >= 0 && position < (hal_index_t)getNumTopSegments());
@@ -365,9 +463,161 @@ void MMapGenome::rename(const std::string &name) {
     _data->setName(_alignment, name);
 }
 
+/* binary search for the index of the segment containing position */
+template <typename GetStart>
+hal_index_t MMapGenome::findSegmentIndex(hal_index_t position, hal_size_t numSegments, GetStart getStart) const {
+    hal_index_t lo = 0, hi = (hal_index_t)numSegments - 1;
+    while (lo < hi) {
+        hal_index_t mid = lo + (hi - lo + 1) / 2;
+        if (getStart(mid) <= position) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+/* Prefetch segment and DNA arrays covering range.  Finding the segment
+ * indices touches O(log n) pages, the ranges are then requested in bulk. */
+void MMapGenome::prefetchRange(hal_index_t start, hal_size_t length) const {
+    hal_size_t genomeLength = getSequenceLength();
+    if ((length == 0) || (start < 0) || ((hal_size_t)start >= genomeLength)) {
+        return;
+    }
+    length = std::min(length, genomeLength - start);
+    hal_index_t last = start + (hal_index_t)length - 1;
+    MMapFile *file = _alignment->getMMapFile();
+
+    hal_size_t numTop = getNumTopSegments();
+    if (numTop > 0) {
+        auto getStart = [this](hal_index_t i) { return getTopStartPosition(i); };
+        hal_index_t first = findSegmentIndex(start, numTop, getStart);
+        // include following segment, which is read to get the length, and guard against
+        // segments that are not yet initialized
+        hal_index_t end = std::max(findSegmentIndex(last, numTop, getStart), first) + 2;
+        if (_segmentColumns) {
+            MMapTopSegmentColumns *columns = getTopColumns();
+            columns->_startPosition.prefetch(file, first, end);
+            columns->_bottomParseIndex.prefetch(file, first, end);
+            columns->_paralogyIndex.prefetch(file, first, end);
+            columns->_parentIndex.prefetch(file, first, end);
+            columns->_reversed.prefetch(file, first, end);
+        } else {
+            file->prefetch(_data->getTopSegmentsOffset() + first * sizeof(MMapTopSegmentData),
+                           (end - first) * sizeof(MMapTopSegmentData));
+        }
+    }
+    hal_size_t numBottom = getNumBottomSegments();
+    if (numBottom > 0) {
+        auto getStart = [this](hal_index_t i) { return getBottomStartPosition(i); };
+        hal_index_t first = findSegmentIndex(start, numBottom, getStart);
+        hal_index_t end = std::max(findSegmentIndex(last, numBottom, getStart), first) + 2;
+        if (_segmentColumns) {
+            MMapBottomSegmentColumns *columns = getBottomColumns();
+            columns->_startPosition.prefetch(file, first, end);
+            columns->_topParseIndex.prefetch(file, first, end);
+            for (hal_size_t child = 0; child < columns->_numChildren; child++) {
+                columns->getChildIndexColumn(child)->prefetch(file, first, end);
+                columns->getChildReversedColumn(child)->prefetch(file, first, end);
+            }
+        } else {
+            size_t segmentSize = MMapBottomSegmentData::getSize(this);
+            file->prefetch(_data->getBottomSegmentsOffset() + first * segmentSize, (end - first) * segmentSize);
+        }
+    }
+    // one base per nibble
+    file->prefetch(_data->getDnaOffset() + start / 2, (last / 2) - (start / 2) + 1);
+}
+
+/* Columns can only be read in place in 2.x files that are mapped as a
+ * whole, not fetched on access (UDC). */
+bool MMapGenome::getSegmentColumns(SegmentColumns &columns) const {
+    if ((not _segmentColumns) || _alignment->getMMapFile()->isUdcProtocol()) {
+        return false;
+    }
+    columns = SegmentColumns();
+    columns._numTopSegments = getNumTopSegments();
+    columns._numBottomSegments = getNumBottomSegments();
+    if ((columns._numTopSegments > 0) && (_data->_topSegmentsOffset != MMAP_NULL_OFFSET)) {
+        const MMapTopSegmentColumns *top = getTopColumns();
+        columns._topStartPosition = top->_startPosition.getView(_alignment);
+        columns._topBottomParseIndex = top->_bottomParseIndex.getView(_alignment);
+        columns._topParalogyIndex = top->_paralogyIndex.getView(_alignment);
+        columns._topParentIndex = top->_parentIndex.getView(_alignment);
+        columns._topReversed = top->_reversed.getView(_alignment);
+    }
+    if ((columns._numBottomSegments > 0) && (_data->_bottomSegmentsOffset != MMAP_NULL_OFFSET)) {
+        MMapBottomSegmentColumns *bottom = getBottomColumns();
+        columns._bottomStartPosition = bottom->_startPosition.getView(_alignment);
+        columns._bottomTopParseIndex = bottom->_topParseIndex.getView(_alignment);
+        for (hal_size_t child = 0; child < bottom->_numChildren; child++) {
+            columns._bottomChildIndex.push_back(bottom->getChildIndexColumn(child)->getView(_alignment));
+            columns._bottomChildReversed.push_back(bottom->getChildReversedColumn(child)->getView(_alignment));
+        }
+    }
+    return true;
+}
+
+/* add the size of a range of the file, and how much of it is resident, to
+ * the counters of an array */
+static void addArrayRange(IoStats &stats, const MMapFile *file, const string &genomeName, const string &arrayName,
+                          size_t offset, size_t length) {
+    stats.add(genomeName, arrayName, "bytes", length);
+    stats.add(genomeName, arrayName, "residentBytes", file->getResidentBytes(offset, length));
+}
+
+static void addColumnRange(IoStats &stats, const MMapFile *file, const string &genomeName, const string &arrayName,
+                           const MMapPackedArrayData &column) {
+    addArrayRange(stats, file, genomeName, arrayName, column.getOffset(), column.getNumBytes());
+}
+
+void MMapGenome::getIoStats(IoStats &stats) const {
+    const MMapFile *file = _alignment->getMMapFile();
+    addArrayRange(stats, file, _name, "dna", _data->_dnaOffset, (_data->_totalSequenceLength + 1) / 2);
+    addArrayRange(stats, file, _name, "sequences", _data->_sequencesOffset,
+                  _data->_numSequences * sizeof(MMapSequenceData));
+    if (_data->_topSegmentsOffset != MMAP_NULL_OFFSET) {
+        if (_segmentColumns) {
+            const MMapTopSegmentColumns *columns = getTopColumns();
+            addColumnRange(stats, file, _name, "topSegments", columns->_startPosition);
+            addColumnRange(stats, file, _name, "topSegments", columns->_bottomParseIndex);
+            addColumnRange(stats, file, _name, "topSegments", columns->_paralogyIndex);
+            addColumnRange(stats, file, _name, "topSegments", columns->_parentIndex);
+            addColumnRange(stats, file, _name, "topSegments", columns->_reversed);
+        } else {
+            addArrayRange(stats, file, _name, "topSegments", _data->_topSegmentsOffset,
+                          (_data->_numTopSegments + 1) * sizeof(MMapTopSegmentData));
+        }
+    }
+    if (_data->_bottomSegmentsOffset != MMAP_NULL_OFFSET) {
+        if (_segmentColumns) {
+            MMapBottomSegmentColumns *columns = getBottomColumns();
+            addColumnRange(stats, file, _name, "bottomSegments", columns->_startPosition);
+            addColumnRange(stats, file, _name, "bottomSegments", columns->_topParseIndex);
+            for (hal_size_t child = 0; child < columns->_numChildren; child++) {
+                addColumnRange(stats, file, _name, "bottomSegments", *columns->getChildIndexColumn(child));
+                addColumnRange(stats, file, _name, "bottomSegments", *columns->getChildReversedColumn(child));
+            }
+        } else {
+            addArrayRange(stats, file, _name, "bottomSegments", _data->_bottomSegmentsOffset,
+                          (_data->_numBottomSegments + 1) * MMapBottomSegmentData::getSize(this));
+        }
+    }
+}
+
+/* resize the sequence object cache, keeping any existing objects */
+void MMapGenome::resizeSequenceCache(size_t numSequences) {
+    vector<std::atomic<MMapSequence *>> sequenceObjCache(numSequences);
+    for (size_t i = 0; i < std::min(numSequences, _sequenceObjCache.size()); i++) {
+        sequenceObjCache[i] = _sequenceObjCache[i].load();
+    }
+    _sequenceObjCache.swap(sequenceObjCache);
+}
+
 void MMapGenome::deleteSequenceCache() {
-    for (auto seq : _sequenceObjCache) {
-        delete seq;
+    for (auto &seq : _sequenceObjCache) {
+        delete seq.load();
     }
     _sequenceObjCache.clear();
 }
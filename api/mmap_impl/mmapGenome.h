@@ -8,6 +8,7 @@
 #include "mmapPerfectHashTable.h"
 #include "mmapString.h"
 #include "mmapTopSegmentData.h"
+#include <atomic>
 #include <map>
 
 namespace hal {
@@ -25,7 +26,12 @@ namespace hal {
         void setName(MMapAlignment *alignment, const std::string &name);
         void initializeName(MMapAlignment *alignment, const std::string &name);
         MMapTopSegmentData *getTopSegmentData(MMapAlignment *alignment, hal_index_t index);
-        MMapBottomSegmentData *getBottomSegmentData(MMapAlignment *alignment, MMapGenome *genome, hal_index_t index);
+        MMapBottomSegmentData *getBottomSegmentData(MMapAlignment *alignment, const MMapGenome *genome, hal_index_t index);
+        MMapTopSegmentColumns *getTopSegmentColumns(MMapAlignment *alignment);
+        MMapBottomSegmentColumns *getBottomSegmentColumns(MMapAlignment *alignment, hal_size_t numChildren);
+        size_t getTopSegmentsOffset() const;
+        size_t getBottomSegmentsOffset() const;
+        size_t getDnaOffset() const;
 
       private:
         hal_size_t _totalSequenceLength;
@@ -39,8 +45,8 @@ namespace hal {
         size_t _sequencesOffset;
         size_t _metadataOffset;
         size_t _dnaOffset;
-        size_t _topSegmentsOffset;
-        size_t _bottomSegmentsOffset;
+        size_t _topSegmentsOffset;    // MMapTopSegmentColumns in 2.x, array of MMapTopSegmentData in 1.x
+        size_t _bottomSegmentsOffset; // MMapBottomSegmentColumns in 2.x, array of MMapBottomSegmentData in 1.x
         // note: couldn't add a reserved field, since MMapGenomeData is an array
         // of structs.
     };
@@ -51,26 +57,51 @@ namespace hal {
             : Genome(alignment, data->getName(alignment)), _alignment(alignment), _data(data), _arrayIndex(arrayIndex),
               _name(data->getName(_alignment)), _metaData(_alignment, _data->_metadataOffset),
               _sequenceNameHash(alignment->getMMapFile(), data->_sequenceHashOffset),
-              _genomeSiteMap(alignment->getMMapFile(), data->_genomeSiteMapOffset) {
-            _sequenceObjCache.resize(data->_numSequences);
+              _genomeSiteMap(alignment->getMMapFile(), data->_genomeSiteMapOffset, hasSiteIndex(alignment)),
+              _segmentColumns(hasSegmentColumns(alignment)) {
+            resizeSequenceCache(data->_numSequences);
         };
         MMapGenome(MMapAlignment *alignment, MMapGenomeData *data, size_t arrayIndex, const std::string &name)
             : Genome(alignment, name), _alignment(alignment), _data(data), _arrayIndex(arrayIndex), _name(name),
               _metaData(_alignment), _sequenceNameHash(alignment->getMMapFile(), data->_sequenceHashOffset),
-              _genomeSiteMap(alignment->getMMapFile(), data->_genomeSiteMapOffset) {
+              _genomeSiteMap(alignment->getMMapFile(), data->_genomeSiteMapOffset, hasSiteIndex(alignment)),
+              _segmentColumns(hasSegmentColumns(alignment)) {
             _data->initializeName(_alignment, _name);
             _data->_metadataOffset = _metaData.getOffset();
-            _sequenceObjCache.resize(data->_numSequences);
+            resizeSequenceCache(data->_numSequences);
         };
 
         virtual ~MMapGenome();
 
-        MMapTopSegmentData *getTopSegmentPointer(hal_index_t index) {
-            return _data->getTopSegmentData(_alignment, index);
-        };
-        MMapBottomSegmentData *getBottomSegmentPointer(hal_index_t index) {
-            return _data->getBottomSegmentData(_alignment, this, index);
-        };
+        // Segment fields are accessed through the genome, since they are
+        // stored as bit-packed columns in mmap API 2.x files and as arrays of
+        // records in 1.x files.
+        hal_index_t getTopStartPosition(hal_index_t index) const;
+        void setTopStartPosition(hal_index_t index, hal_index_t startPosition);
+        hal_index_t getTopBottomParseIndex(hal_index_t index) const;
+        void setTopBottomParseIndex(hal_index_t index, hal_index_t parseIndex);
+        hal_index_t getTopNextParalogyIndex(hal_index_t index) const;
+        void setTopNextParalogyIndex(hal_index_t index, hal_index_t paralogyIndex);
+        hal_index_t getTopParentIndex(hal_index_t index) const;
+        void setTopParentIndex(hal_index_t index, hal_index_t parentIndex);
+        bool getTopParentReversed(hal_index_t index) const;
+        void setTopParentReversed(hal_index_t index, bool reversed);
+        hal_index_t getBottomStartPosition(hal_index_t index) const;
+        void setBottomStartPosition(hal_index_t index, hal_index_t startPosition);
+        hal_index_t getBottomTopParseIndex(hal_index_t index) const;
+        void setBottomTopParseIndex(hal_index_t index, hal_index_t parseIndex);
+        hal_index_t getBottomChildIndex(hal_index_t index, hal_size_t child) const;
+        void setBottomChildIndex(hal_index_t index, hal_size_t child, hal_index_t childIndex);
+        bool getBottomChildReversed(hal_index_t index, hal_size_t child) const;
+        void setBottomChildReversed(hal_index_t index, hal_size_t child, bool reversed);
+
+        /* Widen the index columns to fit the numbers of segments of the
+         * parent and children, which may not have had their dimensions when
+         * the columns were allocated.  Once all genomes have their
+         * dimensions, this lets the segments of different genomes be set by
+         * different threads, as valid values then never need a column to be
+         * widened, which would allocate in the file. */
+        void fitSegmentColumns();
 
         void updateGenomeArrayBasePtr(MMapGenomeData *base) {
             _data = base + _arrayIndex;
@@ -118,6 +149,14 @@ namespace hal {
 
         void rename(const std::string &newName);
 
+        void prefetchRange(hal_index_t start, hal_size_t length) const;
+
+        bool getSegmentColumns(SegmentColumns &columns) const;
+
+        /* add the size of each array of the genome, and how many of its
+         * bytes are resident in memory, to I/O statistics */
+        void getIoStats(IoStats &stats) const;
+
         // SEGMENTED SEQUENCE INTERFACE
 
         hal_size_t getSequenceLength() const;
@@ -150,6 +189,8 @@ namespace hal {
 
         void setSubString(const std::string &intString, hal_size_t start, hal_size_t length);
 
+        void getPackedDna(PackedDnaSpan &span, hal_size_t start, hal_size_t length) const;
+
         RearrangementPtr getRearrangement(hal_index_t position, hal_size_t gapLengthThreshold, double nThreshold,
                                           bool atomic = false) const;
 
@@ -167,11 +208,36 @@ namespace hal {
         void createSequenceNameHash(size_t numSequences);
 
       private:
+        static bool hasSegmentColumns(MMapAlignment *alignment) {
+            return alignment->getMMapFile()->getMajorVersion() >= 2;
+        }
+        static bool hasSiteIndex(MMapAlignment *alignment) {
+            const MMapFile *file = alignment->getMMapFile();
+            return (file->getMajorVersion() > 2) || ((file->getMajorVersion() == 2) && (file->getMinorVersion() >= 1));
+        }
+        /* indices are stored plus one, so NULL_INDEX is zero */
+        static uint64_t encodeIndex(hal_index_t index) {
+            return (uint64_t)(index + 1);
+        }
+        static hal_index_t decodeIndex(uint64_t value) {
+            return (hal_index_t)value - 1;
+        }
+        MMapTopSegmentColumns *getTopColumns() const {
+            return _data->getTopSegmentColumns(_alignment);
+        }
+        MMapBottomSegmentColumns *getBottomColumns() const {
+            return _data->getBottomSegmentColumns(_alignment, getNumChildren());
+        }
+        void allocateTopSegmentColumns();
+        void allocateBottomSegmentColumns();
+        template <typename GetStart>
+        hal_index_t findSegmentIndex(hal_index_t position, hal_size_t numSegments, GetStart getStart) const;
         void createGenomeSiteMap(size_t numSequences);
         void setSequenceData(size_t i, hal_index_t startPos, hal_index_t topSegmentStartIndex,
                              hal_index_t bottomSegmentStartIndex, const Sequence::Info &sequenceInfo);
         std::vector<Sequence::UpdateInfo> getCompleteInputDimensions(const std::vector<Sequence::UpdateInfo> &inputDimensions,
                                                                      bool isTop);
+        void resizeSequenceCache(size_t numSequences);
         void deleteSequenceCache();
 
         MMapGenomeData *_data;
@@ -181,7 +247,11 @@ namespace hal {
         MMapPerfectHashTable _sequenceNameHash;
         MMapGenomeSiteMap _genomeSiteMap;
 
-        mutable std::vector<MMapSequence *> _sequenceObjCache;
+        bool _segmentColumns; // segments stored in columns (mmap API 2.x)
+
+        // sequence objects are created on first use, atomically so that
+        // concurrent readers can share them
+        mutable std::vector<std::atomic<MMapSequence *>> _sequenceObjCache;
     };
 
     inline std::string MMapGenomeData::getName(MMapAlignment *alignment) const {
@@ -206,7 +276,7 @@ namespace hal {
             alignment->resolveOffset(_topSegmentsOffset + index * sizeof(MMapTopSegmentData), 2 * sizeof(MMapTopSegmentData)));
     }
 
-    inline MMapBottomSegmentData *MMapGenomeData::getBottomSegmentData(MMapAlignment *alignment, MMapGenome *genome,
+    inline MMapBottomSegmentData *MMapGenomeData::getBottomSegmentData(MMapAlignment *alignment, const MMapGenome *genome,
                                                                        hal_index_t index) {
         size_t segmentSize = MMapBottomSegmentData::getSize(genome);
         // We request twice the segment length here because checking the length of
@@ -216,9 +286,175 @@ namespace hal {
             alignment->resolveOffset(_bottomSegmentsOffset + index * segmentSize, 2 * segmentSize));
     }
 
+    inline MMapTopSegmentColumns *MMapGenomeData::getTopSegmentColumns(MMapAlignment *alignment) {
+        return static_cast<MMapTopSegmentColumns *>(
+            alignment->resolveOffset(_topSegmentsOffset, sizeof(MMapTopSegmentColumns)));
+    }
+
+    inline MMapBottomSegmentColumns *MMapGenomeData::getBottomSegmentColumns(MMapAlignment *alignment, hal_size_t numChildren) {
+        return static_cast<MMapBottomSegmentColumns *>(
+            alignment->resolveOffset(_bottomSegmentsOffset, MMapBottomSegmentColumns::getSize(numChildren)));
+    }
+
+    inline size_t MMapGenomeData::getTopSegmentsOffset() const {
+        return _topSegmentsOffset;
+    }
+
+    inline size_t MMapGenomeData::getBottomSegmentsOffset() const {
+        return _bottomSegmentsOffset;
+    }
+
+    inline size_t MMapGenomeData::getDnaOffset() const {
+        return _dnaOffset;
+    }
+
     inline char *MMapGenomeData::getDNA(MMapAlignment *alignment, size_t start, size_t length) const {
         return static_cast<char *>(alignment->resolveOffset(_dnaOffset + start, length));
     }
+
+    inline hal_index_t MMapGenome::getTopStartPosition(hal_index_t index) const {
+        if (_segmentColumns) {
+            return getTopColumns()->_startPosition.get(_alignment, index);
+        } else {
+            return _data->getTopSegmentData(_alignment, index)->getStartPosition();
+        }
+    }
+
+    inline void MMapGenome::setTopStartPosition(hal_index_t index, hal_index_t startPosition) {
+        if (_segmentColumns) {
+            getTopColumns()->_startPosition.set(_alignment, index, startPosition);
+        } else {
+            _data->getTopSegmentData(_alignment, index)->setStartPosition(startPosition);
+        }
+    }
+
+    inline hal_index_t MMapGenome::getTopBottomParseIndex(hal_index_t index) const {
+        if (_segmentColumns) {
+            return decodeIndex(getTopColumns()->_bottomParseIndex.get(_alignment, index));
+        } else {
+            return _data->getTopSegmentData(_alignment, index)->getBottomParseIndex();
+        }
+    }
+
+    inline void MMapGenome::setTopBottomParseIndex(hal_index_t index, hal_index_t parseIndex) {
+        if (_segmentColumns) {
+            getTopColumns()->_bottomParseIndex.set(_alignment, index, encodeIndex(parseIndex));
+        } else {
+            _data->getTopSegmentData(_alignment, index)->setBottomParseIndex(parseIndex);
+        }
+    }
+
+    inline hal_index_t MMapGenome::getTopNextParalogyIndex(hal_index_t index) const {
+        if (_segmentColumns) {
+            return decodeIndex(getTopColumns()->_paralogyIndex.get(_alignment, index));
+        } else {
+            return _data->getTopSegmentData(_alignment, index)->getNextParalogyIndex();
+        }
+    }
+
+    inline void MMapGenome::setTopNextParalogyIndex(hal_index_t index, hal_index_t paralogyIndex) {
+        if (_segmentColumns) {
+            getTopColumns()->_paralogyIndex.set(_alignment, index, encodeIndex(paralogyIndex));
+        } else {
+            _data->getTopSegmentData(_alignment, index)->setNextParalogyIndex(paralogyIndex);
+        }
+    }
+
+    inline hal_index_t MMapGenome::getTopParentIndex(hal_index_t index) const {
+        if (_segmentColumns) {
+            return decodeIndex(getTopColumns()->_parentIndex.get(_alignment, index));
+        } else {
+            return _data->getTopSegmentData(_alignment, index)->getParentIndex();
+        }
+    }
+
+    inline void MMapGenome::setTopParentIndex(hal_index_t index, hal_index_t parentIndex) {
+        if (_segmentColumns) {
+            getTopColumns()->_parentIndex.set(_alignment, index, encodeIndex(parentIndex));
+        } else {
+            _data->getTopSegmentData(_alignment, index)->setParentIndex(parentIndex);
+        }
+    }
+
+    inline bool MMapGenome::getTopParentReversed(hal_index_t index) const {
+        if (_segmentColumns) {
+            return getTopColumns()->_reversed.get(_alignment, index);
+        } else {
+            return _data->getTopSegmentData(_alignment, index)->getReversed();
+        }
+    }
+
+    inline void MMapGenome::setTopParentReversed(hal_index_t index, bool reversed) {
+        if (_segmentColumns) {
+            getTopColumns()->_reversed.set(_alignment, index, reversed);
+        } else {
+            _data->getTopSegmentData(_alignment, index)->setReversed(reversed);
+        }
+    }
+
+    inline hal_index_t MMapGenome::getBottomStartPosition(hal_index_t index) const {
+        if (_segmentColumns) {
+            return getBottomColumns()->_startPosition.get(_alignment, index);
+        } else {
+            return _data->getBottomSegmentData(_alignment, this, index)->getStartPosition();
+        }
+    }
+
+    inline void MMapGenome::setBottomStartPosition(hal_index_t index, hal_index_t startPosition) {
+        if (_segmentColumns) {
+            getBottomColumns()->_startPosition.set(_alignment, index, startPosition);
+        } else {
+            _data->getBottomSegmentData(_alignment, this, index)->setStartPosition(startPosition);
+        }
+    }
+
+    inline hal_index_t MMapGenome::getBottomTopParseIndex(hal_index_t index) const {
+        if (_segmentColumns) {
+            return decodeIndex(getBottomColumns()->_topParseIndex.get(_alignment, index));
+        } else {
+            return _data->getBottomSegmentData(_alignment, this, index)->getTopParseIndex();
+        }
+    }
+
+    inline void MMapGenome::setBottomTopParseIndex(hal_index_t index, hal_index_t parseIndex) {
+        if (_segmentColumns) {
+            getBottomColumns()->_topParseIndex.set(_alignment, index, encodeIndex(parseIndex));
+        } else {
+            _data->getBottomSegmentData(_alignment, this, index)->setTopParseIndex(parseIndex);
+        }
+    }
+
+    inline hal_index_t MMapGenome::getBottomChildIndex(hal_index_t index, hal_size_t child) const {
+        if (_segmentColumns) {
+            return decodeIndex(getBottomColumns()->getChildIndexColumn(child)->get(_alignment, index));
+        } else {
+            return _data->getBottomSegmentData(_alignment, this, index)->getChildIndex(child);
+        }
+    }
+
+    inline void MMapGenome::setBottomChildIndex(hal_index_t index, hal_size_t child, hal_index_t childIndex) {
+        if (_segmentColumns) {
+            getBottomColumns()->getChildIndexColumn(child)->set(_alignment, index, encodeIndex(childIndex));
+        } else {
+            _data->getBottomSegmentData(_alignment, this, index)->setChildIndex(child, childIndex);
+        }
+    }
+
+    inline bool MMapGenome::getBottomChildReversed(hal_index_t index, hal_size_t child) const {
+        if (_segmentColumns) {
+            return getBottomColumns()->getChildReversedColumn(child)->get(_alignment, index);
+        } else {
+            return _data->getBottomSegmentData(_alignment, this, index)->getChildReversed(getNumChildren(), child);
+        }
+    }
+
+    inline void MMapGenome::setBottomChildReversed(hal_index_t index, hal_size_t child, bool reversed) {
+        if (_segmentColumns) {
+            getBottomColumns()->getChildReversedColumn(child)->set(_alignment, index, reversed);
+        } else {
+            _data->getBottomSegmentData(_alignment, this, index)->setChildReversed(getNumChildren(), child, reversed);
+        }
+    }
 }
 #endif
 // Local Variables:
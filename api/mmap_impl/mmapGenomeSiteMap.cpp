@@ -1,6 +1,7 @@
 #include "mmapGenomeSiteMap.h"
 #include "mmapRbTree.h"
 #include "mmapSequence.h"
+#include <algorithm>
 using namespace std;
 using namespace hal;
 
@@ -37,8 +38,15 @@ size_t hal::MMapGenomeSiteMap::calcRequiredSpace(size_t numSequences) {
            ((numSequences - 1) * MMapFile::alignRound(sizeof(MMapGenomeSiteMapNode)));
 }
 
+/* cache line alignment for site index end positions */
+static const size_t SITE_INDEX_ALIGN = 64;
+
 /* read header information */
 void hal::MMapGenomeSiteMap::readGsm(size_t gsmOffset) {
+    if (_useSiteIndex) {
+        readIndex(gsmOffset);
+        return;
+    }
     _gsmOffset = gsmOffset;
     _data = static_cast<MMapGenomeSiteMapData *>(_file->toPtr(gsmOffset, sizeof(MMapGenomeSiteMapData)));
     // prefetch full table
@@ -84,7 +92,7 @@ hal_index_t hal::MMapGenomeSiteMap::copyTree(struct rb_tree_node *tmpNode, int &
     return nodeIdx;
 }
 
-size_t hal::MMapGenomeSiteMap::build(const vector<MMapSequence *> &sequences) {
+size_t hal::MMapGenomeSiteMap::buildTree(const vector<MMapSequence *> &sequences) {
     struct rb_tree tmpTree;
     TmpTreeNodes tmpTreeNodes; // manages memory for tmp tree
 
@@ -96,8 +104,7 @@ size_t hal::MMapGenomeSiteMap::build(const vector<MMapSequence *> &sequences) {
     return _gsmOffset;
 }
 
-hal_index_t MMapGenomeSiteMap::getSequenceIndexBySite(size_t position) {
-    assert(_gsmOffset != MMAP_NULL_OFFSET);
+hal_index_t MMapGenomeSiteMap::searchTree(size_t position) const {
     const MMapGenomeSiteMapNode *node = getNodePtr(0);
     while (node != NULL) {
         int dir = node->positionCmp(position);
@@ -111,3 +118,63 @@ hal_index_t MMapGenomeSiteMap::getSequenceIndexBySite(size_t position) {
     }
     return NULL_INDEX;
 }
+
+/* read site index header and arrays */
+void hal::MMapGenomeSiteMap::readIndex(size_t gsmOffset) {
+    _gsmOffset = gsmOffset;
+    _indexData = static_cast<MMapGenomeSiteIndexData *>(_file->toPtr(gsmOffset, sizeof(MMapGenomeSiteIndexData)));
+    // prefetch full arrays
+    size_t numElements = _indexData->_numEntries + 1;
+    _ends = static_cast<size_t *>(_file->toPtr(_indexData->_endsOffset, numElements * sizeof(size_t)));
+    _sequenceIndexes = static_cast<hal_index_t *>(
+        _file->toPtr(_indexData->_sequenceIndexesOffset, numElements * sizeof(hal_index_t)));
+}
+
+/* allocate the site index, with the end positions aligned to a cache line */
+void hal::MMapGenomeSiteMap::createIndex(size_t numEntries) {
+    size_t numElements = numEntries + 1;
+    _gsmOffset = _file->allocMem(sizeof(MMapGenomeSiteIndexData));
+    size_t endsOffset = _file->allocMem(numElements * sizeof(size_t) + SITE_INDEX_ALIGN);
+    endsOffset = ((endsOffset + SITE_INDEX_ALIGN - 1) / SITE_INDEX_ALIGN) * SITE_INDEX_ALIGN;
+    size_t sequenceIndexesOffset = _file->allocMem(numElements * sizeof(hal_index_t));
+
+    _indexData = static_cast<MMapGenomeSiteIndexData *>(_file->toPtr(_gsmOffset, sizeof(MMapGenomeSiteIndexData)));
+    _indexData->_numEntries = numEntries;
+    _indexData->_endsOffset = endsOffset;
+    _indexData->_sequenceIndexesOffset = sequenceIndexesOffset;
+    _ends = static_cast<size_t *>(_file->toPtr(endsOffset, numElements * sizeof(size_t)));
+    _sequenceIndexes = static_cast<hal_index_t *>(_file->toPtr(sequenceIndexesOffset, numElements * sizeof(hal_index_t)));
+}
+
+/* recursively copy sorted entries to the Eytzinger ordered arrays by an
+ * in-order walk of the implicit tree */
+void hal::MMapGenomeSiteMap::copyIndex(const IndexEntries &entries, size_t &nextEntry, size_t eytzIndex) {
+    if (eytzIndex > entries.size()) {
+        return;
+    }
+    copyIndex(entries, nextEntry, 2 * eytzIndex);
+    _ends[eytzIndex] = entries[nextEntry].first;
+    _sequenceIndexes[eytzIndex] = entries[nextEntry].second;
+    nextEntry++;
+    copyIndex(entries, nextEntry, 2 * eytzIndex + 1);
+}
+
+/* Build site index.  Empty sequences contain no sites, so they are left out,
+ * leaving the end positions strictly increasing. */
+size_t hal::MMapGenomeSiteMap::buildIndex(const vector<MMapSequence *> &sequences) {
+    IndexEntries entries;
+    for (auto seq : sequences) {
+        if (seq->getSequenceLength() > 0) {
+            entries.push_back(make_pair(seq->getStartPosition() + seq->getSequenceLength(), seq->getArrayIndex()));
+        }
+    }
+    sort(entries.begin(), entries.end());
+    createIndex(entries.size());
+    size_t nextEntry = 0;
+    copyIndex(entries, nextEntry, 1);
+    return _gsmOffset;
+}
+
+size_t hal::MMapGenomeSiteMap::build(const vector<MMapSequence *> &sequences) {
+    return _useSiteIndex ? buildIndex(sequences) : buildTree(sequences);
+}
@@ -47,17 +47,33 @@ namespace hal {
         MMapGenomeSiteMapNode _root;
     };
 
+    /* Site index used by mmap API 2.1 and later files in place of the
+     * tree.  The end positions of the non-empty sequences are stored in
+     * Eytzinger order (the breadth-first layout of a complete binary search
+     * tree) in a one-based array, with the sequence indexes in a parallel
+     * array.  The end positions are aligned to a cache line, so the search
+     * can prefetch four levels ahead with one or two lines. */
+    class MMapGenomeSiteIndexData {
+      public:
+        size_t _numEntries;
+        size_t _endsOffset;
+        size_t _sequenceIndexesOffset;
+    };
+
     /**
      * MMap file structure used to map position in genome to specific
-     * sequence.  This builds a balance binary tree and stores it in the
-     * mmapped file for direct access.
+     * sequence.  This is either a balanced binary tree (mmap API before 2.1)
+     * or a site index, stored in the mmapped file for direct access.
      */
     class MMapGenomeSiteMap {
       public:
         /** Construct new object for accessing site map in HAL file.
          * If the hash table is being created, then gsmOffset
-         * should be MMAP_NULL_OFFSET.  */
-        MMapGenomeSiteMap(MMapFile *mmapFile, size_t gsmOffset) : _file(mmapFile), _gsmOffset(gsmOffset), _data(NULL) {
+         * should be MMAP_NULL_OFFSET.  If useSiteIndex is false,
+         * the binary tree used by older files is accessed. */
+        MMapGenomeSiteMap(MMapFile *mmapFile, size_t gsmOffset, bool useSiteIndex)
+            : _file(mmapFile), _gsmOffset(gsmOffset), _useSiteIndex(useSiteIndex), _data(NULL), _indexData(NULL),
+              _ends(NULL), _sequenceIndexes(NULL) {
             if (gsmOffset != MMAP_NULL_OFFSET) {
                 readGsm(gsmOffset);
             }
@@ -68,7 +84,10 @@ namespace hal {
         size_t build(const std::vector<MMapSequence *> &sequences);
 
         /** find the sequence index containing a position */
-        hal_index_t getSequenceIndexBySite(size_t position);
+        hal_index_t getSequenceIndexBySite(size_t position) const {
+            assert(_gsmOffset != MMAP_NULL_OFFSET);
+            return _useSiteIndex ? searchIndex(position) : searchTree(position);
+        }
 
         /** find the sequence containing a position */
         const Sequence *getSequenceBySite(hal_size_t position) const {
@@ -76,11 +95,19 @@ namespace hal {
         }
 
       private:
+        typedef std::vector<std::pair<size_t, hal_index_t>> IndexEntries;
         static size_t calcRequiredSpace(size_t numSequences);
         void readGsm(size_t gsmOffset);
         void createGsm(size_t numSequences);
         void loadTmpTree(const std::vector<MMapSequence *> &sequences, struct rb_tree *tmpTree, TmpTreeNodes &tmpTreeNodes);
         hal_index_t copyTree(struct rb_tree_node *tmpNode, int &nextNodeIdx);
+        size_t buildTree(const std::vector<MMapSequence *> &sequences);
+        hal_index_t searchTree(size_t position) const;
+        void readIndex(size_t gsmOffset);
+        void createIndex(size_t numEntries);
+        void copyIndex(const IndexEntries &entries, size_t &nextEntry, size_t eytzIndex);
+        size_t buildIndex(const std::vector<MMapSequence *> &sequences);
+        inline hal_index_t searchIndex(size_t position) const;
 
         /* returns null for NULL_INDEX */
         MMapGenomeSiteMapNode *getNodePtr(int nodeIndex) {
@@ -98,7 +125,28 @@ namespace hal {
 
         MMapFile *_file;
         size_t _gsmOffset;
+        bool _useSiteIndex;
         MMapGenomeSiteMapData *_data;
+        MMapGenomeSiteIndexData *_indexData;
+        size_t *_ends;
+        hal_index_t *_sequenceIndexes;
     };
+
+    /* Branch-free search for the first sequence ending after position.  The
+     * descent goes right whenever the end is at or before the position;
+     * afterwards, the trailing right turns plus the final left one are
+     * shifted off to get the node where the last left turn was made.  This
+     * is zero if there was no left turn, meaning the position is past the
+     * end of the genome. */
+    inline hal_index_t MMapGenomeSiteMap::searchIndex(size_t position) const {
+        size_t numEntries = _indexData->_numEntries;
+        size_t k = 1;
+        while (k <= numEntries) {
+            __builtin_prefetch(_ends + 16 * k);
+            k = 2 * k + (_ends[k] <= position);
+        }
+        k >>= __builtin_ffsll(~k);
+        return (k == 0) ? NULL_INDEX : _sequenceIndexes[k];
+    }
 }
 #endif
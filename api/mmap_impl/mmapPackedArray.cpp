@@ -0,0 +1,39 @@
+#include "mmapPackedArray.h"
+#include <algorithm>
+#include <cstring>
+
+/* allocate storage for length values of the given width, all zero */
+void hal::MMapPackedArrayData::allocate(MMapAlignment *alignment, size_t length, unsigned width) {
+    assert((width >= 1) && (width <= 64));
+    size_t size = getNumWords(length, width) * sizeof(uint64_t);
+    _offset = alignment->allocateNewArray(size);
+    memset(alignment->resolveOffset(_offset, size), 0, size);
+    _length = length;
+    _width = width;
+    _reserved = 0;
+}
+
+/* Copy to a new array with at least minWidth bits per value.  The width is
+ * rounded up to a byte boundary, so a column that slowly grows is only
+ * copied a few times. */
+void hal::MMapPackedArrayData::widen(MMapAlignment *alignment, unsigned minWidth) {
+    assert(minWidth > _width);
+    unsigned width = std::min(((minWidth + 7) / 8) * 8, 64u);
+    MMapPackedArrayData wider;
+    wider.allocate(alignment, _length, width);
+    for (size_t i = 0; i < _length; i++) {
+        wider.store(alignment, i, get(alignment, i));
+    }
+    *this = wider;
+}
+
+/* prefetch the words containing elements [first, end) */
+void hal::MMapPackedArrayData::prefetch(MMapFile *file, size_t first, size_t end) const {
+    end = std::min(end, _length);
+    if (first >= end) {
+        return;
+    }
+    size_t firstWord = (first * _width) / 64;
+    size_t endWord = ((end * _width) + 63) / 64 + 1;
+    file->prefetch(_offset + firstWord * sizeof(uint64_t), (endWord - firstWord) * sizeof(uint64_t));
+}
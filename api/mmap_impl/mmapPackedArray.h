@@ -0,0 +1,114 @@
+#ifndef _MMAPPACKEDARRAY_H
+#define _MMAPPACKEDARRAY_H
+#include "halSegmentColumns.h"
+#include "mmapAlignment.h"
+#include <cstdint>
+
+namespace hal {
+    /**
+     * Array of unsigned integers bit-packed at a fixed width, stored in the
+     * mmapped file.  This descriptor is embedded in another structure in the
+     * file; the packed words are allocated separately.  Storing a value that
+     * doesn't fit in the current width copies the array to a wider one,
+     * losing the old space in the file, much like MMapArray::grow().
+     */
+    class MMapPackedArrayData {
+      public:
+        /* allocate storage for length values of the given width, all zero */
+        void allocate(MMapAlignment *alignment, size_t length, unsigned width);
+
+        uint64_t get(const MMapAlignment *alignment, size_t index) const {
+            assert(index < _length);
+            size_t bit = index * _width;
+            unsigned shift = bit % 64;
+            const uint64_t *words = getWords(alignment, bit / 64);
+            uint64_t value = words[0] >> shift;
+            if (shift + _width > 64) {
+                value |= words[1] << (64 - shift);
+            }
+            return value & getMask();
+        }
+
+        void set(MMapAlignment *alignment, size_t index, uint64_t value) {
+            if (value > getMask()) {
+                widen(alignment, getBitWidth(value));
+            }
+            store(alignment, index, value);
+        }
+
+        /* widen the array if needed so values of minWidth bits can be
+         * stored without widening it again */
+        void reserveWidth(MMapAlignment *alignment, unsigned minWidth) {
+            if (minWidth > _width) {
+                widen(alignment, minWidth);
+            }
+        }
+
+        size_t getLength() const {
+            return _length;
+        }
+        unsigned getWidth() const {
+            return _width;
+        }
+        /* location and size of the words in the file */
+        size_t getOffset() const {
+            return _offset;
+        }
+        size_t getNumBytes() const {
+            return getNumWords(_length, _width) * sizeof(uint64_t);
+        }
+        /* view of the array for reading in place, which stays valid until
+         * the array is widened */
+        PackedColumnView getView(const MMapAlignment *alignment) const {
+            const uint64_t *words = static_cast<const uint64_t *>(alignment->resolveOffset(_offset, getNumBytes()));
+            return PackedColumnView(words, _length, _width);
+        }
+
+        /* prefetch the words containing elements [first, end) */
+        void prefetch(MMapFile *file, size_t first, size_t end) const;
+
+        /* number of bits needed to store value, minimum of one */
+        static unsigned getBitWidth(uint64_t value) {
+            unsigned width = 1;
+            while ((width < 64) && ((value >> width) != 0)) {
+                width++;
+            }
+            return width;
+        }
+
+      private:
+        uint64_t getMask() const {
+            return (_width == 64) ? ~uint64_t(0) : ((uint64_t(1) << _width) - 1);
+        }
+        /* get pointer to a word, with the following word also accessible */
+        uint64_t *getWords(const MMapAlignment *alignment, size_t wordIndex) const {
+            return static_cast<uint64_t *>(
+                alignment->resolveOffset(_offset + wordIndex * sizeof(uint64_t), 2 * sizeof(uint64_t)));
+        }
+        static size_t getNumWords(size_t length, unsigned width) {
+            // extra word so that two words can always be accessed
+            return ((length * width) + 63) / 64 + 1;
+        }
+        void store(MMapAlignment *alignment, size_t index, uint64_t value) {
+            assert(index < _length);
+            size_t bit = index * _width;
+            unsigned shift = bit % 64;
+            uint64_t *words = getWords(alignment, bit / 64);
+            uint64_t mask = getMask();
+            words[0] = (words[0] & ~(mask << shift)) | (value << shift);
+            if (shift + _width > 64) {
+                words[1] = (words[1] & ~(mask >> (64 - shift))) | (value >> (64 - shift));
+            }
+        }
+        void widen(MMapAlignment *alignment, unsigned minWidth);
+
+        size_t _offset;
+        size_t _length;
+        uint32_t _width;
+        uint32_t _reserved;
+    };
+}
+#endif
+// Local Variables:
+// mode: c++
+// End:
@@ -66,9 +66,17 @@ void MMapSequence::setString(const std::string &inString) {
 }
 
 void MMapSequence::getSubString(std::string &outString, hal_size_t start, hal_size_t length) const {
-    outString.resize(length);
-    DnaIteratorPtr dnaIt(getDnaIterator(start));
-    dnaIt->readString(outString, length);
+    PackedDnaSpan span;
+    getPackedDna(span, start, length);
+    span.unpack(outString);
+}
+
+void MMapSequence::getPackedDna(PackedDnaSpan &span, hal_size_t start, hal_size_t length) const {
+    if (start + length > getSequenceLength()) {
+        throw hal_exception("MMapSequence::getPackedDna: range (" + std::to_string(start) + ", " + std::to_string(length) +
+                            ") out of bounds for sequence " + getFullName());
+    }
+    _genome->getPackedDna(span, getStartPosition() + start, length);
 }
 
 void MMapSequence::setSubString(const std::string &inString, hal_size_t start, hal_size_t length) {
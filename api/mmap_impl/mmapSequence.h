@@ -109,6 +109,8 @@ namespace hal {
 
         void setSubString(const std::string &intString, hal_size_t start, hal_size_t length);
 
+        void getPackedDna(PackedDnaSpan &span, hal_size_t start, hal_size_t length) const;
+
         RearrangementPtr getRearrangement(hal_index_t position, hal_size_t gapLengthThreshold, double nThreshold,
                                           bool atomic = false) const;
 
@@ -10,8 +10,8 @@ void MMapTopSegment::setCoordinates(hal_index_t startPos, hal_size_t length) {
         throw hal_exception("Trying to set top segment coordinate out of range");
     }
 
-    _data->setStartPosition(startPos);
-    (_data + 1)->setStartPosition(startPos + length);
+    getMMapGenome()->setTopStartPosition(_index, startPos);
+    getMMapGenome()->setTopStartPosition(_index + 1, startPos + length);
 }
 
 hal_offset_t MMapTopSegment::getBottomParseOffset() const {
@@ -4,24 +4,21 @@
 #include "halGenome.h"
 #include "halTopSegment.h"
 #include "mmapGenome.h"
-#include "mmapTopSegmentData.h"
 
 namespace hal {
     class MMapTopSegment : public TopSegment {
       public:
-        MMapTopSegment(MMapGenome *genome, hal_index_t arrayIndex)
-            : TopSegment(genome, arrayIndex), _data(getMMapGenome()->getTopSegmentPointer(arrayIndex)) {
+        MMapTopSegment(MMapGenome *genome, hal_index_t arrayIndex) : TopSegment(genome, arrayIndex) {
         }
 
         // SEGMENT INTERFACE
         void setArrayIndex(Genome *genome, hal_index_t arrayIndex) {
             _genome = genome;
-            _data = getMMapGenome()->getTopSegmentPointer(arrayIndex);
             _index = arrayIndex;
         }
         const Sequence *getSequence() const;
         hal_index_t getStartPosition() const {
-            return _data->getStartPosition();
+            return getMMapGenome()->getTopStartPosition(_index);
         };
         hal_index_t getEndPosition() const;
         hal_size_t getLength() const;
@@ -33,32 +30,32 @@ namespace hal {
 
         // TOP SEGMENT INTERFACE
         hal_index_t getParentIndex() const {
-            return _data->getParentIndex();
+            return getMMapGenome()->getTopParentIndex(_index);
         };
         bool hasParent() const;
         void setParentIndex(hal_index_t parIdx) {
-            _data->setParentIndex(parIdx);
+            getMMapGenome()->setTopParentIndex(_index, parIdx);
         };
         bool getParentReversed() const {
-            return _data->getReversed();
+            return getMMapGenome()->getTopParentReversed(_index);
         };
         void setParentReversed(bool isReversed) {
-            _data->setReversed(isReversed);
+            getMMapGenome()->setTopParentReversed(_index, isReversed);
         };
         hal_index_t getBottomParseIndex() const {
-            return _data->getBottomParseIndex();
+            return getMMapGenome()->getTopBottomParseIndex(_index);
         };
         void setBottomParseIndex(hal_index_t botParseIdx) {
-            _data->setBottomParseIndex(botParseIdx);
+            getMMapGenome()->setTopBottomParseIndex(_index, botParseIdx);
         };
         hal_offset_t getBottomParseOffset() const;
         bool hasParseDown() const;
         hal_index_t getNextParalogyIndex() const {
-            return _data->getNextParalogyIndex();
+            return getMMapGenome()->getTopNextParalogyIndex(_index);
         }
         bool hasNextParalogy() const;
         void setNextParalogyIndex(hal_index_t parIdx) {
-            _data->setNextParalogyIndex(parIdx);
+            getMMapGenome()->setTopNextParalogyIndex(_index, parIdx);
         };
         hal_index_t getLeftParentIndex() const;
         hal_index_t getRightParentIndex() const;
@@ -68,7 +65,6 @@ namespace hal {
         MMapGenome *getMMapGenome() const {
             return static_cast<MMapGenome *>(_genome);
         }
-        MMapTopSegmentData *_data;
     };
 
     inline hal_index_t MMapTopSegment::getEndPosition() const {
@@ -76,7 +72,7 @@ namespace hal {
     }
 
     inline hal_size_t MMapTopSegment::getLength() const {
-        return (_data + 1)->getStartPosition() - _data->getStartPosition();
+        return getMMapGenome()->getTopStartPosition(_index + 1) - getStartPosition();
     }
 
     inline const Sequence *MMapTopSegment::getSequence() const {
@@ -1,7 +1,9 @@
 #ifndef _MMAPTOPSEGMENTDATA_H
 #define _MMAPTOPSEGMENTDATA_H
+#include "mmapPackedArray.h"
 
 namespace hal {
+    /* Top segment record, mmap API 1.x files store an array of these. */
     class MMapTopSegmentData {
       public:
         void setStartPosition(hal_index_t startPosition) {
@@ -43,6 +45,19 @@ namespace hal {
         hal_index_t _parentIndex;
         bool _reversed;
     };
+
+    /* Top segments stored as columns in mmap API 2.x files.  Each column has
+     * one more element than the number of segments; the start position of
+     * the extra one gives the length of the last segment.  Indices are
+     * stored plus one, so NULL_INDEX is zero. */
+    class MMapTopSegmentColumns {
+      public:
+        MMapPackedArrayData _startPosition;
+        MMapPackedArrayData _bottomParseIndex;
+        MMapPackedArrayData _paralogyIndex;
+        MMapPackedArrayData _parentIndex;
+        MMapPackedArrayData _reversed;
+    };
 }
 #endif
 // Local Variables:
@@ -6,10 +6,12 @@
  */
 
 #include "halApiTestSupport.h"
+#include "hal.h"
 #include "halAlignmentInstance.h"
 #include <H5Cpp.h>
 #include <iostream>
 #include <cstdlib>
+#include <sstream>
 #include <unistd.h>
 
 
@@ -27,9 +29,9 @@ Alignment *getTestAlignmentInstances(const std::string &storageFormat, const std
                                      hdf5DefaultDSetCreatPropList());
 
     } else if (storageFormat == hal::STORAGE_FORMAT_MMAP) {
-        // We use a default init size of only 1GiB here, because the test
-        // alignments we create are relatively small.
-        return mmapAlignmentInstance(alignmentPath, mode, 1024 * 1024 * 1024);
+        // We use a tiny initial size here, so that the tests exercise
+        // growing the file.
+        return mmapAlignmentInstance(alignmentPath, mode, 64 * 1024);
     } else {
         throw hal_exception("invalid storage format: " + storageFormat);
     }
@@ -61,6 +63,60 @@ int runHalTestSuite(int argc, char *argv[], CuSuite *suite) {
 
 }
 
+vector<string> getGenomeNames(const Alignment *alignment) {
+    vector<string> names(1, alignment->getRootName());
+    for (size_t i = 0; i < names.size(); i++) {
+        vector<string> childNames = alignment->getChildNames(names[i]);
+        names.insert(names.end(), childNames.begin(), childNames.end());
+    }
+    return names;
+}
+
+string describeGenome(const Genome *genome) {
+    ostringstream out;
+    out << genome->getName() << " " << genome->getNumSequences() << " " << genome->getSequenceLength() << "\n";
+    for (SequenceIteratorPtr seqIt = genome->getSequenceIterator(); not seqIt->atEnd(); seqIt->toNext()) {
+        const Sequence *sequence = seqIt->getSequence();
+        out << sequence->getName() << "," << sequence->getStartPosition() << "," << sequence->getSequenceLength() << ","
+            << sequence->getNumTopSegments() << "," << sequence->getNumBottomSegments() << " ";
+    }
+    out << "\n";
+    string dna;
+    genome->getString(dna);
+    out << dna << "\n";
+    for (TopSegmentIteratorPtr topIt = genome->getTopSegmentIterator(); not topIt->atEnd(); topIt->toRight()) {
+        const TopSegment *tseg = topIt->tseg();
+        out << tseg->getStartPosition() << "," << tseg->getLength() << "," << tseg->getParentIndex() << ","
+            << tseg->getParentReversed() << "," << tseg->getBottomParseIndex() << "," << tseg->getNextParalogyIndex() << " ";
+    }
+    out << "\n";
+    for (BottomSegmentIteratorPtr botIt = genome->getBottomSegmentIterator(); not botIt->atEnd(); botIt->toRight()) {
+        const BottomSegment *bseg = botIt->bseg();
+        out << bseg->getStartPosition() << "," << bseg->getLength() << "," << bseg->getTopParseIndex();
+        for (hal_size_t child = 0; child < bseg->getNumChildren(); child++) {
+            out << "," << bseg->getChildIndex(child) << "," << bseg->getChildReversed(child);
+        }
+        out << " ";
+    }
+    out << "\n";
+    const map<string, string> &meta = genome->getMetaData()->getMap();
+    for (map<string, string>::const_iterator i = meta.begin(); i != meta.end(); ++i) {
+        out << i->first << "=" << i->second << " ";
+    }
+    out << "\n";
+    return out.str();
+}
+
+string describeAlignment(const Alignment *alignment) {
+    string description;
+    for (const string &name : getGenomeNames(alignment)) {
+        const Genome *genome = alignment->openGenome(name);
+        description += describeGenome(genome);
+        alignment->closeGenome(genome);
+    }
+    return description;
+}
+
 string AlignmentTest::randomString(hal_size_t length) {
     string s;
     s.resize(length);
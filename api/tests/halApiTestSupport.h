@@ -24,6 +24,20 @@ Alignment *getTestAlignmentInstances(const string &storageFormat, const string &
  * return exit code  */
 int runHalTestSuite(int argc, char *argv[], CuSuite *suite);
 
+/** names of all the genomes of an alignment, parents before children,
+ * without opening any genomes */
+vector<string> getGenomeNames(const Alignment *alignment);
+
+/** dump everything a reader can get from a genome: its sequences, DNA,
+ * every field of every top and bottom segment, and its metadata.  Reads
+ * every array of the genome, so two dumps only match if all the arrays
+ * read the same. */
+string describeGenome(const Genome *genome);
+
+/** describeGenome of every genome of an alignment, in getGenomeNames
+ * order, opening and closing each genome */
+string describeAlignment(const Alignment *alignment);
+
 /* Base class for alignment tests.  Handles setup of test HAL and has required
  * methods. */
 class AlignmentTest {
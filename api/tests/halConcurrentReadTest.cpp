@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halApiTestSupport.h"
+#include "halRandNumberGen.h"
+#include "halRandomData.h"
+#include "hal.h"
+#include <sstream>
+#include <thread>
+
+using namespace std;
+using namespace hal;
+
+static RandNumberGen rng;
+static const size_t NUM_THREADS = 8;
+
+/* summarize everything a reader can get from a genome: sequences, DNA,
+ * segments, and the mapping of each top segment up to the root */
+static string readGenome(const Alignment *alignment, const string &name) {
+    ostringstream out;
+    const Genome *genome = alignment->openGenome(name);
+    const Genome *root = alignment->openGenome(alignment->getRootName());
+    out << genome->getNumSequences() << " " << genome->getSequenceLength() << " " << genome->getNumChildren() << "\n";
+    for (SequenceIteratorPtr seqIt = genome->getSequenceIterator(); not seqIt->atEnd(); seqIt->toNext()) {
+        const Sequence *sequence = seqIt->getSequence();
+        out << sequence->getName() << " " << sequence->getStartPosition() << " " << sequence->getSequenceLength() << " "
+            << (genome->getSequence(sequence->getName()) == sequence) << "\n";
+    }
+    string dna;
+    genome->getString(dna);
+    out << dna << "\n";
+    DnaIteratorPtr dnaIt = genome->getDnaIterator(0);
+    for (hal_size_t i = 0; i < genome->getSequenceLength(); i += 7, dnaIt->jumpTo(i)) {
+        out << dnaIt->getBase();
+    }
+    out << "\n";
+
+    string segmentDna;
+    for (TopSegmentIteratorPtr topIt = genome->getTopSegmentIterator(); not topIt->atEnd(); topIt->toRight()) {
+        topIt->getString(segmentDna);
+        out << topIt->tseg()->getParentIndex() << " " << topIt->tseg()->getParentReversed() << " "
+            << topIt->tseg()->getSequence()->getName() << " " << segmentDna << "\n";
+        if (genome != root) {
+            MappedSegmentSet results;
+            halMapSegmentSP(topIt, results, root, NULL, false);
+            for (const MappedSegmentPtr &mapped : results) {
+                out << " " << mapped->getStartPosition() << "," << mapped->getLength() << "," << mapped->getReversed();
+            }
+            out << "\n";
+        }
+    }
+    for (BottomSegmentIteratorPtr botIt = genome->getBottomSegmentIterator(); not botIt->atEnd(); botIt->toRight()) {
+        for (hal_size_t i = 0; i < botIt->bseg()->getNumChildren(); i++) {
+            out << botIt->bseg()->getChildIndex(i) << " ";
+            if (botIt->bseg()->hasChild(i)) {
+                out << genome->getChild(i)->getName() << " ";
+            }
+        }
+        out << "\n";
+    }
+    if (genome->getParent() != NULL) {
+        out << genome->getParent()->getName() << "\n";
+    }
+    return out.str();
+}
+
+struct ConcurrentReadTest : public AlignmentTest {
+    void createCallBack(Alignment *alignment) {
+        createRandomAlignment(rng, alignment, 1.5, 0.5, 10, 15, 10, 300, 20, 200);
+    }
+
+    void checkCallBack(const Alignment *alignment) {
+        if (not alignment->supportsConcurrentReads()) {
+            return;
+        }
+        vector<string> names = getGenomeNames(alignment);
+
+        // each thread reads every genome starting at a different one, so
+        // that genomes and their caches are first opened concurrently
+        vector<vector<string>> results(NUM_THREADS, vector<string>(names.size()));
+        vector<string> errors(NUM_THREADS);
+        vector<thread> threads;
+        for (size_t t = 0; t < NUM_THREADS; t++) {
+            threads.push_back(thread([&, t]() {
+                try {
+                    for (size_t i = 0; i < names.size(); i++) {
+                        size_t g = (i + t) % names.size();
+                        results[t][g] = readGenome(alignment, names[g]);
+                    }
+                } catch (const exception &e) {
+                    errors[t] = e.what();
+                }
+            }));
+        }
+        for (thread &th : threads) {
+            th.join();
+        }
+
+        for (size_t t = 0; t < NUM_THREADS; t++) {
+            CuAssertStrEquals(_testCase, "", errors[t].c_str());
+        }
+        for (size_t g = 0; g < names.size(); g++) {
+            string expected = readGenome(alignment, names[g]);
+            for (size_t t = 0; t < NUM_THREADS; t++) {
+                CuAssertTrue(_testCase, results[t][g] == expected);
+            }
+        }
+    }
+};
+
+static void halConcurrentReadTest(CuTest *testCase) {
+    ConcurrentReadTest tester;
+    tester.check(testCase);
+}
+
+static CuSuite *halConcurrentReadTestSuite(void) {
+    CuSuite *suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, halConcurrentReadTest);
+    return suite;
+}
+
+int main(int argc, char *argv[]) {
+    return runHalTestSuite(argc, argv, halConcurrentReadTestSuite());
+}
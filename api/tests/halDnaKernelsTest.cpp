@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halApiTestSupport.h"
+#include "halCommon.h"
+#include <vector>
+
+using namespace std;
+using namespace hal;
+
+static const DnaKernelLevel kernelLevels[] = {DNA_KERNEL_SCALAR, DNA_KERNEL_SSE4, DNA_KERNEL_AVX2};
+
+/* random packed DNA using all valid codes */
+static vector<unsigned char> randomPacked(size_t numBytes) {
+    static const uint8_t codes[] = {0, 1, 2, 3, 4, 8, 9, 10, 11, 12};
+    vector<unsigned char> packed(numBytes);
+    for (unsigned char &b : packed) {
+        b = (codes[rand() % 10] << 4) | codes[rand() % 10];
+    }
+    return packed;
+}
+
+/* compare the bulk functions against per-base decoding at every kernel
+ * level the CPU supports */
+static void halDnaKernelsUnpackTest(CuTest *testCase) {
+    DnaKernelLevel savedLevel = getDnaKernelLevel();
+    srand(7);
+    vector<unsigned char> packed = randomPacked(1000);
+    string expected, expectedRevComp;
+    for (size_t i = 0; i < packed.size() * 2; i++) {
+        expected += dnaUnpack(i, packed[i / 2]);
+    }
+    for (DnaKernelLevel level : kernelLevels) {
+        if (setDnaKernelLevel(level) != level) {
+            continue;
+        }
+        for (hal_size_t offset : {0, 1, 2, 3, 31, 32, 33, 64, 65}) {
+            for (hal_size_t length : {0, 1, 2, 3, 15, 16, 31, 32, 33, 63, 64, 65, 127, 128, 129, 500, 1935}) {
+                string unpacked(length, '?');
+                dnaUnpackString(packed.data(), offset, length, &unpacked[0]);
+                CuAssertTrue(testCase, unpacked == expected.substr(offset, length));
+                expectedRevComp = expected.substr(offset, length);
+                reverseComplement(expectedRevComp);
+                dnaUnpackReverseComplement(packed.data(), offset, length, &unpacked[0]);
+                CuAssertTrue(testCase, unpacked == expectedRevComp);
+            }
+        }
+
+        // in-place reverse complement, including characters that aren't bases
+        static const char chars[] = "acgtnACGTNxX.*";
+        for (size_t length : {0, 1, 2, 17, 31, 32, 33, 63, 64, 65, 1001}) {
+            string s;
+            for (size_t i = 0; i < length; i++) {
+                s += chars[rand() % (sizeof(chars) - 1)];
+            }
+            string revComp(s.rbegin(), s.rend());
+            for (char &c : revComp) {
+                c = reverseComplement(c);
+            }
+            dnaReverseComplement(&s[0], s.length());
+            CuAssertTrue(testCase, s == revComp);
+        }
+    }
+    setDnaKernelLevel(savedLevel);
+}
+
+/* gapped strings keep their gaps in place */
+static void halDnaKernelsGappedReverseComplementTest(CuTest *testCase) {
+    string s = "AC--gTn-";
+    reverseComplement(s);
+    CuAssertTrue(testCase, s == "nA--cGT-");
+}
+
+static CuSuite *halDnaKernelsTestSuite(void) {
+    CuSuite *suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, halDnaKernelsUnpackTest);
+    SUITE_ADD_TEST(suite, halDnaKernelsGappedReverseComplementTest);
+    return suite;
+}
+
+int main(int argc, char *argv[]) {
+    return runHalTestSuite(argc, argv, halDnaKernelsTestSuite());
+}
@@ -144,6 +144,105 @@ struct GenomeStringTest : public AlignmentTest {
     }
 };
 
+struct GenomePrefetchTest : public GenomeStringTest {
+    void checkCallBack(const Alignment *alignment) {
+        const Genome *ancGenome = alignment->openGenome("AncGenome");
+        hal_size_t seqLength = ancGenome->getSequenceLength();
+        alignment->adviseRandom();
+        ancGenome->prefetchRange(0, seqLength);
+        ancGenome->prefetchRange(seqLength - 1, 100); // clipped to end
+        ancGenome->prefetchRange(seqLength, 100);     // ignored
+        ancGenome->prefetchRange(12345, 0);           // ignored
+        ancGenome->prefetchRange(1001, 999);
+        string genomeString;
+        ancGenome->getSubString(genomeString, 1001, 999);
+        CuAssertTrue(_testCase, genomeString == _string.substr(1001, 999));
+        alignment->adviseSequential();
+        ancGenome->getString(genomeString);
+        CuAssertTrue(_testCase, genomeString == _string);
+    }
+};
+
+struct GenomePackedDnaTest : public GenomeStringTest {
+    void checkRange(const Genome *genome, hal_size_t start, hal_size_t length) {
+        PackedDnaSpan span;
+        genome->getPackedDna(span, start, length);
+        CuAssertTrue(_testCase, span.getLength() == length);
+        CuAssertTrue(_testCase, span.isOdd() == bool(start & 1));
+        string expected = _string.substr(start, length);
+        string unpacked;
+        span.unpack(unpacked);
+        CuAssertTrue(_testCase, unpacked == expected);
+        if (length > 0) {
+            CuAssertTrue(_testCase, span.getBase(0) == expected[0]);
+            CuAssertTrue(_testCase, span.getBase(length - 1) == expected[length - 1]);
+        }
+        reverseComplement(expected);
+        span.unpackReverseComplement(unpacked);
+        CuAssertTrue(_testCase, unpacked == expected);
+    }
+
+    void checkCallBack(const Alignment *alignment) {
+        const Genome *ancGenome = alignment->openGenome("AncGenome");
+        hal_size_t seqLength = ancGenome->getSequenceLength();
+        for (hal_size_t start : {0, 1, 2, 3, 1000001, 4000000}) {
+            for (hal_size_t length : {0, 1, 2, 3, 4, 5, 997, 1000000, 3000001}) {
+                checkRange(ancGenome, start, length);
+            }
+        }
+        checkRange(ancGenome, seqLength - 1, 1);
+        checkRange(ancGenome, 0, seqLength);
+
+        const Sequence *sequence = ancGenome->getSequence("Sequence");
+        PackedDnaSpan span;
+        sequence->getPackedDna(span, 3, 10);
+        string unpacked;
+        span.unpack(unpacked);
+        CuAssertTrue(_testCase, unpacked == _string.substr(3, 10));
+        try {
+            ancGenome->getPackedDna(span, seqLength - 1, 2);
+            CuFail(_testCase, "expected out of range exception");
+        } catch (const hal_exception &e) {
+        }
+    }
+};
+
+struct GenomeSequencesBySitesTest : public AlignmentTest {
+    void createCallBack(Alignment *alignment) {
+        Genome *ancGenome = alignment->addRootGenome("AncGenome", 0);
+        vector<Sequence::Info> seqVec;
+        // include empty sequences, which never contain a site
+        for (size_t i = 0; i < 500; i++) {
+            hal_size_t length = ((i % 7) == 3) ? 0 : 1 + ((i * 7919) % 211);
+            seqVec.push_back(Sequence::Info("Sequence" + std::to_string(i), length, 0, 0));
+        }
+        ancGenome->setDimensions(seqVec, false);
+    }
+
+    void checkCallBack(const Alignment *alignment) {
+        const Genome *ancGenome = alignment->openGenome("AncGenome");
+        hal_size_t genomeLength = ancGenome->getSequenceLength();
+        vector<hal_size_t> positions;
+        for (hal_size_t pos = 0; pos < genomeLength + 3; pos++) {
+            positions.push_back(pos);
+        }
+        vector<const Sequence *> sequences;
+        ancGenome->getSequencesBySites(positions, sequences);
+        CuAssertTrue(_testCase, sequences.size() == positions.size());
+        for (size_t i = 0; i < positions.size(); i++) {
+            const Sequence *sequence = ancGenome->getSequenceBySite(positions[i]);
+            CuAssertTrue(_testCase, sequences[i] == sequence);
+            if (positions[i] < genomeLength) {
+                CuAssertTrue(_testCase, sequence != NULL);
+                CuAssertTrue(_testCase, positions[i] >= (hal_size_t)sequence->getStartPosition());
+                CuAssertTrue(_testCase, positions[i] < sequence->getStartPosition() + sequence->getSequenceLength());
+            } else {
+                CuAssertTrue(_testCase, sequence == NULL);
+            }
+        }
+    }
+};
+
 struct GenomeCopyTest : public AlignmentTest {
     std::string _path;
     AlignmentPtr _secondAlignment;
@@ -556,6 +655,21 @@ static void halGenomeStringTest(CuTest *testCase) {
     tester.check(testCase);
 }
 
+static void halGenomePrefetchTest(CuTest *testCase) {
+    GenomePrefetchTest tester;
+    tester.check(testCase);
+}
+
+static void halGenomePackedDnaTest(CuTest *testCase) {
+    GenomePackedDnaTest tester;
+    tester.check(testCase);
+}
+
+static void halGenomeSequencesBySitesTest(CuTest *testCase) {
+    GenomeSequencesBySitesTest tester;
+    tester.check(testCase);
+}
+
 static void halGenomeCopyTest(CuTest *testCase) {
     GenomeCopyTest tester;
     tester.check(testCase);
@@ -578,6 +692,9 @@ static CuSuite *halGenomeTestSuite(void) {
     SUITE_ADD_TEST(suite, halGenomeCreateTest);
     SUITE_ADD_TEST(suite, halGenomeUpdateTest);
     SUITE_ADD_TEST(suite, halGenomeStringTest);
+    SUITE_ADD_TEST(suite, halGenomePrefetchTest);
+    SUITE_ADD_TEST(suite, halGenomePackedDnaTest);
+    SUITE_ADD_TEST(suite, halGenomeSequencesBySitesTest);
     SUITE_ADD_TEST(suite, halGenomeCopyTest);
     SUITE_ADD_TEST(suite, halGenomeCopySegmentsWhenSequencesOutOfOrderTest);
     SUITE_ADD_TEST(suite, halGenomeDNAPackUnpackTest);
@@ -0,0 +1,300 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halApiTestSupport.h"
+#include "halRandNumberGen.h"
+#include "halRandomData.h"
+#include "hal.h"
+#include "hdf5Alignment.h"
+#include "hdf5ChunkCache.h"
+#include "hdf5ExternalArray.h"
+#include <H5Cpp.h>
+#include <sstream>
+#include <unistd.h>
+
+using namespace std;
+using namespace hal;
+
+static RandNumberGen rng;
+
+static Hdf5ChunkCache::ChunkPtr makeChunk(size_t numBytes, char value) {
+    return Hdf5ChunkCache::ChunkPtr(new vector<char>(numBytes, value));
+}
+
+/* least recently used chunks are evicted to stay under the limit */
+static void halHdf5ChunkCacheLruTest(CuTest *testCase) {
+    Hdf5ChunkCache cache(100);
+    size_t a = cache.registerArray();
+    size_t b = cache.registerArray();
+    CuAssertTrue(testCase, a != b);
+
+    Hdf5ChunkCache::ChunkPtr held = makeChunk(40, 'a');
+    cache.insert(a, 0, held);
+    cache.insert(a, 1, makeChunk(40, 'b'));
+    CuAssertIntEquals(testCase, 80, cache.getNumBytes());
+    CuAssertTrue(testCase, cache.find(b, 0) == NULL);
+    CuAssertTrue(testCase, cache.find(a, 0) == held);
+
+    // chunk 1 is now the least recently used
+    cache.insert(b, 0, makeChunk(40, 'c'));
+    CuAssertTrue(testCase, cache.find(a, 1) == NULL);
+    CuAssertTrue(testCase, cache.find(a, 0) == held);
+    CuAssertIntEquals(testCase, 80, cache.getNumBytes());
+    CuAssertIntEquals(testCase, 1, cache.getNumEvictions());
+    CuAssertIntEquals(testCase, 2, cache.getNumHits());
+    CuAssertIntEquals(testCase, 2, cache.getNumMisses());
+
+    // chunks larger than the cache aren't kept
+    cache.insert(b, 1, makeChunk(101, 'd'));
+    CuAssertTrue(testCase, cache.find(b, 1) == NULL);
+    CuAssertIntEquals(testCase, 80, cache.getNumBytes());
+
+    // evicted chunks stay valid while held
+    cache.setMaxBytes(40);
+    CuAssertTrue(testCase, cache.find(b, 0) == NULL);
+    CuAssertTrue(testCase, (*held)[39] == 'a');
+
+    cache.removeArray(a);
+    CuAssertIntEquals(testCase, 0, cache.getNumBytes());
+    CuAssertIntEquals(testCase, 80, cache.getPeakBytes());
+    CuAssertTrue(testCase, cache.find(a, 0) == NULL);
+}
+
+/* mapped images are cached and evicted like other chunks, by their size */
+static void halHdf5ChunkCacheMappedTest(CuTest *testCase) {
+    Hdf5ChunkCache cache(100);
+    size_t a = cache.registerArray();
+    static const char image[60] = "mapped";
+    size_t numUnmapped = 0;
+    Hdf5ChunkCache::MappedChunkPtr mapped(image, [&numUnmapped](const char *) { numUnmapped++; });
+    cache.insertMapped(a, 0, mapped, sizeof(image));
+    cache.insert(a, 1, makeChunk(30, 'a'));
+    mapped.reset();
+    CuAssertIntEquals(testCase, 90, cache.getNumBytes());
+
+    Hdf5ChunkCache::MappedChunkPtr found;
+    CuAssertTrue(testCase, cache.find(a, 0, &found) == NULL);
+    CuAssertTrue(testCase, found.get() == image);
+    CuAssertTrue(testCase, cache.find(a, 1, &found) != NULL);
+    CuAssertTrue(testCase, found == NULL);
+    CuAssertTrue(testCase, cache.find(a, 2, &found) == NULL);
+    CuAssertTrue(testCase, found == NULL);
+
+    // chunk 0 is the least recently used, and is unmapped once evicted
+    cache.insert(a, 2, makeChunk(30, 'b'));
+    CuAssertIntEquals(testCase, 60, cache.getNumBytes());
+    CuAssertTrue(testCase, cache.find(a, 0, &found) == NULL);
+    CuAssertTrue(testCase, found == NULL);
+    CuAssertIntEquals(testCase, 1, numUnmapped);
+}
+
+/* read every genome twice, so that arrays go back to chunks they have
+ * read before */
+static string readAlignment(const Alignment *alignment) {
+    return describeAlignment(alignment) + describeAlignment(alignment);
+}
+
+/* create a random alignment with small chunks, so arrays have many */
+static void createChunkedAlignment(const string &path, bool shuffle, RandNumberGen &rng = ::rng) {
+    H5::DSetCreatPropList dcprops;
+    dcprops.copy(hdf5DefaultDSetCreatPropList());
+    hsize_t chunkSize = 10;
+    dcprops.setChunk(1, &chunkSize);
+    if (shuffle) {
+        dcprops.setShuffle();
+        dcprops.setDeflate(2);
+    }
+    AlignmentPtr alignment(hdf5AlignmentInstance(path, CREATE_ACCESS, hdf5DefaultFileCreatPropList(),
+                                                 hdf5DefaultFileAccPropList(), dcprops));
+    createRandomAlignment(rng, alignment.get(), 1.5, 0.5, 5, 8, 10, 300, 20, 200);
+    alignment->close();
+}
+
+static Alignment *openChunkedAlignment(const string &path, size_t cacheBytes, hsize_t readAheadBuffers) {
+    H5::FileAccPropList aprops;
+    aprops.copy(hdf5DefaultFileAccPropList());
+    aprops.setCache(Hdf5Alignment::DefaultCacheMDCElems, Hdf5Alignment::DefaultCacheRDCElems, cacheBytes,
+                    Hdf5Alignment::DefaultCacheW0);
+    Hdf5Alignment *alignment = dynamic_cast<Hdf5Alignment *>(
+        hdf5AlignmentInstance(path, READ_ACCESS, hdf5DefaultFileCreatPropList(), aprops, hdf5DefaultDSetCreatPropList()));
+    alignment->setReadAheadBuffers(readAheadBuffers);
+    return alignment;
+}
+
+/* an alignment reads the same with any cache size, and the cache stays
+ * within its limit */
+static void halHdf5ChunkCacheAlignmentTest(CuTest *testCase) {
+    string path = getTempFile();
+    createChunkedAlignment(path, false);
+
+    string expected;
+    const size_t cacheSizes[] = {0, 2000, 100000000};
+    for (size_t cacheBytes : cacheSizes) {
+        AlignmentPtr alignment(openChunkedAlignment(path, cacheBytes, 0));
+        string result = readAlignment(alignment.get());
+        if (expected.empty()) {
+            expected = result;
+        }
+        CuAssertTrue(testCase, result == expected);
+
+        const Hdf5ChunkCache *cache = dynamic_cast<Hdf5Alignment *>(alignment.get())->getChunkCache();
+        CuAssertTrue(testCase, cache->getPeakBytes() <= cacheBytes);
+        if (cacheBytes == 0) {
+            CuAssertIntEquals(testCase, 0, cache->getNumHits());
+        } else {
+            CuAssertTrue(testCase, cache->getNumHits() > 0);
+        }
+        if (cacheBytes > 100000) {
+            // everything fits, so nothing is read twice
+            CuAssertIntEquals(testCase, 0, cache->getNumEvictions());
+        }
+    }
+    ::unlink(path.c_str());
+}
+
+/* chunks read ahead and decoded on the thread pool, with or without the
+ * shuffle filter, read the same as chunks read normally */
+static void halHdf5ChunkCacheReadAheadTest(CuTest *testCase) {
+    ThreadPool::setSharedNumThreads(4);
+    for (bool shuffle : {false, true}) {
+        string path = getTempFile();
+        createChunkedAlignment(path, shuffle);
+        string expected;
+        {
+            AlignmentPtr alignment(openChunkedAlignment(path, 0, 0));
+            expected = readAlignment(alignment.get());
+        }
+        const size_t cacheSizes[] = {0, 100000000};
+        for (size_t cacheBytes : cacheSizes) {
+            AlignmentPtr alignment(openChunkedAlignment(path, cacheBytes, 3));
+            CuAssertTrue(testCase, readAlignment(alignment.get()) == expected);
+            const Hdf5ChunkCache *cache = dynamic_cast<Hdf5Alignment *>(alignment.get())->getChunkCache();
+            CuAssertTrue(testCase, cache->getNumReadAheadUsed() > 0);
+            CuAssertTrue(testCase, cache->getNumReadAheadUsed() <= cache->getNumReadAhead());
+        }
+        ::unlink(path.c_str());
+    }
+    ThreadPool::setSharedNumThreads(1);
+}
+
+/* a chunk that was never written is read normally, and the buffers after it
+ * are still read ahead */
+static void halHdf5ChunkCacheReadAheadUnwrittenTest(CuTest *testCase) {
+#if H5_VERSION_GE(1, 10, 3)
+    static const hsize_t chunkSize = 10, numChunks = 10, unwrittenChunk = 3;
+    string path = getTempFile();
+    {
+        H5::H5File file(path, H5F_ACC_TRUNC);
+        H5::DSetCreatPropList dcprops;
+        dcprops.setChunk(1, &chunkSize);
+        dcprops.setDeflate(2);
+        hsize_t size = chunkSize * numChunks;
+        H5::DataSpace dataSpace(1, &size);
+        H5::DataSet dataSet = file.createDataSet("array", H5::PredType::NATIVE_UINT8, dataSpace, dcprops);
+        for (hsize_t chunk = 0; chunk < numChunks; chunk++) {
+            if (chunk != unwrittenChunk) {
+                vector<unsigned char> data(chunkSize, (unsigned char)(chunk + 1));
+                hsize_t start = chunk * chunkSize;
+                dataSpace.selectHyperslab(H5S_SELECT_SET, &chunkSize, &start);
+                dataSet.write(data.data(), H5::PredType::NATIVE_UINT8, H5::DataSpace(1, &chunkSize), dataSpace);
+            }
+        }
+    }
+    ThreadPool::setSharedNumThreads(4);
+    {
+        H5::H5File file(path, H5F_ACC_RDONLY);
+        Hdf5ChunkCache cache(100000);
+        Hdf5ExternalArray array;
+        array.load(&file, "array", 1, &cache, 4);
+        for (hsize_t i = 0; i < chunkSize * numChunks; i++) {
+            hsize_t chunk = i / chunkSize;
+            CuAssertIntEquals(testCase, (chunk == unwrittenChunk) ? 0 : chunk + 1, *(const unsigned char *)array.get(i));
+        }
+        IoStats stats;
+        array.getIoStats(stats, "genome", "array");
+        // all but the unwritten buffer and the first two, read before the
+        // access is seen to be sequential
+        CuAssertIntEquals(testCase, numChunks - 3, stats.get("genome", "array", "readAheadHits"));
+    }
+    ThreadPool::setSharedNumThreads(1);
+    ::unlink(path.c_str());
+#endif
+}
+
+/* the raw (compressed) chunks of the chunked datasets in each genome group
+ * of an alignment file */
+static string readRawChunks(const string &path) {
+    string chunks;
+#if H5_VERSION_GE(1, 10, 3)
+    H5::H5File file(path, H5F_ACC_RDONLY);
+    for (hsize_t i = 0; i < file.getNumObjs(); i++) {
+        if (file.getObjTypeByIdx(i) != H5G_GROUP) {
+            continue;
+        }
+        H5::Group group = file.openGroup(file.getObjnameByIdx(i));
+        for (hsize_t j = 0; j < group.getNumObjs(); j++) {
+            if (group.getObjTypeByIdx(j) != H5G_DATASET) {
+                continue;
+            }
+            H5::DataSet dataSet = group.openDataSet(group.getObjnameByIdx(j));
+            H5::DSetCreatPropList cparms = dataSet.getCreatePlist();
+            if (cparms.getLayout() != H5D_CHUNKED) {
+                continue;
+            }
+            hsize_t chunkSize, size;
+            cparms.getChunk(1, &chunkSize);
+            dataSet.getSpace().getSimpleExtentDims(&size, NULL);
+            for (hsize_t offset = 0; offset < size; offset += chunkSize) {
+                hsize_t storageSize = 0;
+                H5Dget_chunk_storage_size(dataSet.getId(), &offset, &storageSize);
+                vector<char> chunk(storageSize);
+                uint32_t filterMask;
+                H5Dread_chunk(dataSet.getId(), H5P_DEFAULT, &offset, &filterMask, chunk.data());
+                chunks.append(chunk.begin(), chunk.end());
+            }
+        }
+    }
+#endif
+    return chunks;
+}
+
+/* chunks compressed on the thread pool when creating an alignment are the
+ * same as the ones HDF5 compresses */
+static void halHdf5ChunkCacheParallelWriteTest(CuTest *testCase) {
+    for (bool shuffle : {false, true}) {
+        string serialPath = getTempFile();
+        string parallelPath = getTempFile();
+        RandNumberGen serialRng(false, 7);
+        createChunkedAlignment(serialPath, shuffle, serialRng);
+        ThreadPool::setSharedNumThreads(4);
+        RandNumberGen parallelRng(false, 7);
+        createChunkedAlignment(parallelPath, shuffle, parallelRng);
+        ThreadPool::setSharedNumThreads(1);
+        string rawChunks = readRawChunks(serialPath);
+        CuAssertTrue(testCase, not rawChunks.empty());
+        CuAssertTrue(testCase, readRawChunks(parallelPath) == rawChunks);
+        AlignmentPtr serialAlignment(openChunkedAlignment(serialPath, 0, 0));
+        AlignmentPtr parallelAlignment(openChunkedAlignment(parallelPath, 0, 0));
+        CuAssertTrue(testCase, readAlignment(parallelAlignment.get()) == readAlignment(serialAlignment.get()));
+        ::unlink(serialPath.c_str());
+        ::unlink(parallelPath.c_str());
+    }
+}
+
+static CuSuite *halHdf5ChunkCacheTestSuite(void) {
+    CuSuite *suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, halHdf5ChunkCacheLruTest);
+    SUITE_ADD_TEST(suite, halHdf5ChunkCacheMappedTest);
+    SUITE_ADD_TEST(suite, halHdf5ChunkCacheAlignmentTest);
+    SUITE_ADD_TEST(suite, halHdf5ChunkCacheReadAheadTest);
+    SUITE_ADD_TEST(suite, halHdf5ChunkCacheReadAheadUnwrittenTest);
+    SUITE_ADD_TEST(suite, halHdf5ChunkCacheParallelWriteTest);
+    return suite;
+}
+
+int main(int argc, char *argv[]) {
+    return runHalTestSuite(argc, argv, halHdf5ChunkCacheTestSuite());
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halApiTestSupport.h"
+#include "halRandNumberGen.h"
+#include "halRandomData.h"
+#include "hal.h"
+#include "hdf5Alignment.h"
+#include <H5Cpp.h>
+#include <sstream>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using namespace hal;
+
+static Hdf5Alignment *createHdf5Alignment(const string &path) {
+    return new Hdf5Alignment(path, CREATE_ACCESS, hdf5DefaultFileCreatPropList(), hdf5DefaultFileAccPropList(),
+                             hdf5DefaultDSetCreatPropList());
+}
+
+/* chunks hold about the target bytes, more for the sequence arrays, and
+ * never more than the array */
+static void halHdf5ChunkingSizeTest(CuTest *testCase) {
+    string path = getTempFile();
+    Hdf5Alignment *alignment = createHdf5Alignment(path);
+    CuAssertIntEquals(testCase, 0, alignment->getChunkBytes());
+    CuAssertIntEquals(testCase, 0, alignment->getChunkSize(Hdf5Codec::SegmentDataset, 40, 10000));
+
+    alignment->setChunkBytes(4096);
+    CuAssertIntEquals(testCase, 102, alignment->getChunkSize(Hdf5Codec::SegmentDataset, 40, 10000));
+    CuAssertIntEquals(testCase, 4096, alignment->getChunkSize(Hdf5Codec::DnaDataset, 1, 10000));
+    CuAssertIntEquals(testCase, 409, alignment->getChunkSize(Hdf5Codec::SequenceNameDataset, 40, 10000));
+    CuAssertIntEquals(testCase, 5, alignment->getChunkSize(Hdf5Codec::SegmentDataset, 40, 5));
+    CuAssertIntEquals(testCase, 2, alignment->getChunkSize(Hdf5Codec::SegmentDataset, 10000, 100));
+    alignment->close();
+    delete alignment;
+    ::unlink(path.c_str());
+}
+
+/* write a random alignment, which is the same for the same seed */
+static void createChunkingAlignment(const string &path, hsize_t chunkBytes) {
+    RandNumberGen rng(false, 5);
+    Hdf5Alignment *alignment = createHdf5Alignment(path);
+    AlignmentPtr alignmentPtr(alignment);
+    alignment->setChunkBytes(chunkBytes);
+    createRandomAlignment(rng, alignment, 1.5, 0.5, 4, 6, 10, 2000, 20, 200);
+    alignment->close();
+}
+
+static string readChunkingAlignment(const string &path) {
+    AlignmentPtr alignment(openHalAlignment(path, NULL, READ_ACCESS));
+    return describeAlignment(alignment.get());
+}
+
+/* get the number of elements and elements per chunk of a dataset of a
+ * genome, arrays of one element not being chunked */
+static void getDatasetChunking(H5::H5File &file, const string &genomeName, const string &datasetName, hsize_t &size,
+                               hsize_t &chunkSize) {
+    H5::DataSet dataset = file.openGroup(genomeName).openDataSet(datasetName);
+    dataset.getSpace().getSimpleExtentDims(&size, NULL);
+    H5::DSetCreatPropList cparms = dataset.getCreatePlist();
+    chunkSize = size;
+    if (cparms.getLayout() == H5D_CHUNKED) {
+        cparms.getChunk(1, &chunkSize);
+    }
+}
+
+/* each dataset is chunked for its size, the setting is recorded and
+ * adopted when writing to the file again, and the alignment reads the
+ * same as with fixed chunks */
+static void halHdf5ChunkingAlignmentTest(CuTest *testCase) {
+    string fixedPath = getTempFile();
+    string sizedPath = getTempFile();
+    createChunkingAlignment(fixedPath, 0);
+    createChunkingAlignment(sizedPath, 1024);
+    CuAssertTrue(testCase, readChunkingAlignment(sizedPath) == readChunkingAlignment(fixedPath));
+
+    vector<string> genomeNames;
+    hal_size_t numGenomes;
+    {
+        AlignmentPtr alignment(openHalAlignment(sizedPath, NULL, READ_ACCESS));
+        genomeNames = alignment->getChildNames(alignment->getRootName());
+        genomeNames.push_back(alignment->getRootName());
+        numGenomes = alignment->getNumGenomes();
+    }
+    H5::H5File file(sizedPath, H5F_ACC_RDONLY);
+    for (const string &genomeName : genomeNames) {
+        hsize_t size, chunkSize;
+        getDatasetChunking(file, genomeName, "DNA_ARRAY", size, chunkSize);
+        CuAssertIntEquals(testCase, min(size, hsize_t(1024)), chunkSize);
+        getDatasetChunking(file, genomeName, "SEQNAME_ARRAY", size, chunkSize);
+        CuAssertTrue(testCase, chunkSize == size or chunkSize > 1024 / 20);
+    }
+    file.close();
+
+    Hdf5Alignment *alignment = new Hdf5Alignment(sizedPath, WRITE_ACCESS, hdf5DefaultFileCreatPropList(),
+                                                 hdf5DefaultFileAccPropList(), hdf5DefaultDSetCreatPropList());
+    CuAssertIntEquals(testCase, 1024, alignment->getChunkBytes());
+    alignment->close();
+    delete alignment;
+
+    // the setting is kept with the version, so adds no group that a
+    // genome couldn't be named
+    file.openFile(sizedPath, H5F_ACC_RDONLY);
+    CuAssertIntEquals(testCase, numGenomes + 4, file.getNumObjs());
+    file.close();
+
+    ::unlink(fixedPath.c_str());
+    ::unlink(sizedPath.c_str());
+}
+
+/* a genome can't take the name of a group of the alignment */
+static void halHdf5ChunkingReservedNameTest(CuTest *testCase) {
+    string path = getTempFile();
+    Hdf5Alignment *alignment = createHdf5Alignment(path);
+    AlignmentPtr alignmentPtr(alignment);
+    bool thrown = false;
+    try {
+        alignment->addRootGenome(Hdf5Alignment::VersionGroupName, 0);
+    } catch (const hal_exception &e) {
+        thrown = true;
+    }
+    CuAssertTrue(testCase, thrown);
+    alignment->addRootGenome("root", 0);
+    thrown = false;
+    try {
+        alignment->addLeafGenome(Hdf5Alignment::MetaGroupName, "root", 0.1);
+    } catch (const hal_exception &e) {
+        thrown = true;
+    }
+    CuAssertTrue(testCase, thrown);
+    Genome *leaf = alignment->addLeafGenome("leaf", "root", 0.1);
+    thrown = false;
+    try {
+        leaf->rename(Hdf5Alignment::GenomesGroupName);
+    } catch (const hal_exception &e) {
+        thrown = true;
+    }
+    CuAssertTrue(testCase, thrown);
+    CuAssertTrue(testCase, alignment->getChildNames("root") == vector<string>(1, "leaf"));
+    alignmentPtr.reset();
+    ::unlink(path.c_str());
+}
+
+static CuSuite *halHdf5ChunkingTestSuite(void) {
+    CuSuite *suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, halHdf5ChunkingSizeTest);
+    SUITE_ADD_TEST(suite, halHdf5ChunkingAlignmentTest);
+    SUITE_ADD_TEST(suite, halHdf5ChunkingReservedNameTest);
+    return suite;
+}
+
+int main(int argc, char *argv[]) {
+    return runHalTestSuite(argc, argv, halHdf5ChunkingTestSuite());
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halApiTestSupport.h"
+#include "halRandNumberGen.h"
+#include "halRandomData.h"
+#include "hal.h"
+#include "hdf5Alignment.h"
+#include "hdf5Codec.h"
+#include <H5Cpp.h>
+#include <sstream>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using namespace hal;
+
+/* get the ids of the filters in dataset creation properties */
+static vector<H5Z_filter_t> getFilterIds(const H5::DSetCreatPropList &cparms) {
+    vector<H5Z_filter_t> filterIds;
+    for (int f = 0; f < cparms.getNfilters(); f++) {
+        unsigned flags, config;
+        size_t numParams = 0;
+        char name[64];
+        filterIds.push_back(cparms.getFilter(f, flags, numParams, NULL, sizeof(name), name, config));
+    }
+    return filterIds;
+}
+
+/* each codec gives its own filters for each kind of dataset, keeping the
+ * chunking */
+static void halHdf5CodecPropertiesTest(CuTest *testCase) {
+    H5::DSetCreatPropList cparms;
+    cparms.copy(hdf5DefaultDSetCreatPropList());
+    hsize_t chunkSize = 0;
+    cparms.getChunk(1, &chunkSize);
+
+    Hdf5Codec deflate;
+    CuAssertTrue(testCase, deflate.getName() == "deflate");
+    CuAssertTrue(testCase, deflate.isAvailable());
+    CuAssertTrue(testCase, getFilterIds(deflate.getDSetCreatPropList(cparms, Hdf5Codec::SegmentDataset)) ==
+                               getFilterIds(cparms));
+
+    Hdf5Codec none("none");
+    CuAssertTrue(testCase, none.isAvailable());
+    H5::DSetCreatPropList noneParms = none.getDSetCreatPropList(cparms, Hdf5Codec::SegmentDataset);
+    CuAssertIntEquals(testCase, 0, noneParms.getNfilters());
+    hsize_t noneChunkSize = 0;
+    noneParms.getChunk(1, &noneChunkSize);
+    CuAssertIntEquals(testCase, chunkSize, noneChunkSize);
+
+    Hdf5Codec zstd("zstd", 3);
+    vector<H5Z_filter_t> segmentIds = getFilterIds(zstd.getDSetCreatPropList(cparms, Hdf5Codec::SegmentDataset));
+    CuAssertIntEquals(testCase, 2, segmentIds.size());
+    CuAssertIntEquals(testCase, H5Z_FILTER_SHUFFLE, segmentIds[0]);
+    CuAssertIntEquals(testCase, Hdf5Codec::ZstdFilterId, segmentIds[1]);
+    vector<H5Z_filter_t> dnaIds = getFilterIds(zstd.getDSetCreatPropList(cparms, Hdf5Codec::DnaDataset));
+    CuAssertIntEquals(testCase, 1, dnaIds.size());
+    CuAssertIntEquals(testCase, Hdf5Codec::ZstdFilterId, dnaIds[0]);
+
+    Hdf5Codec lz4("lz4");
+    vector<H5Z_filter_t> nameIds = getFilterIds(lz4.getDSetCreatPropList(cparms, Hdf5Codec::SequenceNameDataset));
+    CuAssertIntEquals(testCase, 1, nameIds.size());
+    CuAssertIntEquals(testCase, Hdf5Codec::Lz4FilterId, nameIds[0]);
+
+    bool threw = false;
+    try {
+        Hdf5Codec bad("gzip");
+    } catch (const hal_exception &) {
+        threw = true;
+    }
+    CuAssertTrue(testCase, threw);
+}
+
+/* write a random alignment, which is the same for the same seed */
+static void createCodecAlignment(const string &path, const Hdf5Codec &codec) {
+    RandNumberGen rng(false, 11);
+    AlignmentPtr alignment(hdf5AlignmentInstance(path, CREATE_ACCESS, hdf5DefaultFileCreatPropList(),
+                                                 hdf5DefaultFileAccPropList(), hdf5DefaultDSetCreatPropList()));
+    dynamic_cast<Hdf5Alignment *>(alignment.get())->setCodec(codec);
+    createRandomAlignment(rng, alignment.get(), 1.5, 0.5, 4, 6, 10, 300, 20, 200);
+    alignment->close();
+}
+
+static string readCodecAlignment(const string &path) {
+    AlignmentPtr alignment(openHalAlignment(path, NULL, READ_ACCESS));
+    return describeAlignment(alignment.get());
+}
+
+/* alignments written with any available codec read back the same without
+ * being told the codec, and unavailable codecs are refused */
+static void halHdf5CodecAlignmentTest(CuTest *testCase) {
+    string expected;
+    for (const string &name : {"deflate", "none", "zstd", "lz4"}) {
+        Hdf5Codec codec(name, 3);
+        string path = getTempFile();
+        if (not codec.isAvailable()) {
+            AlignmentPtr alignment(hdf5AlignmentInstance(path, CREATE_ACCESS, hdf5DefaultFileCreatPropList(),
+                                                         hdf5DefaultFileAccPropList(), hdf5DefaultDSetCreatPropList()));
+            bool threw = false;
+            try {
+                dynamic_cast<Hdf5Alignment *>(alignment.get())->setCodec(codec);
+            } catch (const hal_exception &) {
+                threw = true;
+            }
+            CuAssertTrue(testCase, threw);
+            alignment->close();
+        } else {
+            createCodecAlignment(path, codec);
+            string result = readCodecAlignment(path);
+            if (expected.empty()) {
+                expected = result;
+            }
+            CuAssertTrue(testCase, result == expected);
+        }
+        ::unlink(path.c_str());
+    }
+}
+
+static CuSuite *halHdf5CodecTestSuite(void) {
+    CuSuite *suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, halHdf5CodecPropertiesTest);
+    SUITE_ADD_TEST(suite, halHdf5CodecAlignmentTest);
+    return suite;
+}
+
+int main(int argc, char *argv[]) {
+    return runHalTestSuite(argc, argv, halHdf5CodecTestSuite());
+}
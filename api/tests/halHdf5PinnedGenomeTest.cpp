@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halApiTestSupport.h"
+#include "halRandNumberGen.h"
+#include "halRandomData.h"
+#include "hal.h"
+#include "hdf5Alignment.h"
+#include <sstream>
+#include <unistd.h>
+
+using namespace std;
+using namespace hal;
+
+static Hdf5Alignment *openHdf5Alignment(const string &path) {
+    return new Hdf5Alignment(path, READ_ACCESS, hdf5DefaultFileCreatPropList(), hdf5DefaultFileAccPropList(),
+                             hdf5DefaultDSetCreatPropList());
+}
+
+static string createAlignment() {
+    string path = getTempFile();
+    RandNumberGen rng(false, 11);
+    Hdf5Alignment *alignment = new Hdf5Alignment(path, CREATE_ACCESS, hdf5DefaultFileCreatPropList(),
+                                                 hdf5DefaultFileAccPropList(), hdf5DefaultDSetCreatPropList());
+    AlignmentPtr alignmentPtr(alignment);
+    alignment->setChunkBytes(1024);
+    createRandomAlignment(rng, alignment, 1.5, 0.5, 5, 8, 10, 3000, 20, 200);
+    alignment->close();
+    return path;
+}
+
+/* pinned genomes read the same as through the cache, without using it,
+ * and stay loaded when closed */
+static void halHdf5PinnedGenomeReadTest(CuTest *testCase) {
+    string path = createAlignment();
+    string expected;
+    {
+        Hdf5Alignment *alignment = openHdf5Alignment(path);
+        AlignmentPtr alignmentPtr(alignment);
+        expected = describeAlignment(alignment);
+        CuAssertTrue(testCase, alignment->getChunkCache()->getNumMisses() > 0);
+    }
+    {
+        Hdf5Alignment *alignment = openHdf5Alignment(path);
+        AlignmentPtr alignmentPtr(alignment);
+        vector<string> names = getGenomeNames(alignment);
+        alignment->pinGenomes(names);
+        CuAssertTrue(testCase, describeAlignment(alignment) == expected);
+        CuAssertIntEquals(testCase, 0, alignment->getChunkCache()->getNumMisses());
+        CuAssertIntEquals(testCase, 0, alignment->getChunkCache()->getNumHits());
+        const Genome *genome = alignment->openGenome(names.back());
+        alignment->closeGenome(genome);
+        CuAssertTrue(testCase, alignment->openGenome(names.back()) == genome);
+    }
+    ::unlink(path.c_str());
+}
+
+/* a subtree is its root and all its descendants, and only genomes of the
+ * alignment can be pinned */
+static void halHdf5PinnedGenomeSubtreeTest(CuTest *testCase) {
+    string path = createAlignment();
+    Hdf5Alignment *alignment = openHdf5Alignment(path);
+    AlignmentPtr alignmentPtr(alignment);
+    vector<string> names = getGenomeNames(alignment);
+    string subtreeRoot = alignment->getChildNames(names[0])[0];
+    alignment->pinSubtree(subtreeRoot);
+    for (const string &name : names) {
+        bool inSubtree = false;
+        for (string ancestor = name; not inSubtree and not ancestor.empty();
+             ancestor = (ancestor == names[0]) ? "" : alignment->getParentName(ancestor)) {
+            inSubtree = (ancestor == subtreeRoot);
+        }
+        CuAssertTrue(testCase, alignment->isPinned(name) == inSubtree);
+    }
+    bool thrown = false;
+    try {
+        alignment->pinGenomes(vector<string>(1, "notAGenome"));
+    } catch (const hal_exception &e) {
+        thrown = true;
+    }
+    CuAssertTrue(testCase, thrown);
+    thrown = false;
+    try {
+        alignment->pinSubtree("notAGenome");
+    } catch (const hal_exception &e) {
+        thrown = true;
+    }
+    CuAssertTrue(testCase, thrown);
+    alignmentPtr.reset();
+    ::unlink(path.c_str());
+}
+
+static CuSuite *halHdf5PinnedGenomeTestSuite(void) {
+    CuSuite *suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, halHdf5PinnedGenomeReadTest);
+    SUITE_ADD_TEST(suite, halHdf5PinnedGenomeSubtreeTest);
+    return suite;
+}
+
+int main(int argc, char *argv[]) {
+    return runHalTestSuite(argc, argv, halHdf5PinnedGenomeTestSuite());
+}
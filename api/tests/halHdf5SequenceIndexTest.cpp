@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halApiTestSupport.h"
+#include "hal.h"
+#include "hdf5Alignment.h"
+#include <H5Cpp.h>
+#include <sstream>
+#include <unistd.h>
+
+using namespace std;
+using namespace hal;
+
+static const hal_size_t numSequences = 3000;
+
+/* sequence i is named out of order, and every tenth one is empty */
+static Sequence::Info getSequenceInfo(hal_size_t i) {
+    ostringstream name;
+    name << "scaffold_" << (i * 7919) % numSequences;
+    return Sequence::Info(name.str(), i % 10 == 3 ? 0 : 1 + i % 17, 0, 0);
+}
+
+static Hdf5Alignment *openHdf5Alignment(const string &path, unsigned mode) {
+    return new Hdf5Alignment(path, mode, hdf5DefaultFileCreatPropList(), hdf5DefaultFileAccPropList(),
+                             hdf5DefaultDSetCreatPropList());
+}
+
+static void createAlignment(const string &path) {
+    AlignmentPtr alignment(openHdf5Alignment(path, CREATE_ACCESS));
+    static_cast<Hdf5Alignment *>(alignment.get())->setChunkBytes(1024);
+    Genome *genome = alignment->addRootGenome("root");
+    vector<Sequence::Info> dims;
+    for (hal_size_t i = 0; i < numSequences; i++) {
+        dims.push_back(getSequenceInfo(i));
+    }
+    genome->setDimensions(dims);
+    alignment->close();
+}
+
+/* every sequence is found by name and by each of its sites, whether looked
+ * up through the index or through the sequence caches */
+static void checkSequences(CuTest *testCase, const string &path) {
+    AlignmentPtr alignment(openHdf5Alignment(path, READ_ACCESS));
+    const Genome *genome = alignment->openGenome("root");
+    CuAssertIntEquals(testCase, numSequences, genome->getNumSequences());
+    hal_index_t start = 0;
+    for (hal_size_t i = 0; i < numSequences; i++) {
+        Sequence::Info info = getSequenceInfo(i);
+        const Sequence *sequence = genome->getSequence(info._name);
+        CuAssertTrue(testCase, sequence != NULL);
+        CuAssertTrue(testCase, sequence->getName() == info._name);
+        CuAssertIntEquals(testCase, i, sequence->getArrayIndex());
+        CuAssertIntEquals(testCase, start, sequence->getStartPosition());
+        CuAssertIntEquals(testCase, info._length, sequence->getSequenceLength());
+        CuAssertTrue(testCase, genome->getSequence(info._name) == sequence);
+        for (hal_size_t j = 0; j < info._length; j++) {
+            CuAssertTrue(testCase, genome->getSequenceBySite(start + j) == sequence);
+        }
+        start += info._length;
+    }
+    CuAssertTrue(testCase, genome->getSequenceBySite(start) == NULL);
+    CuAssertTrue(testCase, genome->getSequence("scaffold_") == NULL);
+    CuAssertTrue(testCase, genome->getSequence("scaffold_" + to_string(numSequences)) == NULL);
+    CuAssertTrue(testCase, genome->getSequence("") == NULL);
+
+    // iterating gives the same objects
+    hal_size_t i = 0;
+    for (SequenceIteratorPtr seqIt = genome->getSequenceIterator(); not seqIt->atEnd(); seqIt->toNext(), i++) {
+        CuAssertTrue(testCase, seqIt->getSequence() == genome->getSequence(getSequenceInfo(i)._name));
+    }
+    CuAssertIntEquals(testCase, numSequences, i);
+}
+
+static bool hasNameIndex(const string &path) {
+    H5::H5File file(path, H5F_ACC_RDONLY);
+    return H5Lexists(file.openGroup("root").getId(), "SEQNAMEIDX_ARRAY", H5P_DEFAULT) > 0;
+}
+
+static void halHdf5SequenceIndexLookupTest(CuTest *testCase) {
+    string path = getTempFile();
+    createAlignment(path);
+    CuAssertTrue(testCase, hasNameIndex(path));
+    checkSequences(testCase, path);
+    ::unlink(path.c_str());
+}
+
+/* files written before the name index existed load the name cache */
+static void halHdf5SequenceIndexFallbackTest(CuTest *testCase) {
+    string path = getTempFile();
+    createAlignment(path);
+    {
+        H5::H5File file(path, H5F_ACC_RDWR);
+        file.openGroup("root").unlink("SEQNAMEIDX_ARRAY");
+    }
+    CuAssertTrue(testCase, not hasNameIndex(path));
+    checkSequences(testCase, path);
+    ::unlink(path.c_str());
+}
+
+/* renaming a sequence, including to a longer name, rewrites the index */
+static void halHdf5SequenceIndexRenameTest(CuTest *testCase) {
+    string path = getTempFile();
+    createAlignment(path);
+    string oldName = getSequenceInfo(5)._name;
+    string newName = "a_much_longer_name_sorting_first";
+    {
+        AlignmentPtr alignment(openHdf5Alignment(path, WRITE_ACCESS));
+        Genome *genome = alignment->openGenome("root");
+        genome->getSequence(oldName)->setName(newName);
+        CuAssertTrue(testCase, genome->getSequence(oldName) == NULL);
+        CuAssertIntEquals(testCase, 5, genome->getSequence(newName)->getArrayIndex());
+        alignment->close();
+    }
+    AlignmentPtr alignment(openHdf5Alignment(path, READ_ACCESS));
+    const Genome *genome = alignment->openGenome("root");
+    CuAssertTrue(testCase, genome->getSequence(oldName) == NULL);
+    CuAssertIntEquals(testCase, 5, genome->getSequence(newName)->getArrayIndex());
+    for (hal_size_t i = 0; i < numSequences; i++) {
+        if (i != 5) {
+            CuAssertIntEquals(testCase, i, genome->getSequence(getSequenceInfo(i)._name)->getArrayIndex());
+        }
+    }
+    ::unlink(path.c_str());
+}
+
+static CuSuite *halHdf5SequenceIndexTestSuite(void) {
+    CuSuite *suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, halHdf5SequenceIndexLookupTest);
+    SUITE_ADD_TEST(suite, halHdf5SequenceIndexFallbackTest);
+    SUITE_ADD_TEST(suite, halHdf5SequenceIndexRenameTest);
+    return suite;
+}
+
+int main(int argc, char *argv[]) {
+    return runHalTestSuite(argc, argv, halHdf5SequenceIndexTestSuite());
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halApiTestSupport.h"
+#include "halRandNumberGen.h"
+#include "halRandomData.h"
+#include "hal.h"
+#include "hdf5Alignment.h"
+#include "hdf5SharedChunkDir.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+using namespace std;
+using namespace hal;
+
+static void removeDir(const string &dirPath) {
+    if (system(("rm -rf '" + dirPath + "'").c_str()) != 0) {
+        throw hal_exception("can't remove " + dirPath);
+    }
+}
+
+/* an image stored by one process is mapped by others, as long as the file
+ * hasn't changed */
+static void halHdf5SharedChunkDirImageTest(CuTest *testCase) {
+    string halPath = getTempFile();
+    string dirPath = halPath + ".chunks";
+    ofstream(halPath.c_str()) << "not really hdf5";
+    const char image[] = "decompressed chunk";
+    {
+        Hdf5SharedChunkDir storer(dirPath, halPath);
+        CuAssertTrue(testCase, storer.isEnabled());
+        CuAssertTrue(testCase, storer.map("/Genome_0/DNA_ARRAY", 64, sizeof(image)) == NULL);
+        storer.store("/Genome_0/DNA_ARRAY", 64, image, sizeof(image));
+        CuAssertIntEquals(testCase, 1, storer.getNumStored());
+    }
+    {
+        Hdf5SharedChunkDir mapper(dirPath, halPath);
+        CuAssertTrue(testCase, mapper.contains("/Genome_0/DNA_ARRAY", 64, sizeof(image)));
+        Hdf5SharedChunkDir::MappedImage mapped = mapper.map("/Genome_0/DNA_ARRAY", 64, sizeof(image));
+        CuAssertTrue(testCase, mapped != NULL);
+        CuAssertTrue(testCase, memcmp(mapped.get(), image, sizeof(image)) == 0);
+        // another buffer, dataset or size is another image
+        CuAssertTrue(testCase, mapper.map("/Genome_0/DNA_ARRAY", 0, sizeof(image)) == NULL);
+        CuAssertTrue(testCase, mapper.map("/Genome_1/DNA_ARRAY", 64, sizeof(image)) == NULL);
+        CuAssertTrue(testCase, mapper.map("/Genome_0/DNA_ARRAY", 64, 4) == NULL);
+        CuAssertIntEquals(testCase, 1, mapper.getNumMapped());
+        CuAssertIntEquals(testCase, 3, mapper.getNumMisses());
+    }
+    // images that others could have written aren't trusted, nor is a
+    // directory they could write images to
+    if (system(("find '" + dirPath + "' -type f -exec chmod go+w {} +").c_str()) != 0) {
+        throw hal_exception("can't chmod images in " + dirPath);
+    }
+    {
+        Hdf5SharedChunkDir mapper(dirPath, halPath);
+        CuAssertTrue(testCase, mapper.isEnabled());
+        CuAssertTrue(testCase, mapper.map("/Genome_0/DNA_ARRAY", 64, sizeof(image)) == NULL);
+    }
+    if (system(("chmod -R go+w '" + dirPath + "'").c_str()) != 0) {
+        throw hal_exception("can't chmod " + dirPath);
+    }
+    {
+        Hdf5SharedChunkDir mapper(dirPath, halPath);
+        CuAssertTrue(testCase, not mapper.isEnabled());
+    }
+    ofstream(halPath.c_str(), ios::app) << ", rewritten";
+    {
+        Hdf5SharedChunkDir mapper(dirPath, halPath);
+        CuAssertTrue(testCase, not mapper.contains("/Genome_0/DNA_ARRAY", 64, sizeof(image)));
+    }
+    {
+        Hdf5SharedChunkDir remote(dirPath, "http://example.com/remote.hal");
+        CuAssertTrue(testCase, not remote.isEnabled());
+    }
+    removeDir(dirPath);
+    ::unlink(halPath.c_str());
+}
+
+static Hdf5Alignment *openSharedAlignment(const string &path, const string &dirPath) {
+    Hdf5Alignment *alignment = new Hdf5Alignment(path, READ_ACCESS, hdf5DefaultFileCreatPropList(),
+                                                 hdf5DefaultFileAccPropList(), hdf5DefaultDSetCreatPropList());
+    alignment->setSharedChunkDir(dirPath);
+    return alignment;
+}
+
+/* the first reader of a file decompresses its chunks and stores them, the
+ * next one maps them all, and both read the same as without sharing */
+static void halHdf5SharedChunkDirAlignmentTest(CuTest *testCase) {
+    string path = getTempFile();
+    string dirPath = path + ".chunks";
+    {
+        RandNumberGen rng(false, 5);
+        Hdf5Alignment *alignment = new Hdf5Alignment(path, CREATE_ACCESS, hdf5DefaultFileCreatPropList(),
+                                                     hdf5DefaultFileAccPropList(), hdf5DefaultDSetCreatPropList());
+        AlignmentPtr alignmentPtr(alignment);
+        alignment->setChunkBytes(1024);
+        createRandomAlignment(rng, alignment, 1.5, 0.5, 4, 6, 10, 2000, 20, 200);
+        alignment->close();
+    }
+    string expected;
+    {
+        AlignmentPtr alignment(openSharedAlignment(path, ""));
+        CuAssertTrue(testCase, static_cast<Hdf5Alignment *>(alignment.get())->getSharedChunkDir() == NULL);
+        expected = describeAlignment(alignment.get());
+    }
+    {
+        Hdf5Alignment *alignment = openSharedAlignment(path, dirPath);
+        AlignmentPtr alignmentPtr(alignment);
+        CuAssertTrue(testCase, describeAlignment(alignment) == expected);
+        CuAssertTrue(testCase, alignment->getSharedChunkDir()->getNumStored() > 0);
+    }
+    {
+        Hdf5Alignment *alignment = openSharedAlignment(path, dirPath);
+        AlignmentPtr alignmentPtr(alignment);
+        CuAssertTrue(testCase, describeAlignment(alignment) == expected);
+        CuAssertTrue(testCase, alignment->getSharedChunkDir()->getNumMapped() > 0);
+        CuAssertIntEquals(testCase, 0, alignment->getSharedChunkDir()->getNumStored());
+        CuAssertIntEquals(testCase, 0, alignment->getSharedChunkDir()->getNumMisses());
+    }
+    {
+        // buffers mapped once stay in the chunk cache
+        Hdf5Alignment *alignment = openSharedAlignment(path, dirPath);
+        AlignmentPtr alignmentPtr(alignment);
+        const Genome *genome = alignment->openGenome(alignment->getRootName());
+        string dna1, dna2;
+        genome->getString(dna1);
+        size_t numMapped = alignment->getSharedChunkDir()->getNumMapped();
+        CuAssertTrue(testCase, numMapped > 0);
+        genome->getString(dna2);
+        CuAssertTrue(testCase, dna1 == dna2);
+        CuAssertIntEquals(testCase, numMapped, alignment->getSharedChunkDir()->getNumMapped());
+    }
+    removeDir(dirPath);
+    ::unlink(path.c_str());
+}
+
+static CuSuite *halHdf5SharedChunkDirTestSuite(void) {
+    CuSuite *suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, halHdf5SharedChunkDirImageTest);
+    SUITE_ADD_TEST(suite, halHdf5SharedChunkDirAlignmentTest);
+    return suite;
+}
+
+int main(int argc, char *argv[]) {
+    return runHalTestSuite(argc, argv, halHdf5SharedChunkDirTestSuite());
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halApiTestSupport.h"
+#include "halRandNumberGen.h"
+#include "halRandomData.h"
+#include "hal.h"
+#include "halThreadPool.h"
+#include "halValidate.h"
+#include <sstream>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using namespace hal;
+
+/* copy an alignment with the tree of the input already added */
+static void copyAlignment(const Alignment *inAlignment, const string &outPath) {
+    AlignmentPtr outAlignment(getTestAlignmentInstances(STORAGE_FORMAT_MMAP, outPath, CREATE_ACCESS));
+    vector<string> names = getGenomeNames(inAlignment);
+    outAlignment->closeGenome(outAlignment->addRootGenome(names[0]));
+    for (size_t i = 1; i < names.size(); i++) {
+        string parentName = inAlignment->getParentName(names[i]);
+        outAlignment->closeGenome(
+            outAlignment->addLeafGenome(names[i], parentName, inAlignment->getBranchLength(parentName, names[i])));
+    }
+    copyHdf5GenomesToMMap(inAlignment, outAlignment.get(), names);
+    outAlignment->close();
+}
+
+/* the copy reads the same as the original, whether genomes are copied
+ * one after the other or in parallel */
+static void halHdf5ToMMapCopyTest(CuTest *testCase) {
+    string hdf5Path = getTempFile();
+    {
+        RandNumberGen rng(false, 11);
+        AlignmentPtr alignment(getTestAlignmentInstances(STORAGE_FORMAT_HDF5, hdf5Path, CREATE_ACCESS));
+        createRandomAlignment(rng, alignment.get(), 1.5, 0.5, 4, 6, 10, 2000, 20, 200);
+        alignment->getMetaData()->set("test", "value");
+        Genome *root = alignment->openGenome(alignment->getRootName());
+        root->getMetaData()->set("genomeKey", "genomeValue");
+        alignment->closeGenome(root);
+        alignment->close();
+    }
+    AlignmentPtr inAlignment(openHalAlignment(hdf5Path, NULL, READ_ACCESS));
+    string expected = describeAlignment(inAlignment.get());
+    for (size_t numThreads : {1, 4}) {
+        ThreadPool::setSharedNumThreads(numThreads);
+        string mmapPath = getTempFile();
+        copyAlignment(inAlignment.get(), mmapPath);
+        AlignmentPtr outAlignment(openHalAlignment(mmapPath, NULL, READ_ACCESS));
+        validateAlignment(outAlignment.get());
+        CuAssertTrue(testCase, describeAlignment(outAlignment.get()) == expected);
+        outAlignment->close();
+        ::unlink(mmapPath.c_str());
+    }
+    ThreadPool::setSharedNumThreads(1);
+    inAlignment->close();
+    ::unlink(hdf5Path.c_str());
+}
+
+static CuSuite *halHdf5ToMMapTestSuite(void) {
+    CuSuite *suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, halHdf5ToMMapCopyTest);
+    return suite;
+}
+
+int main(int argc, char *argv[]) {
+    return runHalTestSuite(argc, argv, halHdf5ToMMapTestSuite());
+}
@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halApiTestSupport.h"
+#include "halRandNumberGen.h"
+#include "halRandomData.h"
+#include "hal.h"
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+using namespace std;
+using namespace hal;
+
+/* read all of every genome, so each array has been accessed */
+static void readGenomes(const Alignment *alignment, vector<const Genome *> &genomes) {
+    for (const string &name : getGenomeNames(alignment)) {
+        const Genome *genome = alignment->openGenome(name);
+        describeGenome(genome);
+        genomes.push_back(genome);
+    }
+}
+
+static vector<string> readLines(const string &path) {
+    ifstream in(path.c_str());
+    vector<string> lines;
+    string line;
+    while (getline(in, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+struct IoStatsCountersTest : public AlignmentTest {
+    void createCallBack(Alignment *alignment) {
+        RandNumberGen rng(false, 7);
+        createRandomAlignment(rng, alignment, 1.5, 0.5, 3, 5, 10, 2000, 10, 100);
+    }
+
+    void checkCallBack(const Alignment *alignment) {
+        vector<const Genome *> genomes;
+        readGenomes(alignment, genomes);
+        IoStats stats;
+        alignment->getIoStats(stats);
+        CuAssertIntEquals(_testCase, genomes.size(), stats.getGenomes().size());
+        for (const Genome *genome : genomes) {
+            const string &name = genome->getName();
+            if (alignment->getStorageFormat() == STORAGE_FORMAT_HDF5) {
+                CuAssertTrue(_testCase, stats.get(name, "dna", "pages") > 0);
+                CuAssertTrue(_testCase, stats.get(name, "dna", "pagedBytes") > 0);
+            } else {
+                CuAssertIntEquals(_testCase, (genome->getSequenceLength() + 1) / 2, stats.get(name, "dna", "bytes"));
+                CuAssertTrue(_testCase, stats.get(name, "dna", "residentBytes") <= stats.get(name, "dna", "bytes"));
+                CuAssertTrue(_testCase, stats.get(name, "sequences", "bytes") > 0);
+            }
+        }
+        if (alignment->getStorageFormat() == STORAGE_FORMAT_HDF5) {
+            CuAssertTrue(_testCase, stats.getFile("cacheMisses") > 0);
+        } else {
+            CuAssertTrue(_testCase, stats.getFile("bytes") > 0);
+            CuAssertTrue(_testCase, stats.getFile("residentBytes") > 0);
+            CuAssertTrue(_testCase, stats.getFile("residentBytes") <= stats.getFile("bytes"));
+        }
+
+        // the first write truncates the file, later ones append a line each
+        string path = getTempFile();
+        {
+            ofstream out(path.c_str());
+            out << "left over from before\n";
+        }
+        writeIoStats(alignment, _checkPath, path);
+        writeIoStats(alignment, _checkPath, path);
+        vector<string> lines = readLines(path);
+        CuAssertIntEquals(_testCase, 2, lines.size());
+        string prefix = "{\"path\": \"" + _checkPath + "\", \"format\": \"" + alignment->getStorageFormat() + "\"";
+        CuAssertTrue(_testCase, lines[0].compare(0, prefix.size(), prefix) == 0);
+        CuAssertTrue(_testCase, lines[0].substr(lines[0].size() - 2) == "}}");
+        CuAssertTrue(_testCase, lines[0].find("\"" + genomes[0]->getName() + "\": {\"") != string::npos);
+        ::unlink(path.c_str());
+    }
+};
+
+static void halIoStatsCountersTest(CuTest *testCase) {
+    IoStatsCountersTest tester;
+    tester.check(testCase);
+}
+
+/* open an alignment with an --ioStats path */
+static Alignment *openWithIoStats(const string &alignmentPath, const string &ioStatsPath) {
+    CLParser parser;
+    string arg0 = "halIoStatsTest", arg1 = "--ioStats";
+    char *argv[] = {&arg0[0], &arg1[0], const_cast<char *>(ioStatsPath.c_str())};
+    parser.parseOptions(3, argv);
+    return openHalAlignment(alignmentPath, &parser);
+}
+
+/* an --ioStats path that can't be written is an error when the alignment is
+ * opened, and one that can no longer be written when it's closed is only
+ * reported, as closing may be done by a destructor */
+struct IoStatsBadPathTest : public AlignmentTest {
+    void createCallBack(Alignment *alignment) {
+        RandNumberGen rng(false, 3);
+        createRandomAlignment(rng, alignment, 1.5, 0.5, 2, 3, 10, 200, 5, 20);
+    }
+
+    void checkCallBack(const Alignment *alignment) {
+        bool threw = false;
+        try {
+            AlignmentConstPtr bad(openWithIoStats(_checkPath, "/nonexistent/dir/io.json"));
+        } catch (const hal_exception &e) {
+            threw = true;
+        }
+        CuAssertTrue(_testCase, threw);
+
+        char dirTemplate[] = "/tmp/halIoStatsTestXXXXXX";
+        CuAssertTrue(_testCase, mkdtemp(dirTemplate) != NULL);
+        string dir = dirTemplate;
+        string path = dir + "/io.json";
+        AlignmentConstPtr removed(openWithIoStats(_checkPath, path));
+        vector<const Genome *> genomes;
+        readGenomes(removed.get(), genomes);
+        CuAssertIntEquals(_testCase, 0, ::unlink(path.c_str()));
+        CuAssertIntEquals(_testCase, 0, ::rmdir(dir.c_str()));
+        removed.reset();
+        CuAssertTrue(_testCase, ::access(path.c_str(), F_OK) != 0);
+    }
+};
+
+static void halIoStatsBadPathTest(CuTest *testCase) {
+    IoStatsBadPathTest tester;
+    tester.check(testCase);
+}
+
+/* counters are summed, and written as integers unless fractional, with
+ * strings escaped */
+static void halIoStatsJsonTest(CuTest *testCase) {
+    IoStats stats;
+    stats.add("g\"1", "dna", "reads", 2);
+    stats.add("g\"1", "dna", "reads", 3);
+    stats.add("g2", "topSegments", "readSeconds", 0.25);
+    stats.addFile("cacheHits", 1e12);
+    IoStats total;
+    total.merge(stats);
+    total.merge(stats);
+    CuAssertDblEquals(testCase, 10, total.get("g\"1", "dna", "reads"), 0);
+    CuAssertDblEquals(testCase, 0, total.get("g2", "dna", "reads"), 0);
+    CuAssertDblEquals(testCase, 0, total.get("g3", "dna", "reads"), 0);
+    ostringstream out;
+    total.writeJson(out, "a\\b.hal", "hdf5");
+    CuAssertStrEquals(testCase,
+                      "{\"path\": \"a\\\\b.hal\", \"format\": \"hdf5\", \"file\": {\"cacheHits\": 2000000000000}, "
+                      "\"genomes\": {\"g\\\"1\": {\"dna\": {\"reads\": 10}}, "
+                      "\"g2\": {\"topSegments\": {\"readSeconds\": 0.5}}}}\n",
+                      out.str().c_str());
+}
+
+static CuSuite *halIoStatsTestSuite(void) {
+    CuSuite *suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, halIoStatsCountersTest);
+    SUITE_ADD_TEST(suite, halIoStatsBadPathTest);
+    SUITE_ADD_TEST(suite, halIoStatsJsonTest);
+    return suite;
+}
+
+int main(int argc, char *argv[]) {
+    return runHalTestSuite(argc, argv, halIoStatsTestSuite());
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halApiTestSupport.h"
+#include "mmapFetchScheduler.h"
+#include <vector>
+
+using namespace std;
+using namespace hal;
+
+static const size_t FILE_SIZE = 64 * 1024 * 1024;
+static const size_t RECORD_SIZE = 40;
+
+/* Fetch a record, checking that it is resident afterwards and that any
+ * fetch overlaps it. Returns true if a fetch was done. */
+static bool fetchRecord(CuTest *testCase, MMapFetchScheduler &scheduler, size_t offset, size_t size) {
+    size_t fetchOffset, fetchSize;
+    bool fetched = scheduler.schedule(offset, size, fetchOffset, fetchSize);
+    if (fetched) {
+        CuAssertTrue(testCase, fetchOffset < offset + size);
+        CuAssertTrue(testCase, fetchOffset + fetchSize > offset);
+        CuAssertTrue(testCase, fetchOffset + fetchSize <= FILE_SIZE);
+    }
+    CuAssertTrue(testCase, scheduler.isResident(offset, size));
+    return fetched;
+}
+
+static void halMMapFetchSchedulerForwardTest(CuTest *testCase) {
+    MMapFetchScheduler scheduler;
+    scheduler.setFileSize(FILE_SIZE);
+    size_t numRecords = FILE_SIZE / RECORD_SIZE;
+    for (size_t i = 0; i < numRecords; i++) {
+        fetchRecord(testCase, scheduler, i * RECORD_SIZE, 2 * RECORD_SIZE);
+    }
+    // read-ahead grows to 4M, so 64M takes a few dozen requests
+    CuAssertTrue(testCase, scheduler.getNumFetches() < 32);
+    CuAssertTrue(testCase, scheduler.getFetchBytes() == FILE_SIZE);
+}
+
+static void halMMapFetchSchedulerReverseTest(CuTest *testCase) {
+    MMapFetchScheduler scheduler;
+    scheduler.setFileSize(FILE_SIZE);
+    size_t numRecords = FILE_SIZE / RECORD_SIZE;
+    for (size_t i = numRecords; i > 0; i--) {
+        fetchRecord(testCase, scheduler, (i - 1) * RECORD_SIZE, RECORD_SIZE);
+    }
+    CuAssertTrue(testCase, scheduler.getNumFetches() < 32);
+    CuAssertTrue(testCase, scheduler.getFetchBytes() <= FILE_SIZE);
+}
+
+static void halMMapFetchSchedulerRandomTest(CuTest *testCase) {
+    MMapFetchScheduler scheduler;
+    scheduler.setFileSize(FILE_SIZE);
+    // widely spaced accesses don't read ahead
+    for (size_t i = 0; i < 100; i++) {
+        size_t offset = ((i * 7919) % 997) * (FILE_SIZE / 1000);
+        if (not scheduler.isResident(offset, RECORD_SIZE)) {
+            CuAssertTrue(testCase, fetchRecord(testCase, scheduler, offset, RECORD_SIZE));
+            CuAssertTrue(testCase,
+                         scheduler.getFetchBytes() <= scheduler.getNumFetches() * 2 * MMapFetchScheduler::DEFAULT_BLOCK_SIZE);
+        }
+    }
+    // re-accessing resident data doesn't fetch
+    size_t numFetches = scheduler.getNumFetches();
+    for (size_t i = 0; i < 100; i++) {
+        size_t offset = ((i * 7919) % 997) * (FILE_SIZE / 1000);
+        CuAssertTrue(testCase, not fetchRecord(testCase, scheduler, offset, RECORD_SIZE));
+    }
+    CuAssertTrue(testCase, scheduler.getNumFetches() == numFetches);
+}
+
+static void halMMapFetchSchedulerEndTest(CuTest *testCase) {
+    MMapFetchScheduler scheduler;
+    size_t fileSize = 3 * MMapFetchScheduler::DEFAULT_BLOCK_SIZE + 17;
+    scheduler.setFileSize(fileSize);
+    size_t fetchOffset, fetchSize;
+    CuAssertTrue(testCase, scheduler.schedule(fileSize - 10, 100, fetchOffset, fetchSize));
+    CuAssertTrue(testCase, fetchOffset == 3 * MMapFetchScheduler::DEFAULT_BLOCK_SIZE);
+    CuAssertTrue(testCase, fetchSize == 17);
+    CuAssertTrue(testCase, not scheduler.schedule(fileSize, 100, fetchOffset, fetchSize));
+    CuAssertTrue(testCase, not scheduler.schedule(0, 0, fetchOffset, fetchSize));
+}
+
+static CuSuite *halMMapFetchSchedulerTestSuite(void) {
+    CuSuite *suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, halMMapFetchSchedulerForwardTest);
+    SUITE_ADD_TEST(suite, halMMapFetchSchedulerReverseTest);
+    SUITE_ADD_TEST(suite, halMMapFetchSchedulerRandomTest);
+    SUITE_ADD_TEST(suite, halMMapFetchSchedulerEndTest);
+    return suite;
+}
+
+int main(int argc, char *argv[]) {
+    return runHalTestSuite(argc, argv, halMMapFetchSchedulerTestSuite());
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halApiTestSupport.h"
+#include "mmapAlignment.h"
+#include "mmapGenome.h"
+#include "mmapGenomeSiteMap.h"
+#include "mmapSequence.h"
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using namespace hal;
+
+static const size_t NUM_SEQUENCES = 200000;
+static const size_t NUM_LOOKUPS = 100000;
+
+/* Create a genome with many small sequences, some of them empty, and
+ * return the sequences for building site maps. */
+static vector<MMapSequence *> createSequences(Alignment *alignment) {
+    Genome *genome = alignment->addRootGenome("root", 0);
+    vector<Sequence::Info> seqVec;
+    for (size_t i = 0; i < NUM_SEQUENCES; i++) {
+        hal_size_t length = ((i % 11) == 5) ? 0 : 1 + ((i * 7919) % 3001);
+        seqVec.push_back(Sequence::Info("seq" + std::to_string(i), length, 0, 0));
+    }
+    genome->setDimensions(seqVec, false);
+    MMapGenome *mmapGenome = dynamic_cast<MMapGenome *>(genome);
+    vector<MMapSequence *> sequences;
+    for (size_t i = 0; i < NUM_SEQUENCES; i++) {
+        sequences.push_back(static_cast<MMapSequence *>(mmapGenome->getSequenceByIndex(i)));
+    }
+    return sequences;
+}
+
+/* compare the site index against the tree used by older files */
+static void halMMapGenomeSiteMapTest(CuTest *testCase) {
+    string alignmentPath = getTempFile();
+    try {
+        AlignmentPtr alignment(getTestAlignmentInstances(STORAGE_FORMAT_MMAP, alignmentPath, CREATE_ACCESS));
+        vector<MMapSequence *> sequences = createSequences(alignment.get());
+        MMapFile *file = dynamic_cast<MMapAlignment *>(alignment.get())->getMMapFile();
+        MMapGenomeSiteMap tree(file, MMAP_NULL_OFFSET, false);
+        tree.build(sequences);
+        MMapGenomeSiteMap index(file, MMAP_NULL_OFFSET, true);
+        index.build(sequences);
+
+        // every sequence boundary
+        for (MMapSequence *sequence : sequences) {
+            hal_index_t expect = (sequence->getSequenceLength() > 0) ? sequence->getArrayIndex() : NULL_INDEX;
+            size_t start = sequence->getStartPosition();
+            size_t end = start + sequence->getSequenceLength();
+            if (expect != NULL_INDEX) {
+                CuAssertTrue(testCase, index.getSequenceIndexBySite(start) == expect);
+                CuAssertTrue(testCase, index.getSequenceIndexBySite(end - 1) == expect);
+                CuAssertTrue(testCase, tree.getSequenceIndexBySite(end - 1) == expect);
+            }
+            CuAssertTrue(testCase, index.getSequenceIndexBySite(start) == tree.getSequenceIndexBySite(start));
+        }
+        size_t genomeLength = alignment->openGenome("root")->getSequenceLength();
+        CuAssertTrue(testCase, index.getSequenceIndexBySite(genomeLength) == NULL_INDEX);
+        CuAssertTrue(testCase, tree.getSequenceIndexBySite(genomeLength) == NULL_INDEX);
+
+        // random positions
+        srand(42);
+        for (size_t i = 0; i < NUM_LOOKUPS; i++) {
+            size_t position = ((size_t)rand() * RAND_MAX + rand()) % genomeLength;
+            CuAssertTrue(testCase, index.getSequenceIndexBySite(position) == tree.getSequenceIndexBySite(position));
+        }
+        alignment->close();
+    } catch (const exception &e) {
+        CuFail(testCase, stString_print("Caught exception while testing: %s", e.what()));
+    }
+    ::unlink(alignmentPath.c_str());
+}
+
+static CuSuite *halMMapGenomeSiteMapTestSuite(void) {
+    CuSuite *suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, halMMapGenomeSiteMapTest);
+    return suite;
+}
+
+int main(int argc, char *argv[]) {
+    return runHalTestSuite(argc, argv, halMMapGenomeSiteMapTestSuite());
+}
@@ -14,6 +14,7 @@
 #include <cstdlib>
 #include <ctime>
 #include <iostream>
+#include <set>
 #include <string>
 
 using namespace std;
@@ -796,6 +797,94 @@ struct MappedSegmentColCompareTest3 : public MappedSegmentColCompareTest {
     }
 };
 
+/* a slice of child1's top segment mapped to the same positions of
+ * parent's bottom segment, on either strand */
+static MappedSegmentPtr makeMappedSegment(const Alignment *alignment, hal_offset_t left, hal_offset_t right,
+                                          bool reversed) {
+    SegmentIteratorPtr sourceIt = alignment->openGenome("child1")->getTopSegmentIterator(0);
+    sourceIt->slice(left, right);
+    SegmentIteratorPtr targetIt = alignment->openGenome("parent")->getBottomSegmentIterator(0);
+    if (reversed) {
+        targetIt->toReverse();
+        targetIt->slice(right, left);
+    } else {
+        targetIt->slice(left, right);
+    }
+    return MappedSegmentPtr(new MappedSegment(sourceIt, targetIt));
+}
+
+/* the (target, source) position pairs of a segment */
+static void addPositionPairs(const MappedSegmentPtr &mseg, set<pair<hal_index_t, hal_index_t>> &pairs) {
+    hal_index_t delta = mseg->getReversed() ? -1 : 1;
+    for (hal_index_t i = 0; i < (hal_index_t)mseg->getLength(); ++i) {
+        pairs.insert(make_pair(mseg->getStartPosition() + i * delta, mseg->getSource()->getStartPosition() + i));
+    }
+}
+
+/* segments added to a set with insertAndBreakOverlaps() are cut so
+ * that any two targets are the same or disjoint, whether the set is
+ * looked at in between or not */
+struct MappedSegmentSetOverlapTest : public MappedSegmentMapUpTest {
+    void checkCallBack(const Alignment *alignment) {
+        const hal_offset_t slices[][3] = {{0, 0, 0}, {2, 5, 0}, {4, 1, 1}, {0, 6, 0}, {6, 0, 0},
+                                          {2, 5, 0}, {3, 3, 1}, {0, 11, 1}, {11, 0, 0}, {5, 5, 0}};
+        const size_t numSlices = sizeof(slices) / sizeof(slices[0]);
+        set<pair<hal_index_t, hal_index_t>> inputPairs;
+        for (size_t i = 0; i < numSlices; ++i) {
+            addPositionPairs(makeMappedSegment(alignment, slices[i][0], slices[i][1], slices[i][2]), inputPairs);
+        }
+
+        MappedSegmentSet allAtOnce;
+        MappedSegmentSet oneByOne;
+        for (size_t i = 0; i < numSlices; ++i) {
+            allAtOnce.insertAndBreakOverlaps(makeMappedSegment(alignment, slices[i][0], slices[i][1], slices[i][2]));
+            oneByOne.insertAndBreakOverlaps(makeMappedSegment(alignment, slices[i][0], slices[i][1], slices[i][2]));
+            CuAssertTrue(_testCase, not oneByOne.empty());
+            oneByOne.resolve();
+            checkSet(oneByOne, inputPairs, false);
+        }
+        CuAssertTrue(_testCase, not allAtOnce.isResolved());
+        allAtOnce.resolve();
+        checkSet(allAtOnce, inputPairs, true);
+        checkSet(oneByOne, inputPairs, true);
+        CuAssertIntEquals(_testCase, allAtOnce.size(), oneByOne.size());
+        for (MappedSegmentSet::const_iterator i = allAtOnce.begin(), j = oneByOne.begin(); i != allAtOnce.end(); ++i, ++j) {
+            CuAssertTrue(_testCase, (*i)->equals(j->get()));
+        }
+
+        // plain insertion leaves overlaps alone, and drops equal segments
+        MappedSegmentSet plain;
+        CuAssertTrue(_testCase, plain.insert(makeMappedSegment(alignment, 2, 5, false)).second);
+        CuAssertTrue(_testCase, plain.insert(makeMappedSegment(alignment, 0, 0, false)).second);
+        CuAssertTrue(_testCase, not plain.insert(makeMappedSegment(alignment, 2, 5, true)).second);
+        CuAssertIntEquals(_testCase, 2, plain.size());
+        CuAssertIntEquals(_testCase, 12, (*plain.begin())->getLength());
+        CuAssertTrue(_testCase, plain.find(makeMappedSegment(alignment, 2, 5, false)) == plain.begin() + 1);
+        CuAssertIntEquals(_testCase, 1, plain.erase(makeMappedSegment(alignment, 0, 0, false)));
+        CuAssertIntEquals(_testCase, 1, plain.size());
+    }
+
+    void checkSet(const MappedSegmentSet &segments, const set<pair<hal_index_t, hal_index_t>> &inputPairs,
+                  bool complete) {
+        set<pair<hal_index_t, hal_index_t>> pairs;
+        for (MappedSegmentSet::const_iterator i = segments.begin(); i != segments.end(); ++i) {
+            CuAssertTrue(_testCase, (*i)->getLength() == (*i)->getSource()->getLength());
+            addPositionPairs(*i, pairs);
+            for (MappedSegmentSet::const_iterator j = i + 1; j != segments.end(); ++j) {
+                CuAssertTrue(_testCase, (*i)->lessThan(j->get()));
+                hal_index_t iMin = min((*i)->getStartPosition(), (*i)->getEndPosition());
+                hal_index_t iMax = max((*i)->getStartPosition(), (*i)->getEndPosition());
+                hal_index_t jMin = min((*j)->getStartPosition(), (*j)->getEndPosition());
+                hal_index_t jMax = max((*j)->getStartPosition(), (*j)->getEndPosition());
+                CuAssertTrue(_testCase, (iMin == jMin && iMax == jMax) || iMax < jMin || jMax < iMin);
+            }
+        }
+        if (complete) {
+            CuAssertTrue(_testCase, pairs == inputPairs);
+        }
+    }
+};
+
 static void halMappedSegmentMapUpTest(CuTest *testCase) {
     MappedSegmentMapUpTest tester;
     tester.check(testCase);
@@ -826,6 +915,11 @@ static void halMappedSegmentMapExtraParalogsTest(CuTest *testCase) {
     tester.check(testCase);
 }
 
+static void halMappedSegmentSetOverlapTest(CuTest *testCase) {
+    MappedSegmentSetOverlapTest tester;
+    tester.check(testCase);
+}
+
 static void halMappedSegmentColCompareTestCheck1(CuTest *testCase) {
     MappedSegmentColCompareTestCheck1 tester;
     tester.check(testCase);
@@ -859,6 +953,7 @@ static CuSuite *halMappedSegmentTestSuite(void) {
     SUITE_ADD_TEST(suite, halMappedSegmentParseTest);
     SUITE_ADD_TEST(suite, halMappedSegmentMapAcrossTest);
     SUITE_ADD_TEST(suite, halMappedSegmentMapDupeTest);
+    SUITE_ADD_TEST(suite, halMappedSegmentSetOverlapTest);
     SUITE_ADD_TEST(suite, halMappedSegmentColCompareTestCheck1);
     SUITE_ADD_TEST(suite, halMappedSegmentColCompareTestCheck2);
     SUITE_ADD_TEST(suite, halMappedSegmentColCompareTest1);
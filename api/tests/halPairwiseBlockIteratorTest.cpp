@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halApiTestSupport.h"
+#include "halRandNumberGen.h"
+#include "halRandomData.h"
+#include "halSegmentTestSupport.h"
+#include "hal.h"
+#include <iostream>
+#include <set>
+#include <tuple>
+
+using namespace std;
+using namespace hal;
+
+/* an aligned pair of bases: source and target position, and whether the
+ * target is reversed */
+typedef tuple<hal_index_t, hal_index_t, bool> BasePair;
+
+/* the base pairs of mapping each source segment with SegmentMapper::map() */
+static set<BasePair> mapEachSegment(const Genome *srcGenome, const Genome *tgtGenome, bool doDupes) {
+    SegmentIteratorPtr segIt;
+    hal_size_t numSegments;
+    if (srcGenome->getParent() != NULL) {
+        segIt = srcGenome->getTopSegmentIterator();
+        numSegments = srcGenome->getNumTopSegments();
+    } else {
+        segIt = srcGenome->getBottomSegmentIterator();
+        numSegments = srcGenome->getNumBottomSegments();
+    }
+    set<BasePair> pairs;
+    SegmentMapper mapper;
+    for (hal_size_t i = 0; i < numSegments; ++i, segIt->toRight()) {
+        mapper.map(segIt.get(), tgtGenome, NULL, doDupes);
+        for (const SegmentMapping &mapping : mapper.getMappings()) {
+            bool reversed = mapping._source._reversed != mapping._target._reversed;
+            hal_index_t srcMin = mapping._source.getMinPosition();
+            hal_index_t tgtMin = mapping._target.getMinPosition();
+            hal_index_t length = mapping._source.getLength();
+            for (hal_index_t j = 0; j < length; ++j) {
+                pairs.insert(BasePair(srcMin + j, reversed ? tgtMin + length - 1 - j : tgtMin + j, reversed));
+            }
+        }
+    }
+    return pairs;
+}
+
+struct PairwiseBlockIteratorTest : public AlignmentTest {
+    void createCallBack(Alignment *alignment) {
+        RandNumberGen rng(false, 13);
+        createRandomAlignment(rng, alignment, 1.5, 0.5, 4, 6, 5, 20, 50, 200);
+    }
+
+    void checkPair(const Genome *srcGenome, const Genome *tgtGenome, bool doDupes, hal_size_t segmentsPerRun) {
+        set<BasePair> blockPairs;
+        bool first = true;
+        PairwiseBlock last;
+        for (PairwiseBlockIterator blockIt(srcGenome, tgtGenome, doDupes, NULL, segmentsPerRun); not blockIt.atEnd();
+             blockIt.toNext()) {
+            const PairwiseBlock &block = blockIt.getBlock();
+            CuAssertTrue(_testCase, block._length > 0);
+            // sorted by source then target, within one sequence of each
+            CuAssertTrue(_testCase, first || last._srcStart < block._srcStart ||
+                                        (last._srcStart == block._srcStart && last._tgtStart <= block._tgtStart));
+            CuAssertTrue(_testCase, block._srcSequence == srcGenome->getSequenceBySite(block._srcStart));
+            CuAssertTrue(_testCase,
+                         block._srcSequence == srcGenome->getSequenceBySite(block._srcStart + block._length - 1));
+            CuAssertTrue(_testCase, block._tgtSequence == tgtGenome->getSequenceBySite(block._tgtStart));
+            CuAssertTrue(_testCase,
+                         block._tgtSequence == tgtGenome->getSequenceBySite(block._tgtStart + block._length - 1));
+            for (hal_index_t j = 0; j < (hal_index_t)block._length; ++j) {
+                hal_index_t tgtPos =
+                    block._reversed ? block._tgtStart + (hal_index_t)block._length - 1 - j : block._tgtStart + j;
+                blockPairs.insert(BasePair(block._srcStart + j, tgtPos, block._reversed));
+            }
+            last = block;
+            first = false;
+        }
+        CuAssertTrue(_testCase, blockPairs == mapEachSegment(srcGenome, tgtGenome, doDupes));
+    }
+
+    void checkCallBack(const Alignment *alignment) {
+        vector<string> names = getGenomeNames(alignment);
+        for (const string &srcName : names) {
+            for (const string &tgtName : names) {
+                const Genome *srcGenome = alignment->openGenome(srcName);
+                const Genome *tgtGenome = alignment->openGenome(tgtName);
+                checkPair(srcGenome, tgtGenome, true, 4096);
+                checkPair(srcGenome, tgtGenome, false, 4096);
+                // blocks merge across runs
+                checkPair(srcGenome, tgtGenome, true, 7);
+            }
+        }
+    }
+};
+
+/* two collinear segments on a branch come out as one block, and an
+ * inverted one as a reversed block */
+struct PairwiseBlockMergeTest : public AlignmentTest {
+    void createCallBack(Alignment *alignment) {
+        Genome *parent = alignment->addRootGenome("parent");
+        Genome *child = alignment->addLeafGenome("child", "parent", 1);
+        vector<Sequence::Info> seqVec(1);
+        seqVec[0] = Sequence::Info("Sequence", 30, 0, 3);
+        parent->setDimensions(seqVec);
+        seqVec[0] = Sequence::Info("Sequence", 30, 3, 0);
+        child->setDimensions(seqVec);
+        parent->setString(string(30, 'A'));
+        child->setString(string(30, 'A'));
+
+        BottomSegmentIteratorPtr bi = parent->getBottomSegmentIterator();
+        TopSegmentIteratorPtr ti = child->getTopSegmentIterator();
+        for (hal_index_t i = 0; i < 3; ++i) {
+            bool reversed = i == 2;
+            BottomSegmentStruct bs;
+            bs.set(i * 10, 10);
+            bs._children.push_back(pair<hal_size_t, bool>(i, reversed));
+            bs.applyTo(bi);
+            TopSegmentStruct ts;
+            ts.set(i * 10, 10, i, reversed);
+            ts.applyTo(ti);
+            bi->toRight();
+            ti->toRight();
+        }
+    }
+
+    void checkCallBack(const Alignment *alignment) {
+        const Genome *parent = alignment->openGenome("parent");
+        const Genome *child = alignment->openGenome("child");
+        PairwiseBlockIterator blockIt(child, parent);
+        CuAssertTrue(_testCase, not blockIt.atEnd());
+        CuAssertIntEquals(_testCase, 0, blockIt.getBlock()._srcStart);
+        CuAssertIntEquals(_testCase, 0, blockIt.getBlock()._tgtStart);
+        CuAssertIntEquals(_testCase, 20, blockIt.getBlock()._length);
+        CuAssertTrue(_testCase, not blockIt.getBlock()._reversed);
+        blockIt.toNext();
+        CuAssertTrue(_testCase, not blockIt.atEnd());
+        CuAssertIntEquals(_testCase, 20, blockIt.getBlock()._srcStart);
+        CuAssertIntEquals(_testCase, 20, blockIt.getBlock()._tgtStart);
+        CuAssertIntEquals(_testCase, 10, blockIt.getBlock()._length);
+        CuAssertTrue(_testCase, blockIt.getBlock()._reversed);
+        blockIt.toNext();
+        CuAssertTrue(_testCase, blockIt.atEnd());
+    }
+};
+
+static void halPairwiseBlockIteratorTest(CuTest *testCase) {
+    PairwiseBlockIteratorTest tester;
+    tester.check(testCase);
+}
+
+static void halPairwiseBlockMergeTest(CuTest *testCase) {
+    PairwiseBlockMergeTest tester;
+    tester.check(testCase);
+}
+
+static CuSuite *halPairwiseBlockIteratorTestSuite(void) {
+    CuSuite *suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, halPairwiseBlockIteratorTest);
+    SUITE_ADD_TEST(suite, halPairwiseBlockMergeTest);
+    return suite;
+}
+
+int main(int argc, char *argv[]) {
+    return runHalTestSuite(argc, argv, halPairwiseBlockIteratorTestSuite());
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halApiTestSupport.h"
+#include "halRandNumberGen.h"
+#include "halRandomData.h"
+#include "hal.h"
+
+using namespace std;
+using namespace hal;
+
+static vector<const Genome *> getGenomes(const Alignment *alignment) {
+    vector<const Genome *> genomes;
+    for (const string &name : getGenomeNames(alignment)) {
+        genomes.push_back(alignment->openGenome(name));
+    }
+    return genomes;
+}
+
+struct SegmentReaderTest : public AlignmentTest {
+    void createCallBack(Alignment *alignment) {
+        RandNumberGen rng(false, 11);
+        createRandomAlignment(rng, alignment, 1.5, 0.5, 4, 7, 10, 200, 500, 2000);
+    }
+
+    void checkCallBack(const Alignment *alignment) {
+        vector<const Genome *> genomes = getGenomes(alignment);
+        bool inPlace = alignment->getStorageFormat() == STORAGE_FORMAT_MMAP;
+        for (const Genome *genome : genomes) {
+            VirtualSegmentReader virtualReader;
+            ColumnSegmentReader columnReader;
+            CuAssertTrue(_testCase, virtualReader.open(genome));
+            CuAssertTrue(_testCase, columnReader.open(genome) == inPlace);
+            if (not inPlace) {
+                continue;
+            }
+            CuAssertIntEquals(_testCase, genome->getNumTopSegments(), columnReader.getNumTopSegments());
+            CuAssertIntEquals(_testCase, genome->getNumBottomSegments(), columnReader.getNumBottomSegments());
+            for (hal_index_t i = 0; i < (hal_index_t)genome->getNumTopSegments(); ++i) {
+                CuAssertIntEquals(_testCase, virtualReader.getTopStartPosition(i), columnReader.getTopStartPosition(i));
+                CuAssertIntEquals(_testCase, virtualReader.getTopLength(i), columnReader.getTopLength(i));
+                CuAssertIntEquals(_testCase, virtualReader.getTopParentIndex(i), columnReader.getTopParentIndex(i));
+                CuAssertTrue(_testCase, virtualReader.getTopParentReversed(i) == columnReader.getTopParentReversed(i));
+                CuAssertIntEquals(_testCase, virtualReader.getTopBottomParseIndex(i), columnReader.getTopBottomParseIndex(i));
+                CuAssertIntEquals(_testCase, virtualReader.getTopNextParalogyIndex(i),
+                                  columnReader.getTopNextParalogyIndex(i));
+            }
+            for (hal_index_t i = 0; i < (hal_index_t)genome->getNumBottomSegments(); ++i) {
+                CuAssertIntEquals(_testCase, virtualReader.getBottomStartPosition(i), columnReader.getBottomStartPosition(i));
+                CuAssertIntEquals(_testCase, virtualReader.getBottomLength(i), columnReader.getBottomLength(i));
+                CuAssertIntEquals(_testCase, virtualReader.getBottomTopParseIndex(i), columnReader.getBottomTopParseIndex(i));
+                for (hal_size_t child = 0; child < genome->getNumChildren(); ++child) {
+                    CuAssertIntEquals(_testCase, virtualReader.getBottomChildIndex(i, child),
+                                      columnReader.getBottomChildIndex(i, child));
+                    CuAssertTrue(_testCase, virtualReader.getBottomChildReversed(i, child) ==
+                                                columnReader.getBottomChildReversed(i, child));
+                }
+            }
+        }
+    }
+};
+
+static void halSegmentReaderTest(CuTest *testCase) {
+    SegmentReaderTest tester;
+    tester.check(testCase);
+}
+
+static CuSuite *halSegmentReaderTestSuite(void) {
+    CuSuite *suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, halSegmentReaderTest);
+    return suite;
+}
+
+int main(int argc, char *argv[]) {
+    return runHalTestSuite(argc, argv, halSegmentReaderTestSuite());
+}
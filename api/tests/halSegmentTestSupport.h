@@ -35,6 +35,7 @@ struct TopSegmentStruct {
         _startPosition = rand();
         _nextParalogyIndex = rand();
         _parentIndex = rand();
+        _parentReversed = rand() % 2;
         _arrayIndex = rand();
         _bottomParseIndex = rand();
     }
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halApiTestSupport.h"
+#include "halThreadPool.h"
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+using namespace hal;
+
+static const size_t poolSizes[] = {1, 2, 8};
+
+static void halThreadPoolSplitRangeTest(CuTest *testCase) {
+    CuAssertTrue(testCase, splitRange(5, 0, 10).empty());
+
+    vector<pair<hal_size_t, hal_size_t>> chunks = splitRange(5, 25, 10);
+    CuAssertIntEquals(testCase, 3, chunks.size());
+    CuAssertIntEquals(testCase, 5, chunks[0].first);
+    CuAssertIntEquals(testCase, 10, chunks[0].second);
+    CuAssertIntEquals(testCase, 25, chunks[2].first);
+    CuAssertIntEquals(testCase, 5, chunks[2].second);
+
+    // chunk sizes are rounded down to the alignment, but never to zero
+    chunks = splitRange(0, 20, 10, 4);
+    CuAssertIntEquals(testCase, 3, chunks.size());
+    CuAssertIntEquals(testCase, 8, chunks[1].first);
+    chunks = splitRange(0, 20, 2, 4);
+    CuAssertIntEquals(testCase, 5, chunks.size());
+    CuAssertIntEquals(testCase, 4, chunks[0].second);
+}
+
+/* tasks, including ones submitted by other tasks, all run before wait()
+ * returns */
+static void halThreadPoolTaskGroupTest(CuTest *testCase) {
+    for (size_t numThreads : poolSizes) {
+        ThreadPool pool(numThreads);
+        CuAssertIntEquals(testCase, numThreads, pool.getNumThreads());
+        atomic<size_t> total(0);
+        TaskGroup group(pool);
+        for (size_t i = 0; i < 100; i++) {
+            group.run([&, i]() {
+                TaskGroup inner(pool);
+                for (size_t j = 0; j < 10; j++) {
+                    inner.run([&, i, j]() { total += i * 10 + j; });
+                }
+                inner.wait();
+            });
+        }
+        group.wait();
+        CuAssertIntEquals(testCase, 999 * 1000 / 2, total);
+    }
+}
+
+static void halThreadPoolExceptionTest(CuTest *testCase) {
+    for (size_t numThreads : poolSizes) {
+        ThreadPool pool(numThreads);
+        TaskGroup group(pool);
+        atomic<size_t> numRun(0);
+        for (size_t i = 0; i < 20; i++) {
+            group.run([&, i]() {
+                numRun++;
+                if (i == 7) {
+                    throw hal_exception("task failed");
+                }
+            });
+        }
+        bool caught = false;
+        try {
+            group.wait();
+        } catch (const hal_exception &e) {
+            caught = string(e.what()) == "task failed";
+        }
+        CuAssertTrue(testCase, caught);
+        CuAssertIntEquals(testCase, 20, numRun);
+    }
+}
+
+/* output is consumed in chunk order whatever order it is produced in, and
+ * errors stop the consumption */
+static void halThreadPoolOrderedOutputTest(CuTest *testCase) {
+    for (size_t numThreads : poolSizes) {
+        ThreadPool pool(numThreads);
+        string result;
+        parallelOrderedOutput(1000,
+                              [](size_t i, string &output) {
+                                  // uneven amounts of work per chunk
+                                  volatile size_t work = 0;
+                                  for (size_t j = 0; j < (i * 7919) % 100000; j++) {
+                                      work += j;
+                                  }
+                                  output = to_string(i) + ",";
+                              },
+                              [&](const string &output) { result += output; }, pool);
+        string expected;
+        for (size_t i = 0; i < 1000; i++) {
+            expected += to_string(i) + ",";
+        }
+        CuAssertTrue(testCase, result == expected);
+
+        size_t numConsumed = 0;
+        bool caught = false;
+        try {
+            parallelOrderedOutput(100,
+                                  [](size_t i, string &output) {
+                                      if (i == 50) {
+                                          throw hal_exception("chunk failed");
+                                      }
+                                  },
+                                  [&](const string &output) { numConsumed++; }, pool);
+        } catch (const hal_exception &e) {
+            caught = true;
+        }
+        CuAssertTrue(testCase, caught);
+        CuAssertIntEquals(testCase, 50, numConsumed);
+    }
+}
+
+static CuSuite *halThreadPoolTestSuite(void) {
+    CuSuite *suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, halThreadPoolSplitRangeTest);
+    SUITE_ADD_TEST(suite, halThreadPoolTaskGroupTest);
+    SUITE_ADD_TEST(suite, halThreadPoolExceptionTest);
+    SUITE_ADD_TEST(suite, halThreadPoolOrderedOutputTest);
+    return suite;
+}
+
+int main(int argc, char *argv[]) {
+    return runHalTestSuite(argc, argv, halThreadPoolTestSuite());
+}
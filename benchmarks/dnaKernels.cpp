@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/* Measure FASTA export speed from an mmap file at each DNA kernel level
+ * the CPU supports: the DNA of a random genome is unpacked into FASTA lines
+ * in memory, and the output of each level is checked against the first. */
+
+#include "hal.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using namespace hal;
+
+static const DnaKernelLevel kernelLevels[] = {DNA_KERNEL_SCALAR, DNA_KERNEL_SSE4, DNA_KERNEL_AVX2};
+static const char *kernelLevelNames[] = {"scalar", "sse4", "avx2"};
+
+static void initParser(CLParser &optionsParser) {
+    optionsParser.addOption("genomeLength", "number of bases in the genome", 64 * 1024 * 1024);
+    optionsParser.addOption("lineWidth", "bases per FASTA line", 80);
+    optionsParser.addOption("tempPath", "path of the temporary mmap file", "halDnaKernelsBenchmark.hal");
+    optionsParser.setDescription("Measure FASTA export speed at each DNA kernel level.");
+}
+
+static string randomDna(hal_size_t length) {
+    static const char bases[] = "acgtACGTnN";
+    string dna(length, 'n');
+    for (char &c : dna) {
+        c = bases[rand() % 10];
+    }
+    return dna;
+}
+
+/* format a whole genome as FASTA lines in memory, returning bytes written */
+static size_t formatFasta(const Genome *genome, hal_size_t lineWidth, vector<char> &buffer) {
+    PackedDnaSpan span;
+    hal_size_t length = genome->getSequenceLength();
+    genome->getPackedDna(span, 0, length);
+    char *out = buffer.data();
+    for (hal_size_t i = 0; i < length; i += lineWidth) {
+        hal_size_t lineLen = std::min(lineWidth, length - i);
+        dnaUnpackString(span.getData(), span.isOdd() + i, lineLen, out);
+        out += lineLen;
+        *out++ = '\n';
+    }
+    return out - buffer.data();
+}
+
+int main(int argc, char **argv) {
+    CLParser optionsParser;
+    initParser(optionsParser);
+    hal_size_t genomeLength;
+    hal_size_t lineWidth;
+    string tempPath;
+    try {
+        optionsParser.parseOptions(argc, argv);
+        genomeLength = optionsParser.getOption<hal_size_t>("genomeLength");
+        lineWidth = optionsParser.getOption<hal_size_t>("lineWidth");
+        tempPath = optionsParser.getOption<string>("tempPath");
+    } catch (exception &e) {
+        cerr << e.what() << endl;
+        optionsParser.printUsage(cerr);
+        return 1;
+    }
+
+    try {
+        AlignmentPtr alignment(mmapAlignmentInstance(tempPath, CREATE_ACCESS, genomeLength * 2));
+        Genome *genome = alignment->addRootGenome("root", 0);
+        vector<Sequence::Info> seqVec(1, Sequence::Info("seq", genomeLength, 0, 0));
+        genome->setDimensions(seqVec);
+        genome->setString(randomDna(genomeLength));
+
+        vector<char> buffer(genomeLength + genomeLength / lineWidth + 1);
+        string first;
+        cout << "level\tGB/s" << endl;
+        for (size_t i = 0; i < sizeof(kernelLevels) / sizeof(kernelLevels[0]); i++) {
+            if (setDnaKernelLevel(kernelLevels[i]) != kernelLevels[i]) {
+                continue;
+            }
+            formatFasta(genome, lineWidth, buffer); // warm up
+            auto start = chrono::steady_clock::now();
+            size_t numBytes = formatFasta(genome, lineWidth, buffer);
+            chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+            if (first.empty()) {
+                first.assign(buffer.data(), numBytes);
+            } else if (first.compare(0, numBytes, buffer.data(), numBytes) != 0) {
+                throw hal_exception(string("FASTA from ") + kernelLevelNames[i] + " kernels differs from scalar");
+            }
+            cout << kernelLevelNames[i] << "\t" << numBytes / elapsed.count() / 1e9 << endl;
+        }
+        alignment->close();
+    } catch (exception &e) {
+        cerr << "Exception caught: " << e.what() << endl;
+        ::unlink(tempPath.c_str());
+        return 1;
+    }
+    ::unlink(tempPath.c_str());
+    return 0;
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/* Measure the speed of looking up the sequence of a genome position in an
+ * mmap file, with the site index and with the tree used by older files, on
+ * a genome with many small sequences (some of them empty). */
+
+#include "hal.h"
+#include "mmapAlignment.h"
+#include "mmapGenome.h"
+#include "mmapGenomeSiteMap.h"
+#include "mmapSequence.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using namespace hal;
+
+static void initParser(CLParser &optionsParser) {
+    optionsParser.addOption("numSequences", "number of sequences in the genome", 200000);
+    optionsParser.addOption("numLookups", "number of random positions to look up", 2000000);
+    optionsParser.addOption("tempPath", "path of the temporary mmap file", "halGenomeSiteMapBenchmark.hal");
+    optionsParser.setDescription("Measure genome position to sequence lookups in mmap files.");
+}
+
+/* Create a genome with many small sequences, some of them empty, and
+ * return the sequences for building site maps. */
+static vector<MMapSequence *> createSequences(Alignment *alignment, size_t numSequences) {
+    Genome *genome = alignment->addRootGenome("root", 0);
+    vector<Sequence::Info> seqVec;
+    for (size_t i = 0; i < numSequences; i++) {
+        hal_size_t length = ((i % 11) == 5) ? 0 : 1 + ((i * 7919) % 3001);
+        seqVec.push_back(Sequence::Info("seq" + std::to_string(i), length, 0, 0));
+    }
+    genome->setDimensions(seqVec, false);
+    MMapGenome *mmapGenome = dynamic_cast<MMapGenome *>(genome);
+    vector<MMapSequence *> sequences;
+    for (size_t i = 0; i < numSequences; i++) {
+        sequences.push_back(static_cast<MMapSequence *>(mmapGenome->getSequenceByIndex(i)));
+    }
+    return sequences;
+}
+
+/* time lookups of positions, returning ns per lookup */
+static double timeLookups(const MMapGenomeSiteMap &siteMap, const vector<size_t> &positions, hal_index_t &checkSum) {
+    auto start = chrono::steady_clock::now();
+    for (size_t position : positions) {
+        checkSum += siteMap.getSequenceIndexBySite(position);
+    }
+    chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count() / positions.size();
+}
+
+int main(int argc, char **argv) {
+    CLParser optionsParser;
+    initParser(optionsParser);
+    size_t numSequences;
+    size_t numLookups;
+    string tempPath;
+    try {
+        optionsParser.parseOptions(argc, argv);
+        numSequences = optionsParser.getOption<size_t>("numSequences");
+        numLookups = optionsParser.getOption<size_t>("numLookups");
+        tempPath = optionsParser.getOption<string>("tempPath");
+    } catch (exception &e) {
+        cerr << e.what() << endl;
+        optionsParser.printUsage(cerr);
+        return 1;
+    }
+
+    try {
+        AlignmentPtr alignment(mmapAlignmentInstance(tempPath, CREATE_ACCESS));
+        vector<MMapSequence *> sequences = createSequences(alignment.get(), numSequences);
+        MMapFile *file = dynamic_cast<MMapAlignment *>(alignment.get())->getMMapFile();
+        MMapGenomeSiteMap tree(file, MMAP_NULL_OFFSET, false);
+        tree.build(sequences);
+        MMapGenomeSiteMap index(file, MMAP_NULL_OFFSET, true);
+        index.build(sequences);
+
+        size_t genomeLength = alignment->openGenome("root")->getSequenceLength();
+        vector<size_t> positions;
+        srand(42);
+        for (size_t i = 0; i < numLookups; i++) {
+            positions.push_back(((size_t)rand() * RAND_MAX + rand()) % genomeLength);
+        }
+        hal_index_t treeSum = 0, indexSum = 0;
+        double treeNs = timeLookups(tree, positions, treeSum);
+        double indexNs = timeLookups(index, positions, indexSum);
+        if (treeSum != indexSum) {
+            throw hal_exception("site index and tree lookups differ");
+        }
+        cout << "map\tns/lookup" << endl;
+        cout << "tree\t" << treeNs << endl;
+        cout << "index\t" << indexNs << endl;
+        alignment->close();
+    } catch (exception &e) {
+        cerr << "Exception caught: " << e.what() << endl;
+        ::unlink(tempPath.c_str());
+        return 1;
+    }
+    ::unlink(tempPath.c_str());
+    return 0;
+}
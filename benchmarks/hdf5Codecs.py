@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+
+# Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+#
+# Released under the MIT license, see LICENSE.txt
+
+"""Compare the HDF5 codecs on the same random alignment: file size, time
+to create it, and latency of random queries (short DNA ranges and a
+liftover between two leaves).  Codecs whose HDF5 filter plugin is not
+found (see HDF5_PLUGIN_PATH) are skipped."""
+
+import argparse
+import os
+import random
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def runHalGen(preset, seed, codec, outPath):
+    """create the alignment, returning the time it took or None if the
+    codec is not available"""
+    start = time.perf_counter()
+    proc = subprocess.run(["halRandGen", "--preset", preset, "--seed", str(seed),
+                           "--format", "hdf5", "--hdf5Codec", codec, outPath],
+                          stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+    if proc.returncode != 0:
+        sys.stderr.write("skipping %s: %s" % (codec, proc.stderr.decode()))
+        return None
+    return time.perf_counter() - start
+
+
+def medianMs(cmds):
+    times = []
+    for cmd in cmds:
+        start = time.perf_counter()
+        subprocess.check_call(cmd, stdout=subprocess.DEVNULL)
+        times.append((time.perf_counter() - start) * 1000.0)
+    return statistics.median(times)
+
+
+def getLeaves(halPath):
+    genomes = subprocess.check_output(["halStats", "--genomes", halPath]).decode().split()
+    leaves = []
+    for genome in genomes:
+        children = subprocess.check_output(["halStats", "--children", genome, halPath]).decode().split()
+        if len(children) == 0:
+            leaves.append(genome)
+    return leaves
+
+
+def getSequences(halPath, genome):
+    out = subprocess.check_output(["halStats", "--chromSizes", genome, halPath]).decode()
+    return [(name, int(length)) for name, length in (line.split() for line in out.strip().split("\n"))]
+
+
+def makeQueries(halPath, seed, reps, length, workDir):
+    """random DNA ranges and a random BED of the same ranges, picked once
+    so every codec answers the same queries"""
+    rng = random.Random(seed)
+    leaves = getLeaves(halPath)
+    src, tgt = leaves[0], leaves[-1]
+    sequences = getSequences(halPath, src)
+    ranges = []
+    for i in range(reps):
+        name, seqLength = rng.choice(sequences)
+        start = rng.randrange(max(seqLength - length, 1))
+        ranges.append((name, start, min(length, seqLength - start)))
+    bedPath = os.path.join(workDir, "query.bed")
+    with open(bedPath, "w") as bed:
+        for name, start, rangeLength in ranges:
+            bed.write("%s\t%d\t%d\n" % (name, start, start + rangeLength))
+    return src, tgt, ranges, bedPath
+
+
+def benchmark(halPath, src, tgt, ranges, bedPath, reps):
+    dnaCmds = [["hal2fasta", halPath, src, "--sequence", name, "--start", str(start),
+                "--length", str(rangeLength)] for name, start, rangeLength in ranges]
+    liftoverCmds = [["halLiftover", halPath, src, bedPath, tgt, "/dev/null"]] * reps
+    return medianMs(dnaCmds), medianMs(liftoverCmds)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--preset", default="medium",
+                        help="halRandGen preset to use [small, medium, big, large]")
+    parser.add_argument("--seed", type=int, default=4, help="random seed")
+    parser.add_argument("--codecs", default="none,deflate,zstd,lz4", help="comma-separated codecs to test")
+    parser.add_argument("--reps", type=int, default=20, help="number of random queries")
+    parser.add_argument("--length", type=int, default=1000, help="length of each random DNA range")
+    parser.add_argument("--keep", action="store_true", help="keep the generated alignments")
+    args = parser.parse_args()
+
+    workDir = tempfile.mkdtemp(prefix="halHdf5Codecs")
+    try:
+        queries = None
+        print("codec\tfile size\tcreate\tdna range\tliftover")
+        for codec in args.codecs.split(","):
+            halPath = os.path.join(workDir, "random.%s.hal" % codec)
+            seconds = runHalGen(args.preset, args.seed, codec, halPath)
+            if seconds is None:
+                continue
+            if queries is None:
+                queries = makeQueries(halPath, args.seed, args.reps, args.length, workDir)
+            dnaMs, liftoverMs = benchmark(halPath, *queries, args.reps)
+            print("%s\t%d\t%.2f s\t%.1f ms\t%.1f ms" % (codec, os.path.getsize(halPath), seconds,
+                                                       dnaMs, liftoverMs))
+            sys.stdout.flush()
+    finally:
+        if args.keep:
+            print("alignments kept in %s" % workDir)
+        else:
+            shutil.rmtree(workDir)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
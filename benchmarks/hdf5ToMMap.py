@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+
+# Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+#
+# Released under the MIT license, see LICENSE.txt
+
+"""Time converting an HDF5 alignment to mmap with halExtract, which copies
+the genomes in bulk and in parallel, for different numbers of threads.
+The alignment is a random one from halRandGen unless one is given."""
+
+import argparse
+import os
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def timeExtract(inPath, outPath, numThreads, reps):
+    """median seconds to convert the alignment"""
+    times = []
+    for i in range(reps):
+        if os.path.exists(outPath):
+            os.remove(outPath)
+        start = time.perf_counter()
+        subprocess.check_call(["halExtract", "--outputFormat", "mmap", "--numThreads", str(numThreads),
+                               inPath, outPath], stdout=subprocess.DEVNULL)
+        times.append(time.perf_counter() - start)
+    return statistics.median(times)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--hal", help="hdf5 alignment to convert (default: generate one)")
+    parser.add_argument("--preset", default="big",
+                        help="halRandGen preset to generate [small, medium, big, large]")
+    parser.add_argument("--seed", type=int, default=4, help="random seed")
+    parser.add_argument("--threads", default="1,2,4,8", help="comma-separated numbers of threads to test")
+    parser.add_argument("--reps", type=int, default=3, help="number of conversions to take the median of")
+    args = parser.parse_args()
+
+    workDir = tempfile.mkdtemp(prefix="halHdf5ToMMap")
+    try:
+        inPath = args.hal
+        if inPath is None:
+            inPath = os.path.join(workDir, "random.hal")
+            subprocess.check_call(["halRandGen", "--preset", args.preset, "--seed", str(args.seed),
+                                   "--format", "hdf5", inPath], stdout=subprocess.DEVNULL)
+        outPath = os.path.join(workDir, "out.mmap.hal")
+        expected = subprocess.check_output(["halStats", inPath])
+        print("threads\tconvert\tspeedup")
+        baseline = None
+        for numThreads in [int(n) for n in args.threads.split(",")]:
+            seconds = timeExtract(inPath, outPath, numThreads, args.reps)
+            if subprocess.check_output(["halStats", outPath]) != expected:
+                raise RuntimeError("converted alignment differs with %d threads" % numThreads)
+            if baseline is None:
+                baseline = seconds
+            print("%d\t%.2f s\t%.2fx" % (numThreads, seconds, baseline / seconds))
+            sys.stdout.flush()
+        subprocess.check_call(["halValidate", outPath], stdout=subprocess.DEVNULL)
+    finally:
+        shutil.rmtree(workDir)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
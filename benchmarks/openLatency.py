@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+
+# Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+#
+# Released under the MIT license, see LICENSE.txt
+
+"""Time how long it takes to open a large random alignment and touch a
+few genomes in it, for both storage formats.  Opening should only read the
+tree and genome names, so these times should stay in the milliseconds no
+matter how many genomes the alignment has."""
+
+import argparse
+import os
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def runHalGen(preset, seed, numGenomes, storageFormat, outPath):
+    subprocess.check_call(["halRandGen", "--preset", preset, "--seed", str(seed),
+                           "--minGenomes", "2", "--maxGenomes", str(numGenomes),
+                           "--meanDegree", "1.7", "--format", storageFormat, outPath],
+                          stdout=subprocess.DEVNULL)
+
+
+def medianMs(cmd, reps):
+    times = []
+    for i in range(reps):
+        start = time.perf_counter()
+        subprocess.check_call(cmd, stdout=subprocess.DEVNULL)
+        times.append((time.perf_counter() - start) * 1000.0)
+    return statistics.median(times)
+
+
+def getLeaves(halPath):
+    out = subprocess.check_output(["halStats", "--genomes", halPath]).decode()
+    genomes = out.split()
+    leaves = []
+    for genome in genomes:
+        children = subprocess.check_output(["halStats", "--children", genome, halPath]).decode().split()
+        if len(children) == 0:
+            leaves.append(genome)
+    return leaves
+
+
+def firstSequence(halPath, genome):
+    out = subprocess.check_output(["halStats", "--chromSizes", genome, halPath]).decode()
+    name, length = out.split("\n")[0].split()
+    return name, int(length)
+
+
+def benchmark(halPath, reps, workDir):
+    leaves = getLeaves(halPath)
+    src, tgt = leaves[0], leaves[-1]
+    seqName, seqLength = firstSequence(halPath, src)
+    bedPath = os.path.join(workDir, "query.bed")
+    with open(bedPath, "w") as bed:
+        bed.write("%s\t0\t%d\n" % (seqName, min(seqLength, 1000)))
+    return [("open (root)", medianMs(["halStats", "--root", halPath], reps)),
+            ("genome names", medianMs(["halStats", "--genomes", halPath], reps)),
+            ("one genome", medianMs(["halStats", "--chromSizes", src, halPath], reps)),
+            ("leaf liftover", medianMs(["halLiftover", halPath, src, bedPath, tgt, "/dev/null"], reps))]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--preset", default="small",
+                        help="halRandGen preset to use [small, medium, big, large]")
+    parser.add_argument("--numGenomes", type=int, default=300,
+                        help="maximum number of genomes in the random alignment")
+    parser.add_argument("--seed", type=int, default=4, help="random seed")
+    parser.add_argument("--reps", type=int, default=10, help="repetitions of each command")
+    parser.add_argument("--formats", default="mmap,hdf5", help="comma-separated storage formats to test")
+    parser.add_argument("--keep", action="store_true", help="keep the generated alignments")
+    args = parser.parse_args()
+
+    workDir = tempfile.mkdtemp(prefix="halOpenLatency")
+    try:
+        for storageFormat in args.formats.split(","):
+            halPath = os.path.join(workDir, "random.%s.hal" % storageFormat)
+            runHalGen(args.preset, args.seed, args.numGenomes, storageFormat, halPath)
+            for name, ms in benchmark(halPath, args.reps, workDir):
+                print("%s\t%s\t%.1f ms" % (storageFormat, name, ms))
+            sys.stdout.flush()
+    finally:
+        if args.keep:
+            print("alignments kept in %s" % workDir)
+        else:
+            shutil.rmtree(workDir)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+
+# Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+#
+# Released under the MIT license, see LICENSE.txt
+
+"""Compare getting every homology block between two genomes with hal2paf,
+which maps the source segments in batches, to lifting over the whole source
+genome with halLiftover, which maps them one at a time.  The genomes are the
+deepest leaf of a random, nearly linear tree and the leaf furthest from it;
+both tools cover the same aligned source bases."""
+
+import argparse
+import os
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+from segmentMapping import chooseGenomes
+
+
+def medianSecs(cmd, reps):
+    times = []
+    for i in range(reps):
+        start = time.perf_counter()
+        subprocess.check_call(cmd, stdout=subprocess.DEVNULL)
+        times.append(time.perf_counter() - start)
+    return statistics.median(times)
+
+
+def writeSequences(halPath, genome, bedPath):
+    out = subprocess.check_output(["halStats", "--chromSizes", genome, halPath]).decode()
+    with open(bedPath, "w") as bed:
+        for line in out.splitlines():
+            name, length = line.split()
+            bed.write("%s\t0\t%s\n" % (name, length))
+
+
+def pafBases(pafPath):
+    with open(pafPath) as paf:
+        return sum(int(line.split("\t")[10]) for line in paf)
+
+
+def bedBases(bedPath):
+    with open(bedPath) as bed:
+        return sum(int(line.split()[2]) - int(line.split()[1]) for line in bed)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--hal", help="alignment to use (default: generate one)")
+    parser.add_argument("--format", default="mmap", help="storage format of the generated alignment")
+    parser.add_argument("--preset", default="medium",
+                        help="halRandGen preset to generate [small, medium, big, large]")
+    parser.add_argument("--maxGenomes", type=int, default=30, help="maximum number of genomes of the generated alignment")
+    parser.add_argument("--seed", type=int, default=6, help="random seed (the default gives a deep tree)")
+    parser.add_argument("--reps", type=int, default=3, help="number of runs to take the median time of")
+    args = parser.parse_args()
+
+    workDir = tempfile.mkdtemp(prefix="halPairwiseBlocks")
+    try:
+        halPath = args.hal
+        if halPath is None:
+            halPath = os.path.join(workDir, "deep.hal")
+            subprocess.check_call(["halRandGen", "--preset", args.preset, "--seed", str(args.seed),
+                                   "--minGenomes", "1", "--maxGenomes", str(args.maxGenomes),
+                                   "--meanDegree", "1.5", "--format", args.format, halPath],
+                                  stdout=subprocess.DEVNULL)
+        src, tgt, numBranches = chooseGenomes(halPath)
+        print("%s -> %s: %d branches" % (src, tgt, numBranches))
+
+        pafPath = os.path.join(workDir, "blocks.paf")
+        inBedPath = os.path.join(workDir, "sequences.bed")
+        outBedPath = os.path.join(workDir, "lifted.bed")
+        writeSequences(halPath, src, inBedPath)
+        runs = [("hal2paf", ["hal2paf", halPath, src, tgt, pafPath], lambda: pafBases(pafPath)),
+                ("halLiftover", ["halLiftover", halPath, src, inBedPath, tgt, outBedPath],
+                 lambda: bedBases(outBedPath))]
+        print("tool\tsecs\taligned bases\tbases/sec")
+        for name, cmd, countBases in runs:
+            secs = medianSecs(cmd, args.reps)
+            numBases = countBases()
+            print("%s\t%.2f\t%d\t%.0f" % (name, secs, numBases, numBases / secs))
+            sys.stdout.flush()
+    finally:
+        shutil.rmtree(workDir)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
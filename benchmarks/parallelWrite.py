@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+
+# Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+#
+# Released under the MIT license, see LICENSE.txt
+
+"""Time creating a random HDF5 alignment with halRandGen using different
+numbers of threads.  With more than one thread, chunks are compressed on
+the thread pool and written directly, so creation should get faster while
+the files stay the same size."""
+
+import argparse
+import os
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def timeHalGen(preset, seed, compression, numThreads, outPath, reps):
+    times = []
+    for i in range(reps):
+        if os.path.exists(outPath):
+            os.remove(outPath)
+        start = time.perf_counter()
+        subprocess.check_call(["halRandGen", "--preset", preset, "--seed", str(seed),
+                               "--format", "hdf5", "--hdf5Compression", str(compression),
+                               "--numThreads", str(numThreads), outPath],
+                              stdout=subprocess.DEVNULL)
+        times.append(time.perf_counter() - start)
+    return statistics.median(times)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--preset", default="medium",
+                        help="halRandGen preset to use [small, medium, big, large]")
+    parser.add_argument("--seed", type=int, default=4, help="random seed")
+    parser.add_argument("--compression", type=int, default=2, help="deflate level (1-9)")
+    parser.add_argument("--threads", default="1,2,4,8", help="comma-separated numbers of threads to test")
+    parser.add_argument("--reps", type=int, default=3, help="repetitions of each run")
+    parser.add_argument("--keep", action="store_true", help="keep the generated alignments")
+    args = parser.parse_args()
+
+    workDir = tempfile.mkdtemp(prefix="halParallelWrite")
+    try:
+        baseline = None
+        print("threads\ttime\tspeedup\tfile size")
+        for numThreads in [int(n) for n in args.threads.split(",")]:
+            halPath = os.path.join(workDir, "random.%d.hal" % numThreads)
+            seconds = timeHalGen(args.preset, args.seed, args.compression, numThreads, halPath, args.reps)
+            if baseline is None:
+                baseline = seconds
+            print("%d\t%.2f s\t%.2fx\t%d" % (numThreads, seconds, baseline / seconds, os.path.getsize(halPath)))
+            sys.stdout.flush()
+    finally:
+        if args.keep:
+            print("alignments kept in %s" % workDir)
+        else:
+            shutil.rmtree(workDir)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+
+# Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+#
+# Released under the MIT license, see LICENSE.txt
+
+"""Measure segment mapping throughput (halMapSegment) on a deep tree:
+lift windows tiling the deepest leaf of a random, nearly linear tree to
+the leaf furthest from it, and report the mapped segments (output BED
+records) per second.  Give --baseline a bin directory of another build
+to compare against it."""
+
+import argparse
+import os
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def medianSecs(cmd, reps):
+    times = []
+    for i in range(reps):
+        start = time.perf_counter()
+        subprocess.check_call(cmd, stdout=subprocess.DEVNULL)
+        times.append(time.perf_counter() - start)
+    return statistics.median(times)
+
+
+def getParents(halPath):
+    genomes = subprocess.check_output(["halStats", "--genomes", halPath]).decode().split()
+    parents = {}
+    for genome in genomes:
+        parents[genome] = subprocess.check_output(["halStats", "--parent", genome, halPath]).decode().strip()
+    return parents
+
+
+def getAncestors(parents, genome):
+    ancestors = [genome]
+    while parents[ancestors[-1]] != "":
+        ancestors.append(parents[ancestors[-1]])
+    return ancestors
+
+
+def pathLength(parents, genome1, genome2):
+    ancestors1 = getAncestors(parents, genome1)
+    ancestors2 = getAncestors(parents, genome2)
+    common = set(ancestors1) & set(ancestors2)
+    return (len([a for a in ancestors1 if a not in common]) + len([a for a in ancestors2 if a not in common]))
+
+
+def chooseGenomes(halPath):
+    """deepest leaf, and the leaf furthest from it"""
+    parents = getParents(halPath)
+    leaves = [g for g in parents if g not in parents.values()]
+    src = max(leaves, key=lambda g: len(getAncestors(parents, g)))
+    tgt = max([g for g in leaves if g != src], key=lambda g: pathLength(parents, src, g))
+    return src, tgt, pathLength(parents, src, tgt)
+
+
+def writeWindows(halPath, genome, windowSize, bedPath):
+    out = subprocess.check_output(["halStats", "--chromSizes", genome, halPath]).decode()
+    with open(bedPath, "w") as bed:
+        for line in out.splitlines():
+            name, length = line.split()
+            for start in range(0, int(length), windowSize):
+                bed.write("%s\t%d\t%d\n" % (name, start, min(start + windowSize, int(length))))
+
+
+def countLines(path):
+    with open(path) as fh:
+        return sum(1 for line in fh)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--hal", help="alignment to map in (default: generate one)")
+    parser.add_argument("--format", default="mmap", help="storage format of the generated alignment")
+    parser.add_argument("--preset", default="medium",
+                        help="halRandGen preset to generate [small, medium, big, large]")
+    parser.add_argument("--maxGenomes", type=int, default=30, help="maximum number of genomes of the generated alignment")
+    parser.add_argument("--seed", type=int, default=6, help="random seed (the default gives a deep tree)")
+    parser.add_argument("--windowSize", type=int, default=200, help="size of the windows lifted")
+    parser.add_argument("--reps", type=int, default=3, help="number of runs to take the median time of")
+    parser.add_argument("--baseline", help="bin directory of another build to compare against")
+    args = parser.parse_args()
+
+    workDir = tempfile.mkdtemp(prefix="halSegmentMapping")
+    try:
+        halPath = args.hal
+        if halPath is None:
+            halPath = os.path.join(workDir, "deep.hal")
+            subprocess.check_call(["halRandGen", "--preset", args.preset, "--seed", str(args.seed),
+                                   "--minGenomes", "1", "--maxGenomes", str(args.maxGenomes),
+                                   "--meanDegree", "1.5", "--format", args.format, halPath],
+                                  stdout=subprocess.DEVNULL)
+        src, tgt, numBranches = chooseGenomes(halPath)
+        bedPath = os.path.join(workDir, "windows.bed")
+        writeWindows(halPath, src, args.windowSize, bedPath)
+        print("%s -> %s: %d branches, %d windows" % (src, tgt, numBranches, countLines(bedPath)))
+
+        builds = [("current", "halLiftover")]
+        if args.baseline is not None:
+            builds.append(("baseline", os.path.join(args.baseline, "halLiftover")))
+        print("build\tsecs\tsegments\tsegments/sec")
+        for name, liftover in builds:
+            outPath = os.path.join(workDir, name + ".bed")
+            cmd = [liftover, halPath, src, bedPath, tgt, outPath]
+            secs = medianSecs(cmd, args.reps)
+            numSegments = countLines(outPath)
+            print("%s\t%.2f\t%d\t%.0f" % (name, secs, numSegments, numSegments / secs))
+            sys.stdout.flush()
+    finally:
+        shutil.rmtree(workDir)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/* Measure the speed of reading the fields the tree traversals use from
+ * every segment of every genome of an mmap alignment, through the virtual
+ * segment interface and through the in-place column reader. */
+
+#include "hal.h"
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+using namespace hal;
+
+static void initParser(CLParser &optionsParser) {
+    optionsParser.addArgument("halFile", "input mmap hal file");
+    optionsParser.addOption("reps", "number of times to read all the segments", 20);
+    optionsParser.setDescription("Measure segment reading with the virtual and column segment readers.");
+}
+
+static vector<const Genome *> getGenomes(const Alignment *alignment) {
+    vector<string> names(1, alignment->getRootName());
+    for (size_t i = 0; i < names.size(); i++) {
+        vector<string> childNames = alignment->getChildNames(names[i]);
+        names.insert(names.end(), childNames.begin(), childNames.end());
+    }
+    vector<const Genome *> genomes;
+    for (const string &name : names) {
+        genomes.push_back(alignment->openGenome(name));
+    }
+    return genomes;
+}
+
+/* read the fields the traversals use from every segment of a genome, as
+ * a checksum */
+template <class Reader> static hal_index_t readSegments(const Reader &reader, const Genome *genome) {
+    hal_index_t checkSum = 0;
+    for (hal_index_t i = 0; i < (hal_index_t)reader.getNumTopSegments(); ++i) {
+        checkSum += reader.getTopStartPosition(i) + reader.getTopLength(i) + reader.getTopParentIndex(i) +
+                    reader.getTopParentReversed(i) + reader.getTopBottomParseIndex(i) + reader.getTopNextParalogyIndex(i);
+    }
+    for (hal_index_t i = 0; i < (hal_index_t)reader.getNumBottomSegments(); ++i) {
+        checkSum += reader.getBottomStartPosition(i) + reader.getBottomLength(i) + reader.getBottomTopParseIndex(i);
+        for (hal_size_t child = 0; child < genome->getNumChildren(); ++child) {
+            checkSum += reader.getBottomChildIndex(i, child) + reader.getBottomChildReversed(i, child);
+        }
+    }
+    return checkSum;
+}
+
+/* time reading all segments of the genomes, returning segments per second */
+template <class Reader>
+static double timeReads(const vector<const Genome *> &genomes, size_t reps, hal_index_t &checkSum) {
+    hal_size_t numSegments = 0;
+    auto start = chrono::steady_clock::now();
+    for (size_t rep = 0; rep < reps; ++rep) {
+        for (const Genome *genome : genomes) {
+            Reader reader;
+            if (not reader.open(genome)) {
+                throw hal_exception("can't read the segments of " + genome->getName() + " in place");
+            }
+            checkSum += readSegments(reader, genome);
+            numSegments += reader.getNumTopSegments() + reader.getNumBottomSegments();
+        }
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    return numSegments / elapsed.count();
+}
+
+int main(int argc, char **argv) {
+    CLParser optionsParser;
+    initParser(optionsParser);
+    string halPath;
+    size_t reps;
+    try {
+        optionsParser.parseOptions(argc, argv);
+        halPath = optionsParser.getArgument<string>("halFile");
+        reps = optionsParser.getOption<size_t>("reps");
+    } catch (exception &e) {
+        cerr << e.what() << endl;
+        optionsParser.printUsage(cerr);
+        return 1;
+    }
+
+    try {
+        AlignmentConstPtr alignment(openHalAlignment(halPath, &optionsParser));
+        vector<const Genome *> genomes = getGenomes(alignment.get());
+        hal_index_t virtualSum = 0, columnSum = 0;
+        double virtualRate = timeReads<VirtualSegmentReader>(genomes, reps, virtualSum);
+        double columnRate = timeReads<ColumnSegmentReader>(genomes, reps, columnSum);
+        if (virtualSum != columnSum) {
+            throw hal_exception("virtual and column segment readers differ");
+        }
+        cout << "reader\tsegments/sec" << endl;
+        cout << "virtual\t" << virtualRate << endl;
+        cout << "columns\t" << columnRate << endl;
+    } catch (exception &e) {
+        cerr << "Exception caught: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+
+# Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+#
+# Released under the MIT license, see LICENSE.txt
+
+"""Time short-lived processes querying the same HDF5 alignment, the way
+browser servers and batch jobs do, without and with a directory of
+decompressed chunks shared between them (--hdf5SharedCacheDir).  The
+first process with a shared directory fills it; the times reported are
+for the processes after it."""
+
+import argparse
+import os
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def medianMs(cmds):
+    times = []
+    for cmd in cmds:
+        start = time.perf_counter()
+        subprocess.check_call(cmd, stdout=subprocess.DEVNULL)
+        times.append((time.perf_counter() - start) * 1000.0)
+    return statistics.median(times)
+
+
+def getGenomes(halPath):
+    return subprocess.check_output(["halStats", "--genomes", halPath]).decode().split()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--hal", help="hdf5 alignment to query (default: generate one)")
+    parser.add_argument("--preset", default="big",
+                        help="halRandGen preset to generate [small, medium, big, large]")
+    parser.add_argument("--seed", type=int, default=4, help="random seed")
+    parser.add_argument("--reps", type=int, default=10, help="number of processes to time")
+    parser.add_argument("--sharedDir", default=None,
+                        help="shared chunk directory to use (default: a new one under /dev/shm if it "
+                        "exists, else the temporary directory)")
+    args = parser.parse_args()
+
+    workDir = tempfile.mkdtemp(prefix="halSharedChunkCache")
+    shmDir = "/dev/shm" if os.path.isdir("/dev/shm") else None
+    sharedDir = args.sharedDir or tempfile.mkdtemp(prefix="halSharedChunks", dir=shmDir)
+    try:
+        halPath = args.hal
+        if halPath is None:
+            halPath = os.path.join(workDir, "random.hal")
+            subprocess.check_call(["halRandGen", "--preset", args.preset, "--seed", str(args.seed),
+                                   "--format", "hdf5", halPath], stdout=subprocess.DEVNULL)
+        genomes = getGenomes(halPath)
+        src, tgt = genomes[-1], genomes[1]
+        bedPath = os.path.join(workDir, "query.bed")
+        with open(bedPath, "w") as bed:
+            bed.write(subprocess.check_output(["halStats", "--bedSequences", src, halPath]).decode())
+        queries = [("hal2fasta", ["hal2fasta", halPath, src]),
+                   ("halLiftover", ["halLiftover", halPath, src, bedPath, tgt, "/dev/null"])]
+
+        print("query\tprivate\tshared")
+        for name, cmd in queries:
+            privateMs = medianMs([cmd] * args.reps)
+            sharedCmd = cmd + ["--hdf5SharedCacheDir", sharedDir]
+            subprocess.check_call(sharedCmd, stdout=subprocess.DEVNULL)
+            sharedMs = medianMs([sharedCmd] * args.reps)
+            print("%s\t%.1f ms\t%.1f ms" % (name, privateMs, sharedMs))
+            sys.stdout.flush()
+    finally:
+        shutil.rmtree(workDir)
+        if args.sharedDir is None:
+            shutil.rmtree(sharedDir)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
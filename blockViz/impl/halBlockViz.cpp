@@ -289,6 +289,7 @@ extern "C" struct hal_block_results_t *halGetBlocksInTargetRange(int halHandle,
             seqAlignment = getExistingAlignment(halHandle, absEnd - absStart, true);
         }
 
+        tGenome->prefetchRange(absStart, absEnd - absStart + 1);
         results = readBlocks(seqAlignment, tSequence, absStart, absEnd, tReversed != 0, qGenome, getSequenceString,
                              dupMode != HAL_NO_DUPS, dupMode == HAL_QUERY_AND_TARGET_DUPS, mapBackAdjacencies != 0,
                              coalescenceLimitName);
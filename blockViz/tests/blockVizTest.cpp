@@ -45,7 +45,7 @@ static void initParser(hal::CLParser &optionsParser) {
     optionsParser.addOptionFlag("verbose", "verbose tracing", false);
     optionsParser.addOptionFlag("doSeq", "get seqeuence", false);
     optionsParser.addOptionFlag("doDupes", "get duplicate regions", false);
-    optionsParser.addOption("numThreads", "number of threads for thread tests", 10);
+    optionsParser.addOption("numTestThreads", "number of threads for thread tests", 10);
     optionsParser.addOption("coalescenceLimit", "coalescence limit specices, default is none", "");
     optionsParser.addArgument("halLodPath", "path to HAL or LOD file");
     optionsParser.addArgument("qSpecies", "query species name");
@@ -89,7 +89,7 @@ static bool parseArgs(int argc, char **argv, bv_args_t *args) {
     args->tEnd = optionsParser.get<int>("tEnd");
     args->doSeq = optionsParser.get<bool>("doSeq");
     args->doDupes = optionsParser.get<bool>("doDupes");
-    args->numThreads = optionsParser.get<int>("numThreads");
+    args->numThreads = optionsParser.get<int>("numTestThreads");
     args->coalescenceLimit = optionStrOrNull(optionsParser, "coalescenceLimit");
     args->verbose = optionsParser.get<bool>("verbose");
     return true;
@@ -5,83 +5,14 @@
  * Released under the MIT license, see LICENSE.txt
  */
 
-#include "hal.h"
-#include <cstdlib>
+#include "halExtract.h"
+#include <cassert>
 #include <iostream>
 
 using namespace std;
 using namespace hal;
 
-static void getDimensions(const Alignment *outAlignment, const Genome *genome, vector<Sequence::Info> &dimensions);
-
-static void copyGenome(const Genome *inGenome, Genome *outGenome);
-
-static void extractTree(const Alignment *inAlignment, AlignmentPtr outAlignment, const string &rootName);
-
-static void extract(const Alignment *inAlignment, AlignmentPtr outAlignment, const string &rootName);
-
-static void initParser(CLParser &optionsParser) {
-    optionsParser.addArgument("inHalPath", "input hal file");
-    optionsParser.addArgument("outHalPath", "output hal file");
-    optionsParser.addOption("outputFormat", "format for output hal file (same as input file by default)", "");
-    optionsParser.addOption("root", "root of subtree to extract", "\"\"");
-}
-
-int main(int argc, char **argv) {
-    CLParser optionsParser(CREATE_ACCESS);
-    initParser(optionsParser);
-
-    string inHalPath;
-    string outHalPath;
-    string rootName;
-    string outputFormat;
-    try {
-        optionsParser.parseOptions(argc, argv);
-        inHalPath = optionsParser.getArgument<string>("inHalPath");
-        outHalPath = optionsParser.getArgument<string>("outHalPath");
-        rootName = optionsParser.getOption<string>("root");
-        outputFormat = optionsParser.getOption<string>("outputFormat");
-    } catch (exception &e) {
-        cerr << e.what() << endl;
-        optionsParser.printUsage(cerr);
-        exit(1);
-    }
-
-    try {
-        const Alignment *inAlignment = openHalAlignment(inHalPath, &optionsParser);
-        if (inAlignment->getNumGenomes() == 0) {
-            throw hal_exception("input hal alignmenet is empty");
-        }
-
-        if (outputFormat.empty()) {
-            // No alignment format specified, just use the same as the input format.
-            outputFormat = inAlignment->getStorageFormat();
-        }
-
-        AlignmentPtr outAlignment(
-            openHalAlignment(outHalPath, &optionsParser, READ_ACCESS | WRITE_ACCESS | CREATE_ACCESS, outputFormat));
-        if (outAlignment->getNumGenomes() != 0) {
-            throw hal_exception("output hal alignmenet cannot be initialized");
-        }
-
-        if (rootName == "\"\"" || inAlignment->getNumGenomes() == 0) {
-            rootName = inAlignment->getRootName();
-        }
-
-        extractTree(inAlignment, outAlignment, rootName);
-        extract(inAlignment, outAlignment, rootName);
-        outAlignment->close();
-    } catch (hal_exception &e) {
-        cerr << "hal exception caught: " << e.what() << endl;
-        return 1;
-    } catch (exception &e) {
-        cerr << "Exception caught: " << e.what() << endl;
-        return 1;
-    }
-    return 0;
-}
-
-void getDimensions(const Alignment *outAlignment, const Genome *genome, vector<Sequence::Info> &dimensions) {
+static void getDimensions(const Alignment *outAlignment, const Genome *genome, vector<Sequence::Info> &dimensions) {
     assert(dimensions.size() == 0);
 
     bool root = outAlignment->getParentName(genome->getName()).empty();
@@ -95,7 +26,7 @@ void getDimensions(const Alignment *outAlignment, const Genome *genome, vector<S
     }
 }
 
-void copyGenome(const Genome *inGenome, Genome *outGenome) {
+static void copyGenome(const Genome *inGenome, Genome *outGenome) {
     DnaIteratorPtr inDna = inGenome->getDnaIterator();
     DnaIteratorPtr outDna = outGenome->getDnaIterator();
     hal_size_t n = inGenome->getSequenceLength();
@@ -143,7 +74,7 @@ void copyGenome(const Genome *inGenome, Genome *outGenome) {
     }
 }
 
-static void extractTree(const Alignment *inAlignment, AlignmentPtr outAlignment, const string &rootName) {
+static void extractTree(const Alignment *inAlignment, Alignment *outAlignment, const string &rootName) {
     const Genome *genome = inAlignment->openGenome(rootName);
     if (genome == NULL) {
         throw hal_exception(string("Genome not found: ") + rootName);
@@ -168,7 +99,7 @@ static void extractTree(const Alignment *inAlignment, AlignmentPtr outAlignment,
     }
 }
 
-void extract(const Alignment *inAlignment, AlignmentPtr outAlignment, const string &rootName) {
+static void extract(const Alignment *inAlignment, Alignment *outAlignment, const string &rootName, ostream *progress) {
     const Genome *genome = inAlignment->openGenome(rootName);
     Genome *newGenome = outAlignment->openGenome(rootName);
     assert(newGenome != NULL);
@@ -177,7 +108,9 @@ void extract(const Alignment *inAlignment, AlignmentPtr outAlignment, const stri
     getDimensions(inAlignment, genome, dimensions);
     newGenome->setDimensions(dimensions);
 
-    cout << "Extracting " << genome->getName() << endl;
+    if (progress != NULL) {
+        *progress << "Extracting " << genome->getName() << endl;
+    }
     copyGenome(genome, newGenome);
 
     inAlignment->closeGenome(genome);
@@ -185,6 +118,25 @@ void extract(const Alignment *inAlignment, AlignmentPtr outAlignment, const stri
 
     vector<string> childNames = inAlignment->getChildNames(rootName);
     for (size_t i = 0; i < childNames.size(); ++i) {
-        extract(inAlignment, outAlignment, childNames[i]);
+        extract(inAlignment, outAlignment, childNames[i], progress);
+    }
+}
+
+void hal::extractSubtree(const Alignment *inAlignment, Alignment *outAlignment, const string &rootName, ostream *progress) {
+    if (outAlignment->getNumGenomes() != 0) {
+        throw hal_exception("output hal alignmenet cannot be initialized");
+    }
+    extractTree(inAlignment, outAlignment, rootName);
+    if ((inAlignment->getStorageFormat() == STORAGE_FORMAT_HDF5) and
+        (outAlignment->getStorageFormat() == STORAGE_FORMAT_MMAP)) {
+        // copy whole chunks, and different genomes in parallel
+        vector<string> genomeNames(1, rootName);
+        for (size_t i = 0; i < genomeNames.size(); ++i) {
+            vector<string> childNames = inAlignment->getChildNames(genomeNames[i]);
+            genomeNames.insert(genomeNames.end(), childNames.begin(), childNames.end());
+        }
+        copyHdf5GenomesToMMap(inAlignment, outAlignment, genomeNames, progress);
+    } else {
+        extract(inAlignment, outAlignment, rootName, progress);
     }
 }
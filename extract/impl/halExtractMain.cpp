@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2012 by Glenn Hickey (hickey@soe.ucsc.edu)
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halExtract.h"
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+using namespace hal;
+
+static void initParser(CLParser &optionsParser) {
+    optionsParser.addArgument("inHalPath", "input hal file");
+    optionsParser.addArgument("outHalPath", "output hal file");
+    optionsParser.addOption("outputFormat", "format for output hal file (same as input file by default)", "");
+    optionsParser.addOption("root", "root of subtree to extract", "\"\"");
+}
+
+int main(int argc, char **argv) {
+    CLParser optionsParser(CREATE_ACCESS);
+    initParser(optionsParser);
+
+    string inHalPath;
+    string outHalPath;
+    string rootName;
+    string outputFormat;
+    try {
+        optionsParser.parseOptions(argc, argv);
+        inHalPath = optionsParser.getArgument<string>("inHalPath");
+        outHalPath = optionsParser.getArgument<string>("outHalPath");
+        rootName = optionsParser.getOption<string>("root");
+        outputFormat = optionsParser.getOption<string>("outputFormat");
+    } catch (exception &e) {
+        cerr << e.what() << endl;
+        optionsParser.printUsage(cerr);
+        exit(1);
+    }
+
+    try {
+        const Alignment *inAlignment = openHalAlignment(inHalPath, &optionsParser);
+        if (inAlignment->getNumGenomes() == 0) {
+            throw hal_exception("input hal alignmenet is empty");
+        }
+
+        if (outputFormat.empty()) {
+            // No alignment format specified, just use the same as the input format.
+            outputFormat = inAlignment->getStorageFormat();
+        }
+
+        AlignmentPtr outAlignment(
+            openHalAlignment(outHalPath, &optionsParser, READ_ACCESS | WRITE_ACCESS | CREATE_ACCESS, outputFormat));
+        if (rootName == "\"\"" || inAlignment->getNumGenomes() == 0) {
+            rootName = inAlignment->getRootName();
+        }
+
+        extractSubtree(inAlignment, outAlignment.get(), rootName, &cout);
+        outAlignment->close();
+    } catch (hal_exception &e) {
+        cerr << "hal exception caught: " << e.what() << endl;
+        return 1;
+    } catch (exception &e) {
+        cerr << "Exception caught: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
+
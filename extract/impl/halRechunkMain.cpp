@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halExtract.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+using namespace hal;
+
+static void initParser(CLParser &optionsParser) {
+    optionsParser.setDescription("Rewrite a HAL alignment as an HDF5 file for read-mostly serving: each dataset "
+                                 "gets chunks sized for its element size and length (see --hdf5ChunkBytes), "
+                                 "and the file is written compactly with the chosen --hdf5Codec.  The input "
+                                 "can be in either format.");
+    optionsParser.addArgument("inHalPath", "input hal file");
+    optionsParser.addArgument("outHalPath", "output hdf5 hal file");
+    optionsParser.addOptionFlag("progress", "report each genome as it is rewritten", false);
+}
+
+static hal_size_t getFileSize(const string &path) {
+    ifstream file(path.c_str(), ios::binary | ios::ate);
+    return file ? hal_size_t(file.tellg()) : 0;
+}
+
+int main(int argc, char **argv) {
+    CLParser optionsParser(CREATE_ACCESS);
+    initParser(optionsParser);
+
+    string inHalPath;
+    string outHalPath;
+    bool progress;
+    try {
+        optionsParser.parseOptions(argc, argv);
+        inHalPath = optionsParser.getArgument<string>("inHalPath");
+        outHalPath = optionsParser.getArgument<string>("outHalPath");
+        progress = optionsParser.getFlag("progress");
+    } catch (exception &e) {
+        cerr << e.what() << endl;
+        optionsParser.printUsage(cerr);
+        exit(1);
+    }
+
+    try {
+        AlignmentPtr inAlignment(openHalAlignment(inHalPath, &optionsParser));
+        if (inAlignment->getNumGenomes() == 0) {
+            throw hal_exception("input hal alignmenet is empty");
+        }
+        AlignmentPtr outAlignment(
+            openHalAlignment(outHalPath, &optionsParser, READ_ACCESS | WRITE_ACCESS | CREATE_ACCESS, STORAGE_FORMAT_HDF5));
+        extractSubtree(inAlignment.get(), outAlignment.get(), inAlignment->getRootName(), progress ? &cout : NULL);
+        outAlignment->close();
+        cout << inHalPath << ": " << getFileSize(inHalPath) << " bytes, " << outHalPath << ": " << getFileSize(outHalPath)
+             << " bytes" << endl;
+    } catch (hal_exception &e) {
+        cerr << "hal exception caught: " << e.what() << endl;
+        return 1;
+    } catch (exception &e) {
+        cerr << "Exception caught: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2012 by Glenn Hickey (hickey@soe.ucsc.edu)
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HALEXTRACT_H
+#define _HALEXTRACT_H
+
+#include "hal.h"
+#include <iostream>
+#include <string>
+
+namespace hal {
+
+    /** Copy the subtree of an alignment rooted at a genome, with its
+     * dimensions, DNA, segments and metadata, into an empty alignment,
+     * which is written with its own storage options.
+     * @param inAlignment alignment to copy from
+     * @param outAlignment empty alignment to copy to
+     * @param rootName root of the subtree to copy
+     * @param progress stream to report each genome copied to, or NULL */
+    void extractSubtree(const Alignment *inAlignment, Alignment *outAlignment, const std::string &rootName,
+                        std::ostream *progress);
+}
+
+#endif
+// Local Variables:
+// mode: c++
+// End:
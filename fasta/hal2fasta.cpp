@@ -11,18 +11,26 @@
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <vector>
 
 using namespace std;
 using namespace hal;
 
-static void printSequenceLine(ostream &outStream, const Sequence *sequence, hal_size_t start, hal_size_t length,
-                              string &buffer);
-static void printSequence(ostream &outStream, const Sequence *sequence, hal_size_t lineWidth, hal_size_t start,
-                          hal_size_t length);
+/* a block of whole lines of a sequence, preceded by the sequence's
+ * header if it is the first block */
+struct FastaBlock {
+    const Sequence *_sequence;
+    hal_size_t _start;
+    hal_size_t _length;
+    bool _header;
+};
+
+static void addSequenceBlocks(vector<FastaBlock> &blocks, const Sequence *sequence, hal_size_t lineWidth,
+                              hal_size_t start, hal_size_t length);
 static void printGenome(ostream &outStream, const Genome *genome, const Sequence *sequence, hal_size_t lineWidth,
                         hal_size_t start, hal_size_t length);
 
-static const hal_size_t StringBufferSize = 1024;
+static const hal_size_t StringBufferSize = 1024 * 1024;
 
 static void initParser(CLParser &optionsParser) {
     optionsParser.addArgument("inHalPath", "input hal file");
@@ -74,6 +82,7 @@ int main(int argc, char **argv) {
         if (alignment->getNumGenomes() == 0) {
             throw hal_exception("input hal alignmenet is empty");
         }
+        alignment->adviseSequential();
 
         const Genome *genome = alignment->openGenome(genomeName);
         if (genome == NULL) {
@@ -110,17 +119,8 @@ int main(int argc, char **argv) {
     return 0;
 }
 
-void printSequenceLine(ostream &outStream, const Sequence *sequence, hal_size_t start, hal_size_t length, string &buffer) {
-    hal_size_t last = start + length;
-    hal_size_t readLen;
-    for (hal_size_t i = start; i < last; i += StringBufferSize) {
-        readLen = std::min(StringBufferSize, last - i);
-        sequence->getSubString(buffer, i, readLen);
-        outStream << buffer;
-    }
-}
-
-void printSequence(ostream &outStream, const Sequence *sequence, hal_size_t lineWidth, hal_size_t start, hal_size_t length) {
+void addSequenceBlocks(vector<FastaBlock> &blocks, const Sequence *sequence, hal_size_t lineWidth, hal_size_t start,
+                       hal_size_t length) {
     hal_size_t seqLen = sequence->getSequenceLength();
     if (length == 0) {
         length = seqLen - start;
@@ -131,20 +131,42 @@ void printSequence(ostream &outStream, const Sequence *sequence, hal_size_t line
                             "out of range for sequence " + sequence->getName() + ", which has length " +
                             std::to_string(seqLen));
     }
-    outStream << '>' << sequence->getName() << '\n';
-    hal_size_t readLen;
-    string buffer;
-    for (hal_size_t i = start; i < last; i += lineWidth) {
-        readLen = std::min(lineWidth, last - i);
-        printSequenceLine(outStream, sequence, i, readLen, buffer);
-        outStream << '\n';
+    hal_size_t blockLines = std::max(StringBufferSize / lineWidth, hal_size_t(1));
+    vector<pair<hal_size_t, hal_size_t>> chunks = splitRange(start, length, blockLines * lineWidth);
+    if (chunks.empty()) {
+        // still print the header of an empty range
+        chunks.push_back(make_pair(start, 0));
+    }
+    for (size_t i = 0; i < chunks.size(); i++) {
+        FastaBlock block = {sequence, chunks[i].first, chunks[i].second, i == 0};
+        blocks.push_back(block);
+    }
+}
+
+/* decode a block of whole lines straight from the packed DNA into the
+ * output */
+static void formatBlock(const FastaBlock &block, hal_size_t lineWidth, string &output) {
+    if (block._header) {
+        output += '>' + block._sequence->getName() + '\n';
+    }
+    size_t outStart = output.size();
+    output.resize(outStart + block._length + (block._length + lineWidth - 1) / lineWidth);
+    char *out = &output[outStart];
+    PackedDnaSpan span;
+    block._sequence->getPackedDna(span, block._start, block._length);
+    for (hal_size_t j = 0; j < block._length; j += lineWidth) {
+        hal_size_t lineLen = std::min(lineWidth, block._length - j);
+        dnaUnpackString(span.getData(), span.isOdd() + j, lineLen, out);
+        out += lineLen;
+        *out++ = '\n';
     }
 }
 
 void printGenome(ostream &outStream, const Genome *genome, const Sequence *sequence, hal_size_t lineWidth, hal_size_t start,
                  hal_size_t length) {
+    vector<FastaBlock> blocks;
     if (sequence != NULL) {
-        printSequence(outStream, sequence, lineWidth, start, length);
+        addSequenceBlocks(blocks, sequence, lineWidth, start, length);
     } else {
         if (start + length > genome->getSequenceLength()) {
             throw hal_exception("Specified range [" + std::to_string(start) + "," + std::to_string(length) + "] is" +
@@ -165,9 +187,16 @@ void printGenome(ostream &outStream, const Genome *genome, const Sequence *seque
                 hal_size_t readStart = seqStart >= start ? 0 : seqStart - start;
                 hal_size_t readLen = std::min(seqLen - start, length - runningLength);
 
-                printSequence(outStream, sequence, lineWidth, readStart, readLen);
+                // the iterator's sequence is only valid until it moves on, so
+                // keep the genome's own
+                addSequenceBlocks(blocks, genome->getSequence(sequence->getName()), lineWidth, readStart, readLen);
                 runningLength += readLen;
             }
         }
     }
+
+    // blocks are decoded in parallel, and written in order
+    parallelOrderedOutput(blocks.size(), [&](size_t i, string &output) { formatBlock(blocks[i], lineWidth, output); },
+                          [&](const string &output) { outStream.write(output.data(), output.size()); },
+                          getReadThreadPool(genome->getAlignment()));
 }
@@ -47,7 +47,7 @@ ifeq (${CXX_11_ABI_DEF},)
 endif
 
 cflags += -I${sonLibDir} -fPIC
-cppflags += -I${sonLibDir} -fPIC ${CXX_11_ABI_DEF} -std=c++11 -Wno-sign-compare
+cppflags += -I${sonLibDir} -fPIC ${CXX_11_ABI_DEF} -std=c++11 -pthread -Wno-sign-compare
 
 basicLibs += ${sonLibDir}/sonLib.a ${sonLibDir}/cuTest.a
 basicLibsDependencies += ${sonLibDir}/sonLib.a ${sonLibDir}/cuTest.a
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "hal.h"
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+using namespace hal;
+
+static void initParser(CLParser &optionsParser) {
+    optionsParser.addArgument("halFile", "input hal file");
+    optionsParser.addArgument("srcGenome", "source (query) genome name");
+    optionsParser.addArgument("tgtGenome", "target genome name");
+    optionsParser.addArgument("outPafPath", "path of output PAF file.  set as stdout"
+                                            " to stream to standard output.");
+    optionsParser.addOptionFlag("noDupes", "do not map between duplications in"
+                                           " graph.",
+                                false);
+    optionsParser.addOption("coalescenceLimit", "coalescence limit genome:"
+                                                " the genome at or above the MRCA of source"
+                                                " and target at which we stop looking for"
+                                                " homologies (default: MRCA)",
+                            "");
+    optionsParser.setDescription("Write the ungapped homology blocks between two "
+                                 "genomes in PAF format, one line per block, "
+                                 "sorted by source position.");
+}
+
+/* number of equal bases (ignoring case) of a block */
+static hal_size_t countMatches(const PairwiseBlock &block, string &srcDna, string &tgtDna) {
+    const Sequence *srcSequence = block._srcSequence;
+    const Sequence *tgtSequence = block._tgtSequence;
+    srcSequence->getSubString(srcDna, block._srcStart - srcSequence->getStartPosition(), block._length);
+    tgtSequence->getSubString(tgtDna, block._tgtStart - tgtSequence->getStartPosition(), block._length);
+    if (block._reversed) {
+        reverseComplement(tgtDna);
+    }
+    hal_size_t matches = 0;
+    for (hal_size_t i = 0; i < block._length; ++i) {
+        if (toupper(srcDna[i]) == toupper(tgtDna[i])) {
+            ++matches;
+        }
+    }
+    return matches;
+}
+
+static void writePaf(const Genome *srcGenome, const Genome *tgtGenome, bool noDupes, const Genome *coalescenceLimit,
+                     ostream &pafStream) {
+    string srcDna, tgtDna;
+    for (PairwiseBlockIterator blockIt(srcGenome, tgtGenome, !noDupes, coalescenceLimit); not blockIt.atEnd();
+         blockIt.toNext()) {
+        const PairwiseBlock &block = blockIt.getBlock();
+        const Sequence *srcSequence = block._srcSequence;
+        const Sequence *tgtSequence = block._tgtSequence;
+        hal_index_t srcStart = block._srcStart - srcSequence->getStartPosition();
+        hal_index_t tgtStart = block._tgtStart - tgtSequence->getStartPosition();
+        pafStream << srcSequence->getName() << '\t' << srcSequence->getSequenceLength() << '\t' << srcStart << '\t'
+                  << srcStart + block._length << '\t' << (block._reversed ? '-' : '+') << '\t' << tgtSequence->getName()
+                  << '\t' << tgtSequence->getSequenceLength() << '\t' << tgtStart << '\t' << tgtStart + block._length
+                  << '\t' << countMatches(block, srcDna, tgtDna) << '\t' << block._length << '\t' << 255 << '\t'
+                  << "cg:Z:" << block._length << 'M' << '\n';
+    }
+}
+
+int main(int argc, char **argv) {
+    CLParser optionsParser;
+    initParser(optionsParser);
+
+    string halPath;
+    string srcGenomeName;
+    string tgtGenomeName;
+    string outPafPath;
+    string coalescenceLimitName;
+    bool noDupes;
+    try {
+        optionsParser.parseOptions(argc, argv);
+        halPath = optionsParser.getArgument<string>("halFile");
+        srcGenomeName = optionsParser.getArgument<string>("srcGenome");
+        tgtGenomeName = optionsParser.getArgument<string>("tgtGenome");
+        outPafPath = optionsParser.getArgument<string>("outPafPath");
+        coalescenceLimitName = optionsParser.getOption<string>("coalescenceLimit");
+        noDupes = optionsParser.getFlag("noDupes");
+    } catch (exception &e) {
+        cerr << e.what() << endl;
+        optionsParser.printUsage(cerr);
+        exit(1);
+    }
+
+    try {
+        AlignmentConstPtr alignment(openHalAlignment(halPath, &optionsParser));
+        if (alignment->getNumGenomes() == 0) {
+            throw hal_exception("hal alignment is empty");
+        }
+
+        const Genome *srcGenome = alignment->openGenome(srcGenomeName);
+        if (srcGenome == NULL) {
+            throw hal_exception(string("srcGenome, ") + srcGenomeName + ", not found in alignment");
+        }
+        const Genome *tgtGenome = alignment->openGenome(tgtGenomeName);
+        if (tgtGenome == NULL) {
+            throw hal_exception(string("tgtGenome, ") + tgtGenomeName + ", not found in alignment");
+        }
+
+        const Genome *coalescenceLimit = NULL;
+        if (coalescenceLimitName != "") {
+            coalescenceLimit = alignment->openGenome(coalescenceLimitName);
+            if (coalescenceLimit == NULL) {
+                throw hal_exception("coalescence limit genome " + coalescenceLimitName + " not found in alignment\n");
+            }
+        }
+
+        ofstream pafFile;
+        ostream *pafStream;
+        if (outPafPath == "stdout") {
+            pafStream = &cout;
+        } else {
+            pafFile.open(outPafPath.c_str());
+            pafStream = &pafFile;
+            if (!pafFile) {
+                throw hal_exception("Error opening outPafPath, " + outPafPath);
+            }
+        }
+        writePaf(srcGenome, tgtGenome, noDupes, coalescenceLimit, *pafStream);
+        pafStream->flush();
+        if (!*pafStream) {
+            throw hal_exception("Error writing " + outPafPath);
+        }
+    } catch (hal_exception &e) {
+        cerr << "hal exception caught: " << e.what() << endl;
+        return 1;
+    } catch (exception &e) {
+        cerr << "Exception caught: " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -7,6 +7,7 @@
 
 #include "halBlockLiftover.h"
 #include "halBlockMapper.h"
+#include "halLiftoverIndex.h"
 #include "halSegmentMapper.h"
 #include <cassert>
 #include <deque>
@@ -14,7 +15,7 @@
 using namespace std;
 using namespace hal;
 
-BlockLiftover::BlockLiftover() : Liftover() {
+BlockLiftover::BlockLiftover() : Liftover(), _index(NULL) {
 }
 
 BlockLiftover::~BlockLiftover() {
@@ -64,7 +65,12 @@ void BlockLiftover::liftInterval(BedList &mappedBedLines) {
         if (flip == true) {
             _refSeg->toReverseInPlace();
         }
-        halMapSegment(_refSeg.get(), _mappedSegments, _tgtGenome, &_downwardPath, _traverseDupes, 0, _coalescenceLimit, _mrca);
+        if (_index != NULL) {
+            _index->mapSegment(_refSeg.get(), _tgtGenome, _mappedSegments);
+        } else {
+            halMapSegment(_refSeg.get(), _mappedSegments, _tgtGenome, &_downwardPath, _traverseDupes, 0,
+                          _coalescenceLimit, _mrca);
+        }
         if (flip == true) {
             _refSeg->toReverseInPlace();
         }
@@ -109,10 +109,12 @@ void BlockMapper::map() {
 
     if (_mapAdj) {
         assert(_targetReversed == false);
-        MappedSegmentSet::const_iterator i;
-        for (i = _segSet.begin(); i != _segSet.end(); ++i) {
-            if (_adjSet.find(*i) == _adjSet.end()) {
-                mapAdjacencies(i);
+        for (size_t i = 0; i < _segSet.size(); ++i) {
+            MappedSegmentPtr mappedSeg = *(_segSet.begin() + i);
+            if (_adjSet.find(mappedSeg) == _adjSet.end()) {
+                mapAdjacencies(_segSet.begin() + i);
+                // adjacencies inserted to its left move the segment along
+                i = _segSet.find(mappedSeg) - _segSet.begin();
             }
         }
     }
@@ -121,7 +123,7 @@ void BlockMapper::map() {
 void BlockMapper::extractReferenceParalogies(MappedSegmentSet &outParalogies) {
     MappedSegmentSet::iterator i = _segSet.begin();
     MappedSegmentSet::iterator j = _segSet.end();
-    MappedSegmentSet::iterator k;
+    MappedSegmentSet kept;
     hal_index_t iStart = NULL_INDEX;
     hal_index_t iEnd = NULL_INDEX;
     bool iIns = false;
@@ -160,10 +162,7 @@ void BlockMapper::extractReferenceParalogies(MappedSegmentSet &outParalogies) {
                         outParalogies.insert(*i);
                     }
                     outParalogies.insert(*j);
-                    k = j;
-                    ++k;
-                    _segSet.erase(*j);
-                    j = k;
+                    ++j;
                 } else {
                     assert(iStart > jEnd || iEnd < jStart);
                     iStart = NULL_INDEX;
@@ -172,8 +171,10 @@ void BlockMapper::extractReferenceParalogies(MappedSegmentSet &outParalogies) {
                 }
             }
         }
+        kept.insert(*i);
         i = j;
     }
+    _segSet.swap(kept);
 
 #ifndef _NDEBUG
     for (i = _segSet.begin(); i != _segSet.end(); ++i) {
@@ -424,8 +425,9 @@ void BlockMapper::extractSegment(MappedSegmentSet::iterator start, const MappedS
         queryCutPoints.insert(max(fragments.back()->getStartPosition(), fragments.back()->getEndPosition()));
     }
 
-    for (size_t i = 0; i < toErase.size(); ++i) {
-        startSet->erase(toErase[i]);
+    // erase from the right, so the iterators left of each stay valid
+    for (size_t i = toErase.size(); i > 0; --i) {
+        startSet->erase(toErase[i - 1]);
     }
 
     assert(fragments.front()->getSequence() == fragments.back()->getSequence());
@@ -68,6 +68,9 @@ void Liftover::visitLine() {
         return;
     }
 
+    if (_bedLine._end > _bedLine._start) {
+        _srcGenome->prefetchRange(_srcSequence->getStartPosition() + _bedLine._start, _bedLine._end - _bedLine._start);
+    }
     _mappedBlocks.clear();
     if (_bedLine._version <= 9) {
         liftInterval(_mappedBlocks);
@@ -0,0 +1,301 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halLiftoverIndex.h"
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <limits>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using namespace hal;
+
+static const char *const LIFTOVER_INDEX_FORMAT = "HAL liftover index";
+static const uint32_t LIFTOVER_INDEX_VERSION = 1;
+
+/* header flags */
+static const uint32_t INDEX_TRAVERSE_DUPES = 0x1;
+static const uint32_t INDEX_SOURCE_TOP = 0x2;
+
+/* block flags */
+static const uint32_t BLOCK_TARGET_TOP = 0x1;
+static const uint32_t BLOCK_REVERSED = 0x2;
+
+/* the segments mapped from, as BlockLiftover chooses them */
+static bool isSourceTop(const Genome *srcGenome) {
+    return srcGenome->getNumTopSegments() > 0;
+}
+
+static hal_size_t getNumSourceSegments(const Genome *srcGenome) {
+    return isSourceTop(srcGenome) ? srcGenome->getNumTopSegments() : srcGenome->getNumBottomSegments();
+}
+
+/* the coalescence limit used when none is given: the MRCA */
+static const Genome *getCoalescenceLimit(const Genome *srcGenome, const Genome *tgtGenome,
+                                         const Genome *coalescenceLimit) {
+    if (coalescenceLimit != NULL) {
+        return coalescenceLimit;
+    }
+    set<const Genome *> inputSet;
+    inputSet.insert(srcGenome);
+    inputSet.insert(tgtGenome);
+    return getLowestCommonAncestor(inputSet);
+}
+
+void LiftoverIndex::build(const Genome *srcGenome, const Genome *tgtGenome, bool traverseDupes,
+                          const Genome *coalescenceLimit, const string &indexPath) {
+    set<const Genome *> inputSet;
+    inputSet.insert(srcGenome);
+    inputSet.insert(tgtGenome);
+    const Genome *mrca = getLowestCommonAncestor(inputSet);
+    coalescenceLimit = getCoalescenceLimit(srcGenome, tgtGenome, coalescenceLimit);
+    inputSet.clear();
+    inputSet.insert(coalescenceLimit);
+    inputSet.insert(tgtGenome);
+    set<const Genome *> downwardPath;
+    getGenomesInSpanningTree(inputSet, downwardPath);
+
+    ofstream indexFile(indexPath.c_str(), ios::out | ios::binary | ios::trunc);
+    if (!indexFile) {
+        throw hal_errno_exception(indexPath, "open failed", errno);
+    }
+    LiftoverIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    strncpy(header.format, LIFTOVER_INDEX_FORMAT, sizeof(header.format) - 1);
+    header.version = LIFTOVER_INDEX_VERSION;
+    header.flags = (traverseDupes ? INDEX_TRAVERSE_DUPES : 0) | (isSourceTop(srcGenome) ? INDEX_SOURCE_TOP : 0);
+    header.srcGenomeLength = srcGenome->getSequenceLength();
+    header.srcNumSegments = getNumSourceSegments(srcGenome);
+    header.tgtGenomeLength = tgtGenome->getSequenceLength();
+    header.tgtNumTopSegments = tgtGenome->getNumTopSegments();
+    header.tgtNumBottomSegments = tgtGenome->getNumBottomSegments();
+
+    // names, then the blocks aligned to 8 bytes
+    string names = srcGenome->getName() + '\0' + tgtGenome->getName() + '\0' + coalescenceLimit->getName() + '\0';
+    names.resize(((sizeof(header) + names.size() + 7) / 8) * 8 - sizeof(header), '\0');
+    header.blocksOffset = sizeof(header) + names.size();
+    indexFile.write((const char *)&header, sizeof(header));
+    indexFile.write(names.data(), names.size());
+
+    // the mappings of each segment, which come sorted by source
+    SegmentMapper mapper;
+    static const hal_size_t segmentsPerRun = 4096;
+    for (hal_size_t first = 0; first < header.srcNumSegments; first += segmentsPerRun) {
+        hal_size_t numSegments = min(segmentsPerRun, header.srcNumSegments - first);
+        mapper.mapSegments(srcGenome, isSourceTop(srcGenome), first, numSegments, tgtGenome, &downwardPath,
+                           traverseDupes, 0, coalescenceLimit, mrca);
+        for (const SegmentMapping &mapping : mapper.getMappings()) {
+            if (mapping._source.getLength() > numeric_limits<uint32_t>::max()) {
+                throw hal_exception("segment too long for liftover index");
+            }
+            LiftoverIndexBlock block;
+            block.srcStart = mapping._source.getMinPosition();
+            block.tgtStart = mapping._target.getMinPosition();
+            block.tgtArrayIndex = mapping._target._arrayIndex;
+            block.length = mapping._source.getLength();
+            block.flags = (mapping._target._top ? BLOCK_TARGET_TOP : 0) |
+                          (mapping._source._reversed != mapping._target._reversed ? BLOCK_REVERSED : 0);
+            indexFile.write((const char *)&block, sizeof(block));
+            ++header.numBlocks;
+        }
+    }
+
+    indexFile.seekp(0);
+    indexFile.write((const char *)&header, sizeof(header));
+    indexFile.close();
+    if (!indexFile) {
+        throw hal_errno_exception(indexPath, "write failed", errno);
+    }
+}
+
+LiftoverIndex::LiftoverIndex(const string &indexPath) : _indexPath(indexPath), _basePtr(NULL), _fileSize(0) {
+    int fd = ::open(indexPath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw hal_errno_exception(indexPath, "open failed", errno);
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) < 0) {
+        int errnum = errno;
+        ::close(fd);
+        throw hal_errno_exception(indexPath, "stat failed", errnum);
+    }
+    _fileSize = fileStat.st_size;
+    if (_fileSize < sizeof(LiftoverIndexHeader)) {
+        ::close(fd);
+        throw hal_exception(indexPath + ": not a liftover index");
+    }
+    void *ptr = mmap(NULL, _fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    int errnum = errno;
+    ::close(fd);
+    if (ptr == MAP_FAILED) {
+        throw hal_errno_exception(indexPath, "mmap failed", errnum);
+    }
+    _basePtr = ptr;
+
+    _header = (const LiftoverIndexHeader *)_basePtr;
+    if (strncmp(_header->format, LIFTOVER_INDEX_FORMAT, sizeof(_header->format)) != 0) {
+        munmap(const_cast<void *>(_basePtr), _fileSize);
+        throw hal_exception(indexPath + ": not a liftover index");
+    }
+    if ((_header->version != LIFTOVER_INDEX_VERSION) || (_header->blocksOffset < sizeof(LiftoverIndexHeader)) ||
+        (_header->blocksOffset > _fileSize) ||
+        (_header->numBlocks != (_fileSize - _header->blocksOffset) / sizeof(LiftoverIndexBlock)) ||
+        ((_fileSize - _header->blocksOffset) % sizeof(LiftoverIndexBlock) != 0)) {
+        munmap(const_cast<void *>(_basePtr), _fileSize);
+        throw hal_exception(indexPath + ": unsupported version or truncated liftover index");
+    }
+    // the names are between the header and the blocks
+    const char *names = (const char *)_basePtr + sizeof(LiftoverIndexHeader);
+    const char *namesEnd = (const char *)_basePtr + _header->blocksOffset;
+    string *nameFields[] = {&_srcGenomeName, &_tgtGenomeName, &_coalescenceLimitName};
+    for (string *name : nameFields) {
+        const char *nameEnd = (const char *)memchr(names, '\0', namesEnd - names);
+        if (nameEnd == NULL) {
+            munmap(const_cast<void *>(_basePtr), _fileSize);
+            throw hal_exception(indexPath + ": corrupt liftover index, genome names not terminated");
+        }
+        name->assign(names, nameEnd);
+        names = nameEnd + 1;
+    }
+    _blocks = (const LiftoverIndexBlock *)((const char *)_basePtr + _header->blocksOffset);
+}
+
+LiftoverIndex::~LiftoverIndex() {
+    munmap(const_cast<void *>(_basePtr), _fileSize);
+}
+
+void LiftoverIndex::check(const Genome *srcGenome, const Genome *tgtGenome, bool traverseDupes,
+                          const Genome *coalescenceLimit) const {
+    if ((srcGenome->getName() != _srcGenomeName) || (tgtGenome->getName() != _tgtGenomeName)) {
+        throw hal_exception(_indexPath + " is an index from " + _srcGenomeName + " to " + _tgtGenomeName + ", not from " +
+                            srcGenome->getName() + " to " + tgtGenome->getName());
+    }
+    if (getCoalescenceLimit(srcGenome, tgtGenome, coalescenceLimit)->getName() != _coalescenceLimitName) {
+        throw hal_exception(_indexPath + " was built with coalescence limit " + _coalescenceLimitName);
+    }
+    if (traverseDupes != ((_header->flags & INDEX_TRAVERSE_DUPES) != 0)) {
+        throw hal_exception(_indexPath + (traverseDupes ? " was built with --noDupes" : " was built without --noDupes"));
+    }
+    if ((isSourceTop(srcGenome) != ((_header->flags & INDEX_SOURCE_TOP) != 0)) ||
+        (srcGenome->getSequenceLength() != _header->srcGenomeLength) ||
+        (getNumSourceSegments(srcGenome) != _header->srcNumSegments) ||
+        (tgtGenome->getSequenceLength() != _header->tgtGenomeLength) ||
+        (tgtGenome->getNumTopSegments() != _header->tgtNumTopSegments) ||
+        (tgtGenome->getNumBottomSegments() != _header->tgtNumBottomSegments)) {
+        throw hal_exception(_indexPath + " was built from a different alignment");
+    }
+}
+
+namespace {
+    /* a block cut to the part of a source slice it covers */
+    struct SlicedBlock {
+        hal_index_t _srcMin;
+        hal_index_t _srcMax;
+        hal_index_t _tgtMin;
+        hal_index_t _tgtMax;
+        const LiftoverIndexBlock *_block;
+    };
+
+    /* the order halMapSegment() gives its mappings in, by source then
+     * target bounds */
+    bool lessByBounds(const SlicedBlock &b1, const SlicedBlock &b2) {
+        if (b1._srcMin != b2._srcMin) {
+            return b1._srcMin < b2._srcMin;
+        } else if (b1._srcMax != b2._srcMax) {
+            return b1._srcMax < b2._srcMax;
+        } else if (b1._tgtMin != b2._tgtMin) {
+            return b1._tgtMin < b2._tgtMin;
+        }
+        return b1._tgtMax < b2._tgtMax;
+    }
+
+    bool equalBounds(const SlicedBlock &b1, const SlicedBlock &b2) {
+        return not lessByBounds(b1, b2) and not lessByBounds(b2, b1);
+    }
+
+    bool lessBySrcStart(const LiftoverIndexBlock &block, hal_index_t position) {
+        return block.srcStart < position;
+    }
+}
+
+hal_size_t LiftoverIndex::mapSegment(const SegmentIterator *source, const Genome *tgtGenome,
+                                     MappedSegmentSet &outSegments) const {
+    // the slice, and the segment it's in
+    bool flip = source->getReversed();
+    hal_index_t srcMin = min(source->getStartPosition(), source->getEndPosition());
+    hal_index_t srcMax = max(source->getStartPosition(), source->getEndPosition());
+    hal_index_t segStart = srcMin - (hal_index_t)(flip ? source->getEndOffset() : source->getStartOffset());
+    hal_index_t segEnd = srcMax + (hal_index_t)(flip ? source->getStartOffset() : source->getEndOffset());
+
+    // the blocks of the segment start in it
+    vector<SlicedBlock> sliced;
+    const LiftoverIndexBlock *end = _blocks + _header->numBlocks;
+    for (const LiftoverIndexBlock *block = lower_bound(_blocks, end, segStart, lessBySrcStart);
+         block != end && block->srcStart <= srcMax; ++block) {
+        hal_index_t blockMax = block->srcStart + (hal_index_t)block->length - 1;
+        if (blockMax < srcMin) {
+            continue;
+        }
+        SlicedBlock slice;
+        slice._srcMin = max(block->srcStart, srcMin);
+        slice._srcMax = min(blockMax, srcMax);
+        hal_index_t cutLeft = slice._srcMin - block->srcStart;
+        hal_index_t cutRight = blockMax - slice._srcMax;
+        if (block->flags & BLOCK_REVERSED) {
+            swap(cutLeft, cutRight);
+        }
+        slice._tgtMin = block->tgtStart + cutLeft;
+        slice._tgtMax = block->tgtStart + (hal_index_t)block->length - 1 - cutRight;
+        slice._block = block;
+        sliced.push_back(slice);
+    }
+    stable_sort(sliced.begin(), sliced.end(), lessByBounds);
+    sliced.erase(unique(sliced.begin(), sliced.end(), equalBounds), sliced.end());
+
+    for (const SlicedBlock &slice : sliced) {
+        SegmentIteratorPtr srcIt;
+        if (source->isTop()) {
+            srcIt = source->getGenome()->getTopSegmentIterator(source->getArrayIndex());
+        } else {
+            srcIt = source->getGenome()->getBottomSegmentIterator(source->getArrayIndex());
+        }
+        hal_offset_t leftOffset = slice._srcMin - segStart;
+        hal_offset_t rightOffset = segEnd - slice._srcMax;
+        if (flip) {
+            srcIt->toReverse();
+            srcIt->slice(rightOffset, leftOffset);
+        } else {
+            srcIt->slice(leftOffset, rightOffset);
+        }
+
+        SegmentIteratorPtr tgtIt;
+        if (slice._block->flags & BLOCK_TARGET_TOP) {
+            tgtIt = tgtGenome->getTopSegmentIterator(slice._block->tgtArrayIndex);
+        } else {
+            tgtIt = tgtGenome->getBottomSegmentIterator(slice._block->tgtArrayIndex);
+        }
+        hal_index_t tgtSegStart = tgtIt->getStartPosition();
+        hal_index_t tgtSegEnd = tgtSegStart + (hal_index_t)tgtIt->getLength() - 1;
+        leftOffset = slice._tgtMin - tgtSegStart;
+        rightOffset = tgtSegEnd - slice._tgtMax;
+        if (((slice._block->flags & BLOCK_REVERSED) != 0) != flip) {
+            tgtIt->toReverse();
+            tgtIt->slice(rightOffset, leftOffset);
+        } else {
+            tgtIt->slice(leftOffset, rightOffset);
+        }
+        outSegments.insertAndBreakOverlaps(MappedSegmentPtr(new MappedSegment(srcIt, tgtIt)));
+    }
+    outSegments.resolve();
+    return sliced.size();
+}
@@ -7,9 +7,11 @@
 
 #include "halBlockLiftover.h"
 #include "halColumnLiftover.h"
+#include "halLiftoverIndex.h"
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <memory>
 
 using namespace std;
 using namespace hal;
@@ -36,6 +38,11 @@ static void initParser(CLParser &optionsParser) {
     optionsParser.addOptionFlag("outPSLWithName", "write output as input BED name followed by PSL line instead of "
                                                   "bed format",
                                 false);
+    optionsParser.addOption("index", "liftover index from srcGenome to tgtGenome,"
+                                     " built by halBuildLiftoverIndex with the same"
+                                     " --noDupes and --coalescenceLimit options, to"
+                                     " look mappings up in rather than computing them",
+                            "");
     optionsParser.setDescription("Map BED genome interval coordinates between "
                                  "two genomes.");
 }
@@ -50,6 +57,7 @@ int main(int argc, char **argv) {
     string tgtGenomeName;
     string tgtBedPath;
     string coalescenceLimitName;
+    string indexPath;
     bool noDupes;
     bool append;
     bool outPSL;
@@ -62,6 +70,7 @@ int main(int argc, char **argv) {
         tgtGenomeName = optionsParser.getArgument<string>("tgtGenome");
         tgtBedPath = optionsParser.getArgument<string>("tgtBed");
         coalescenceLimitName = optionsParser.getOption<string>("coalescenceLimit");
+        indexPath = optionsParser.getOption<string>("index");
         noDupes = optionsParser.getFlag("noDupes");
         append = optionsParser.getFlag("append");
         outPSL = optionsParser.getFlag("outPSL");
@@ -123,7 +132,14 @@ int main(int argc, char **argv) {
             }
         }
 
+        unique_ptr<LiftoverIndex> index;
+        if (indexPath != "") {
+            index.reset(new LiftoverIndex(indexPath));
+            index->check(srcGenome, tgtGenome, !noDupes, coalescenceLimit);
+        }
+
         BlockLiftover liftover;
+        liftover.setIndex(index.get());
         liftover.convert(alignment.get(), srcGenome, srcBedPtr, tgtGenome, tgtBedPtr, false,
                          !noDupes, outPSL, outPSLWithName, coalescenceLimit);
 
@@ -130,7 +130,7 @@ void WiggleLiftover::mapSegment() {
     set<hal_index_t> queryCutSet;
     set<hal_index_t> targetCutSet;
 
-    for (std::set<MappedSegmentPtr>::iterator i = _mappedSegments.begin(); i != _mappedSegments.end(); ++i) {
+    for (MappedSegmentSet::iterator i = _mappedSegments.begin(); i != _mappedSegments.end(); ++i) {
         BlockMapper::extractSegment(i, emptySet, fragments, &_mappedSegments, targetCutSet, queryCutSet);
         mapFragments(fragments);
     }
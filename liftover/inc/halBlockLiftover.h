@@ -15,12 +15,20 @@
 #include <vector>
 
 namespace hal {
+    class LiftoverIndex;
 
     class BlockLiftover : public Liftover {
       public:
         BlockLiftover();
         virtual ~BlockLiftover();
 
+        /** Get the mappings of the source segments from an index rather
+         * than with halMapSegment().  The index must have been built for
+         * the genomes and options given to convert(). */
+        void setIndex(const LiftoverIndex *index) {
+            _index = index;
+        }
+
       protected:
         void liftInterval(BedList &mappedBedLines);
         void visitBegin();
@@ -34,6 +42,7 @@ namespace hal {
         hal_index_t _lastIndex;
         std::set<const Genome *> _downwardPath;
         const Genome *_mrca;
+        const LiftoverIndex *_index;
     };
 }
 #endif
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HALLIFTOVERINDEX_H
+#define _HALLIFTOVERINDEX_H
+
+#include "hal.h"
+#include <cstdint>
+#include <string>
+
+namespace hal {
+
+    /* header of a liftover index file, followed by the source, target and
+     * coalescence limit genome names (each NUL-terminated), then by the
+     * blocks, from blocksOffset */
+    struct LiftoverIndexHeader {
+        char format[32];
+        uint32_t version;
+        uint32_t flags;
+        uint64_t numBlocks;
+        uint64_t blocksOffset;
+        uint64_t srcGenomeLength;
+        uint64_t srcNumSegments;
+        uint64_t tgtGenomeLength;
+        uint64_t tgtNumTopSegments;
+        uint64_t tgtNumBottomSegments;
+    };
+
+    /* a mapping of part of a source segment to a target segment slice of
+     * the same length, in genome coordinates */
+    struct LiftoverIndexBlock {
+        hal_index_t srcStart;
+        hal_index_t tgtStart; // leftmost target position
+        hal_index_t tgtArrayIndex;
+        uint32_t length;
+        uint32_t flags;
+    };
+
+    /**
+     * The mappings halMapSegment() finds from every segment of a source
+     * genome to a target genome, precomputed by
+     * halBuildLiftoverIndex and stored as a table of blocks sorted by
+     * source position.  The file is mapped into memory, and a slice of a
+     * source segment is mapped by finding the blocks of its segment with a
+     * binary search and slicing them, without walking the tree.
+     *
+     * The index depends on the genomes and options it was built for: it
+     * is only valid for the same alignment, genomes, coalescence limit
+     * and following of paralogies.
+     */
+    class LiftoverIndex {
+      public:
+        /** Map every segment of a source genome and write the index to
+         * a file.  Arguments as for BlockLiftover. */
+        static void build(const Genome *srcGenome, const Genome *tgtGenome, bool traverseDupes,
+                          const Genome *coalescenceLimit, const std::string &indexPath);
+
+        /** Map an index file into memory */
+        LiftoverIndex(const std::string &indexPath);
+        ~LiftoverIndex();
+
+        /** Throw an exception unless the index was built for these
+         * genomes and options */
+        void check(const Genome *srcGenome, const Genome *tgtGenome, bool traverseDupes,
+                   const Genome *coalescenceLimit) const;
+
+        hal_size_t getNumBlocks() const {
+            return _header->numBlocks;
+        }
+
+        /** Get the mappings of a slice of a source segment, as
+         * halMapSegment(source, outSegments, tgtGenome, ...) would with the
+         * options of the index.  Returns the number of mappings. */
+        hal_size_t mapSegment(const SegmentIterator *source, const Genome *tgtGenome,
+                              MappedSegmentSet &outSegments) const;
+
+      private:
+        LiftoverIndex(const LiftoverIndex &);
+        LiftoverIndex &operator=(const LiftoverIndex &);
+
+        std::string _indexPath;
+        const void *_basePtr;
+        size_t _fileSize;
+        const LiftoverIndexHeader *_header;
+        std::string _srcGenomeName;
+        std::string _tgtGenomeName;
+        std::string _coalescenceLimitName;
+        const LiftoverIndexBlock *_blocks;
+    };
+}
+#endif
+// Local Variables:
+// mode: c++
+// End:
@@ -35,6 +35,7 @@ void MafExport::convertSequence(ostream &mafStream, AlignmentConstPtr alignment,
         throw hal_exception("Cannot convert zero length sequence");
     }
     hal_index_t lastPosition = startPosition + (hal_index_t)(length - 1);
+    seq->getGenome()->prefetchRange(seq->getStartPosition() + startPosition, length);
 
     _mafStream = &mafStream;
     _alignment = alignment;
@@ -29,7 +29,7 @@ string BranchMutations::substitutionBedTag(char parent, char child) {
     return string("S_") + parent + child;
 }
 
-BranchMutations::BranchMutations() {
+BranchMutations::BranchMutations() : _readColumns(false) {
 }
 
 BranchMutations::~BranchMutations() {
@@ -64,6 +64,12 @@ void BranchMutations::analyzeBranch(AlignmentConstPtr alignment, hal_size_t gapT
 
     hal_index_t end = startPosition + (hal_index_t)length - 1;
 
+    _readColumns = _columnReader.open(reference) && _parentColumnReader.open(reference->getParent());
+    if (not _readColumns) {
+        _virtualReader.open(reference);
+        _parentVirtualReader.open(reference->getParent());
+    }
+
     _top = reference->getTopSegmentIterator();
     _top->toSite(startPosition);
     _bottom1 = reference->getParent()->getBottomSegmentIterator();
@@ -147,27 +153,80 @@ void BranchMutations::writeInsertionOrInversion() {
     *_refStream << _parName << '\t' << _refName << '\n';
 }
 
+namespace {
+    /* a slice of a top segment, moved as TopSegmentIterator::toRight()
+     * moves an iterator that is not reversed */
+    struct TopSlice {
+        hal_index_t _index;
+        hal_offset_t _startOffset;
+        hal_offset_t _endOffset;
+
+        template <class Reader> void toRight(const Reader &reader) {
+            if (_endOffset == 0) {
+                ++_index;
+                _startOffset = 0;
+            } else {
+                _startOffset = reader.getTopLength(_index) - _endOffset;
+                _endOffset = 0;
+            }
+        }
+    };
+
+    TopSlice getTopSlice(const TopSegmentIteratorPtr &topIt) {
+        assert(topIt->getReversed() == false);
+        TopSlice slice;
+        slice._index = topIt->getArrayIndex();
+        slice._startOffset = topIt->getStartOffset();
+        slice._endOffset = topIt->getEndOffset();
+        return slice;
+    }
+}
+
 void BranchMutations::writeSubstitutions(TopSegmentIteratorPtr first, TopSegmentIteratorPtr lastPlusOne) {
     if (_snpStream == NULL) {
         return;
     }
+    if (_readColumns) {
+        writeSubstitutions(_columnReader, _parentColumnReader, first, lastPlusOne->getArrayIndex());
+    } else {
+        writeSubstitutions(_virtualReader, _parentVirtualReader, first, lastPlusOne->getArrayIndex());
+    }
+}
+
+template <class Reader>
+void BranchMutations::writeSubstitutions(const Reader &reader, const Reader &parentReader, TopSegmentIteratorPtr first,
+                                         hal_index_t endIndex) {
+    const Genome *parent = _reference->getParent();
+    PackedDnaSpan span;
     string tstring, bstring;
     hal_size_t pos;
-    _top->copy(first);
-    hal_index_t endIndex = lastPlusOne->getArrayIndex();
-    assert(_top->getReversed() == false);
+    TopSlice top = getTopSlice(first);
     do {
-        if (_top->tseg()->hasParent()) {
+        hal_index_t parentIndex = reader.getTopParentIndex(top._index);
+        if (parentIndex != NULL_INDEX) {
+            hal_index_t segmentStart = reader.getTopStartPosition(top._index);
+            hal_size_t length = reader.getTopLength(top._index) - top._startOffset - top._endOffset;
             if (_refStream == NULL && _parentStream == NULL) {
-                _sequence = _top->getSequence();
+                _sequence = _reference->getSequenceBySite(segmentStart);
+            }
+            hal_index_t start = segmentStart + (hal_index_t)top._startOffset;
+            _reference->getPackedDna(span, start, length);
+            span.unpack(tstring);
+
+            // the homologous slice of the parent, as BottomSegmentIterator::toParent()
+            // gives it
+            hal_index_t parentStart = parentReader.getBottomStartPosition(parentIndex);
+            if (reader.getTopParentReversed(top._index)) {
+                parent->getPackedDna(span, parentStart + (hal_index_t)top._endOffset, length);
+                span.unpackReverseComplement(bstring);
+            } else {
+                parent->getPackedDna(span, parentStart + (hal_index_t)top._startOffset, length);
+                span.unpack(bstring);
             }
-            _bottom1->toParent(_top);
-            _top->getString(tstring);
-            _bottom1->getString(bstring);
             assert(tstring.length() == bstring.length());
 
             for (hal_index_t i = 0; i < (hal_index_t)tstring.length(); ++i) {
-                pos = i + _top->getStartPosition();
+                pos = i + start;
                 char c = fastUpper(tstring[i]);
                 char p = fastUpper(bstring[i]);
 
@@ -178,20 +237,30 @@ void BranchMutations::writeSubstitutions(TopSegmentIteratorPtr first, TopSegment
                 }
             }
         }
-        _top->toRight();
-    } while (_top->getArrayIndex() < endIndex);
+        top.toRight(reader);
+    } while (top._index < endIndex);
 }
 
 void BranchMutations::writeGapInsertions() {
     if (_refStream == NULL) {
         return;
     }
+    if (_readColumns) {
+        writeGapInsertions(_columnReader);
+    } else {
+        writeGapInsertions(_virtualReader);
+    }
+}
+
+template <class Reader> void BranchMutations::writeGapInsertions(const Reader &reader) {
     hal_size_t startPos, endPos;
-    _top->copy(_rearrangement->getLeftBreakpoint());
+    TopSlice top = getTopSlice(_rearrangement->getLeftBreakpoint());
+    hal_index_t endIndex = _rearrangement->getRightBreakpoint()->getArrayIndex();
     do {
-        if (_top->tseg()->hasParent() == false && _top->getLength() <= _maxGap) {
-            startPos = _top->getStartPosition();
-            endPos = _top->getEndPosition();
+        hal_size_t length = reader.getTopLength(top._index) - top._startOffset - top._endOffset;
+        if (reader.getTopParentIndex(top._index) == NULL_INDEX && length <= _maxGap) {
+            startPos = reader.getTopStartPosition(top._index) + top._startOffset;
+            endPos = startPos + length - 1;
 
             if (startPos < _start) {
                 startPos = _start;
@@ -205,8 +274,8 @@ void BranchMutations::writeGapInsertions() {
                             << '\t' << _refName << '\n';
             }
         }
-        _top->toRight();
-    } while (_top->getArrayIndex() < _rearrangement->getRightBreakpoint()->getArrayIndex());
+        top.toRight(reader);
+    } while (top._index < endIndex);
 }
 
 void BranchMutations::writeDeletion() {
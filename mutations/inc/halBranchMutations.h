@@ -39,7 +39,11 @@ namespace hal {
       protected:
         void writeInsertionOrInversion();
         void writeSubstitutions(TopSegmentIteratorPtr first, TopSegmentIteratorPtr lastPlusOne);
+        template <class Reader>
+        void writeSubstitutions(const Reader &reader, const Reader &parentReader, TopSegmentIteratorPtr first,
+                                hal_index_t endIndex);
         void writeGapInsertions();
+        template <class Reader> void writeGapInsertions(const Reader &reader);
         void writeDeletion();
         void writeDeletionBreakPoint();
         void writeDuplication();
@@ -63,6 +67,12 @@ namespace hal {
         RearrangementPtr _rearrangement;
         TopSegmentIteratorPtr _top;
         BottomSegmentIteratorPtr _bottom1, _bottom2;
+
+        // segments of the reference and its parent, read in place when
+        // possible
+        bool _readColumns;
+        ColumnSegmentReader _columnReader, _parentColumnReader;
+        VirtualSegmentReader _virtualReader, _parentVirtualReader;
     };
 }
 
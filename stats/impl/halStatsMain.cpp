@@ -279,17 +279,16 @@ int main(int argc, char **argv) {
 }
 
 void printGenomes(ostream &os, const Alignment *alignment) {
-    const Genome *root = alignment->openGenome(alignment->getRootName());
-    set<const Genome *> genomes;
-    getGenomesInSubTree(root, genomes);
-    genomes.insert(root);
-    for (set<const Genome *>::iterator i = genomes.begin(); i != genomes.end(); ++i) {
-        set<const Genome *>::iterator next = i;
-        ++next;
-        os << (*i)->getName();
-        if (next != genomes.end()) {
-            os << " ";
-        }
+    // walk the tree by name (pre-order) so that no genomes need to be opened
+    vector<string> stack(1, alignment->getRootName());
+    bool first = true;
+    while (!stack.empty()) {
+        string name = stack.back();
+        stack.pop_back();
+        os << (first ? "" : " ") << name;
+        first = false;
+        vector<string> childNames = alignment->getChildNames(name);
+        stack.insert(stack.end(), childNames.rbegin(), childNames.rend());
     }
     os << endl;
 }